@@ -1,5 +1,10 @@
 PREFIX = /usr/local
 INCPREFIX = $(PREFIX)/include
 
+# Keep counters of the work done by the library, see `struct dulcet_stats`. Removing this makes
+# them compile to nothing.
+CPPFLAGS = -DDULCET_STATS
+
 CFLAGS = -std=c11 -Os -Wall -Wextra -Wpedantic
 LDFLAGS = -s
+LDLIBS = -lpthread
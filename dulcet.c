@@ -4,60 +4,494 @@
  * SPDX-License-Identifier: BSD-2-Clause
  */
 
+#define _POSIX_C_SOURCE 200809L
+
 #include <assert.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
 
 #include "dulcet.h"
 
-struct dulcet_term *dulcet_alloc_var(unsigned int index)
+static inline unsigned long long __dulcet_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (unsigned long long) ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+#ifdef DULCET_STATS
+static _Thread_local struct dulcet_stats __dulcet_stats;
+
+// Strategy of the reducer that was called from outside of the library, to which its steps count
+static _Thread_local enum dulcet_strategy __dulcet_strategy = DULCET_STRATEGY_NONE;
+
+// Current depth of recursion within the library
+static _Thread_local unsigned long long __dulcet_depth;
+
+#define __DULCET_STATS(statement) \
+	do {                      \
+		statement;        \
+	} while (0)
+
+static inline void __dulcet_stats_enter(void)
+{
+	__dulcet_depth += 1;
+	if (__dulcet_depth > __dulcet_stats.max_depth) {
+		__dulcet_stats.max_depth = __dulcet_depth;
+	}
+}
+
+static inline void __dulcet_stats_leave(void)
+{
+	__dulcet_depth -= 1;
+}
+#else
+#define __DULCET_STATS(statement) \
+	do {                      \
+	} while (0)
+#endif
+
+int dulcet_stats_enabled(void)
+{
+#ifdef DULCET_STATS
+	return 1;
+#else
+	return 0;
+#endif
+}
+
+void dulcet_stats_get(struct dulcet_stats *stats)
+{
+#ifdef DULCET_STATS
+	*stats = __dulcet_stats;
+#else
+	*stats = (struct dulcet_stats) { 0 };
+#endif
+}
+
+// Term nodes allocated minus those freed by the calling thread, which may free nodes allocated by
+// another, for the memory limit of the reducers and the peak of the stats
+static _Thread_local long long __dulcet_live_nodes;
+
+void dulcet_stats_reset(void)
+{
+#ifdef DULCET_STATS
+	// Nodes allocated before the reset and still alive count toward the new peak, though not
+	// toward the nodes allocated since
+	__dulcet_stats = (struct dulcet_stats) { 0 };
+	__dulcet_stats.peak_live_nodes = __dulcet_live_nodes > 0 ? __dulcet_live_nodes : 0;
+#endif
+}
+
+void dulcet_stats_add_time(enum dulcet_phase phase, unsigned long long ns)
+{
+	(void) phase;
+	(void) ns;
+
+	__DULCET_STATS(__dulcet_stats.phase_ns[phase] += ns);
+}
+
+unsigned long long dulcet_stats_time(void)
+{
+#ifdef DULCET_STATS
+	return __dulcet_now();
+#else
+	return 0;
+#endif
+}
+
+// Allocator of the context in use by the calling thread, if any, or else the C library's. Within
+// a context, freed nodes are kept on a list through their `app.m` to be allocated again.
+static _Thread_local struct dulcet_allocator __dulcet_allocator;
+static _Thread_local int __dulcet_cache_nodes;
+static _Thread_local struct dulcet_term *__dulcet_node_cache;
+static _Thread_local unsigned long long __dulcet_cached_nodes;
+// Bytes of the blocks of the images loaded with the allocator above, and not yet unloaded
+static _Thread_local unsigned long long __dulcet_image_bytes;
+
+static _Thread_local dulcet_error_handler __dulcet_error_handler;
+static _Thread_local void *__dulcet_error_handler_data;
+static _Thread_local const char *__dulcet_error;
+
+static _Noreturn void __dulcet_fatal(const char *error);
+
+static inline struct dulcet_term *__dulcet_node_alloc(void)
 {
-	struct dulcet_term *t = malloc(sizeof(*t));
-	t->kind = DULCET_TERM_KIND_VAR;
-	t->var = (struct dulcet_var) { index };
+	struct dulcet_term *t = __dulcet_node_cache;
+
+	if (t) {
+		__dulcet_node_cache = t->app.m;
+		__dulcet_cached_nodes -= 1;
+	} else {
+		t = __dulcet_allocator.alloc
+			    ? __dulcet_allocator.alloc(__dulcet_allocator.data, sizeof(*t))
+			    : malloc(sizeof(*t));
+		if (!t) {
+			__dulcet_fatal("out of memory");
+		}
+	}
+
+	__dulcet_live_nodes += 1;
+
+	__DULCET_STATS({
+		__dulcet_stats.nodes_allocated += 1;
+
+		if (__dulcet_live_nodes > 0 &&
+		    (unsigned long long) __dulcet_live_nodes > __dulcet_stats.peak_live_nodes) {
+			__dulcet_stats.peak_live_nodes = __dulcet_live_nodes;
+		}
+	});
 
 	return t;
 }
 
+static inline void __dulcet_node_free(struct dulcet_term *t)
+{
+	__dulcet_live_nodes -= 1;
+
+	__DULCET_STATS(__dulcet_stats.nodes_freed += 1);
+
+	if (__dulcet_cache_nodes) {
+		t->app.m = __dulcet_node_cache;
+		__dulcet_node_cache = t;
+		__dulcet_cached_nodes += 1;
+	} else if (__dulcet_allocator.free) {
+		__dulcet_allocator.free(__dulcet_allocator.data, t, sizeof(*t));
+	} else {
+		free(t);
+	}
+}
+
+// Variables are immediates rather than nodes: the index shifted left, with the lowest bit set,
+// which no node has as they are aligned. Only the nodes reduced in place to a variable hold one,
+// and, where pointers are too narrow, variables of the largest indices.
+#define __DULCET_IMMEDIATE(t) ((uintptr_t) (t) & 1)
+
+#define __DULCET_KIND(t) (__DULCET_IMMEDIATE(t) ? DULCET_TERM_KIND_VAR : (t)->kind)
+
+#define __DULCET_INDEX(t) \
+	(__DULCET_IMMEDIATE(t) ? (unsigned int) ((uintptr_t) (t) >> 1) : (t)->var.index)
+
+struct dulcet_term *dulcet_alloc_var(unsigned int index)
+{
+#if UINT_MAX > UINTPTR_MAX >> 1
+	if (index > UINTPTR_MAX >> 1) {
+		struct dulcet_term *t = __dulcet_node_alloc();
+		t->kind = DULCET_TERM_KIND_VAR;
+		t->var = (struct dulcet_var) { index };
+
+		return t;
+	}
+#endif
+
+	return (struct dulcet_term *) (((uintptr_t) index << 1) | 1);
+}
+
+// Renumbers the variable `*t`, in the node that holds it, if any, or in the pointer to it
+static inline void __dulcet_set_index(struct dulcet_term **t, unsigned int index)
+{
+	if (__DULCET_IMMEDIATE(*t)) {
+		*t = dulcet_alloc_var(index);
+	} else {
+		(*t)->var.index = index;
+	}
+}
+
+// Moves the term `s` into the node `t`, whose contents are dropped
+static inline void __dulcet_move(struct dulcet_term *t, struct dulcet_term *s)
+{
+	if (__DULCET_IMMEDIATE(s)) {
+		t->kind = DULCET_TERM_KIND_VAR;
+		t->var = (struct dulcet_var) { __DULCET_INDEX(s) };
+	} else {
+		*t = *s;
+		__dulcet_node_free(s);
+	}
+}
+
+enum dulcet_term_kind dulcet_term_kind(const struct dulcet_term *t)
+{
+	assert(t);
+
+	return __DULCET_KIND(t);
+}
+
+unsigned int dulcet_var_index(const struct dulcet_term *t)
+{
+	assert(t && __DULCET_KIND(t) == DULCET_TERM_KIND_VAR);
+
+	return __DULCET_INDEX(t);
+}
+
 struct dulcet_term *dulcet_alloc_abs(struct dulcet_term *m)
 {
-	struct dulcet_term *t = malloc(sizeof(*t));
+	struct dulcet_term *t = __dulcet_node_alloc();
 	t->kind = DULCET_TERM_KIND_ABS;
-	t->abs = (struct dulcet_abs) { m };
+	t->abs = (struct dulcet_abs) { m, 0 };
 
 	return t;
 }
 
 struct dulcet_term *dulcet_alloc_app(struct dulcet_term *m, struct dulcet_term *n)
 {
-	struct dulcet_term *t = malloc(sizeof(*t));
+	struct dulcet_term *t = __dulcet_node_alloc();
 	t->kind = DULCET_TERM_KIND_APP;
 	t->app = (struct dulcet_app) { m, n };
 
 	return t;
 }
 
+struct dulcet_term *dulcet_alloc_int(long long value)
+{
+	struct dulcet_term *t = __dulcet_node_alloc();
+	t->kind = DULCET_TERM_KIND_INT;
+	t->integer = (struct dulcet_int) { value };
+
+	return t;
+}
+
+struct dulcet_term *dulcet_alloc_bool(int value)
+{
+	struct dulcet_term *t = __dulcet_node_alloc();
+	t->kind = DULCET_TERM_KIND_BOOL;
+	t->boolean = (struct dulcet_bool) { value != 0 };
+
+	return t;
+}
+
+struct dulcet_term *dulcet_alloc_prim(enum dulcet_prim_op op)
+{
+	assert(op < DULCET_PRIM_OP_COUNT);
+
+	struct dulcet_term *t = __dulcet_node_alloc();
+	t->kind = DULCET_TERM_KIND_PRIM;
+	t->prim = (struct dulcet_prim) { op };
+
+	return t;
+}
+
+static const struct {
+	const char *name;
+	unsigned int arity;
+} __dulcet_prims[DULCET_PRIM_OP_COUNT] = {
+	[DULCET_PRIM_OP_ADD] = { "+", 2 },
+	[DULCET_PRIM_OP_SUB] = { "-", 2 },
+	[DULCET_PRIM_OP_MUL] = { "*", 2 },
+	[DULCET_PRIM_OP_DIV] = { "/", 2 },
+	[DULCET_PRIM_OP_EQ] = { "=", 2 },
+	[DULCET_PRIM_OP_LT] = { "<", 2 },
+	[DULCET_PRIM_OP_IF] = { "if", 3 },
+};
+
+// No primitive takes more arguments than this
+#define __DULCET_PRIM_MAX_ARITY 3
+
+const char *dulcet_prim_name(enum dulcet_prim_op op)
+{
+	assert(op < DULCET_PRIM_OP_COUNT);
+
+	return __dulcet_prims[op].name;
+}
+
+unsigned int dulcet_prim_arity(enum dulcet_prim_op op)
+{
+	assert(op < DULCET_PRIM_OP_COUNT);
+
+	return __dulcet_prims[op].arity;
+}
+
+// Allocated as a node, and freed along with its term by whichever thread drops the last reference.
+// A term borrowed from a caller, see `dulcet_beta_nor_shared`, is left to it instead, and may have
+// free variables bound where the references to it are, which must then be instantiated before
+// anything renumbers them.
+struct dulcet_shared {
+	atomic_ulong refs;
+	struct dulcet_term *m;
+	unsigned int normal : 1;
+	unsigned int borrowed : 1;
+	unsigned int open : 1;
+};
+
+static_assert(sizeof(struct dulcet_shared) <= sizeof(struct dulcet_term),
+	      "shared terms must fit in a node");
+
+static inline const struct dulcet_term *__dulcet_deref(const struct dulcet_term *t)
+{
+	while (__DULCET_KIND(t) == DULCET_TERM_KIND_REF) {
+		t = t->ref.shared->m;
+	}
+
+	return t;
+}
+
+static void __dulcet_shared_release(struct dulcet_shared *shared)
+{
+	if (atomic_fetch_sub_explicit(&shared->refs, 1, memory_order_acq_rel) == 1) {
+		if (!shared->borrowed) {
+			dulcet_term_free(shared->m);
+		}
+		__dulcet_node_free((struct dulcet_term *) shared);
+	}
+}
+
+// Returns the primitive that an application of `m` applies to all of its arguments, if any, which
+// it contracts once they turn out to be of the right kinds. Only a few heads are looked at.
+static const struct dulcet_term *__dulcet_delta_prim(const struct dulcet_term *m)
+{
+	for (unsigned int arguments = 1; arguments <= __DULCET_PRIM_MAX_ARITY; ++arguments) {
+		m = __dulcet_deref(m);
+
+		if (__DULCET_KIND(m) == DULCET_TERM_KIND_PRIM) {
+			return __dulcet_prims[m->prim.op].arity == arguments ? m : NULL;
+		}
+
+		if (__DULCET_KIND(m) != DULCET_TERM_KIND_APP) {
+			return NULL;
+		}
+
+		m = m->app.m;
+	}
+
+	return NULL;
+}
+
+static int __dulcet_term_closed_at(const struct dulcet_term *t, unsigned int depth)
+{
+	switch (__DULCET_KIND(t)) {
+	case DULCET_TERM_KIND_VAR:
+		return __DULCET_INDEX(t) <= depth;
+	case DULCET_TERM_KIND_ABS:
+		return __dulcet_term_closed_at(t->abs.m, depth + 1);
+	case DULCET_TERM_KIND_APP:
+		return __dulcet_term_closed_at(t->app.m, depth) &&
+		       __dulcet_term_closed_at(t->app.n, depth);
+	case DULCET_TERM_KIND_REF:
+		return !t->ref.shared->open || __dulcet_term_closed_at(t->ref.shared->m, depth);
+	case DULCET_TERM_KIND_INT:
+	case DULCET_TERM_KIND_BOOL:
+	case DULCET_TERM_KIND_PRIM:
+		return 1;
+	default:
+		__dulcet_fatal("unknown term kind");
+	}
+}
+
+int dulcet_term_closed(const struct dulcet_term *t)
+{
+	assert(t);
+
+	return __dulcet_term_closed_at(t, 0);
+}
+
+static int __dulcet_term_normal(const struct dulcet_term *t)
+{
+	switch (__DULCET_KIND(t)) {
+	case DULCET_TERM_KIND_VAR:
+		return 1;
+	case DULCET_TERM_KIND_ABS:
+		return __dulcet_term_normal(t->abs.m);
+	case DULCET_TERM_KIND_APP: {
+		const struct dulcet_term *m = __dulcet_deref(t->app.m);
+
+		return __DULCET_KIND(m) != DULCET_TERM_KIND_ABS && !__dulcet_delta_prim(m) &&
+		       __dulcet_term_normal(t->app.m) && __dulcet_term_normal(t->app.n);
+	}
+	case DULCET_TERM_KIND_REF:
+		return t->ref.shared->normal;
+	case DULCET_TERM_KIND_INT:
+	case DULCET_TERM_KIND_BOOL:
+	case DULCET_TERM_KIND_PRIM:
+		return 1;
+	default:
+		__dulcet_fatal("unknown term kind");
+	}
+}
+
+static struct dulcet_term *__dulcet_alloc_ref(struct dulcet_term *m, int normal, int borrowed,
+					      int open)
+{
+	struct dulcet_shared *shared = (struct dulcet_shared *) __dulcet_node_alloc();
+	atomic_init(&shared->refs, 1);
+	shared->m = m;
+	shared->normal = normal;
+	shared->borrowed = borrowed;
+	shared->open = open;
+
+	struct dulcet_term *t = __dulcet_node_alloc();
+	t->kind = DULCET_TERM_KIND_REF;
+	t->ref = (struct dulcet_ref) { shared };
+
+	return t;
+}
+
+struct dulcet_term *dulcet_alloc_ref(struct dulcet_term *m)
+{
+	assert(m && dulcet_term_closed(m));
+
+	return __dulcet_alloc_ref(m, __dulcet_term_normal(m), 0, 0);
+}
+
+// Refers to `m`, a subterm of a term of the caller, which has to outlive the reference
+static struct dulcet_term *__dulcet_borrow(const struct dulcet_term *m, int normal, int open)
+{
+	if (__DULCET_KIND(m) == DULCET_TERM_KIND_VAR) {
+		return dulcet_alloc_var(__DULCET_INDEX(m));
+	}
+
+	return __dulcet_alloc_ref((struct dulcet_term *) m, normal, 1, open);
+}
+
 struct dulcet_term *dulcet_term_copy(const struct dulcet_term *t)
 {
 	struct dulcet_term *s;
 
 	assert(t);
 
+	if (__DULCET_IMMEDIATE(t)) {
+		return (struct dulcet_term *) t;
+	}
+
+	__DULCET_STATS({
+		__dulcet_stats.nodes_copied += 1;
+		__dulcet_stats_enter();
+	});
+
 	switch (t->kind) {
 	case DULCET_TERM_KIND_VAR:
 		s = dulcet_alloc_var(t->var.index);
 		break;
 	case DULCET_TERM_KIND_ABS:
 		s = dulcet_alloc_abs(dulcet_term_copy(t->abs.m));
+		s->abs.origin = t->abs.origin;
 		break;
 	case DULCET_TERM_KIND_APP:
 		s = dulcet_alloc_app(dulcet_term_copy(t->app.m), dulcet_term_copy(t->app.n));
 		break;
+	case DULCET_TERM_KIND_REF:
+		atomic_fetch_add_explicit(&t->ref.shared->refs, 1, memory_order_relaxed);
+		s = __dulcet_node_alloc();
+		s->kind = DULCET_TERM_KIND_REF;
+		s->ref = t->ref;
+		break;
+	case DULCET_TERM_KIND_INT:
+	case DULCET_TERM_KIND_BOOL:
+	case DULCET_TERM_KIND_PRIM:
+		s = __dulcet_node_alloc();
+		*s = *t;
+		break;
 	default:
-		fprintf(stderr, "dulcet: fatal error\n");
-		exit(1);
+		__dulcet_fatal("unknown term kind");
 	}
 
+	__DULCET_STATS(__dulcet_stats_leave());
+
 	return s;
 }
 
@@ -65,22 +499,54 @@ void dulcet_term_free(struct dulcet_term *t)
 {
 	assert(t);
 
-	switch (t->kind) {
-	case DULCET_TERM_KIND_VAR:
-		break;
-	case DULCET_TERM_KIND_ABS:
-		dulcet_term_free(t->abs.m);
-		break;
-	case DULCET_TERM_KIND_APP:
-		dulcet_term_free(t->app.m);
-		dulcet_term_free(t->app.n);
-		break;
-	default:
-		fprintf(stderr, "dulcet: fatal error\n");
-		exit(1);
-	}
+	// Right subterms of applications still to be freed are chained through the application
+	// nodes themselves, so that terms of any depth can be freed without recursion
+	struct dulcet_term *pending = NULL;
+
+	while (t) {
+		struct dulcet_term *next;
+
+		switch (__DULCET_KIND(t)) {
+		case DULCET_TERM_KIND_VAR:
+			next = NULL;
+			if (!__DULCET_IMMEDIATE(t)) {
+				__dulcet_node_free(t);
+			}
+			break;
+		case DULCET_TERM_KIND_ABS:
+			next = t->abs.m;
+			__dulcet_node_free(t);
+			break;
+		case DULCET_TERM_KIND_APP:
+			next = t->app.m;
+			t->app.m = pending;
+			pending = t;
+			break;
+		case DULCET_TERM_KIND_REF:
+			next = NULL;
+			__dulcet_shared_release(t->ref.shared);
+			__dulcet_node_free(t);
+			break;
+		case DULCET_TERM_KIND_INT:
+		case DULCET_TERM_KIND_BOOL:
+		case DULCET_TERM_KIND_PRIM:
+			next = NULL;
+			__dulcet_node_free(t);
+			break;
+		default:
+			__dulcet_fatal("unknown term kind");
+		}
 
-	free(t);
+		if (!next && pending) {
+			struct dulcet_term *app = pending;
+
+			pending = app->app.m;
+			next = app->app.n;
+			__dulcet_node_free(app);
+		}
+
+		t = next;
+	}
 }
 
 int dulcet_term_eq(struct dulcet_term *a, struct dulcet_term *b)
@@ -88,13 +554,21 @@ int dulcet_term_eq(struct dulcet_term *a, struct dulcet_term *b)
 	assert(a);
 	assert(b);
 
-	if (a->kind != b->kind) {
+	if (__DULCET_KIND(a) == DULCET_TERM_KIND_REF && __DULCET_KIND(b) == DULCET_TERM_KIND_REF &&
+	    a->ref.shared == b->ref.shared) {
+		return 1;
+	}
+
+	a = (struct dulcet_term *) __dulcet_deref(a);
+	b = (struct dulcet_term *) __dulcet_deref(b);
+
+	if (__DULCET_KIND(a) != __DULCET_KIND(b)) {
 		return 0;
 	}
 
-	switch (a->kind) {
+	switch (__DULCET_KIND(a)) {
 	case DULCET_TERM_KIND_VAR:
-		if (a->var.index != b->var.index) {
+		if (__DULCET_INDEX(a) != __DULCET_INDEX(b)) {
 			return 0;
 		}
 		break;
@@ -108,468 +582,3952 @@ int dulcet_term_eq(struct dulcet_term *a, struct dulcet_term *b)
 			return 0;
 		}
 		break;
+	case DULCET_TERM_KIND_INT:
+		if (a->integer.value != b->integer.value) {
+			return 0;
+		}
+		break;
+	case DULCET_TERM_KIND_BOOL:
+		if (a->boolean.value != b->boolean.value) {
+			return 0;
+		}
+		break;
+	case DULCET_TERM_KIND_PRIM:
+		if (a->prim.op != b->prim.op) {
+			return 0;
+		}
+		break;
 	default:
-		fprintf(stderr, "dulcet: fatal error\n");
-		exit(1);
+		__dulcet_fatal("unknown term kind");
+	}
+
+	return 1;
+}
+
+size_t dulcet_term_size(const struct dulcet_term *t)
+{
+	assert(t);
+
+	// The right-hand sides of the applications on the way down are kept on a stack, so that
+	// arbitrarily deep terms can be measured
+	const struct dulcet_term **stack = NULL;
+	size_t stack_size = 0;
+	size_t stack_capacity = 0;
+	size_t size = 0;
+
+	for (;;) {
+		size += 1;
+
+		switch (__DULCET_KIND(t)) {
+		case DULCET_TERM_KIND_VAR:
+		case DULCET_TERM_KIND_REF:
+		case DULCET_TERM_KIND_INT:
+		case DULCET_TERM_KIND_BOOL:
+		case DULCET_TERM_KIND_PRIM:
+			if (stack_size == 0) {
+				free(stack);
+				return size;
+			}
+			t = stack[--stack_size];
+			break;
+		case DULCET_TERM_KIND_ABS:
+			t = t->abs.m;
+			break;
+		case DULCET_TERM_KIND_APP:
+			if (stack_size == stack_capacity) {
+				stack_capacity = stack_capacity ? 2 * stack_capacity : 64;
+				stack = realloc(stack, stack_capacity * sizeof(*stack));
+				if (!stack) {
+					__dulcet_fatal("out of memory");
+				}
+			}
+			stack[stack_size++] = t->app.n;
+			t = t->app.m;
+			break;
+		default:
+			__dulcet_fatal("unknown term kind");
+		}
+	}
+}
+
+struct dulcet_term *dulcet_church_from_int(long long value)
+{
+	assert(value >= 0);
+
+	struct dulcet_term *t = dulcet_alloc_var(1);
+	for (long long i = 0; i < value; ++i) {
+		t = dulcet_alloc_app(dulcet_alloc_var(2), t);
+	}
+
+	return dulcet_alloc_abs(dulcet_alloc_abs(t));
+}
+
+struct dulcet_term *dulcet_church_from_bool(int value)
+{
+	return dulcet_alloc_abs(dulcet_alloc_abs(dulcet_alloc_var(value ? 2 : 1)));
+}
+
+// Returns the body of `t` under two abstractions, if it has them
+static const struct dulcet_term *__dulcet_church_body(const struct dulcet_term *t)
+{
+	for (int i = 0; i < 2; ++i) {
+		t = __dulcet_deref(t);
+		if (__DULCET_KIND(t) != DULCET_TERM_KIND_ABS) {
+			return NULL;
+		}
+		t = t->abs.m;
+	}
+
+	return __dulcet_deref(t);
+}
+
+int dulcet_church_to_int(const struct dulcet_term *t, long long *value)
+{
+	assert(t && value);
+
+	t = __dulcet_church_body(t);
+	if (!t) {
+		return 0;
+	}
+
+	// The applications of `f` are counted down to `x`, without recursion
+	long long n = 0;
+	while (__DULCET_KIND(t) == DULCET_TERM_KIND_APP) {
+		const struct dulcet_term *f = __dulcet_deref(t->app.m);
+		if (__DULCET_KIND(f) != DULCET_TERM_KIND_VAR || __DULCET_INDEX(f) != 2 ||
+		    n == LLONG_MAX) {
+			return 0;
+		}
+
+		n += 1;
+		t = __dulcet_deref(t->app.n);
+	}
+
+	if (__DULCET_KIND(t) != DULCET_TERM_KIND_VAR || __DULCET_INDEX(t) != 1) {
+		return 0;
+	}
+
+	*value = n;
+
+	return 1;
+}
+
+int dulcet_church_to_bool(const struct dulcet_term *t, int *value)
+{
+	assert(t && value);
+
+	t = __dulcet_church_body(t);
+	if (!t || __DULCET_KIND(t) != DULCET_TERM_KIND_VAR || __DULCET_INDEX(t) > 2) {
+		return 0;
+	}
+
+	*value = __DULCET_INDEX(t) == 2;
+
+	return 1;
+}
+
+// Returns whether `t` is a pair, without looking into its parts
+static int __dulcet_church_pair(const struct dulcet_term *t, const struct dulcet_term **first,
+				const struct dulcet_term **second)
+{
+	t = __dulcet_deref(t);
+	if (__DULCET_KIND(t) != DULCET_TERM_KIND_ABS) {
+		return 0;
+	}
+
+	t = __dulcet_deref(t->abs.m);
+	if (__DULCET_KIND(t) != DULCET_TERM_KIND_APP) {
+		return 0;
+	}
+
+	const struct dulcet_term *m = __dulcet_deref(t->app.m);
+	if (__DULCET_KIND(m) != DULCET_TERM_KIND_APP) {
+		return 0;
+	}
+
+	const struct dulcet_term *f = __dulcet_deref(m->app.m);
+	if (__DULCET_KIND(f) != DULCET_TERM_KIND_VAR || __DULCET_INDEX(f) != 1) {
+		return 0;
+	}
+
+	*first = __dulcet_deref(m->app.n);
+	*second = __dulcet_deref(t->app.n);
+
+	return 1;
+}
+
+int dulcet_church_to_pair(const struct dulcet_term *t, const struct dulcet_term **first,
+			  const struct dulcet_term **second)
+{
+	assert(t && first && second);
+
+	const struct dulcet_term *a, *b;
+	if (!__dulcet_church_pair(t, &a, &b) || !dulcet_term_closed(a) || !dulcet_term_closed(b)) {
+		return 0;
+	}
+
+	*first = a;
+	*second = b;
+
+	return 1;
+}
+
+int dulcet_church_to_list(const struct dulcet_term *t, const struct dulcet_term ***items,
+			  size_t *size)
+{
+	assert(t && items && size);
+
+	const struct dulcet_term **xs = NULL;
+	size_t xs_size = 0;
+	size_t xs_capacity = 0;
+	// Under a third abstraction is the nil of a list of pairs instead
+	const struct dulcet_term *body = __dulcet_church_body(t);
+	if (body && __DULCET_KIND(body) == DULCET_TERM_KIND_ABS) {
+		body = NULL;
+	}
+
+	// Folds apply `c`, and lists of pairs go on through the second part of each, both without
+	// recursion; only the elements have to be closed, as the rest is then checked on the way
+	for (;;) {
+		const struct dulcet_term *x;
+
+		if (body) {
+			if (__DULCET_KIND(body) == DULCET_TERM_KIND_VAR) {
+				if (__DULCET_INDEX(body) == 1) {
+					break;
+				}
+				goto fail;
+			}
+			if (__DULCET_KIND(body) != DULCET_TERM_KIND_APP) {
+				goto fail;
+			}
+
+			const struct dulcet_term *m = __dulcet_deref(body->app.m);
+			if (__DULCET_KIND(m) != DULCET_TERM_KIND_APP) {
+				goto fail;
+			}
+
+			const struct dulcet_term *c = __dulcet_deref(m->app.m);
+			if (__DULCET_KIND(c) != DULCET_TERM_KIND_VAR || __DULCET_INDEX(c) != 2) {
+				goto fail;
+			}
+
+			x = __dulcet_deref(m->app.n);
+			body = __dulcet_deref(body->app.n);
+		} else {
+			t = __dulcet_deref(t);
+			const struct dulcet_term *nil = __dulcet_church_body(t);
+			if (nil && __DULCET_KIND(nil) == DULCET_TERM_KIND_ABS) {
+				nil = __dulcet_deref(nil->abs.m);
+				if (__DULCET_KIND(nil) == DULCET_TERM_KIND_VAR &&
+				    __DULCET_INDEX(nil) == 2) {
+					break;
+				}
+			}
+
+			if (!__dulcet_church_pair(t, &x, &t)) {
+				goto fail;
+			}
+		}
+
+		if (!dulcet_term_closed(x)) {
+			goto fail;
+		}
+
+		if (xs_size == xs_capacity) {
+			xs_capacity = xs_capacity ? 2 * xs_capacity : 16;
+			xs = realloc(xs, xs_capacity * sizeof(*xs));
+			if (!xs) {
+				__dulcet_fatal("out of memory");
+			}
+		}
+		xs[xs_size++] = x;
+	}
+
+	*items = xs;
+	*size = xs_size;
+
+	return 1;
+
+fail:
+	free(xs);
+
+	return 0;
+}
+
+struct __dulcet_image_builder {
+	struct dulcet_image_node *nodes;
+	size_t nodes_size;
+	size_t nodes_capacity;
+	struct dulcet_image_definition *definitions;
+	size_t definitions_size;
+	size_t definitions_capacity;
+	// Shared term of each definition, if it is one, for the references to it to be found
+	const struct dulcet_shared **shared;
+};
+
+static size_t __dulcet_image_find(const struct __dulcet_image_builder *b,
+				  const struct dulcet_shared *shared)
+{
+	for (size_t i = b->definitions_size; i > 0; --i) {
+		if (b->shared[i - 1] == shared) {
+			return i - 1;
+		}
+	}
+
+	return SIZE_MAX;
+}
+
+static void __dulcet_image_put_node(struct __dulcet_image_builder *b, enum dulcet_term_kind kind,
+				    long long value)
+{
+	if (b->nodes_size == b->nodes_capacity) {
+		b->nodes_capacity = b->nodes_capacity ? 2 * b->nodes_capacity : 256;
+		b->nodes = realloc(b->nodes, b->nodes_capacity * sizeof(*b->nodes));
+		if (!b->nodes) {
+			__dulcet_fatal("out of memory");
+		}
+	}
+
+	b->nodes[b->nodes_size++] = (struct dulcet_image_node) { kind, value };
+}
+
+// Writes `t` as a definition, after those of the shared terms it refers to that are not written
+// yet. References to terms that are open where they are, which only the reducers make, are
+// written out in full instead.
+static size_t __dulcet_image_put(struct __dulcet_image_builder *b, const struct dulcet_term *t,
+				 const char *name, const struct dulcet_shared *shared)
+{
+	const struct dulcet_term **stack = NULL;
+	size_t stack_size = 0;
+	size_t stack_capacity = 0;
+	size_t start = 0;
+
+	// The definitions it refers to are written in a first pass, so that its own nodes, written
+	// in the second, are contiguous
+	for (int pass = 0; pass < 2; ++pass) {
+		const struct dulcet_term *s = t;
+		start = b->nodes_size;
+
+		for (;;) {
+			if (stack_size == stack_capacity) {
+				stack_capacity = stack_capacity ? 2 * stack_capacity : 64;
+				stack = realloc(stack, stack_capacity * sizeof(*stack));
+				if (!stack) {
+					__dulcet_fatal("out of memory");
+				}
+			}
+
+			enum dulcet_term_kind kind = __DULCET_KIND(s);
+			if (kind == DULCET_TERM_KIND_REF && s->ref.shared->open) {
+				s = s->ref.shared->m;
+				continue;
+			}
+
+			if (kind == DULCET_TERM_KIND_ABS) {
+				if (pass == 1) {
+					__dulcet_image_put_node(b, kind, 0);
+				}
+				s = s->abs.m;
+				continue;
+			}
+
+			if (kind == DULCET_TERM_KIND_APP) {
+				if (pass == 1) {
+					__dulcet_image_put_node(b, kind, 0);
+				}
+				stack[stack_size++] = s->app.n;
+				s = s->app.m;
+				continue;
+			}
+
+			switch (kind) {
+			case DULCET_TERM_KIND_VAR:
+				if (pass == 1) {
+					__dulcet_image_put_node(b, kind, __DULCET_INDEX(s));
+				}
+				break;
+			case DULCET_TERM_KIND_REF: {
+				size_t i = __dulcet_image_find(b, s->ref.shared);
+				if (i == SIZE_MAX) {
+					i = __dulcet_image_put(b, s->ref.shared->m, NULL,
+							       s->ref.shared);
+				}
+				if (pass == 1) {
+					__dulcet_image_put_node(b, kind, (long long) i);
+				}
+				break;
+			}
+			case DULCET_TERM_KIND_INT:
+				if (pass == 1) {
+					__dulcet_image_put_node(b, kind, s->integer.value);
+				}
+				break;
+			case DULCET_TERM_KIND_BOOL:
+				if (pass == 1) {
+					__dulcet_image_put_node(b, kind, s->boolean.value);
+				}
+				break;
+			case DULCET_TERM_KIND_PRIM:
+				if (pass == 1) {
+					__dulcet_image_put_node(b, kind, s->prim.op);
+				}
+				break;
+			default:
+				__dulcet_fatal("unknown term kind");
+			}
+
+			if (stack_size == 0) {
+				break;
+			}
+			s = stack[--stack_size];
+		}
+	}
+
+	free(stack);
+
+	if (b->definitions_size == b->definitions_capacity) {
+		b->definitions_capacity =
+			b->definitions_capacity ? 2 * b->definitions_capacity : 64;
+		b->definitions =
+			realloc(b->definitions, b->definitions_capacity * sizeof(*b->definitions));
+		b->shared = realloc(b->shared, b->definitions_capacity * sizeof(*b->shared));
+		if (!b->definitions || !b->shared) {
+			__dulcet_fatal("out of memory");
+		}
+	}
+
+	b->definitions[b->definitions_size] =
+		(struct dulcet_image_definition) { name, b->nodes_size - start };
+	b->shared[b->definitions_size] = shared;
+
+	return b->definitions_size++;
+}
+
+void dulcet_image_build(struct dulcet_image *image, const struct dulcet_term *const *terms,
+			const char *const *names, size_t size)
+{
+	struct __dulcet_image_builder b = { 0 };
+
+	assert(image && (terms || size == 0));
+
+	for (size_t i = 0; i < size; ++i) {
+		const struct dulcet_term *t = terms[i];
+		const char *name = names ? names[i] : NULL;
+
+		assert(t && dulcet_term_closed(t));
+
+		// A shared term is written as the definition itself, and named if it was written
+		// already, unless it was named too
+		if (__DULCET_KIND(t) == DULCET_TERM_KIND_REF && !t->ref.shared->open) {
+			size_t j = __dulcet_image_find(&b, t->ref.shared);
+			if (j == SIZE_MAX) {
+				__dulcet_image_put(&b, t->ref.shared->m, name, t->ref.shared);
+				continue;
+			}
+			if (!b.definitions[j].name) {
+				b.definitions[j].name = name;
+				continue;
+			}
+		}
+
+		__dulcet_image_put(&b, t, name, NULL);
+	}
+
+	free(b.shared);
+
+	*image = (struct dulcet_image) {
+		.nodes = b.nodes,
+		.nodes_size = b.nodes_size,
+		.definitions = b.definitions,
+		.definitions_size = b.definitions_size,
+	};
+}
+
+void dulcet_image_free(struct dulcet_image *image)
+{
+	assert(image);
+
+	free((void *) image->nodes);
+	free((void *) image->definitions);
+}
+
+void dulcet_image_load(struct dulcet_loaded_image *loaded, const struct dulcet_image *image)
+{
+	assert(loaded && image);
+
+	const struct dulcet_image_node *nodes = image->nodes;
+	size_t definitions_size = image->definitions_size;
+	size_t nodes_size = 0;
+	size_t total = 0;
+
+	for (size_t i = 0; i < definitions_size; ++i) {
+		total += image->definitions[i].size;
+	}
+	if (total != image->nodes_size) {
+		__dulcet_fatal("malformed image");
+	}
+
+	for (size_t i = 0; i < image->nodes_size; ++i) {
+		nodes_size += nodes[i].kind != DULCET_TERM_KIND_VAR;
+	}
+
+	if (definitions_size == 0) {
+		*loaded = (struct dulcet_loaded_image) { image, NULL, NULL, 0 };
+		return;
+	}
+
+	// The shared terms of the definitions, the references to them, and their nodes, with the
+	// pointers to the references last, all in a block of their own, which is never freed a node
+	// at a time, as the image holds a reference to each shared term that it never drops
+	size_t block_size = (2 * definitions_size + nodes_size) * sizeof(struct dulcet_term) +
+			    definitions_size * sizeof(*loaded->terms);
+	struct dulcet_term *block =
+		__dulcet_allocator.alloc ? __dulcet_allocator.alloc(__dulcet_allocator.data, block_size)
+					 : malloc(block_size);
+	if (!block) {
+		__dulcet_fatal("out of memory");
+	}
+
+	struct dulcet_term *handles = block + definitions_size;
+	struct dulcet_term *next = handles + definitions_size;
+	const struct dulcet_term **terms = (const struct dulcet_term **) (next + nodes_size);
+
+	for (size_t i = 0; i < definitions_size; ++i) {
+		size_t size = image->definitions[i].size;
+		struct dulcet_term *m = NULL;
+		struct dulcet_term **slot = &m;
+
+		// The right-hand sides of the applications still to be read are kept on a list
+		// through the very pointers to them
+		struct dulcet_term *pending = NULL;
+
+		for (; size > 0; --size, ++nodes) {
+			struct dulcet_term *t;
+			long long value = nodes->value;
+
+			if (!slot) {
+				__dulcet_fatal("malformed image");
+			}
+
+			switch (nodes->kind) {
+			case DULCET_TERM_KIND_VAR:
+				if (value < 1 || value > UINT_MAX) {
+					__dulcet_fatal("malformed image");
+				}
+				*slot = dulcet_alloc_var((unsigned int) value);
+				break;
+			case DULCET_TERM_KIND_ABS:
+				t = next++;
+				t->kind = DULCET_TERM_KIND_ABS;
+				t->abs = (struct dulcet_abs) { 0 };
+				*slot = t;
+				slot = &t->abs.m;
+				continue;
+			case DULCET_TERM_KIND_APP:
+				t = next++;
+				t->kind = DULCET_TERM_KIND_APP;
+				t->app.n = pending;
+				pending = t;
+				*slot = t;
+				slot = &t->app.m;
+				continue;
+			case DULCET_TERM_KIND_REF:
+				if (value < 0 || (size_t) value >= i) {
+					__dulcet_fatal("malformed image");
+				}
+				t = next++;
+				t->kind = DULCET_TERM_KIND_REF;
+				t->ref = (struct dulcet_ref) {
+					(struct dulcet_shared *) &block[value],
+				};
+				*slot = t;
+				break;
+			case DULCET_TERM_KIND_INT:
+				t = next++;
+				t->kind = DULCET_TERM_KIND_INT;
+				t->integer = (struct dulcet_int) { value };
+				*slot = t;
+				break;
+			case DULCET_TERM_KIND_BOOL:
+				t = next++;
+				t->kind = DULCET_TERM_KIND_BOOL;
+				t->boolean = (struct dulcet_bool) { value != 0 };
+				*slot = t;
+				break;
+			case DULCET_TERM_KIND_PRIM:
+				if (value < 0 || value >= DULCET_PRIM_OP_COUNT) {
+					__dulcet_fatal("malformed image");
+				}
+				t = next++;
+				t->kind = DULCET_TERM_KIND_PRIM;
+				t->prim = (struct dulcet_prim) { (enum dulcet_prim_op) value };
+				*slot = t;
+				break;
+			default:
+				__dulcet_fatal("malformed image");
+			}
+
+			if (pending) {
+				slot = &pending->app.n;
+				pending = pending->app.n;
+			} else {
+				slot = NULL;
+			}
+		}
+
+		if (slot || !dulcet_term_closed(m)) {
+			__dulcet_fatal("malformed image");
+		}
+
+		struct dulcet_shared *shared = (struct dulcet_shared *) &block[i];
+		atomic_init(&shared->refs, 1);
+		shared->m = m;
+		shared->normal = __dulcet_term_normal(m);
+		shared->borrowed = 0;
+		shared->open = 0;
+
+		handles[i].kind = DULCET_TERM_KIND_REF;
+		handles[i].ref = (struct dulcet_ref) { shared };
+		terms[i] = &handles[i];
+	}
+
+	*loaded = (struct dulcet_loaded_image) { image, terms, block, block_size };
+	__dulcet_image_bytes += loaded->block_size;
+}
+
+void dulcet_image_unload(struct dulcet_loaded_image *loaded)
+{
+	assert(loaded);
+
+	if (!loaded->block) {
+		return;
+	}
+
+	if (__dulcet_allocator.free) {
+		__dulcet_allocator.free(__dulcet_allocator.data, loaded->block, loaded->block_size);
+	} else {
+		free(loaded->block);
+	}
+
+	__dulcet_image_bytes -= loaded->block_size;
+}
+
+const struct dulcet_term *dulcet_image_lookup(const struct dulcet_loaded_image *loaded,
+					      const char *name, unsigned int name_len)
+{
+	assert(loaded && name);
+
+	for (size_t i = loaded->image->definitions_size; i > 0; --i) {
+		const char *s = loaded->image->definitions[i - 1].name;
+		if (s && strlen(s) == name_len && memcmp(s, name, name_len) == 0) {
+			return loaded->terms[i - 1];
+		}
+	}
+
+	return NULL;
+}
+
+#if 1
+static const char __DULCET_LAMBDA[] = "λ";
+#else
+static const char __DULCET_LAMBDA[] = "\\";
+#endif
+
+#define __DULCET_TRY(rc, condition)             \
+	do {                                    \
+		if (((rc) = (condition)) < 0) { \
+			return (rc);            \
+		}                               \
+	} while (0)
+
+#define __DULCET_PRINTER_INITIAL_CAPACITY 4096
+#define __DULCET_PRINTER_BLOCK_SIZE (64 * 1024)
+
+// Every printer renders into this buffer, one character or number at a time, instead of going
+// through stdio for each token. When printing to a file, the buffer grows up to a block size and
+// is then flushed with a single `fwrite`; when printing to a string, it is the string itself, and
+// whatever does not fit in it is dropped but still counted.
+struct __dulcet_printer {
+	char *buf;
+	size_t size;
+	size_t capacity;
+
+	// Total number of bytes rendered, including the ones already flushed or dropped
+	size_t length;
+
+	FILE *fp;
+	int failed;
+};
+
+static struct __dulcet_printer __dulcet_printer_to_file(FILE *fp)
+{
+	return (struct __dulcet_printer) {
+		.buf = NULL,
+		.size = 0,
+		.capacity = 0,
+		.length = 0,
+		.fp = fp,
+		.failed = 0,
+	};
+}
+
+static struct __dulcet_printer __dulcet_printer_to_string(char *buf, size_t capacity)
+{
+	return (struct __dulcet_printer) {
+		.buf = buf,
+		.size = 0,
+		.capacity = capacity,
+		.length = 0,
+		.fp = NULL,
+		.failed = 0,
+	};
+}
+
+static void __dulcet_printer_flush(struct __dulcet_printer *p)
+{
+	if (p->fp && p->size > 0) {
+		if (fwrite(p->buf, sizeof(char), p->size, p->fp) != p->size) {
+			p->failed = 1;
+		}
+		p->size = 0;
+	}
+}
+
+// Makes room for `n` more bytes, returning how many of them can actually be stored
+static size_t __dulcet_printer_reserve(struct __dulcet_printer *p, size_t n)
+{
+	if (p->capacity - p->size >= n) {
+		return n;
+	}
+
+	if (!p->fp) {
+		return p->capacity - p->size;
+	}
+
+	if (p->capacity >= __DULCET_PRINTER_BLOCK_SIZE) {
+		__dulcet_printer_flush(p);
+	}
+
+	if (p->capacity - p->size < n) {
+		size_t capacity = p->capacity ? p->capacity : __DULCET_PRINTER_INITIAL_CAPACITY;
+		while (capacity - p->size < n) {
+			capacity *= 2;
+		}
+
+		p->buf = realloc(p->buf, capacity);
+		if (!p->buf) {
+			__dulcet_fatal("out of memory");
+		}
+		p->capacity = capacity;
+	}
+
+	return n;
+}
+
+static void __dulcet_printer_release(struct __dulcet_printer *p)
+{
+	__dulcet_printer_flush(p);
+
+	if (p->fp) {
+		free(p->buf);
+	}
+}
+
+static inline void __dulcet_printer_putc(struct __dulcet_printer *p, char c)
+{
+	if (__dulcet_printer_reserve(p, 1) > 0) {
+		p->buf[p->size] = c;
+		p->size += 1;
+	}
+	p->length += 1;
+}
+
+static inline void __dulcet_printer_write(struct __dulcet_printer *p, const char *data, size_t n)
+{
+	size_t stored = __dulcet_printer_reserve(p, n);
+
+	if (stored > 0) {
+		memcpy(p->buf + p->size, data, stored);
+		p->size += stored;
+	}
+	p->length += n;
+}
+
+static void __dulcet_printer_putu(struct __dulcet_printer *p, unsigned int value)
+{
+	char digits[sizeof(value) * 3];
+	size_t n = sizeof(digits);
+
+	do {
+		n -= 1;
+		digits[n] = '0' + value % 10;
+		value /= 10;
+	} while (value > 0);
+
+	__dulcet_printer_write(p, digits + n, sizeof(digits) - n);
+}
+
+// Longest rendering of a constant, that of the smallest integer in de Bruijn notation
+#define __DULCET_CONSTANT_MAX_LENGTH sizeof("#-9223372036854775808")
+
+// Renders the constant `t` into `buf`, returning its length. Integers are marked with `#` in de
+// Bruijn notation, where numbers are variables.
+static size_t __dulcet_constant_format(const struct dulcet_term *t, int de_bruijn, char *buf)
+{
+	const size_t size = __DULCET_CONSTANT_MAX_LENGTH;
+
+	switch (t->kind) {
+	case DULCET_TERM_KIND_INT:
+		return (size_t) snprintf(buf, size, de_bruijn ? "#%lld" : "%lld", t->integer.value);
+	case DULCET_TERM_KIND_BOOL:
+		return (size_t) snprintf(buf, size, "%s", t->boolean.value ? "true" : "false");
+	case DULCET_TERM_KIND_PRIM:
+		return (size_t) snprintf(buf, size, "%s", __dulcet_prims[t->prim.op].name);
+	default:
+		__dulcet_fatal("unknown term kind");
+	}
+}
+
+static void __dulcet_printer_put_constant(struct __dulcet_printer *p, const struct dulcet_term *t,
+					  int de_bruijn)
+{
+	char buf[__DULCET_CONSTANT_MAX_LENGTH];
+
+	__dulcet_printer_write(p, buf, __dulcet_constant_format(t, de_bruijn, buf));
+}
+
+static int __dulcet_printer_finish(struct __dulcet_printer *p, int rc)
+{
+	__dulcet_printer_release(p);
+
+	if (rc < 0 || p->failed || p->length > INT_MAX) {
+		return -1;
+	}
+
+	return (int) p->length;
+}
+
+// Pending work of the printers, which keep it on an explicit stack so that terms of any depth can
+// be printed: either a term, printed in the given context, or a single closing character.
+struct __dulcet_print_frame {
+	const struct dulcet_term *t;
+	char c;
+	unsigned char context_precedence;
+	unsigned char head_normal; // Only for streaming, see `__dulcet_term_stream_iter`
+	unsigned int depth;
+};
+
+struct __dulcet_print_stack {
+	struct __dulcet_print_frame *buf;
+	size_t size;
+	size_t capacity;
+};
+
+static void __dulcet_print_stack_push(struct __dulcet_print_stack *stack,
+				      struct __dulcet_print_frame frame)
+{
+	if (stack->size == stack->capacity) {
+		stack->capacity = stack->capacity ? 2 * stack->capacity : 64;
+		stack->buf = realloc(stack->buf, stack->capacity * sizeof(*stack->buf));
+		if (!stack->buf) {
+			__dulcet_fatal("out of memory");
+		}
+	}
+
+	stack->buf[stack->size] = frame;
+	stack->size += 1;
+}
+
+static void __dulcet_print_stack_push_term(struct __dulcet_print_stack *stack,
+					   const struct dulcet_term *t,
+					   unsigned int context_precedence, unsigned int depth)
+{
+	__dulcet_print_stack_push(stack, (struct __dulcet_print_frame) {
+						 .t = t,
+						 .context_precedence = context_precedence,
+						 .depth = depth,
+					 });
+}
+
+static void __dulcet_print_stack_push_char(struct __dulcet_print_stack *stack, char c)
+{
+	__dulcet_print_stack_push(stack, (struct __dulcet_print_frame) { .t = NULL, .c = c });
+}
+
+static int __dulcet_term_print_classic_iter(const struct dulcet_term *t,
+					    struct __dulcet_printer *p)
+{
+	struct __dulcet_print_stack stack = { 0 };
+	int rc = 0;
+
+	__dulcet_print_stack_push_term(&stack, t, 0, 0);
+
+	while (stack.size > 0) {
+		stack.size -= 1;
+		struct __dulcet_print_frame frame = stack.buf[stack.size];
+
+		if (!frame.t) {
+			// Only terms have no closing character, and a missing one cannot be printed
+			if (frame.c == '\0') {
+				rc = -1;
+				break;
+			}
+
+			__dulcet_printer_putc(p, frame.c);
+			continue;
+		}
+
+		t = __dulcet_deref(frame.t);
+
+		switch (__DULCET_KIND(t)) {
+		case DULCET_TERM_KIND_VAR:
+			if (frame.depth >= __DULCET_INDEX(t)) {
+				__dulcet_printer_putc(p, 'a' + frame.depth - __DULCET_INDEX(t));
+			} else {
+				__dulcet_printer_putc(p, 'a' + __DULCET_INDEX(t) - 1);
+			}
+			break;
+		case DULCET_TERM_KIND_ABS:
+			if (frame.context_precedence > 1) {
+				__dulcet_printer_putc(p, '(');
+				__dulcet_print_stack_push_char(&stack, ')');
+			}
+
+			__dulcet_printer_write(p, __DULCET_LAMBDA, sizeof(__DULCET_LAMBDA) - 1);
+			__dulcet_printer_putc(p, 'a' + frame.depth);
+			__dulcet_printer_putc(p, '.');
+
+			__dulcet_print_stack_push_term(&stack, t->abs.m, 0, frame.depth + 1);
+			break;
+		case DULCET_TERM_KIND_APP:
+			if (frame.context_precedence == 3) {
+				__dulcet_printer_putc(p, '(');
+				__dulcet_print_stack_push_char(&stack, ')');
+			}
+
+			__dulcet_print_stack_push_term(&stack, t->app.n, 3, frame.depth);
+			__dulcet_print_stack_push_char(&stack, ' ');
+			__dulcet_print_stack_push_term(&stack, t->app.m, 2, frame.depth);
+			break;
+		case DULCET_TERM_KIND_INT:
+		case DULCET_TERM_KIND_BOOL:
+		case DULCET_TERM_KIND_PRIM:
+			__dulcet_printer_put_constant(p, t, 0);
+			break;
+		default:
+			rc = -1;
+			break;
+		}
+
+		if (rc < 0) {
+			break;
+		}
+	}
+
+	free(stack.buf);
+
+	return rc;
+}
+
+static int __dulcet_term_print_de_bruijn_iter(const struct dulcet_term *t,
+					      struct __dulcet_printer *p)
+{
+	struct __dulcet_print_stack stack = { 0 };
+	int rc = 0;
+
+	__dulcet_print_stack_push_term(&stack, t, 0, 0);
+
+	while (stack.size > 0) {
+		stack.size -= 1;
+		struct __dulcet_print_frame frame = stack.buf[stack.size];
+
+		if (!frame.t) {
+			// Only terms have no closing character, and a missing one cannot be printed
+			if (frame.c == '\0') {
+				rc = -1;
+				break;
+			}
+
+			__dulcet_printer_putc(p, frame.c);
+			continue;
+		}
+
+		t = __dulcet_deref(frame.t);
+
+		switch (__DULCET_KIND(t)) {
+		case DULCET_TERM_KIND_VAR:
+			__dulcet_printer_putu(p, __DULCET_INDEX(t));
+			break;
+		case DULCET_TERM_KIND_ABS:
+			if (frame.context_precedence > 1) {
+				__dulcet_printer_putc(p, '(');
+				__dulcet_print_stack_push_char(&stack, ')');
+			}
+
+			__dulcet_printer_write(p, __DULCET_LAMBDA, sizeof(__DULCET_LAMBDA) - 1);
+
+			__dulcet_print_stack_push_term(&stack, t->abs.m, 0, frame.depth);
+			break;
+		case DULCET_TERM_KIND_APP:
+			if (frame.context_precedence == 3) {
+				__dulcet_printer_putc(p, '(');
+				__dulcet_print_stack_push_char(&stack, ')');
+			}
+
+			__dulcet_print_stack_push_term(&stack, t->app.n, 3, frame.depth);
+			__dulcet_print_stack_push_char(&stack, ' ');
+			__dulcet_print_stack_push_term(&stack, t->app.m, 2, frame.depth);
+			break;
+		case DULCET_TERM_KIND_INT:
+		case DULCET_TERM_KIND_BOOL:
+		case DULCET_TERM_KIND_PRIM:
+			__dulcet_printer_put_constant(p, t, 1);
+			break;
+		default:
+			rc = -1;
+			break;
+		}
+
+		if (rc < 0) {
+			break;
+		}
+	}
+
+	free(stack.buf);
+
+	return rc;
+}
+
+int dulcet_term_print_classic(const struct dulcet_term *t)
+{
+	return dulcet_term_fprint_classic(t, stdout);
+}
+
+int dulcet_term_print_de_bruijn(const struct dulcet_term *t)
+{
+	return dulcet_term_fprint_de_bruijn(t, stdout);
+}
+
+int dulcet_term_fprint_classic(const struct dulcet_term *t, FILE *fp)
+{
+	unsigned long long start = dulcet_stats_time();
+
+	struct __dulcet_printer p = __dulcet_printer_to_file(fp);
+	int rc = __dulcet_printer_finish(&p, __dulcet_term_print_classic_iter(t, &p));
+
+	dulcet_stats_add_time(DULCET_PHASE_PRINT, dulcet_stats_time() - start);
+
+	return rc;
+}
+
+int dulcet_term_fprint_de_bruijn(const struct dulcet_term *t, FILE *fp)
+{
+	unsigned long long start = dulcet_stats_time();
+
+	struct __dulcet_printer p = __dulcet_printer_to_file(fp);
+	int rc = __dulcet_printer_finish(&p, __dulcet_term_print_de_bruijn_iter(t, &p));
+
+	dulcet_stats_add_time(DULCET_PHASE_PRINT, dulcet_stats_time() - start);
+
+	return rc;
+}
+
+int dulcet_term_sprint_classic(const struct dulcet_term *t, char *buf)
+{
+	unsigned long long start = dulcet_stats_time();
+
+	struct __dulcet_printer p = __dulcet_printer_to_string(buf, SIZE_MAX);
+
+	int rc;
+	__DULCET_TRY(rc, __dulcet_printer_finish(&p, __dulcet_term_print_classic_iter(t, &p)));
+
+	buf[rc] = '\0';
+
+	dulcet_stats_add_time(DULCET_PHASE_PRINT, dulcet_stats_time() - start);
+
+	return rc;
+}
+
+int dulcet_term_sprint_de_bruijn(const struct dulcet_term *t, char *buf)
+{
+	unsigned long long start = dulcet_stats_time();
+
+	struct __dulcet_printer p = __dulcet_printer_to_string(buf, SIZE_MAX);
+
+	int rc;
+	__DULCET_TRY(rc, __dulcet_printer_finish(&p, __dulcet_term_print_de_bruijn_iter(t, &p)));
+
+	buf[rc] = '\0';
+
+	dulcet_stats_add_time(DULCET_PHASE_PRINT, dulcet_stats_time() - start);
+
+	return rc;
+}
+
+int dulcet_term_snprint_classic(const struct dulcet_term *t, char *buf, size_t size)
+{
+	unsigned long long start = dulcet_stats_time();
+
+	struct __dulcet_printer p = __dulcet_printer_to_string(buf, size > 0 ? size - 1 : 0);
+
+	int rc;
+	__DULCET_TRY(rc, __dulcet_printer_finish(&p, __dulcet_term_print_classic_iter(t, &p)));
+
+	if (size > 0) {
+		buf[p.size] = '\0';
+	}
+
+	dulcet_stats_add_time(DULCET_PHASE_PRINT, dulcet_stats_time() - start);
+
+	return rc;
+}
+
+int dulcet_term_snprint_de_bruijn(const struct dulcet_term *t, char *buf, size_t size)
+{
+	unsigned long long start = dulcet_stats_time();
+
+	struct __dulcet_printer p = __dulcet_printer_to_string(buf, size > 0 ? size - 1 : 0);
+
+	int rc;
+	__DULCET_TRY(rc, __dulcet_printer_finish(&p, __dulcet_term_print_de_bruijn_iter(t, &p)));
+
+	if (size > 0) {
+		buf[p.size] = '\0';
+	}
+
+	dulcet_stats_add_time(DULCET_PHASE_PRINT, dulcet_stats_time() - start);
+
+	return rc;
+}
+
+static unsigned int __dulcet_count_digits(unsigned int value)
+{
+	unsigned int digits = 1;
+
+	while (value >= 10) {
+		value /= 10;
+		digits += 1;
+	}
+
+	return digits;
+}
+
+// Computes how long the output of the printers is without rendering it, by adding up the length
+// of each token in the same order the printers would emit them
+static int __dulcet_term_len(const struct dulcet_term *t, int de_bruijn)
+{
+	struct __dulcet_print_stack stack = { 0 };
+	size_t length = 0;
+	int rc = 0;
+
+	__dulcet_print_stack_push_term(&stack, t, 0, 0);
+
+	while (stack.size > 0) {
+		stack.size -= 1;
+		struct __dulcet_print_frame frame = stack.buf[stack.size];
+
+		t = frame.t;
+		if (!t) {
+			rc = -1;
+			break;
+		}
+		t = __dulcet_deref(t);
+
+		switch (__DULCET_KIND(t)) {
+		case DULCET_TERM_KIND_VAR:
+			length += de_bruijn ? __dulcet_count_digits(__DULCET_INDEX(t)) : 1;
+			break;
+		case DULCET_TERM_KIND_ABS:
+			if (frame.context_precedence > 1) {
+				length += 2;
+			}
+
+			length += sizeof(__DULCET_LAMBDA) - 1;
+			if (!de_bruijn) {
+				length += 2;
+			}
+
+			__dulcet_print_stack_push_term(&stack, t->abs.m, 0, 0);
+			break;
+		case DULCET_TERM_KIND_APP:
+			if (frame.context_precedence == 3) {
+				length += 2;
+			}
+
+			length += 1;
+
+			__dulcet_print_stack_push_term(&stack, t->app.n, 3, 0);
+			__dulcet_print_stack_push_term(&stack, t->app.m, 2, 0);
+			break;
+		case DULCET_TERM_KIND_INT:
+		case DULCET_TERM_KIND_BOOL:
+		case DULCET_TERM_KIND_PRIM: {
+			char buf[__DULCET_CONSTANT_MAX_LENGTH];
+			length += __dulcet_constant_format(t, de_bruijn, buf);
+			break;
+		}
+		default:
+			rc = -1;
+			break;
+		}
+
+		if (rc < 0) {
+			break;
+		}
+	}
+
+	free(stack.buf);
+
+	if (rc < 0 || length > INT_MAX) {
+		return -1;
+	}
+
+	return (int) length;
+}
+
+int dulcet_term_len_classic(const struct dulcet_term *t)
+{
+	return __dulcet_term_len(t, 0);
+}
+
+int dulcet_term_len_de_bruijn(const struct dulcet_term *t)
+{
+	return __dulcet_term_len(t, 1);
+}
+
+// The printers of shared output write each closed subterm that occurs more than once only once,
+// as a `let` binding that its occurrences refer to by number. The term is first hash-consed into
+// a graph of its distinct subterms, in which each comes after those it is made of, so that the
+// rest of the work, and the output, only grow with the number of distinct subterms.
+struct __dulcet_dag_node {
+	enum dulcet_term_kind kind;
+	long long value; // Index of a variable or value of a constant
+	size_t m;
+	size_t n;
+	const struct dulcet_term *t; // A term of the node, for the constants to be printed from
+
+	unsigned int free; // Binders needed around it for it to be closed
+	size_t size; // Of the term, up to SIZE_MAX
+	size_t refs; // Occurrences in the output, up to SIZE_MAX
+	size_t binding; // Number of its `let`, or 0 if it is written out wherever it occurs
+};
+
+struct __dulcet_dag_ref {
+	const struct dulcet_shared *shared;
+	size_t node;
+};
+
+struct __dulcet_dag {
+	struct __dulcet_dag_node *nodes;
+	size_t size;
+	size_t capacity;
+
+	// Open addressing tables, with capacities that are powers of two, of the nodes plus one by
+	// their contents, and of the nodes of the shared terms already visited
+	size_t *table;
+	size_t table_capacity;
+	struct __dulcet_dag_ref *refs;
+	size_t refs_size;
+	size_t refs_capacity;
+};
+
+static inline size_t __dulcet_saturating_add(size_t a, size_t b)
+{
+	return a > SIZE_MAX - b ? SIZE_MAX : a + b;
+}
+
+static inline uint64_t __dulcet_dag_mix(uint64_t x)
+{
+	x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9;
+	x = (x ^ (x >> 27)) * 0x94d049bb133111eb;
+
+	return x ^ (x >> 31);
+}
+
+static uint64_t __dulcet_dag_hash(const struct __dulcet_dag_node *node)
+{
+	uint64_t h = __dulcet_dag_mix(node->kind);
+	h = __dulcet_dag_mix(h ^ (uint64_t) node->value);
+	h = __dulcet_dag_mix(h ^ node->m);
+
+	return __dulcet_dag_mix(h ^ node->n);
+}
+
+static void *__dulcet_dag_calloc(size_t size, size_t n)
+{
+	void *p = calloc(size, n);
+	if (!p) {
+		__dulcet_fatal("out of memory");
+	}
+
+	return p;
+}
+
+// Returns the node with the contents of `node`, adding it if there is none
+static size_t __dulcet_dag_intern(struct __dulcet_dag *dag, struct __dulcet_dag_node node)
+{
+	if (2 * dag->size >= dag->table_capacity) {
+		free(dag->table);
+		dag->table_capacity = dag->table_capacity ? 2 * dag->table_capacity : 256;
+		dag->table = __dulcet_dag_calloc(dag->table_capacity, sizeof(*dag->table));
+
+		for (size_t i = 0; i < dag->size; ++i) {
+			size_t slot = __dulcet_dag_hash(&dag->nodes[i]) & (dag->table_capacity - 1);
+			while (dag->table[slot]) {
+				slot = (slot + 1) & (dag->table_capacity - 1);
+			}
+			dag->table[slot] = i + 1;
+		}
+	}
+
+	size_t slot = __dulcet_dag_hash(&node) & (dag->table_capacity - 1);
+	for (; dag->table[slot]; slot = (slot + 1) & (dag->table_capacity - 1)) {
+		const struct __dulcet_dag_node *other = &dag->nodes[dag->table[slot] - 1];
+		if (other->kind == node.kind && other->value == node.value && other->m == node.m &&
+		    other->n == node.n) {
+			return dag->table[slot] - 1;
+		}
+	}
+
+	switch (node.kind) {
+	case DULCET_TERM_KIND_VAR:
+		node.free = (unsigned int) node.value;
+		node.size = 1;
+		break;
+	case DULCET_TERM_KIND_ABS: {
+		const struct __dulcet_dag_node *m = &dag->nodes[node.m];
+		node.free = m->free > 0 ? m->free - 1 : 0;
+		node.size = __dulcet_saturating_add(m->size, 1);
+		break;
+	}
+	case DULCET_TERM_KIND_APP: {
+		const struct __dulcet_dag_node *m = &dag->nodes[node.m];
+		const struct __dulcet_dag_node *n = &dag->nodes[node.n];
+		node.free = m->free > n->free ? m->free : n->free;
+		node.size = __dulcet_saturating_add(__dulcet_saturating_add(m->size, n->size), 1);
+		break;
+	}
+	default:
+		node.free = 0;
+		node.size = 1;
+		break;
+	}
+
+	if (dag->size == dag->capacity) {
+		dag->capacity = dag->capacity ? 2 * dag->capacity : 256;
+		dag->nodes = realloc(dag->nodes, dag->capacity * sizeof(*dag->nodes));
+		if (!dag->nodes) {
+			__dulcet_fatal("out of memory");
+		}
+	}
+
+	dag->table[slot] = dag->size + 1;
+	dag->nodes[dag->size] = node;
+
+	return dag->size++;
+}
+
+static size_t *__dulcet_dag_find_ref(struct __dulcet_dag *dag, const struct dulcet_shared *shared)
+{
+	if (dag->refs_capacity == 0) {
+		return NULL;
+	}
+
+	size_t slot = __dulcet_dag_mix((uintptr_t) shared) & (dag->refs_capacity - 1);
+	for (; dag->refs[slot].shared; slot = (slot + 1) & (dag->refs_capacity - 1)) {
+		if (dag->refs[slot].shared == shared) {
+			return &dag->refs[slot].node;
+		}
+	}
+
+	return NULL;
+}
+
+static void __dulcet_dag_put_ref(struct __dulcet_dag *dag, const struct dulcet_shared *shared,
+				 size_t node)
+{
+	if (2 * (dag->refs_size + 1) > dag->refs_capacity) {
+		struct __dulcet_dag_ref *refs = dag->refs;
+		size_t capacity = dag->refs_capacity;
+
+		dag->refs_capacity = capacity ? 2 * capacity : 64;
+		dag->refs = __dulcet_dag_calloc(dag->refs_capacity, sizeof(*dag->refs));
+		dag->refs_size = 0;
+
+		for (size_t i = 0; i < capacity; ++i) {
+			if (refs[i].shared) {
+				__dulcet_dag_put_ref(dag, refs[i].shared, refs[i].node);
+			}
+		}
+		free(refs);
+	}
+
+	size_t slot = __dulcet_dag_mix((uintptr_t) shared) & (dag->refs_capacity - 1);
+	while (dag->refs[slot].shared) {
+		slot = (slot + 1) & (dag->refs_capacity - 1);
+	}
+
+	dag->refs[slot] = (struct __dulcet_dag_ref) { shared, node };
+	dag->refs_size += 1;
+}
+
+// A term still to be gone through, or, when done, whose subterms have been, and whose nodes are
+// then on top of the stack of nodes
+struct __dulcet_dag_build_frame {
+	const struct dulcet_term *t;
+	int done;
+};
+
+struct __dulcet_dag_build_stack {
+	struct __dulcet_dag_build_frame *frames;
+	size_t frames_size;
+	size_t frames_capacity;
+	size_t *nodes;
+	size_t nodes_size;
+	size_t nodes_capacity;
+};
+
+static void __dulcet_dag_push_frame(struct __dulcet_dag_build_stack *stack,
+				    const struct dulcet_term *t, int done)
+{
+	if (stack->frames_size == stack->frames_capacity) {
+		stack->frames_capacity = stack->frames_capacity ? 2 * stack->frames_capacity : 64;
+		stack->frames =
+			realloc(stack->frames, stack->frames_capacity * sizeof(*stack->frames));
+		if (!stack->frames) {
+			__dulcet_fatal("out of memory");
+		}
+	}
+
+	stack->frames[stack->frames_size++] = (struct __dulcet_dag_build_frame) { t, done };
+}
+
+static void __dulcet_dag_push_node(struct __dulcet_dag_build_stack *stack, size_t node)
+{
+	if (stack->nodes_size == stack->nodes_capacity) {
+		stack->nodes_capacity = stack->nodes_capacity ? 2 * stack->nodes_capacity : 64;
+		stack->nodes = realloc(stack->nodes, stack->nodes_capacity * sizeof(*stack->nodes));
+		if (!stack->nodes) {
+			__dulcet_fatal("out of memory");
+		}
+	}
+
+	stack->nodes[stack->nodes_size++] = node;
+}
+
+// Hash-conses `t` into `dag`, returning its node. Shared terms are only gone through once.
+static size_t __dulcet_dag_build(struct __dulcet_dag *dag, const struct dulcet_term *t)
+{
+	struct __dulcet_dag_build_stack stack = { 0 };
+	struct __dulcet_dag_node node;
+
+	__dulcet_dag_push_frame(&stack, t, 0);
+
+	while (stack.frames_size > 0) {
+		struct __dulcet_dag_build_frame frame = stack.frames[--stack.frames_size];
+		t = frame.t;
+
+		if (frame.done) {
+			size_t *top = &stack.nodes[stack.nodes_size - 1];
+
+			switch (__DULCET_KIND(t)) {
+			case DULCET_TERM_KIND_ABS:
+				node = (struct __dulcet_dag_node) { .kind = t->kind, .m = *top };
+				*top = __dulcet_dag_intern(dag, node);
+				break;
+			case DULCET_TERM_KIND_APP:
+				node = (struct __dulcet_dag_node) { .kind = t->kind,
+								    .m = top[-1],
+								    .n = *top };
+				stack.nodes_size -= 1;
+				top[-1] = __dulcet_dag_intern(dag, node);
+				break;
+			default:
+				__dulcet_dag_put_ref(dag, t->ref.shared, *top);
+				break;
+			}
+			continue;
+		}
+
+		switch (__DULCET_KIND(t)) {
+		case DULCET_TERM_KIND_VAR:
+			node = (struct __dulcet_dag_node) { .kind = DULCET_TERM_KIND_VAR,
+							    .value = __DULCET_INDEX(t) };
+			__dulcet_dag_push_node(&stack, __dulcet_dag_intern(dag, node));
+			break;
+		case DULCET_TERM_KIND_ABS:
+			__dulcet_dag_push_frame(&stack, t, 1);
+			__dulcet_dag_push_frame(&stack, t->abs.m, 0);
+			break;
+		case DULCET_TERM_KIND_APP:
+			__dulcet_dag_push_frame(&stack, t, 1);
+			__dulcet_dag_push_frame(&stack, t->app.n, 0);
+			__dulcet_dag_push_frame(&stack, t->app.m, 0);
+			break;
+		case DULCET_TERM_KIND_REF: {
+			const size_t *ref = __dulcet_dag_find_ref(dag, t->ref.shared);
+			if (ref) {
+				__dulcet_dag_push_node(&stack, *ref);
+			} else {
+				__dulcet_dag_push_frame(&stack, t, 1);
+				__dulcet_dag_push_frame(&stack, t->ref.shared->m, 0);
+			}
+			break;
+		}
+		case DULCET_TERM_KIND_INT:
+			node = (struct __dulcet_dag_node) { .kind = t->kind,
+							    .value = t->integer.value,
+							    .t = t };
+			__dulcet_dag_push_node(&stack, __dulcet_dag_intern(dag, node));
+			break;
+		case DULCET_TERM_KIND_BOOL:
+			node = (struct __dulcet_dag_node) { .kind = t->kind,
+							    .value = t->boolean.value,
+							    .t = t };
+			__dulcet_dag_push_node(&stack, __dulcet_dag_intern(dag, node));
+			break;
+		case DULCET_TERM_KIND_PRIM:
+			node = (struct __dulcet_dag_node) { .kind = t->kind,
+							    .value = t->prim.op,
+							    .t = t };
+			__dulcet_dag_push_node(&stack, __dulcet_dag_intern(dag, node));
+			break;
+		default:
+			__dulcet_fatal("unknown term kind");
+		}
+	}
+
+	size_t root = stack.nodes[0];
+
+	free(stack.frames);
+	free(stack.nodes);
+
+	return root;
+}
+
+// Counts the occurrences of each node in the output, from the root down to the nodes it is made
+// of, which come before it, and binds those that are closed and worth it
+static void __dulcet_dag_bind(struct __dulcet_dag *dag, size_t root)
+{
+	size_t bindings = 0;
+
+	dag->nodes[root].refs = 1;
+
+	for (size_t i = root + 1; i > 0; --i) {
+		struct __dulcet_dag_node *node = &dag->nodes[i - 1];
+		if (node->refs == 0) {
+			continue;
+		}
+
+		size_t refs = node->refs;
+		if (i - 1 != root && node->refs > 1 && node->free == 0 && node->size > 2 &&
+		    (node->kind == DULCET_TERM_KIND_ABS || node->kind == DULCET_TERM_KIND_APP)) {
+			node->binding = 1;
+			refs = 1;
+		}
+
+		if (node->kind == DULCET_TERM_KIND_ABS || node->kind == DULCET_TERM_KIND_APP) {
+			struct __dulcet_dag_node *m = &dag->nodes[node->m];
+			m->refs = __dulcet_saturating_add(m->refs, refs);
+		}
+		if (node->kind == DULCET_TERM_KIND_APP) {
+			struct __dulcet_dag_node *n = &dag->nodes[node->n];
+			n->refs = __dulcet_saturating_add(n->refs, refs);
+		}
+	}
+
+	// Bindings are numbered in the order they are written, each after those it refers to
+	for (size_t i = 0; i < root; ++i) {
+		if (dag->nodes[i].binding) {
+			dag->nodes[i].binding = ++bindings;
+		}
+	}
+}
+
+static void __dulcet_printer_put_binding(struct __dulcet_printer *p, size_t binding)
+{
+	char buf[sizeof(binding) * 3 + 1];
+
+	__dulcet_printer_write(p, buf, (size_t) snprintf(buf, sizeof(buf), "$%zu", binding));
+}
+
+// Pending work of the shared printers, a node or, if there is none, a closing character
+struct __dulcet_dag_print_frame {
+	size_t node;
+	char c;
+	unsigned char context_precedence;
+	unsigned int depth;
+};
+
+#define __DULCET_DAG_NO_NODE SIZE_MAX
+
+static void __dulcet_dag_print_push(struct __dulcet_dag_print_frame **stack, size_t *size,
+				    size_t *capacity, struct __dulcet_dag_print_frame frame)
+{
+	if (*size == *capacity) {
+		*capacity = *capacity ? 2 * *capacity : 64;
+		*stack = realloc(*stack, *capacity * sizeof(**stack));
+		if (!*stack) {
+			__dulcet_fatal("out of memory");
+		}
+	}
+
+	(*stack)[(*size)++] = frame;
+}
+
+// Writes the node `root` of `dag`, referring to the bindings of the nodes it is made of
+static void __dulcet_dag_print_node(const struct __dulcet_dag *dag, size_t root, int de_bruijn,
+				    struct __dulcet_printer *p)
+{
+	struct __dulcet_dag_print_frame *stack = NULL;
+	size_t stack_size = 0;
+	size_t stack_capacity = 0;
+
+#define __DULCET_DAG_PRINT_PUSH(...)                                      \
+	__dulcet_dag_print_push(&stack, &stack_size, &stack_capacity,     \
+				(struct __dulcet_dag_print_frame) { __VA_ARGS__ })
+
+	__DULCET_DAG_PRINT_PUSH(.node = root);
+
+	while (stack_size > 0) {
+		struct __dulcet_dag_print_frame frame = stack[--stack_size];
+
+		if (frame.node == __DULCET_DAG_NO_NODE) {
+			__dulcet_printer_putc(p, frame.c);
+			continue;
+		}
+
+		const struct __dulcet_dag_node *node = &dag->nodes[frame.node];
+
+		if (node->binding && frame.node != root) {
+			__dulcet_printer_put_binding(p, node->binding);
+			continue;
+		}
+
+		switch (node->kind) {
+		case DULCET_TERM_KIND_VAR: {
+			unsigned int index = (unsigned int) node->value;
+			if (de_bruijn) {
+				__dulcet_printer_putu(p, index);
+			} else if (frame.depth >= index) {
+				__dulcet_printer_putc(p, 'a' + frame.depth - index);
+			} else {
+				__dulcet_printer_putc(p, 'a' + index - 1);
+			}
+			break;
+		}
+		case DULCET_TERM_KIND_ABS:
+			if (frame.context_precedence > 1) {
+				__dulcet_printer_putc(p, '(');
+				__DULCET_DAG_PRINT_PUSH(.node = __DULCET_DAG_NO_NODE, .c = ')');
+			}
+
+			__dulcet_printer_write(p, __DULCET_LAMBDA, sizeof(__DULCET_LAMBDA) - 1);
+			if (!de_bruijn) {
+				__dulcet_printer_putc(p, 'a' + frame.depth);
+				__dulcet_printer_putc(p, '.');
+			}
+
+			__DULCET_DAG_PRINT_PUSH(.node = node->m, .depth = frame.depth + 1);
+			break;
+		case DULCET_TERM_KIND_APP:
+			if (frame.context_precedence == 3) {
+				__dulcet_printer_putc(p, '(');
+				__DULCET_DAG_PRINT_PUSH(.node = __DULCET_DAG_NO_NODE, .c = ')');
+			}
+
+			__DULCET_DAG_PRINT_PUSH(.node = node->n, .context_precedence = 3,
+						.depth = frame.depth);
+			__DULCET_DAG_PRINT_PUSH(.node = __DULCET_DAG_NO_NODE, .c = ' ');
+			__DULCET_DAG_PRINT_PUSH(.node = node->m, .context_precedence = 2,
+						.depth = frame.depth);
+			break;
+		default:
+			__dulcet_printer_put_constant(p, node->t, de_bruijn);
+			break;
+		}
+	}
+
+#undef __DULCET_DAG_PRINT_PUSH
+
+	free(stack);
+}
+
+static int __dulcet_term_print_shared_iter(const struct dulcet_term *t, int de_bruijn,
+					   struct __dulcet_printer *p)
+{
+	struct __dulcet_dag dag = { 0 };
+
+	size_t root = __dulcet_dag_build(&dag, t);
+	__dulcet_dag_bind(&dag, root);
+
+	for (size_t i = 0; i < root; ++i) {
+		if (dag.nodes[i].binding) {
+			__dulcet_printer_write(p, "let ", 4);
+			__dulcet_printer_put_binding(p, dag.nodes[i].binding);
+			__dulcet_printer_write(p, " = ", 3);
+			__dulcet_dag_print_node(&dag, i, de_bruijn, p);
+			__dulcet_printer_write(p, " in ", 4);
+		}
+	}
+	__dulcet_dag_print_node(&dag, root, de_bruijn, p);
+
+	free(dag.nodes);
+	free(dag.table);
+	free(dag.refs);
+
+	return 0;
+}
+
+int dulcet_term_fprint_classic_shared(const struct dulcet_term *t, FILE *fp)
+{
+	unsigned long long start = dulcet_stats_time();
+
+	struct __dulcet_printer p = __dulcet_printer_to_file(fp);
+	int rc = __dulcet_printer_finish(&p, __dulcet_term_print_shared_iter(t, 0, &p));
+
+	dulcet_stats_add_time(DULCET_PHASE_PRINT, dulcet_stats_time() - start);
+
+	return rc;
+}
+
+int dulcet_term_fprint_de_bruijn_shared(const struct dulcet_term *t, FILE *fp)
+{
+	unsigned long long start = dulcet_stats_time();
+
+	struct __dulcet_printer p = __dulcet_printer_to_file(fp);
+	int rc = __dulcet_printer_finish(&p, __dulcet_term_print_shared_iter(t, 1, &p));
+
+	dulcet_stats_add_time(DULCET_PHASE_PRINT, dulcet_stats_time() - start);
+
+	return rc;
+}
+
+int dulcet_term_snprint_classic_shared(const struct dulcet_term *t, char *buf, size_t size)
+{
+	unsigned long long start = dulcet_stats_time();
+
+	struct __dulcet_printer p = __dulcet_printer_to_string(buf, size > 0 ? size - 1 : 0);
+
+	int rc;
+	__DULCET_TRY(rc, __dulcet_printer_finish(&p, __dulcet_term_print_shared_iter(t, 0, &p)));
+
+	if (size > 0) {
+		buf[p.size] = '\0';
+	}
+
+	dulcet_stats_add_time(DULCET_PHASE_PRINT, dulcet_stats_time() - start);
+
+	return rc;
+}
+
+int dulcet_term_snprint_de_bruijn_shared(const struct dulcet_term *t, char *buf, size_t size)
+{
+	unsigned long long start = dulcet_stats_time();
+
+	struct __dulcet_printer p = __dulcet_printer_to_string(buf, size > 0 ? size - 1 : 0);
+
+	int rc;
+	__DULCET_TRY(rc, __dulcet_printer_finish(&p, __dulcet_term_print_shared_iter(t, 1, &p)));
+
+	if (size > 0) {
+		buf[p.size] = '\0';
+	}
+
+	dulcet_stats_add_time(DULCET_PHASE_PRINT, dulcet_stats_time() - start);
+
+	return rc;
+}
+
+#undef __DULCET_TRY
+
+static void __dulcet_instantiate(struct dulcet_term *t);
+
+static void __dulcet_update_free_variables(struct dulcet_term **t, unsigned int added_depth,
+					   unsigned int own_depth)
+{
+	assert(*t);
+
+	__DULCET_STATS({
+		__dulcet_stats.nodes_shifted += 1;
+		__dulcet_stats_enter();
+	});
+
+	switch (__DULCET_KIND(*t)) {
+	case DULCET_TERM_KIND_VAR:
+		if (__DULCET_INDEX(*t) > own_depth) {
+			__dulcet_set_index(t, __DULCET_INDEX(*t) + added_depth);
+		}
+		break;
+	case DULCET_TERM_KIND_ABS:
+		__dulcet_update_free_variables(&(*t)->abs.m, added_depth, own_depth + 1);
+		break;
+	case DULCET_TERM_KIND_APP:
+		__dulcet_update_free_variables(&(*t)->app.m, added_depth, own_depth);
+		__dulcet_update_free_variables(&(*t)->app.n, added_depth, own_depth);
+		break;
+	case DULCET_TERM_KIND_REF:
+		if ((*t)->ref.shared->open &&
+		    !__dulcet_term_closed_at((*t)->ref.shared->m, own_depth)) {
+			__dulcet_instantiate(*t);
+			__dulcet_update_free_variables(t, added_depth, own_depth);
+		}
+		break;
+	case DULCET_TERM_KIND_INT:
+	case DULCET_TERM_KIND_BOOL:
+	case DULCET_TERM_KIND_PRIM:
+		break;
+	default:
+		__dulcet_fatal("unknown term kind");
+	}
+
+	__DULCET_STATS(__dulcet_stats_leave());
+}
+
+// Substitutions made on the calling thread, to attribute them to the steps that made them
+static _Thread_local unsigned long long __dulcet_substitutions = 0;
+
+// The occurrences of the parameter are only known once the body has been walked, which it has to
+// be anyway to renumber its free variables. So the first one found is set aside, every later one
+// receives a copy of the argument, and the argument itself is then moved into the first. A
+// parameter used once thus costs no copy, and one that is unused, only freeing the argument. As
+// variables are mostly immediates, occurrences are replaced through the pointers to them.
+struct __dulcet_apply_state {
+	const struct dulcet_term *rhs;
+	struct dulcet_term **first;
+	unsigned int first_depth;
+};
+
+static void __dulcet_apply_rec(struct dulcet_term **t, struct __dulcet_apply_state *state,
+			       unsigned int depth)
+{
+	__DULCET_STATS(__dulcet_stats_enter());
+
+	switch (__DULCET_KIND(*t)) {
+	case DULCET_TERM_KIND_VAR: {
+		unsigned int index = __DULCET_INDEX(*t);
+
+		if (index == depth) {
+			__DULCET_STATS(__dulcet_stats.substitutions += 1);
+			__dulcet_substitutions += 1;
+
+			if (!state->first) {
+				state->first = t;
+				state->first_depth = depth;
+				break;
+			}
+
+			struct dulcet_term *s = dulcet_term_copy(state->rhs);
+			if (depth > 1) {
+				__dulcet_update_free_variables(&s, depth - 1, 0);
+			}
+
+			if (!__DULCET_IMMEDIATE(*t)) {
+				__dulcet_node_free(*t);
+			}
+			*t = s;
+		} else if (index > depth) {
+			__dulcet_set_index(t, index - 1);
+		}
+		break;
+	}
+	case DULCET_TERM_KIND_ABS:
+		__dulcet_apply_rec(&(*t)->abs.m, state, depth + 1);
+		break;
+	case DULCET_TERM_KIND_APP:
+		__dulcet_apply_rec(&(*t)->app.m, state, depth);
+		__dulcet_apply_rec(&(*t)->app.n, state, depth);
+		break;
+	case DULCET_TERM_KIND_REF:
+		// Only variables bound by the abstraction being applied, or outside of it, change
+		if ((*t)->ref.shared->open &&
+		    !__dulcet_term_closed_at((*t)->ref.shared->m, depth - 1)) {
+			__dulcet_instantiate(*t);
+			__dulcet_apply_rec(t, state, depth);
+		}
+		break;
+	case DULCET_TERM_KIND_INT:
+	case DULCET_TERM_KIND_BOOL:
+	case DULCET_TERM_KIND_PRIM:
+		break;
+	default:
+		__dulcet_fatal("unknown term kind");
+	}
+
+	__DULCET_STATS(__dulcet_stats_leave());
+}
+
+void dulcet_apply(struct dulcet_term *t, struct dulcet_term *rhs)
+{
+	assert(t && __DULCET_KIND(t) == DULCET_TERM_KIND_ABS);
+
+	struct __dulcet_apply_state state = {
+		.rhs = rhs,
+		.first = NULL,
+		.first_depth = 0,
+	};
+
+	__dulcet_apply_rec(&t->abs.m, &state, 1);
+
+	if (state.first) {
+		__DULCET_STATS(__dulcet_stats.arguments_moved += 1);
+
+		if (!__DULCET_IMMEDIATE(*state.first)) {
+			__dulcet_node_free(*state.first);
+		}
+		*state.first = rhs;
+		if (state.first_depth > 1) {
+			__dulcet_update_free_variables(state.first, state.first_depth - 1, 0);
+		}
+	} else {
+		__DULCET_STATS(__dulcet_stats.arguments_erased += 1);
+
+		dulcet_term_free(rhs);
+	}
+
+	__dulcet_move(t, t->abs.m);
+}
+
+// Hook called after each beta reduction step on the calling thread, and the size of the term being
+// reduced, kept up to date by the reducers while there is a hook
+static _Thread_local dulcet_step_hook __dulcet_step_hook = NULL;
+static _Thread_local void *__dulcet_step_hook_data = NULL;
+static _Thread_local unsigned long long __dulcet_step_hook_steps = 0;
+static _Thread_local size_t __dulcet_term_size = 0;
+static _Thread_local int __dulcet_reducing = 0;
+
+void dulcet_set_step_hook(dulcet_step_hook hook, void *data)
+{
+	__dulcet_step_hook = hook;
+	__dulcet_step_hook_data = data;
+	__dulcet_step_hook_steps = 0;
+}
+
+static _Thread_local struct dulcet_profile *__dulcet_profile = NULL;
+
+void dulcet_profile_init(struct dulcet_profile *profile)
+{
+	*profile = (struct dulcet_profile) {
+		.entries = NULL,
+		.size = 0,
+		.capacity = 0,
+		.source = NULL,
+		.line_offset = 0,
+		.column_offset = 0,
+	};
+}
+
+void dulcet_profile_deinit(struct dulcet_profile *profile)
+{
+	for (size_t i = 0; i < profile->size; ++i) {
+		free(profile->entries[i].parameter);
+	}
+
+	free(profile->entries);
+}
+
+unsigned int dulcet_profile_add(struct dulcet_profile *profile, const char *parameter,
+				unsigned int parameter_len, unsigned int line, unsigned int column)
+{
+	// Once origins run out, further lambdas are simply not attributed
+	if (profile->size >= UINT_MAX) {
+		return 0;
+	}
+
+	if (profile->size == profile->capacity) {
+		profile->capacity = profile->capacity ? 2 * profile->capacity : 64;
+		profile->entries =
+			realloc(profile->entries, profile->capacity * sizeof(*profile->entries));
+		if (!profile->entries) {
+			__dulcet_fatal("out of memory");
+		}
+	}
+
+	char *parameter_copy = NULL;
+	if (parameter) {
+		parameter_copy = malloc(parameter_len + 1);
+		if (!parameter_copy) {
+			__dulcet_fatal("out of memory");
+		}
+		memcpy(parameter_copy, parameter, parameter_len);
+		parameter_copy[parameter_len] = '\0';
+	}
+
+	profile->entries[profile->size] = (struct dulcet_profile_entry) {
+		.source = profile->source,
+		.parameter = parameter_copy,
+		.line = line + profile->line_offset,
+		.column = line == 1 ? column + profile->column_offset : column,
+		.reductions = 0,
+		.substitutions = 0,
+		.nodes_copied = 0,
+	};
+	profile->size += 1;
+
+	return profile->size;
+}
+
+void dulcet_set_profile(struct dulcet_profile *profile)
+{
+	__dulcet_profile = profile;
+}
+
+struct dulcet_profile *dulcet_get_profile(void)
+{
+	return __dulcet_profile;
+}
+
+static void __dulcet_eval(struct dulcet_term *t)
+{
+	struct dulcet_term *tmp = t->app.m;
+
+	__DULCET_STATS(__dulcet_stats.beta_steps[__dulcet_strategy] += 1);
+
+	unsigned int origin = tmp->abs.origin;
+	if (__dulcet_profile && origin > 0) {
+		unsigned long long substitutions = __dulcet_substitutions;
+		size_t argument_size = dulcet_term_size(t->app.n);
+
+		dulcet_apply(t->app.m, t->app.n);
+
+		struct dulcet_profile_entry *entry = &__dulcet_profile->entries[origin - 1];
+		substitutions = __dulcet_substitutions - substitutions;
+
+		entry->reductions += 1;
+		entry->substitutions += substitutions;
+		if (substitutions > 0) {
+			entry->nodes_copied += (substitutions - 1) * argument_size;
+		}
+	} else {
+		dulcet_apply(t->app.m, t->app.n);
+	}
+
+	*t = *t->app.m;
+
+	__dulcet_node_free(tmp);
+}
+
+static void __dulcet_eval_at(struct dulcet_term *t, unsigned int depth)
+{
+	assert(t && __DULCET_KIND(t) == DULCET_TERM_KIND_APP);
+
+	if (!__dulcet_step_hook) {
+		__dulcet_eval(t);
+		return;
+	}
+
+	struct dulcet_step_event event = {
+		.step = ++__dulcet_step_hook_steps,
+		.depth = depth,
+		.body_size = dulcet_term_size(t->app.m->abs.m),
+		.argument_size = dulcet_term_size(t->app.n),
+		.result = t,
+	};
+
+	__dulcet_eval(t);
+
+	size_t result_size = dulcet_term_size(t);
+
+	if (__dulcet_reducing) {
+		__dulcet_term_size += result_size;
+		__dulcet_term_size -= 2 + event.body_size + event.argument_size;
+	} else {
+		__dulcet_term_size = result_size;
+	}
+
+	event.result_size = result_size;
+	event.term_size = __dulcet_term_size;
+
+	__dulcet_step_hook(&event, __dulcet_step_hook_data);
+}
+
+// Replaces `t`, which refers to a shared term, with a copy of the term
+static void __dulcet_instantiate(struct dulcet_term *t)
+{
+	struct dulcet_shared *shared = t->ref.shared;
+	__DULCET_STATS(__dulcet_stats.refs_instantiated += 1);
+
+	struct dulcet_term *s = dulcet_term_copy(shared->m);
+
+	// The reference counted as a single node of the term being reduced
+	if (__dulcet_step_hook && __dulcet_reducing) {
+		__dulcet_term_size += dulcet_term_size(s) - 1;
+	}
+
+	__dulcet_move(t, s);
+	__dulcet_shared_release(shared);
+}
+
+void dulcet_eval(struct dulcet_term *t)
+{
+	assert(t && __DULCET_KIND(t) == DULCET_TERM_KIND_APP);
+
+	while (__DULCET_KIND(t->app.m) == DULCET_TERM_KIND_REF) {
+		__dulcet_instantiate(t->app.m);
+	}
+
+	__dulcet_eval_at(t, 0);
+}
+
+// Limits of the reducers on the calling thread, the steps they took since they were set, and why
+// they stopped, if they did. The deadline is only checked once every few steps, as reading the
+// clock costs more than a step on small terms.
+static _Thread_local struct dulcet_limits __dulcet_limits = {
+	.steps = DULCET_UNLIMITED_STEPS,
+	.depth = UINT_MAX,
+};
+static _Thread_local unsigned long __dulcet_steps_taken;
+static _Thread_local unsigned long long __dulcet_deadline;
+static _Thread_local int __dulcet_governed;
+static _Thread_local enum dulcet_status __dulcet_status = DULCET_STATUS_OK;
+
+#define __DULCET_DEADLINE_CHECK_INTERVAL 256
+
+// Interruptions so far, process wide, and how many of them the calling thread already saw when it
+// set its limits
+static atomic_ulong __dulcet_interrupts;
+static _Thread_local unsigned long __dulcet_interrupts_seen;
+
+// Set on the threads of a portfolio, which stop once another one found the normal form
+static _Thread_local const atomic_int *__dulcet_cancel;
+
+// Reductions that go round in circles are found by comparing the term being reduced in place with
+// a copy of it, taken again after 2, 4, 8 and so on checks as in Brent's algorithm, so that once
+// in a cycle, the copy is eventually kept for longer than the cycle lasts. Each reducer takes the
+// same step from the same term, so coming back to the copy means it never ends. The terms are
+// compared by hash first, and the checks are spaced by a number of steps in proportion to the
+// largest size of the term so far, so that hashing costs a few nodes per step. As the terms of a
+// cycle are no larger than some size, the spacing eventually stays the same, as Brent's needs.
+struct __dulcet_cycle {
+	struct dulcet_term *root;
+	struct dulcet_term *copy;
+	uint64_t hash;
+	unsigned long power;
+	unsigned long checks;
+	unsigned long interval;
+	unsigned long countdown;
+};
+
+static _Thread_local struct __dulcet_cycle __dulcet_cycle;
+
+#define __DULCET_CYCLE_NODES_PER_STEP 32
+
+const char *dulcet_status_name(enum dulcet_status status)
+{
+	switch (status) {
+	case DULCET_STATUS_OK:
+		return "ok";
+	case DULCET_STATUS_STEP_LIMIT:
+		return "step_limit";
+	case DULCET_STATUS_MEMORY_LIMIT:
+		return "memory_limit";
+	case DULCET_STATUS_DEADLINE:
+		return "deadline";
+	case DULCET_STATUS_INTERRUPTED:
+		return "interrupted";
+	case DULCET_STATUS_DIVERGED:
+		return "diverged";
+	case DULCET_STATUS_DEPTH_LIMIT:
+		return "depth_limit";
+	}
+
+	return "unknown";
+}
+
+void dulcet_set_limits(const struct dulcet_limits *limits)
+{
+	assert(limits);
+
+	__dulcet_limits = *limits;
+	if (__dulcet_limits.steps == 0) {
+		__dulcet_limits.steps = DULCET_UNLIMITED_STEPS;
+	}
+	if (__dulcet_limits.depth == 0) {
+		__dulcet_limits.depth = UINT_MAX;
+	}
+
+	// The byte limit is enforced as the node limit it amounts to, whichever is lower
+	unsigned long long bytes_nodes = __dulcet_limits.bytes / sizeof(struct dulcet_term);
+	if (__dulcet_limits.bytes > 0 &&
+	    (__dulcet_limits.nodes == 0 || bytes_nodes < __dulcet_limits.nodes)) {
+		__dulcet_limits.nodes = bytes_nodes > 0 ? bytes_nodes : 1;
+	}
+
+	__dulcet_deadline = __dulcet_limits.time_ns > 0 ? __dulcet_now() + __dulcet_limits.time_ns : 0;
+	__dulcet_governed = __dulcet_limits.nodes > 0 || __dulcet_deadline > 0 ||
+			    __dulcet_limits.divergence;
+
+	__dulcet_steps_taken = 0;
+	__dulcet_status = DULCET_STATUS_OK;
+	__dulcet_interrupts_seen = atomic_load_explicit(&__dulcet_interrupts, memory_order_relaxed);
+}
+
+void dulcet_interrupt(void)
+{
+	atomic_fetch_add_explicit(&__dulcet_interrupts, 1, memory_order_relaxed);
+}
+
+enum dulcet_status dulcet_status(void)
+{
+	return __dulcet_status;
+}
+
+unsigned long dulcet_steps_taken(void)
+{
+	return __dulcet_steps_taken;
+}
+
+void dulcet_set_step_limit(unsigned long limit)
+{
+	struct dulcet_limits limits = { .steps = limit };
+
+	dulcet_set_limits(&limits);
+}
+
+unsigned long dulcet_steps_left(void)
+{
+	if (__dulcet_limits.steps == DULCET_UNLIMITED_STEPS) {
+		return DULCET_UNLIMITED_STEPS;
+	}
+
+	return __dulcet_limits.steps - __dulcet_steps_taken;
+}
+
+int dulcet_step_limit_reached(void)
+{
+	return __dulcet_status == DULCET_STATUS_STEP_LIMIT;
+}
+
+// Hashes `t` in preorder, which is enough to tell terms apart, looking into shared terms as
+// `dulcet_term_eq` does, and measures it on the way
+static uint64_t __dulcet_term_hash(const struct dulcet_term *t, size_t *size)
+{
+	const struct dulcet_term **stack = NULL;
+	size_t stack_size = 0;
+	size_t stack_capacity = 0;
+	uint64_t hash = 0xcbf29ce484222325;
+
+	*size = 0;
+
+	for (;;) {
+		t = __dulcet_deref(t);
+		*size += 1;
+
+		uint64_t token = __DULCET_KIND(t);
+		switch (token) {
+		case DULCET_TERM_KIND_VAR:
+			token |= (uint64_t) __DULCET_INDEX(t) << 3;
+			break;
+		case DULCET_TERM_KIND_INT:
+			token |= (uint64_t) t->integer.value << 3;
+			break;
+		case DULCET_TERM_KIND_BOOL:
+			token |= (uint64_t) t->boolean.value << 3;
+			break;
+		case DULCET_TERM_KIND_PRIM:
+			token |= (uint64_t) t->prim.op << 3;
+			break;
+		}
+		hash = (hash ^ token) * 0x100000001b3;
+
+		switch (__DULCET_KIND(t)) {
+		case DULCET_TERM_KIND_VAR:
+		case DULCET_TERM_KIND_INT:
+		case DULCET_TERM_KIND_BOOL:
+		case DULCET_TERM_KIND_PRIM:
+			if (stack_size == 0) {
+				free(stack);
+				return hash;
+			}
+			t = stack[--stack_size];
+			break;
+		case DULCET_TERM_KIND_ABS:
+			t = t->abs.m;
+			break;
+		case DULCET_TERM_KIND_APP:
+			if (stack_size == stack_capacity) {
+				stack_capacity = stack_capacity ? 2 * stack_capacity : 64;
+				stack = realloc(stack, stack_capacity * sizeof(*stack));
+				if (!stack) {
+					__dulcet_fatal("out of memory");
+				}
+			}
+			stack[stack_size++] = t->app.n;
+			t = t->app.m;
+			break;
+		default:
+			__dulcet_fatal("unknown term kind");
+		}
+	}
+}
+
+static void __dulcet_cycle_start(struct dulcet_term *root)
+{
+	__dulcet_cycle = (struct __dulcet_cycle) {
+		.root = root,
+		.power = 1,
+		.interval = 1,
+		.countdown = 1,
+	};
+}
+
+static void __dulcet_cycle_stop(void)
+{
+	if (__dulcet_cycle.copy) {
+		dulcet_term_free(__dulcet_cycle.copy);
+	}
+
+	__dulcet_cycle_start(NULL);
+}
+
+// Compares the term being reduced with the copy, returning 0 if it came back to it
+static int __dulcet_cycle_check(void)
+{
+	struct __dulcet_cycle *c = &__dulcet_cycle;
+	size_t size;
+	uint64_t hash = __dulcet_term_hash(c->root, &size);
+
+	if (c->copy && hash == c->hash && dulcet_term_eq(c->root, c->copy)) {
+		return 0;
+	}
+
+	c->checks += 1;
+	if (!c->copy || c->checks == c->power) {
+		if (c->copy) {
+			dulcet_term_free(c->copy);
+		}
+
+		c->copy = dulcet_term_copy(c->root);
+		c->hash = hash;
+		c->power *= 2;
+		c->checks = 0;
+	}
+
+	if (c->interval < 1 + size / __DULCET_CYCLE_NODES_PER_STEP) {
+		c->interval = 1 + size / __DULCET_CYCLE_NODES_PER_STEP;
+	}
+	c->countdown = c->interval;
+
+	return 1;
+}
+
+// Checks the limits that cost more than a comparison, only when any of them is set
+static int __dulcet_govern(void)
+{
+	if (__dulcet_cancel && atomic_load_explicit(__dulcet_cancel, memory_order_relaxed)) {
+		__dulcet_status = DULCET_STATUS_INTERRUPTED;
+		return 0;
+	}
+
+	if (__dulcet_limits.nodes > 0 && __dulcet_live_nodes > 0 &&
+	    (unsigned long long) __dulcet_live_nodes > __dulcet_limits.nodes) {
+		__dulcet_status = DULCET_STATUS_MEMORY_LIMIT;
+		return 0;
+	}
+
+	if (__dulcet_deadline > 0 && __dulcet_steps_taken % __DULCET_DEADLINE_CHECK_INTERVAL == 0 &&
+	    __dulcet_now() >= __dulcet_deadline) {
+		__dulcet_status = DULCET_STATUS_DEADLINE;
+		return 0;
+	}
+
+	if (__dulcet_cycle.root && --__dulcet_cycle.countdown == 0 && !__dulcet_cycle_check()) {
+		__dulcet_status = DULCET_STATUS_DIVERGED;
+		return 0;
+	}
+
+	return 1;
+}
+
+static inline int __dulcet_take_step(void)
+{
+	if (__dulcet_status != DULCET_STATUS_OK) {
+		return 0;
+	}
+
+	if (__dulcet_steps_taken == __dulcet_limits.steps) {
+		__dulcet_status = DULCET_STATUS_STEP_LIMIT;
+		return 0;
+	}
+
+	if (atomic_load_explicit(&__dulcet_interrupts, memory_order_relaxed) !=
+	    __dulcet_interrupts_seen) {
+		__dulcet_status = DULCET_STATUS_INTERRUPTED;
+		return 0;
+	}
+
+	if (__dulcet_governed && !__dulcet_govern()) {
+		return 0;
+	}
+
+	__dulcet_steps_taken += 1;
+
+	return 1;
+}
+
+static void __dulcet_beta_cbn_rec(struct dulcet_term *t, unsigned int depth);
+
+// Contracts `t`, an application of a primitive to all of its arguments, in place, returning
+// whether it did. Only the weak head normal forms of its strict arguments are needed, which are
+// thus reduced by name whatever the strategy, and if they are not constants of the right kinds,
+// `t` is left as it is, stuck.
+static int __dulcet_delta(struct dulcet_term *t, unsigned int depth)
+{
+	const struct dulcet_term *prim = __dulcet_delta_prim(t->app.m);
+	if (!prim) {
+		return 0;
+	}
+
+	enum dulcet_prim_op op = prim->prim.op;
+	unsigned int arity = __dulcet_prims[op].arity;
+
+	// The spine is owned by `t` from here on, and is freed along with the primitive. Every
+	// primitive takes at least two arguments, which are thus all set below.
+	struct dulcet_term **arguments[__DULCET_PRIM_MAX_ARITY] = { 0 };
+	assert(arity >= 2 && arity <= __DULCET_PRIM_MAX_ARITY);
+	struct dulcet_term *s = t;
+
+	for (unsigned int i = arity; i-- > 0;) {
+		arguments[i] = &s->app.n;
+
+		while (__DULCET_KIND(s->app.m) == DULCET_TERM_KIND_REF) {
+			__dulcet_instantiate(s->app.m);
+		}
+		s = s->app.m;
+	}
+
+	unsigned int strict = op == DULCET_PRIM_OP_IF ? 1 : arity;
+	for (unsigned int i = 0; i < strict; ++i) {
+		__dulcet_beta_cbn_rec(*arguments[i], depth + arity - i);
+	}
+
+	const struct dulcet_term *a = *arguments[0];
+	const struct dulcet_term *b = *arguments[1];
+	struct dulcet_term result = { .kind = DULCET_TERM_KIND_BOOL };
+
+	if (op == DULCET_PRIM_OP_IF) {
+		if (__DULCET_KIND(a) != DULCET_TERM_KIND_BOOL) {
+			return 0;
+		}
+	} else if (op == DULCET_PRIM_OP_EQ && __DULCET_KIND(a) == DULCET_TERM_KIND_BOOL &&
+		   __DULCET_KIND(b) == DULCET_TERM_KIND_BOOL) {
+		result.boolean.value = a->boolean.value == b->boolean.value;
+	} else {
+		if (__DULCET_KIND(a) != DULCET_TERM_KIND_INT ||
+		    __DULCET_KIND(b) != DULCET_TERM_KIND_INT) {
+			return 0;
+		}
+
+		// Computed unsigned, so as to wrap around rather than overflow
+		unsigned long long x = (unsigned long long) a->integer.value;
+		unsigned long long y = (unsigned long long) b->integer.value;
+
+		result.kind = DULCET_TERM_KIND_INT;
+
+		switch (op) {
+		case DULCET_PRIM_OP_ADD:
+			result.integer.value = (long long) (x + y);
+			break;
+		case DULCET_PRIM_OP_SUB:
+			result.integer.value = (long long) (x - y);
+			break;
+		case DULCET_PRIM_OP_MUL:
+			result.integer.value = (long long) (x * y);
+			break;
+		case DULCET_PRIM_OP_DIV:
+			if (y == 0) {
+				return 0;
+			}
+			result.integer.value = b->integer.value == -1
+						       ? (long long) (0 - x)
+						       : a->integer.value / b->integer.value;
+			break;
+		case DULCET_PRIM_OP_EQ:
+			result.kind = DULCET_TERM_KIND_BOOL;
+			result.boolean.value = x == y;
+			break;
+		case DULCET_PRIM_OP_LT:
+			result.kind = DULCET_TERM_KIND_BOOL;
+			result.boolean.value = a->integer.value < b->integer.value;
+			break;
+		default:
+			__dulcet_fatal("unknown primitive");
+		}
+	}
+
+	if (!__dulcet_take_step()) {
+		return 0;
+	}
+
+	__DULCET_STATS(__dulcet_stats.delta_steps += 1);
+
+	size_t redex_size = __dulcet_step_hook ? dulcet_term_size(t) : 0;
+
+	if (op == DULCET_PRIM_OP_IF) {
+		// The branch taken is moved out of the spine before the rest of it is freed
+		struct dulcet_term **taken = arguments[a->boolean.value ? 1 : 2];
+		struct dulcet_term *branch = *taken;
+		*taken = dulcet_alloc_var(1);
+
+		struct dulcet_term *m = t->app.m;
+		struct dulcet_term *n = t->app.n;
+		__dulcet_move(t, branch);
+
+		dulcet_term_free(m);
+		dulcet_term_free(n);
+	} else {
+		dulcet_term_free(t->app.m);
+		dulcet_term_free(t->app.n);
+		*t = result;
+	}
+
+	if (__dulcet_step_hook && __dulcet_reducing) {
+		__dulcet_term_size += dulcet_term_size(t) - redex_size;
+	}
+
+	return 1;
+}
+
+// Applications of a variable, the most common of those that are not beta redexes, are told apart
+// from delta redexes without a call
+#define __DULCET_DELTA(t, depth) (!__DULCET_IMMEDIATE((t)->app.m) && __dulcet_delta(t, depth))
+
+// Each step replaces the redex `t` with its contractum in place, which the reducers then go on to
+// reduce by looping rather than by recursing, so that a reduction that never ends is stopped by
+// its limits instead of overflowing the stack. Shared terms are instantiated once a reducer has to
+// look into them: at the head of an application by each, and anywhere else by normal and
+// applicative order, unless they are in normal form already.
+
+static void __dulcet_beta_cbn_rec(struct dulcet_term *t, unsigned int depth)
+{
+	assert(t);
+
+	while (__DULCET_KIND(t) == DULCET_TERM_KIND_REF) {
+		__dulcet_instantiate(t);
+	}
+
+	if (__DULCET_KIND(t) == DULCET_TERM_KIND_APP) {
+		if (depth > __dulcet_limits.depth) {
+			__dulcet_status = DULCET_STATUS_DEPTH_LIMIT;
+			return;
+		}
+
+		__DULCET_STATS(__dulcet_stats_enter());
+
+		while (__DULCET_KIND(t) == DULCET_TERM_KIND_APP) {
+			__dulcet_beta_cbn_rec(t->app.m, depth + 1);
+
+			if (t->app.m && __DULCET_KIND(t->app.m) == DULCET_TERM_KIND_ABS) {
+				if (!__dulcet_take_step()) {
+					break;
+				}
+
+				__dulcet_eval_at(t, depth);
+			} else if (!__DULCET_DELTA(t, depth)) {
+				break;
+			}
+
+			while (__DULCET_KIND(t) == DULCET_TERM_KIND_REF) {
+				__dulcet_instantiate(t);
+			}
+		}
+
+		__DULCET_STATS(__dulcet_stats_leave());
+	}
+}
+
+static void __dulcet_beta_nor_rec(struct dulcet_term *t, unsigned int depth);
+
+// Reduces the application `t`, whose head call by name could not get any further, in normal
+// order, once the caller entered it. Neither could it on the applications along its spine, which
+// are thus left alone rather than walked again down to the head, as that takes time in the square
+// of the length of the spine.
+static void __dulcet_beta_nor_stuck(struct dulcet_term *t, unsigned int depth)
+{
+	if (__dulcet_status != DULCET_STATUS_OK) {
+		return;
+	}
+
+	struct dulcet_term *m = t->app.m;
+
+	if (__DULCET_KIND(m) != DULCET_TERM_KIND_APP) {
+		__dulcet_beta_nor_rec(m, depth + 1);
+	} else if (depth + 1 > __dulcet_limits.depth) {
+		__dulcet_status = DULCET_STATUS_DEPTH_LIMIT;
+	} else {
+		__DULCET_STATS(__dulcet_stats_enter());
+		__dulcet_beta_nor_stuck(m, depth + 1);
+		__DULCET_STATS(__dulcet_stats_leave());
+	}
+
+	__dulcet_beta_nor_rec(t->app.n, depth + 1);
+}
+
+static void __dulcet_beta_nor_rec(struct dulcet_term *t, unsigned int depth)
+{
+	assert(t);
+
+	if (__dulcet_status != DULCET_STATUS_OK) {
+		return;
+	}
+
+	if (depth > __dulcet_limits.depth) {
+		__dulcet_status = DULCET_STATUS_DEPTH_LIMIT;
+		return;
+	}
+
+	__DULCET_STATS(__dulcet_stats_enter());
+
+	for (int reduced = 0; !reduced;) {
+		reduced = 1;
+
+		switch (__DULCET_KIND(t)) {
+		case DULCET_TERM_KIND_VAR:
+		case DULCET_TERM_KIND_INT:
+		case DULCET_TERM_KIND_BOOL:
+		case DULCET_TERM_KIND_PRIM:
+			break;
+		case DULCET_TERM_KIND_ABS:
+			__dulcet_beta_nor_rec(t->abs.m, depth + 1);
+			break;
+		case DULCET_TERM_KIND_APP:
+			__dulcet_beta_cbn_rec(t->app.m, depth + 1);
+
+			if (t->app.m && __DULCET_KIND(t->app.m) == DULCET_TERM_KIND_ABS) {
+				if (__dulcet_take_step()) {
+					__dulcet_eval_at(t, depth);
+					reduced = 0;
+				}
+			} else if (__DULCET_DELTA(t, depth)) {
+				reduced = 0;
+			} else {
+				__dulcet_beta_nor_stuck(t, depth);
+			}
+			break;
+		case DULCET_TERM_KIND_REF:
+			if (!t->ref.shared->normal) {
+				__dulcet_instantiate(t);
+				reduced = 0;
+			}
+			break;
+		default:
+			__dulcet_fatal("unknown term kind");
+		}
+	}
+
+	__DULCET_STATS(__dulcet_stats_leave());
+}
+
+static void __dulcet_beta_app_rec(struct dulcet_term *t, unsigned int depth)
+{
+	assert(t);
+
+	if (__dulcet_status != DULCET_STATUS_OK) {
+		return;
+	}
+
+	if (depth > __dulcet_limits.depth) {
+		__dulcet_status = DULCET_STATUS_DEPTH_LIMIT;
+		return;
+	}
+
+	__DULCET_STATS(__dulcet_stats_enter());
+
+	for (int reduced = 0; !reduced;) {
+		reduced = 1;
+
+		switch (__DULCET_KIND(t)) {
+		case DULCET_TERM_KIND_VAR:
+		case DULCET_TERM_KIND_INT:
+		case DULCET_TERM_KIND_BOOL:
+		case DULCET_TERM_KIND_PRIM:
+			break;
+		case DULCET_TERM_KIND_ABS:
+			__dulcet_beta_app_rec(t->abs.m, depth + 1);
+			break;
+		case DULCET_TERM_KIND_APP:
+			__dulcet_beta_app_rec(t->app.m, depth + 1);
+			__dulcet_beta_app_rec(t->app.n, depth + 1);
+
+			// Shared terms in normal form are left as they are, but not at the head
+			while (t->app.m && __DULCET_KIND(t->app.m) == DULCET_TERM_KIND_REF) {
+				__dulcet_instantiate(t->app.m);
+			}
+
+			if (t->app.m && __DULCET_KIND(t->app.m) == DULCET_TERM_KIND_ABS) {
+				if (__dulcet_take_step()) {
+					__dulcet_eval_at(t, depth);
+					reduced = 0;
+				}
+			} else if (__DULCET_DELTA(t, depth)) {
+				reduced = 0;
+			}
+			break;
+		case DULCET_TERM_KIND_REF:
+			if (!t->ref.shared->normal) {
+				__dulcet_instantiate(t);
+				reduced = 0;
+			}
+			break;
+		default:
+			__dulcet_fatal("unknown term kind");
+		}
+	}
+
+	__DULCET_STATS(__dulcet_stats_leave());
+}
+
+// Runs a reducer on behalf of a caller outside of the library, attributing its steps and time.
+// Where it changes `t` in place, `t` is watched for cycles if the limits ask for it.
+static void __dulcet_reduce(struct dulcet_term *t, enum dulcet_strategy strategy,
+			    void (*reduce)(struct dulcet_term *, unsigned int), int in_place)
+{
+	assert(t);
+
+	int caller_reducing = __dulcet_reducing;
+	if (__dulcet_step_hook && !caller_reducing) {
+		__dulcet_term_size = dulcet_term_size(t);
+	}
+	__dulcet_reducing = 1;
+
+	struct __dulcet_cycle caller_cycle = __dulcet_cycle;
+	__dulcet_cycle_start(in_place && __dulcet_limits.divergence ? t : NULL);
+
+#ifdef DULCET_STATS
+	enum dulcet_strategy caller_strategy = __dulcet_strategy;
+	unsigned long long start = __dulcet_now();
+
+	__dulcet_strategy = strategy;
+	reduce(t, 0);
+	__dulcet_strategy = caller_strategy;
+
+	__dulcet_stats.phase_ns[DULCET_PHASE_REDUCE] += __dulcet_now() - start;
+#else
+	(void) strategy;
+
+	reduce(t, 0);
+#endif
+
+	__dulcet_cycle_stop();
+	__dulcet_cycle = caller_cycle;
+
+	__dulcet_reducing = caller_reducing;
+}
+
+enum dulcet_status dulcet_beta_cbn(struct dulcet_term *t)
+{
+	__dulcet_reduce(t, DULCET_STRATEGY_CBN, __dulcet_beta_cbn_rec, 1);
+
+	return __dulcet_status;
+}
+
+enum dulcet_status dulcet_beta_nor(struct dulcet_term *t)
+{
+	__dulcet_reduce(t, DULCET_STRATEGY_NOR, __dulcet_beta_nor_rec, 1);
+
+	return __dulcet_status;
+}
+
+enum dulcet_status dulcet_beta_app(struct dulcet_term *t)
+{
+	__dulcet_reduce(t, DULCET_STRATEGY_APP, __dulcet_beta_app_rec, 1);
+
+	return __dulcet_status;
+}
+
+// The reducers below leave the caller's term as it is. They return NULL for a subterm that they
+// leave unchanged, which whatever contains it then borrows, and otherwise a new term, which
+// borrows what it can in turn. Redexes are reduced in place on a copy, up to their arguments,
+// borrowed when closed. `open` tells whether the subterm may have free variables, which is the
+// case under any abstraction of a term that has them, and under every one of the others.
+
+// Follows the heads of applications, through shared terms, down to the first that is not one
+static const struct dulcet_term *__dulcet_spine_head(const struct dulcet_term *s)
+{
+	s = __dulcet_deref(s);
+	while (__DULCET_KIND(s) == DULCET_TERM_KIND_APP) {
+		s = __dulcet_deref(s->app.m);
+	}
+
+	return s;
+}
+
+static struct dulcet_term *__dulcet_share_argument(const struct dulcet_term *n, int open)
+{
+	if (open && !dulcet_term_closed(n)) {
+		return dulcet_term_copy(n);
+	}
+
+	return __dulcet_borrow(n, __dulcet_term_normal(n), 0);
+}
+
+// Copies the applications on the way to the head of `s`, and the head itself, borrowing their
+// arguments if it can
+static struct dulcet_term *__dulcet_copy_spine(const struct dulcet_term *s, int open)
+{
+	if (__DULCET_KIND(s) != DULCET_TERM_KIND_APP) {
+		return dulcet_term_copy(s);
+	}
+
+	return dulcet_alloc_app(__dulcet_copy_spine(s->app.m, open),
+				__dulcet_share_argument(s->app.n, open));
+}
+
+static struct dulcet_term *__dulcet_beta_cbn_shared(const struct dulcet_term *s,
+						    unsigned int depth, int open)
+{
+	if (__DULCET_KIND(s) != DULCET_TERM_KIND_APP) {
+		return NULL;
+	}
+
+	const struct dulcet_term *head = __dulcet_spine_head(s);
+	if (__DULCET_KIND(head) != DULCET_TERM_KIND_ABS &&
+	    __DULCET_KIND(head) != DULCET_TERM_KIND_PRIM) {
+		return NULL;
+	}
+
+	struct dulcet_term *t = __dulcet_copy_spine(s, open);
+	__dulcet_beta_cbn_rec(t, depth);
+
+	return t;
+}
+
+static struct dulcet_term *__dulcet_beta_nor_shared(const struct dulcet_term *s,
+						    unsigned int depth, int open);
+
+// Reduces `s`, an application whose head is a variable or a constant, and which thus stays one
+static struct dulcet_term *__dulcet_beta_nor_shared_spine(const struct dulcet_term *s,
+							  unsigned int depth, int open)
+{
+	if (__DULCET_KIND(s) != DULCET_TERM_KIND_APP) {
+		return __dulcet_beta_nor_shared(s, depth, open);
+	}
+
+	struct dulcet_term *m = __dulcet_beta_nor_shared_spine(s->app.m, depth + 1, open);
+	struct dulcet_term *n = __dulcet_beta_nor_shared(s->app.n, depth + 1, open);
+
+	if (!m && !n) {
+		return NULL;
+	}
+
+	// What is left unchanged is in normal form, unless a limit stopped the reduction
+	int normal = __dulcet_status == DULCET_STATUS_OK;
+
+	return dulcet_alloc_app(m ? m : __dulcet_borrow(s->app.m, normal, open),
+				n ? n : __dulcet_borrow(s->app.n, normal, open));
+}
+
+static struct dulcet_term *__dulcet_beta_nor_shared(const struct dulcet_term *s,
+						    unsigned int depth, int open)
+{
+	if (__dulcet_status != DULCET_STATUS_OK) {
+		return NULL;
+	}
+
+	if (depth > __dulcet_limits.depth) {
+		__dulcet_status = DULCET_STATUS_DEPTH_LIMIT;
+		return NULL;
+	}
+
+	struct dulcet_term *t = NULL;
+
+	__DULCET_STATS(__dulcet_stats_enter());
+
+	switch (__DULCET_KIND(s)) {
+	case DULCET_TERM_KIND_VAR:
+	case DULCET_TERM_KIND_INT:
+	case DULCET_TERM_KIND_BOOL:
+	case DULCET_TERM_KIND_PRIM:
+		break;
+	case DULCET_TERM_KIND_ABS: {
+		struct dulcet_term *m = __dulcet_beta_nor_shared(s->abs.m, depth + 1, 1);
+		if (m) {
+			t = dulcet_alloc_abs(m);
+			t->abs.origin = s->abs.origin;
+		}
+		break;
+	}
+	case DULCET_TERM_KIND_APP: {
+		const struct dulcet_term *head = __dulcet_spine_head(s);
+
+		if (__DULCET_KIND(head) != DULCET_TERM_KIND_ABS &&
+		    __DULCET_KIND(head) != DULCET_TERM_KIND_PRIM) {
+			t = __dulcet_beta_nor_shared_spine(s, depth, open);
+		} else {
+			t = __dulcet_copy_spine(s, open);
+			__dulcet_beta_nor_rec(t, depth);
+		}
+		break;
+	}
+	case DULCET_TERM_KIND_REF:
+		if (!s->ref.shared->normal) {
+			t = dulcet_term_copy(s);
+			__dulcet_beta_nor_rec(t, depth);
+		}
+		break;
+	default:
+		__dulcet_fatal("unknown term kind");
+	}
+
+	__DULCET_STATS(__dulcet_stats_leave());
+
+	return t;
+}
+
+static struct dulcet_term *__dulcet_beta_app_shared(const struct dulcet_term *s,
+						    unsigned int depth, int open)
+{
+	if (__dulcet_status != DULCET_STATUS_OK) {
+		return NULL;
+	}
+
+	if (depth > __dulcet_limits.depth) {
+		__dulcet_status = DULCET_STATUS_DEPTH_LIMIT;
+		return NULL;
+	}
+
+	struct dulcet_term *t = NULL;
+
+	__DULCET_STATS(__dulcet_stats_enter());
+
+	switch (__DULCET_KIND(s)) {
+	case DULCET_TERM_KIND_VAR:
+	case DULCET_TERM_KIND_INT:
+	case DULCET_TERM_KIND_BOOL:
+	case DULCET_TERM_KIND_PRIM:
+		break;
+	case DULCET_TERM_KIND_ABS: {
+		struct dulcet_term *m = __dulcet_beta_app_shared(s->abs.m, depth + 1, 1);
+		if (m) {
+			t = dulcet_alloc_abs(m);
+			t->abs.origin = s->abs.origin;
+		}
+		break;
+	}
+	case DULCET_TERM_KIND_APP: {
+		struct dulcet_term *m = __dulcet_beta_app_shared(s->app.m, depth + 1, open);
+		struct dulcet_term *n = __dulcet_beta_app_shared(s->app.n, depth + 1, open);
+
+		const struct dulcet_term *head = __dulcet_deref(m ? m : s->app.m);
+
+		if (__DULCET_KIND(head) == DULCET_TERM_KIND_ABS || __dulcet_delta_prim(head)) {
+			t = dulcet_alloc_app(m ? m : dulcet_term_copy(s->app.m),
+					     n ? n : __dulcet_share_argument(s->app.n, open));
+			__dulcet_beta_app_rec(t, depth);
+		} else if (m || n) {
+			int normal = __dulcet_status == DULCET_STATUS_OK;
+
+			t = dulcet_alloc_app(m ? m : __dulcet_borrow(s->app.m, normal, open),
+					     n ? n : __dulcet_borrow(s->app.n, normal, open));
+		}
+		break;
+	}
+	case DULCET_TERM_KIND_REF:
+		if (!s->ref.shared->normal) {
+			t = dulcet_term_copy(s);
+			__dulcet_beta_app_rec(t, depth);
+		}
+		break;
+	default:
+		__dulcet_fatal("unknown term kind");
+	}
+
+	__DULCET_STATS(__dulcet_stats_leave());
+
+	return t;
+}
+
+// Replaces `t`, which borrows the whole of the caller's term, with what `reduce` makes of it. A
+// variable is borrowed as a copy of itself rather than a reference, and is never passed here.
+static void __dulcet_reduce_borrowed(struct dulcet_term *t, unsigned int depth,
+				     struct dulcet_term *(*reduce)(const struct dulcet_term *,
+								   unsigned int, int))
+{
+	struct dulcet_shared *shared = t->ref.shared;
+	struct dulcet_term *s = reduce(shared->m, depth, shared->open);
+
+	if (s) {
+		__dulcet_move(t, s);
+		__dulcet_shared_release(shared);
+	} else if (reduce != __dulcet_beta_cbn_shared && __dulcet_status == DULCET_STATUS_OK) {
+		shared->normal = 1;
+	}
+}
+
+static void __dulcet_reduce_borrowed_cbn(struct dulcet_term *t, unsigned int depth)
+{
+	__dulcet_reduce_borrowed(t, depth, __dulcet_beta_cbn_shared);
+}
+
+static void __dulcet_reduce_borrowed_nor(struct dulcet_term *t, unsigned int depth)
+{
+	__dulcet_reduce_borrowed(t, depth, __dulcet_beta_nor_shared);
+}
+
+static void __dulcet_reduce_borrowed_app(struct dulcet_term *t, unsigned int depth)
+{
+	__dulcet_reduce_borrowed(t, depth, __dulcet_beta_app_shared);
+}
+
+struct dulcet_term *dulcet_beta_cbn_shared(const struct dulcet_term *t)
+{
+	assert(t);
+
+	struct dulcet_term *s = __dulcet_borrow(t, 0, !dulcet_term_closed(t));
+	if (__DULCET_KIND(s) == DULCET_TERM_KIND_VAR) {
+		return s;
+	}
+
+	__dulcet_reduce(s, DULCET_STRATEGY_CBN, __dulcet_reduce_borrowed_cbn, 0);
+
+	return s;
+}
+
+struct dulcet_term *dulcet_beta_nor_shared(const struct dulcet_term *t)
+{
+	assert(t);
+
+	struct dulcet_term *s = __dulcet_borrow(t, 0, !dulcet_term_closed(t));
+	if (__DULCET_KIND(s) == DULCET_TERM_KIND_VAR) {
+		return s;
+	}
+
+	__dulcet_reduce(s, DULCET_STRATEGY_NOR, __dulcet_reduce_borrowed_nor, 0);
+
+	return s;
+}
+
+struct dulcet_term *dulcet_beta_app_shared(const struct dulcet_term *t)
+{
+	assert(t);
+
+	struct dulcet_term *s = __dulcet_borrow(t, 0, !dulcet_term_closed(t));
+	if (__DULCET_KIND(s) == DULCET_TERM_KIND_VAR) {
+		return s;
+	}
+
+	__dulcet_reduce(s, DULCET_STRATEGY_APP, __dulcet_reduce_borrowed_app, 0);
+
+	return s;
+}
+
+// The threads of a portfolio get stacks large enough for the recursion of applicative order on
+// deep terms, of which only what is used is ever touched, and are stopped well before its end
+#define __DULCET_PORTFOLIO_STACK_SIZE ((size_t) 512 << 20)
+#define __DULCET_PORTFOLIO_DEPTH_LIMIT (1u << 20)
+
+enum { __DULCET_PORTFOLIO_NOR, __DULCET_PORTFOLIO_APP, __DULCET_PORTFOLIO_COUNT };
+
+struct __dulcet_portfolio_worker {
+	struct dulcet_term *t;
+	enum dulcet_strategy strategy;
+	void (*reduce)(struct dulcet_term *, unsigned int);
+	atomic_int *cancel;
+	atomic_int *winner;
+	int index;
+
+	// What the thread takes over from the caller, and what it leaves to it, along with the error
+	// it stopped on, if any, to be raised on the caller's thread
+	struct dulcet_allocator allocator;
+	int cache_nodes;
+	struct dulcet_term *node_cache;
+	unsigned long long cached_nodes;
+	const char *error;
+	struct dulcet_limits limits;
+	unsigned long long deadline;
+	unsigned long steps_taken;
+	unsigned long interrupts_seen;
+	long long live_nodes;
+	enum dulcet_status status;
+#ifdef DULCET_STATS
+	struct dulcet_stats stats;
+#endif
+
+	pthread_t thread;
+	int started;
+};
+
+// The worker run by the calling thread, if it is one of a portfolio
+static _Thread_local struct __dulcet_portfolio_worker *__dulcet_portfolio_self;
+
+// An allocator shared by the threads of a portfolio, which take turns to call it, as it is only
+// ever called by a single thread otherwise
+struct __dulcet_portfolio_allocator {
+	struct dulcet_allocator allocator;
+	pthread_mutex_t lock;
+};
+
+static void *__dulcet_portfolio_alloc(void *data, size_t size)
+{
+	struct __dulcet_portfolio_allocator *shared = data;
+
+	pthread_mutex_lock(&shared->lock);
+	void *ptr = shared->allocator.alloc(shared->allocator.data, size);
+	pthread_mutex_unlock(&shared->lock);
+
+	return ptr;
+}
+
+static void __dulcet_portfolio_free(void *data, void *ptr, size_t size)
+{
+	struct __dulcet_portfolio_allocator *shared = data;
+
+	pthread_mutex_lock(&shared->lock);
+	shared->allocator.free(shared->allocator.data, ptr, size);
+	pthread_mutex_unlock(&shared->lock);
+}
+
+static void __dulcet_portfolio_store(struct __dulcet_portfolio_worker *w)
+{
+	w->steps_taken = __dulcet_steps_taken;
+	w->status = __dulcet_status;
+	w->live_nodes = __dulcet_live_nodes;
+	w->node_cache = __dulcet_node_cache;
+	w->cached_nodes = __dulcet_cached_nodes;
+#ifdef DULCET_STATS
+	w->stats = __dulcet_stats;
+#endif
+}
+
+// Stops the thread of a portfolio on a fatal error, which is left to the caller's thread, where
+// the error handler expects to be called, and where it may leave the library
+static _Noreturn void __dulcet_portfolio_fail(struct __dulcet_portfolio_worker *w,
+					      const char *error)
+{
+	w->error = error;
+	atomic_store_explicit(w->cancel, 1, memory_order_relaxed);
+
+	__dulcet_portfolio_store(w);
+	pthread_exit(NULL);
+}
+
+static void *__dulcet_portfolio_run(void *arg)
+{
+	struct __dulcet_portfolio_worker *w = arg;
+
+	__dulcet_portfolio_self = w;
+	__dulcet_allocator = w->allocator;
+	__dulcet_cache_nodes = w->cache_nodes;
+	__dulcet_limits = w->limits;
+	__dulcet_deadline = w->deadline;
+	__dulcet_governed = 1;
+	__dulcet_steps_taken = w->steps_taken;
+	__dulcet_status = w->status;
+	__dulcet_interrupts_seen = w->interrupts_seen;
+	__dulcet_live_nodes = w->live_nodes;
+	__dulcet_cancel = w->cancel;
+	if (__dulcet_limits.depth > __DULCET_PORTFOLIO_DEPTH_LIMIT) {
+		__dulcet_limits.depth = __DULCET_PORTFOLIO_DEPTH_LIMIT;
+	}
+	__dulcet_reducing = 1;
+
+#ifdef DULCET_STATS
+	// Nodes alive before count toward the peak, as after `dulcet_stats_reset`
+	__dulcet_stats.peak_live_nodes = w->live_nodes > 0 ? w->live_nodes : 0;
+	__dulcet_strategy = w->strategy;
+#endif
+
+	__dulcet_cycle_start(w->limits.divergence ? w->t : NULL);
+	w->reduce(w->t, 0);
+	__dulcet_cycle_stop();
+
+	int no_winner = -1;
+	if (__dulcet_status == DULCET_STATUS_OK &&
+	    atomic_compare_exchange_strong(w->winner, &no_winner, w->index)) {
+		atomic_store_explicit(w->cancel, 1, memory_order_relaxed);
+	}
+
+	// Normal order finds the normal form whenever there is one, so none will be found
+	if (w->strategy == DULCET_STRATEGY_NOR && __dulcet_status == DULCET_STATUS_DIVERGED) {
+		atomic_store_explicit(w->cancel, 1, memory_order_relaxed);
+	}
+
+	__dulcet_portfolio_store(w);
+
+	return NULL;
+}
+
+#ifdef DULCET_STATS
+// Adds the work of a thread of a portfolio to the caller's
+static void __dulcet_stats_merge(const struct dulcet_stats *stats)
+{
+	for (int i = 0; i < DULCET_STRATEGY_COUNT; ++i) {
+		__dulcet_stats.beta_steps[i] += stats->beta_steps[i];
+	}
+
+	__dulcet_stats.delta_steps += stats->delta_steps;
+	__dulcet_stats.substitutions += stats->substitutions;
+	__dulcet_stats.arguments_moved += stats->arguments_moved;
+	__dulcet_stats.arguments_erased += stats->arguments_erased;
+	__dulcet_stats.nodes_copied += stats->nodes_copied;
+	__dulcet_stats.refs_instantiated += stats->refs_instantiated;
+	__dulcet_stats.nodes_shifted += stats->nodes_shifted;
+	__dulcet_stats.nodes_allocated += stats->nodes_allocated;
+	__dulcet_stats.nodes_freed += stats->nodes_freed;
+
+	if (stats->peak_live_nodes > __dulcet_stats.peak_live_nodes) {
+		__dulcet_stats.peak_live_nodes = stats->peak_live_nodes;
+	}
+
+	if (stats->max_depth > __dulcet_stats.max_depth) {
+		__dulcet_stats.max_depth = stats->max_depth;
+	}
+}
+#endif
+
+enum dulcet_status dulcet_beta_portfolio(struct dulcet_term *t)
+{
+	assert(t);
+
+	// Variables have nothing to reduce, nor a node to swap with the winner's
+	if (__dulcet_status != DULCET_STATUS_OK || __DULCET_KIND(t) == DULCET_TERM_KIND_VAR) {
+		return __dulcet_status;
+	}
+
+#ifdef DULCET_STATS
+	unsigned long long start = __dulcet_now();
+#endif
+
+	atomic_int cancel = 0;
+	atomic_int winner = -1;
+	struct __dulcet_portfolio_worker workers[__DULCET_PORTFOLIO_COUNT] = {
+		[__DULCET_PORTFOLIO_NOR] = {
+			.t = t,
+			.strategy = DULCET_STRATEGY_NOR,
+			.reduce = __dulcet_beta_nor_rec,
+		},
+		[__DULCET_PORTFOLIO_APP] = {
+			.t = dulcet_term_copy(t),
+			.strategy = DULCET_STRATEGY_APP,
+			.reduce = __dulcet_beta_app_rec,
+		},
+	};
+
+	// The allocator of a context is called by one thread at a time
+	struct __dulcet_portfolio_allocator shared = { .allocator = __dulcet_allocator };
+	struct dulcet_allocator allocator = __dulcet_allocator;
+	int locked = allocator.alloc && pthread_mutex_init(&shared.lock, NULL) == 0;
+	if (locked) {
+		allocator = (struct dulcet_allocator) {
+			.alloc = __dulcet_portfolio_alloc,
+			.free = __dulcet_portfolio_free,
+			.data = &shared,
+		};
+	} else if (allocator.alloc) {
+		dulcet_term_free(workers[__DULCET_PORTFOLIO_APP].t);
+		return dulcet_beta_nor(t);
+	}
+
+	pthread_attr_t attr;
+	int attr_ok = pthread_attr_init(&attr) == 0;
+	if (attr_ok) {
+		pthread_attr_setstacksize(&attr, __DULCET_PORTFOLIO_STACK_SIZE);
+	}
+
+	for (int i = 0; i < __DULCET_PORTFOLIO_COUNT; ++i) {
+		struct __dulcet_portfolio_worker *w = &workers[i];
+
+		w->cancel = &cancel;
+		w->winner = &winner;
+		w->index = i;
+		w->allocator = allocator;
+		w->cache_nodes = __dulcet_cache_nodes;
+		w->limits = __dulcet_limits;
+		w->deadline = __dulcet_deadline;
+		w->steps_taken = __dulcet_steps_taken;
+		w->interrupts_seen = __dulcet_interrupts_seen;
+		w->live_nodes = __dulcet_live_nodes;
+		w->status = DULCET_STATUS_OK;
+
+		// Normal order is started first, so that the portfolio is never worse off than it
+		w->started = pthread_create(&w->thread, attr_ok ? &attr : NULL,
+					    __dulcet_portfolio_run, w) == 0;
+		if (!w->started) {
+			break;
+		}
+	}
+
+	if (attr_ok) {
+		pthread_attr_destroy(&attr);
+	}
+
+	long long live_nodes = __dulcet_live_nodes;
+	for (int i = 0; i < __DULCET_PORTFOLIO_COUNT; ++i) {
+		struct __dulcet_portfolio_worker *w = &workers[i];
+		if (!w->started) {
+			continue;
+		}
+
+		pthread_join(w->thread, NULL);
+
+		__dulcet_live_nodes += w->live_nodes - live_nodes;
+
+		// The nodes the thread kept to allocate again are kept by the caller instead
+		while (w->node_cache) {
+			struct dulcet_term *node = w->node_cache;
+			w->node_cache = node->app.m;
+			node->app.m = __dulcet_node_cache;
+			__dulcet_node_cache = node;
+		}
+		__dulcet_cached_nodes += w->cached_nodes;
+		__DULCET_STATS(__dulcet_stats_merge(&w->stats));
+	}
+
+	if (locked) {
+		pthread_mutex_destroy(&shared.lock);
+	}
+
+	// Both threads stopped, so the terms are left as they are, as after any other fatal error
+	for (int i = 0; i < __DULCET_PORTFOLIO_COUNT; ++i) {
+		if (workers[i].error) {
+			__dulcet_fatal(workers[i].error);
+		}
+	}
+
+	struct dulcet_term *other = workers[__DULCET_PORTFOLIO_APP].t;
+
+	if (!workers[__DULCET_PORTFOLIO_NOR].started) {
+		// No thread to race on, so normal order runs on the caller's
+		dulcet_term_free(other);
+		return dulcet_beta_nor(t);
+	}
+
+	// Unless another strategy found the normal form, `t` is where normal order stopped
+	int kept = winner >= 0 ? winner : __DULCET_PORTFOLIO_NOR;
+	if (kept != __DULCET_PORTFOLIO_NOR) {
+		struct dulcet_term root = *t;
+		*t = *workers[kept].t;
+		*workers[kept].t = root;
+		other = workers[kept].t;
+	}
+
+	dulcet_term_free(other);
+
+	__dulcet_steps_taken = workers[kept].steps_taken;
+	__dulcet_status = workers[kept].status;
+
+	__DULCET_STATS(__dulcet_stats.phase_ns[DULCET_PHASE_REDUCE] += __dulcet_now() - start);
+
+	return __dulcet_status;
+}
+
+// Reduces `t` to head normal form in place: under its binders, the redexes at its head are
+// contracted until the head is a variable
+static void __dulcet_beta_hnf_rec(struct dulcet_term *t, unsigned int depth)
+{
+	for (;;) {
+		while (__DULCET_KIND(t) == DULCET_TERM_KIND_ABS) {
+			t = t->abs.m;
+			depth += 1;
+		}
+
+		if (__DULCET_KIND(t) == DULCET_TERM_KIND_REF ? t->ref.shared->normal
+						     : __DULCET_KIND(t) != DULCET_TERM_KIND_APP) {
+			return;
+		}
+
+		__dulcet_beta_cbn_rec(t, depth);
+
+		if (__DULCET_KIND(t) != DULCET_TERM_KIND_ABS) {
+			return;
+		}
+	}
+}
+
+static int __dulcet_has_head_redex(const struct dulcet_term *t)
+{
+	while (__DULCET_KIND(t) == DULCET_TERM_KIND_ABS) {
+		t = t->abs.m;
 	}
 
-	return 1;
-}
+	if (__DULCET_KIND(t) == DULCET_TERM_KIND_REF) {
+		return !t->ref.shared->normal;
+	}
 
-#if 1
-static const char *__DULCET_LAMBDA = "λ";
-#else
-static const char *__DULCET_LAMBDA = "\\";
-#endif
+	if (__DULCET_KIND(t) != DULCET_TERM_KIND_APP) {
+		return 0;
+	}
 
-#define __DULCET_TRY(rc, condition)             \
-	do {                                    \
-		if (((rc) = (condition)) < 0) { \
-			return (rc);            \
-		}                               \
-	} while (0)
+	while (__DULCET_KIND(t) == DULCET_TERM_KIND_APP) {
+		t = t->app.m;
+	}
+
+	// Shared terms are closed, so an application of one is a redex once it is instantiated, and
+	// primitives are left to find whether they are applied to what they take
+	enum dulcet_term_kind kind = __DULCET_KIND(t);
+
+	return kind == DULCET_TERM_KIND_ABS || kind == DULCET_TERM_KIND_REF ||
+	       kind == DULCET_TERM_KIND_PRIM;
+}
 
-static int __dulcet_term_fprint_classic_rec(const struct dulcet_term *t, FILE *fp,
-					    unsigned int context_precedence, unsigned int depth)
+// Prints like the printers, except that each term is first brought to head normal form, and
+// marked as such on the stack, so that all that is printed of it is already final. Before any
+// reduction, the output so far is flushed, so that it can be read while the rest is computed.
+static int __dulcet_term_stream_iter(struct dulcet_term *t, struct __dulcet_printer *p,
+				     int de_bruijn)
 {
-	if (!t) {
-		return -1;
-	}
+	struct __dulcet_print_stack stack = { 0 };
+	int rc = 0;
 
-	int chars_written = 0;
-	int rc;
+	__dulcet_print_stack_push_term(&stack, t, 0, 0);
 
-	switch (t->kind) {
-	case DULCET_TERM_KIND_VAR:
-		if (depth >= t->var.index) {
-			__DULCET_TRY(rc, fprintf(fp, "%c", 'a' + depth - t->var.index));
-			chars_written += rc;
-		} else {
-			__DULCET_TRY(rc, fprintf(fp, "%c", 'a' + t->var.index - 1));
-			chars_written += rc;
-		}
-		break;
-	case DULCET_TERM_KIND_ABS:
-		if (context_precedence > 1) {
-			__DULCET_TRY(rc, fprintf(fp, "("));
-			chars_written += rc;
+	while (stack.size > 0 && !p->failed) {
+		stack.size -= 1;
+		struct __dulcet_print_frame frame = stack.buf[stack.size];
+
+		if (!frame.t) {
+			__dulcet_printer_putc(p, frame.c);
+			continue;
 		}
 
-		__DULCET_TRY(rc, fprintf(fp, "%s%c.", __DULCET_LAMBDA, 'a' + depth));
-		chars_written += rc;
+		// The printers never modify the terms on their stack, but this one reduces them
+		t = (struct dulcet_term *) frame.t;
 
-		__DULCET_TRY(rc, __dulcet_term_fprint_classic_rec(t->abs.m, fp, 0, depth + 1));
-		chars_written += rc;
+		if (!frame.head_normal && __dulcet_status == DULCET_STATUS_OK &&
+		    __dulcet_has_head_redex(t)) {
+			__dulcet_printer_flush(p);
+			if (p->failed || fflush(p->fp) != 0) {
+				p->failed = 1;
+				break;
+			}
 
-		if (context_precedence > 1) {
-			__DULCET_TRY(rc, fprintf(fp, ")"));
-			chars_written += rc;
-		}
-		break;
-	case DULCET_TERM_KIND_APP:
-		if (context_precedence == 3) {
-			__DULCET_TRY(rc, fprintf(fp, "("));
-			chars_written += rc;
+			__dulcet_reduce(t, DULCET_STRATEGY_NOR, __dulcet_beta_hnf_rec, 1);
 		}
 
-		__DULCET_TRY(rc, __dulcet_term_fprint_classic_rec(t->app.m, fp, 2, depth));
-		chars_written += rc;
+		// What is left shared is in normal form, unless a limit stopped the reduction
+		t = (struct dulcet_term *) __dulcet_deref(t);
+
+		switch (__DULCET_KIND(t)) {
+		case DULCET_TERM_KIND_VAR:
+			if (de_bruijn) {
+				__dulcet_printer_putu(p, __DULCET_INDEX(t));
+			} else if (frame.depth >= __DULCET_INDEX(t)) {
+				__dulcet_printer_putc(p, 'a' + frame.depth - __DULCET_INDEX(t));
+			} else {
+				__dulcet_printer_putc(p, 'a' + __DULCET_INDEX(t) - 1);
+			}
+			break;
+		case DULCET_TERM_KIND_ABS:
+			if (frame.context_precedence > 1) {
+				__dulcet_printer_putc(p, '(');
+				__dulcet_print_stack_push_char(&stack, ')');
+			}
 
-		__DULCET_TRY(rc, fprintf(fp, " "));
-		chars_written += rc;
+			__dulcet_printer_write(p, __DULCET_LAMBDA, sizeof(__DULCET_LAMBDA) - 1);
+			if (!de_bruijn) {
+				__dulcet_printer_putc(p, 'a' + frame.depth);
+				__dulcet_printer_putc(p, '.');
+			}
 
-		__DULCET_TRY(rc, __dulcet_term_fprint_classic_rec(t->app.n, fp, 3, depth));
-		chars_written += rc;
+			__dulcet_print_stack_push_term(&stack, t->abs.m, 0, frame.depth + 1);
+			stack.buf[stack.size - 1].head_normal = 1;
+			break;
+		case DULCET_TERM_KIND_APP:
+			if (frame.context_precedence == 3) {
+				__dulcet_printer_putc(p, '(');
+				__dulcet_print_stack_push_char(&stack, ')');
+			}
 
-		if (context_precedence == 3) {
-			__DULCET_TRY(rc, fprintf(fp, ")"));
-			chars_written += rc;
+			// Along the spine, only the arguments are left to normalize
+			__dulcet_print_stack_push_term(&stack, t->app.n, 3, frame.depth);
+			__dulcet_print_stack_push_char(&stack, ' ');
+			__dulcet_print_stack_push_term(&stack, t->app.m, 2, frame.depth);
+			stack.buf[stack.size - 1].head_normal = 1;
+			break;
+		case DULCET_TERM_KIND_INT:
+		case DULCET_TERM_KIND_BOOL:
+		case DULCET_TERM_KIND_PRIM:
+			__dulcet_printer_put_constant(p, t, de_bruijn);
+			break;
+		default:
+			rc = -1;
+			break;
+		}
+
+		if (rc < 0) {
+			break;
 		}
-		break;
-	default:
-		return -1;
 	}
 
-	return chars_written;
+	free(stack.buf);
+
+	return rc;
 }
 
-static int __dulcet_term_sprint_classic_rec(const struct dulcet_term *t, char *buf,
-					    unsigned int context_precedence, unsigned int depth)
+static int __dulcet_term_stream(struct dulcet_term *t, FILE *fp, int de_bruijn)
 {
-	if (!t) {
-		return -1;
+	assert(t);
+
+	// Steps are reported against the size of the whole term, not of the part being reduced
+	int caller_reducing = __dulcet_reducing;
+	if (__dulcet_step_hook && !caller_reducing) {
+		__dulcet_term_size = dulcet_term_size(t);
 	}
+	__dulcet_reducing = 1;
 
-	int chars_written = 0;
-	int rc;
+#ifdef DULCET_STATS
+	unsigned long long start = __dulcet_now();
+	unsigned long long reduce_ns = __dulcet_stats.phase_ns[DULCET_PHASE_REDUCE];
+#endif
 
-	switch (t->kind) {
-	case DULCET_TERM_KIND_VAR:
-		if (depth >= t->var.index) {
-			__DULCET_TRY(
-				rc, sprintf(buf + chars_written, "%c", 'a' + depth - t->var.index));
-			chars_written += rc;
-		} else {
-			__DULCET_TRY(rc,
-				     sprintf(buf + chars_written, "%c", 'a' + t->var.index - 1));
-			chars_written += rc;
-		}
-		break;
-	case DULCET_TERM_KIND_ABS:
-		if (context_precedence > 1) {
-			__DULCET_TRY(rc, sprintf(buf + chars_written, "("));
-			chars_written += rc;
-		}
+	struct __dulcet_printer p = __dulcet_printer_to_file(fp);
+	int rc = __dulcet_printer_finish(&p, __dulcet_term_stream_iter(t, &p, de_bruijn));
 
-		__DULCET_TRY(rc,
-			     sprintf(buf + chars_written, "%s%c.", __DULCET_LAMBDA, 'a' + depth));
-		chars_written += rc;
+	__DULCET_STATS({
+		reduce_ns = __dulcet_stats.phase_ns[DULCET_PHASE_REDUCE] - reduce_ns;
+		__dulcet_stats.phase_ns[DULCET_PHASE_PRINT] += __dulcet_now() - start - reduce_ns;
+	});
 
-		__DULCET_TRY(rc, __dulcet_term_sprint_classic_rec(t->abs.m, buf + chars_written, 0,
-								  depth + 1));
-		chars_written += rc;
+	__dulcet_reducing = caller_reducing;
 
-		if (context_precedence > 1) {
-			__DULCET_TRY(rc, sprintf(buf + chars_written, ")"));
-			chars_written += rc;
-		}
-		break;
-	case DULCET_TERM_KIND_APP:
-		if (context_precedence == 3) {
-			__DULCET_TRY(rc, sprintf(buf + chars_written, "("));
-			chars_written += rc;
-		}
+	return rc;
+}
 
-		__DULCET_TRY(rc, __dulcet_term_sprint_classic_rec(t->app.m, buf + chars_written, 2,
-								  depth));
-		chars_written += rc;
+int dulcet_term_stream_classic(struct dulcet_term *t, FILE *fp)
+{
+	return __dulcet_term_stream(t, fp, 0);
+}
 
-		__DULCET_TRY(rc, sprintf(buf + chars_written, " "));
-		chars_written += rc;
+int dulcet_term_stream_de_bruijn(struct dulcet_term *t, FILE *fp)
+{
+	return __dulcet_term_stream(t, fp, 1);
+}
 
-		__DULCET_TRY(rc, __dulcet_term_sprint_classic_rec(t->app.n, buf + chars_written, 3,
-								  depth));
-		chars_written += rc;
+// Context in use by the calling thread, if any, whose state is then that of the thread
+static _Thread_local struct dulcet_ctx *__dulcet_ctx;
 
-		if (context_precedence == 3) {
-			__DULCET_TRY(rc, sprintf(buf + chars_written, ")"));
-			chars_written += rc;
-		}
-		break;
-	default:
-		return -1;
-	}
+static void __dulcet_ctx_store(struct __dulcet_ctx_state *state)
+{
+	state->allocator = __dulcet_allocator;
+	state->cache_nodes = __dulcet_cache_nodes;
+	state->node_cache = __dulcet_node_cache;
+	state->cached_nodes = __dulcet_cached_nodes;
+	state->live_nodes = __dulcet_live_nodes;
+	state->image_bytes = __dulcet_image_bytes;
+	state->error_handler = __dulcet_error_handler;
+	state->error_handler_data = __dulcet_error_handler_data;
+	state->error = __dulcet_error;
+	state->limits = __dulcet_limits;
+	state->steps_taken = __dulcet_steps_taken;
+	state->deadline = __dulcet_deadline;
+	state->governed = __dulcet_governed;
+	state->status = __dulcet_status;
+	state->interrupts_seen = __dulcet_interrupts_seen;
+	__DULCET_STATS(state->stats = __dulcet_stats);
+}
 
-	return chars_written;
+static void __dulcet_ctx_load(const struct __dulcet_ctx_state *state)
+{
+	__dulcet_allocator = state->allocator;
+	__dulcet_cache_nodes = state->cache_nodes;
+	__dulcet_node_cache = state->node_cache;
+	__dulcet_cached_nodes = state->cached_nodes;
+	__dulcet_live_nodes = state->live_nodes;
+	__dulcet_image_bytes = state->image_bytes;
+	__dulcet_error_handler = state->error_handler;
+	__dulcet_error_handler_data = state->error_handler_data;
+	__dulcet_error = state->error;
+	__dulcet_limits = state->limits;
+	__dulcet_steps_taken = state->steps_taken;
+	__dulcet_deadline = state->deadline;
+	__dulcet_governed = state->governed;
+	__dulcet_status = state->status;
+	__dulcet_interrupts_seen = state->interrupts_seen;
+	__DULCET_STATS(__dulcet_stats = state->stats);
 }
 
-static int __dulcet_term_fprint_de_bruijn_rec(const struct dulcet_term *t, FILE *fp,
-					      unsigned int context_precedence, unsigned int depth)
+static _Noreturn void __dulcet_fatal(const char *error)
 {
-	if (!t) {
-		return -1;
+	if (__dulcet_portfolio_self) {
+		__dulcet_portfolio_fail(__dulcet_portfolio_self, error);
 	}
 
-	int chars_written = 0;
-	int rc;
+	dulcet_error_handler handler = __dulcet_error_handler;
+	void *data = __dulcet_error_handler_data;
 
-	switch (t->kind) {
-	case DULCET_TERM_KIND_VAR:
-		__DULCET_TRY(rc, fprintf(fp, "%d", t->var.index));
-		chars_written += rc;
-		break;
-	case DULCET_TERM_KIND_ABS:
-		if (context_precedence > 1) {
-			__DULCET_TRY(rc, fprintf(fp, "("));
-			chars_written += rc;
-		}
+	__dulcet_error = error;
 
-		__DULCET_TRY(rc, fprintf(fp, "%s", __DULCET_LAMBDA));
-		chars_written += rc;
+	// The handler may not come back, so the reduction is given up and the context is left
+	// beforehand
+	__dulcet_reducing = 0;
+	__DULCET_STATS({
+		__dulcet_strategy = DULCET_STRATEGY_NONE;
+		__dulcet_depth = 0;
+	});
 
-		__DULCET_TRY(rc, __dulcet_term_fprint_de_bruijn_rec(t->abs.m, fp, 0, depth));
-		chars_written += rc;
+	struct dulcet_ctx *ctx = __dulcet_ctx;
+	if (ctx) {
+		ctx->depth = 1;
+		dulcet_ctx_leave(ctx);
+	}
 
-		if (context_precedence > 1) {
-			__DULCET_TRY(rc, fprintf(fp, ")"));
-			chars_written += rc;
-		}
-		break;
-	case DULCET_TERM_KIND_APP:
-		if (context_precedence == 3) {
-			__DULCET_TRY(rc, fprintf(fp, "("));
-			chars_written += rc;
-		}
+	if (handler) {
+		handler(data, error);
+	}
+
+	fprintf(stderr, "dulcet: fatal error: %s\n", error);
+	exit(1);
+}
+
+void dulcet_ctx_init(struct dulcet_ctx *ctx, const struct dulcet_allocator *allocator)
+{
+	assert(ctx);
+	assert(!allocator || (allocator->alloc && allocator->free));
+
+	*ctx = (struct dulcet_ctx) {
+		.state = {
+			.cache_nodes = 1,
+			.limits = { .steps = DULCET_UNLIMITED_STEPS, .depth = UINT_MAX },
+			.status = DULCET_STATUS_OK,
+			.interrupts_seen =
+				atomic_load_explicit(&__dulcet_interrupts, memory_order_relaxed),
+		},
+	};
+
+	if (allocator) {
+		ctx->state.allocator = *allocator;
+	}
+}
 
-		__DULCET_TRY(rc, __dulcet_term_fprint_de_bruijn_rec(t->app.m, fp, 2, depth));
-		chars_written += rc;
+void dulcet_ctx_deinit(struct dulcet_ctx *ctx)
+{
+	assert(ctx);
+	assert(ctx->depth == 0);
 
-		__DULCET_TRY(rc, fprintf(fp, " "));
-		chars_written += rc;
+	struct dulcet_allocator *allocator = &ctx->state.allocator;
 
-		__DULCET_TRY(rc, __dulcet_term_fprint_de_bruijn_rec(t->app.n, fp, 3, depth));
-		chars_written += rc;
+	while (ctx->state.node_cache) {
+		struct dulcet_term *node = ctx->state.node_cache;
+		ctx->state.node_cache = node->app.m;
 
-		if (context_precedence == 3) {
-			__DULCET_TRY(rc, fprintf(fp, ")"));
-			chars_written += rc;
+		if (allocator->free) {
+			allocator->free(allocator->data, node, sizeof(*node));
+		} else {
+			free(node);
 		}
-		break;
-	default:
-		return -1;
 	}
 
-	return chars_written;
+	ctx->state.cached_nodes = 0;
 }
 
-static int __dulcet_term_sprint_de_bruijn_rec(const struct dulcet_term *t, char *buf,
-					      unsigned int context_precedence, unsigned int depth)
+void dulcet_ctx_enter(struct dulcet_ctx *ctx)
 {
-	if (!t) {
-		return -1;
+	assert(ctx);
+
+	if (ctx->depth > 0) {
+		assert(__dulcet_ctx == ctx);
+		ctx->depth += 1;
+		return;
 	}
 
-	int chars_written = 0;
-	int rc;
+	__dulcet_ctx_store(&ctx->outer);
+	__dulcet_ctx_load(&ctx->state);
 
-	switch (t->kind) {
-	case DULCET_TERM_KIND_VAR:
-		__DULCET_TRY(rc, sprintf(buf + chars_written, "%d", t->var.index));
-		chars_written += rc;
-		break;
-	case DULCET_TERM_KIND_ABS:
-		if (context_precedence > 1) {
-			__DULCET_TRY(rc, sprintf(buf + chars_written, "("));
-			chars_written += rc;
-		}
+	ctx->outer_ctx = __dulcet_ctx;
+	ctx->depth = 1;
+	__dulcet_ctx = ctx;
+}
+
+void dulcet_ctx_leave(struct dulcet_ctx *ctx)
+{
+	assert(ctx);
+	assert(__dulcet_ctx == ctx && ctx->depth > 0);
 
-		__DULCET_TRY(rc, sprintf(buf + chars_written, "%s", __DULCET_LAMBDA));
-		chars_written += rc;
+	ctx->depth -= 1;
+	if (ctx->depth > 0) {
+		return;
+	}
 
-		__DULCET_TRY(rc, __dulcet_term_sprint_de_bruijn_rec(t->abs.m, buf + chars_written,
-								    0, depth));
-		chars_written += rc;
+	__dulcet_ctx_store(&ctx->state);
+	__dulcet_ctx_load(&ctx->outer);
 
-		if (context_precedence > 1) {
-			__DULCET_TRY(rc, sprintf(buf + chars_written, ")"));
-			chars_written += rc;
-		}
-		break;
-	case DULCET_TERM_KIND_APP:
-		if (context_precedence == 3) {
-			__DULCET_TRY(rc, sprintf(buf + chars_written, "("));
-			chars_written += rc;
-		}
+	__dulcet_ctx = ctx->outer_ctx;
+	ctx->outer_ctx = NULL;
+}
 
-		__DULCET_TRY(rc, __dulcet_term_sprint_de_bruijn_rec(t->app.m, buf + chars_written,
-								    2, depth));
-		chars_written += rc;
+void dulcet_ctx_set_error_handler(struct dulcet_ctx *ctx, dulcet_error_handler handler, void *data)
+{
+	dulcet_ctx_enter(ctx);
+	__dulcet_error_handler = handler;
+	__dulcet_error_handler_data = data;
+	dulcet_ctx_leave(ctx);
+}
 
-		__DULCET_TRY(rc, sprintf(buf + chars_written, " "));
-		chars_written += rc;
+const char *dulcet_ctx_error(struct dulcet_ctx *ctx)
+{
+	dulcet_ctx_enter(ctx);
+	const char *error = __dulcet_error;
+	dulcet_ctx_leave(ctx);
 
-		__DULCET_TRY(rc, __dulcet_term_sprint_de_bruijn_rec(t->app.n, buf + chars_written,
-								    3, depth));
-		chars_written += rc;
+	return error;
+}
 
-		if (context_precedence == 3) {
-			__DULCET_TRY(rc, sprintf(buf + chars_written, ")"));
-			chars_written += rc;
-		}
-		break;
-	default:
-		return -1;
+unsigned long long dulcet_ctx_live_nodes(struct dulcet_ctx *ctx)
+{
+	dulcet_ctx_enter(ctx);
+	unsigned long long live_nodes = __dulcet_live_nodes > 0 ? __dulcet_live_nodes : 0;
+	dulcet_ctx_leave(ctx);
+
+	return live_nodes;
+}
+
+unsigned long long dulcet_ctx_bytes(struct dulcet_ctx *ctx)
+{
+	dulcet_ctx_enter(ctx);
+	unsigned long long nodes = __dulcet_cached_nodes;
+	if (__dulcet_live_nodes > 0) {
+		nodes += __dulcet_live_nodes;
 	}
+	unsigned long long image_bytes = __dulcet_image_bytes;
+	dulcet_ctx_leave(ctx);
 
-	return chars_written;
+	return nodes * sizeof(struct dulcet_term) + image_bytes;
 }
 
-int dulcet_term_print_classic(const struct dulcet_term *t)
+struct dulcet_term *dulcet_ctx_alloc_var(struct dulcet_ctx *ctx, unsigned int index)
 {
-	return __dulcet_term_fprint_classic_rec(t, stdout, 0, 0);
+	dulcet_ctx_enter(ctx);
+	struct dulcet_term *t = dulcet_alloc_var(index);
+	dulcet_ctx_leave(ctx);
+
+	return t;
 }
 
-int dulcet_term_print_de_bruijn(const struct dulcet_term *t)
+struct dulcet_term *dulcet_ctx_alloc_abs(struct dulcet_ctx *ctx, struct dulcet_term *m)
 {
-	return __dulcet_term_fprint_de_bruijn_rec(t, stdout, 0, 0);
+	dulcet_ctx_enter(ctx);
+	struct dulcet_term *t = dulcet_alloc_abs(m);
+	dulcet_ctx_leave(ctx);
+
+	return t;
 }
 
-int dulcet_term_fprint_classic(const struct dulcet_term *t, FILE *fp)
+struct dulcet_term *dulcet_ctx_alloc_app(struct dulcet_ctx *ctx, struct dulcet_term *m,
+					 struct dulcet_term *n)
 {
-	return __dulcet_term_fprint_classic_rec(t, fp, 0, 0);
+	dulcet_ctx_enter(ctx);
+	struct dulcet_term *t = dulcet_alloc_app(m, n);
+	dulcet_ctx_leave(ctx);
+
+	return t;
 }
 
-int dulcet_term_fprint_de_bruijn(const struct dulcet_term *t, FILE *fp)
+struct dulcet_term *dulcet_ctx_alloc_int(struct dulcet_ctx *ctx, long long value)
 {
-	return __dulcet_term_fprint_de_bruijn_rec(t, fp, 0, 0);
+	dulcet_ctx_enter(ctx);
+	struct dulcet_term *t = dulcet_alloc_int(value);
+	dulcet_ctx_leave(ctx);
+
+	return t;
 }
 
-int dulcet_term_sprint_classic(const struct dulcet_term *t, char *buf)
+struct dulcet_term *dulcet_ctx_alloc_bool(struct dulcet_ctx *ctx, int value)
 {
-	int rc;
-	__DULCET_TRY(rc, __dulcet_term_sprint_classic_rec(t, buf, 0, 0));
+	dulcet_ctx_enter(ctx);
+	struct dulcet_term *t = dulcet_alloc_bool(value);
+	dulcet_ctx_leave(ctx);
 
-	buf[rc] = '\0';
+	return t;
+}
 
-	return rc;
+struct dulcet_term *dulcet_ctx_alloc_prim(struct dulcet_ctx *ctx, enum dulcet_prim_op op)
+{
+	dulcet_ctx_enter(ctx);
+	struct dulcet_term *t = dulcet_alloc_prim(op);
+	dulcet_ctx_leave(ctx);
+
+	return t;
 }
 
-int dulcet_term_sprint_de_bruijn(const struct dulcet_term *t, char *buf)
+struct dulcet_term *dulcet_ctx_alloc_ref(struct dulcet_ctx *ctx, struct dulcet_term *m)
 {
-	int rc;
-	__DULCET_TRY(rc, __dulcet_term_sprint_de_bruijn_rec(t, buf, 0, 0));
+	dulcet_ctx_enter(ctx);
+	struct dulcet_term *t = dulcet_alloc_ref(m);
+	dulcet_ctx_leave(ctx);
 
-	buf[rc] = '\0';
+	return t;
+}
 
-	return rc;
+struct dulcet_term *dulcet_ctx_church_from_int(struct dulcet_ctx *ctx, long long value)
+{
+	dulcet_ctx_enter(ctx);
+	struct dulcet_term *t = dulcet_church_from_int(value);
+	dulcet_ctx_leave(ctx);
+
+	return t;
 }
 
-#undef __DULCET_TRY
+struct dulcet_term *dulcet_ctx_church_from_bool(struct dulcet_ctx *ctx, int value)
+{
+	dulcet_ctx_enter(ctx);
+	struct dulcet_term *t = dulcet_church_from_bool(value);
+	dulcet_ctx_leave(ctx);
 
-static void __dulcet_update_free_variables(struct dulcet_term *t, unsigned int added_depth,
-					   unsigned int own_depth)
+	return t;
+}
+
+void dulcet_ctx_image_load(struct dulcet_ctx *ctx, struct dulcet_loaded_image *loaded,
+			   const struct dulcet_image *image)
 {
-	assert(t);
+	dulcet_ctx_enter(ctx);
+	dulcet_image_load(loaded, image);
+	dulcet_ctx_leave(ctx);
+}
 
-	switch (t->kind) {
-	case DULCET_TERM_KIND_VAR:
-		if (t->var.index > own_depth) {
-			t->var.index += added_depth;
-		}
-		break;
-	case DULCET_TERM_KIND_ABS:
-		__dulcet_update_free_variables(t->abs.m, added_depth, own_depth + 1);
-		break;
-	case DULCET_TERM_KIND_APP:
-		__dulcet_update_free_variables(t->app.m, added_depth, own_depth);
-		__dulcet_update_free_variables(t->app.n, added_depth, own_depth);
-		break;
-	default:
-		fprintf(stderr, "dulcet: fatal error\n");
-		exit(1);
-	}
+void dulcet_ctx_image_unload(struct dulcet_ctx *ctx, struct dulcet_loaded_image *loaded)
+{
+	dulcet_ctx_enter(ctx);
+	dulcet_image_unload(loaded);
+	dulcet_ctx_leave(ctx);
 }
 
-static void __dulcet_apply_rec(struct dulcet_term *t, const struct dulcet_term *rhs,
-			       unsigned int depth)
+struct dulcet_term *dulcet_ctx_term_copy(struct dulcet_ctx *ctx, const struct dulcet_term *t)
 {
-	switch (t->kind) {
-	case DULCET_TERM_KIND_VAR:
-		if (t->var.index == depth) {
-			struct dulcet_term *tmp = dulcet_term_copy(rhs);
-			*t = *tmp;
-			free(tmp);
-			__dulcet_update_free_variables(t, depth - 1, 0);
-		} else if (t->var.index > depth) {
-			t->var.index -= 1;
-		}
-		break;
-	case DULCET_TERM_KIND_ABS:
-		__dulcet_apply_rec(t->abs.m, rhs, depth + 1);
-		break;
-	case DULCET_TERM_KIND_APP:
-		__dulcet_apply_rec(t->app.m, rhs, depth);
-		__dulcet_apply_rec(t->app.n, rhs, depth);
-		break;
-	default:
-		fprintf(stderr, "dulcet: fatal error\n");
-		exit(1);
-	}
+	dulcet_ctx_enter(ctx);
+	struct dulcet_term *s = dulcet_term_copy(t);
+	dulcet_ctx_leave(ctx);
+
+	return s;
 }
 
-void dulcet_apply(struct dulcet_term *t, struct dulcet_term *rhs)
+void dulcet_ctx_term_free(struct dulcet_ctx *ctx, struct dulcet_term *t)
 {
-	assert(t && t->kind == DULCET_TERM_KIND_ABS);
+	dulcet_ctx_enter(ctx);
+	dulcet_term_free(t);
+	dulcet_ctx_leave(ctx);
+}
 
-	struct dulcet_term *tmp = t->abs.m;
+void dulcet_ctx_apply(struct dulcet_ctx *ctx, struct dulcet_term *t, struct dulcet_term *rhs)
+{
+	dulcet_ctx_enter(ctx);
+	dulcet_apply(t, rhs);
+	dulcet_ctx_leave(ctx);
+}
 
-	__dulcet_apply_rec(t, rhs, 0);
+void dulcet_ctx_eval(struct dulcet_ctx *ctx, struct dulcet_term *t)
+{
+	dulcet_ctx_enter(ctx);
+	dulcet_eval(t);
+	dulcet_ctx_leave(ctx);
+}
 
-	dulcet_term_free(rhs);
+void dulcet_ctx_set_limits(struct dulcet_ctx *ctx, const struct dulcet_limits *limits)
+{
+	dulcet_ctx_enter(ctx);
+	dulcet_set_limits(limits);
+	dulcet_ctx_leave(ctx);
+}
 
-	*t = *t->abs.m;
+enum dulcet_status dulcet_ctx_status(struct dulcet_ctx *ctx)
+{
+	dulcet_ctx_enter(ctx);
+	enum dulcet_status status = __dulcet_status;
+	dulcet_ctx_leave(ctx);
 
-	free(tmp);
+	return status;
 }
 
-void dulcet_eval(struct dulcet_term *t)
+unsigned long dulcet_ctx_steps_taken(struct dulcet_ctx *ctx)
 {
-	assert(t && t->kind == DULCET_TERM_KIND_APP);
+	dulcet_ctx_enter(ctx);
+	unsigned long steps_taken = __dulcet_steps_taken;
+	dulcet_ctx_leave(ctx);
 
-	struct dulcet_term *tmp = t->app.m;
+	return steps_taken;
+}
 
-	dulcet_apply(t->app.m, t->app.n);
+enum dulcet_status dulcet_ctx_beta_cbn(struct dulcet_ctx *ctx, struct dulcet_term *t)
+{
+	dulcet_ctx_enter(ctx);
+	enum dulcet_status status = dulcet_beta_cbn(t);
+	dulcet_ctx_leave(ctx);
 
-	*t = *t->app.m;
+	return status;
+}
+
+enum dulcet_status dulcet_ctx_beta_nor(struct dulcet_ctx *ctx, struct dulcet_term *t)
+{
+	dulcet_ctx_enter(ctx);
+	enum dulcet_status status = dulcet_beta_nor(t);
+	dulcet_ctx_leave(ctx);
 
-	free(tmp);
+	return status;
 }
 
-void dulcet_beta_cbn(struct dulcet_term *t)
+enum dulcet_status dulcet_ctx_beta_app(struct dulcet_ctx *ctx, struct dulcet_term *t)
 {
-	assert(t);
+	dulcet_ctx_enter(ctx);
+	enum dulcet_status status = dulcet_beta_app(t);
+	dulcet_ctx_leave(ctx);
 
-	if (t->kind == DULCET_TERM_KIND_APP) {
-		dulcet_beta_cbn(t->app.m);
+	return status;
+}
 
-		if (t->app.m && t->app.m->kind == DULCET_TERM_KIND_ABS) {
-			dulcet_eval(t);
+enum dulcet_status dulcet_ctx_beta_portfolio(struct dulcet_ctx *ctx, struct dulcet_term *t)
+{
+	dulcet_ctx_enter(ctx);
+	enum dulcet_status status = dulcet_beta_portfolio(t);
+	dulcet_ctx_leave(ctx);
 
-			dulcet_beta_cbn(t);
-		}
-	}
+	return status;
 }
 
-void dulcet_beta_nor(struct dulcet_term *t)
+struct dulcet_term *dulcet_ctx_beta_cbn_shared(struct dulcet_ctx *ctx, const struct dulcet_term *t)
 {
-	assert(t);
+	dulcet_ctx_enter(ctx);
+	struct dulcet_term *s = dulcet_beta_cbn_shared(t);
+	dulcet_ctx_leave(ctx);
 
-	switch (t->kind) {
-	case DULCET_TERM_KIND_VAR:
-		break;
-	case DULCET_TERM_KIND_ABS:
-		dulcet_beta_nor(t->abs.m);
-		break;
-	case DULCET_TERM_KIND_APP:
-		dulcet_beta_cbn(t->app.m);
+	return s;
+}
 
-		if (t->app.m && t->app.m->kind == DULCET_TERM_KIND_ABS) {
-			dulcet_eval(t);
+struct dulcet_term *dulcet_ctx_beta_nor_shared(struct dulcet_ctx *ctx, const struct dulcet_term *t)
+{
+	dulcet_ctx_enter(ctx);
+	struct dulcet_term *s = dulcet_beta_nor_shared(t);
+	dulcet_ctx_leave(ctx);
 
-			dulcet_beta_nor(t);
-		} else {
-			dulcet_beta_nor(t->app.m);
-			dulcet_beta_nor(t->app.n);
-		}
-		break;
-	default:
-		fprintf(stderr, "dulcet: fatal error\n");
-		exit(1);
-	}
+	return s;
 }
 
-void dulcet_beta_app(struct dulcet_term *t)
+struct dulcet_term *dulcet_ctx_beta_app_shared(struct dulcet_ctx *ctx, const struct dulcet_term *t)
 {
-	assert(t);
+	dulcet_ctx_enter(ctx);
+	struct dulcet_term *s = dulcet_beta_app_shared(t);
+	dulcet_ctx_leave(ctx);
 
-	switch (t->kind) {
-	case DULCET_TERM_KIND_VAR:
-		break;
-	case DULCET_TERM_KIND_ABS:
-		dulcet_beta_app(t->abs.m);
-		break;
-	case DULCET_TERM_KIND_APP:
-		dulcet_beta_app(t->app.m);
-		dulcet_beta_app(t->app.n);
+	return s;
+}
 
-		if (t->app.m && t->app.m->kind == DULCET_TERM_KIND_ABS) {
-			dulcet_eval(t);
+int dulcet_ctx_term_stream_classic(struct dulcet_ctx *ctx, struct dulcet_term *t, FILE *fp)
+{
+	dulcet_ctx_enter(ctx);
+	int len = dulcet_term_stream_classic(t, fp);
+	dulcet_ctx_leave(ctx);
 
-			dulcet_beta_app(t);
-		}
-		break;
-	default:
-		fprintf(stderr, "dulcet: fatal error\n");
-		exit(1);
-	}
+	return len;
+}
+
+int dulcet_ctx_term_stream_de_bruijn(struct dulcet_ctx *ctx, struct dulcet_term *t, FILE *fp)
+{
+	dulcet_ctx_enter(ctx);
+	int len = dulcet_term_stream_de_bruijn(t, fp);
+	dulcet_ctx_leave(ctx);
+
+	return len;
+}
+
+void dulcet_ctx_stats_get(struct dulcet_ctx *ctx, struct dulcet_stats *stats)
+{
+	dulcet_ctx_enter(ctx);
+	dulcet_stats_get(stats);
+	dulcet_ctx_leave(ctx);
+}
+
+void dulcet_ctx_stats_reset(struct dulcet_ctx *ctx)
+{
+	dulcet_ctx_enter(ctx);
+	dulcet_stats_reset();
+	dulcet_ctx_leave(ctx);
 }
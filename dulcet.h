@@ -17,6 +17,7 @@ struct dulcet_var {
 
 struct dulcet_abs {
 	struct dulcet_term *m;
+	unsigned int origin; // Source lambda in the current profile, or 0 if unknown
 };
 
 struct dulcet_app {
@@ -24,10 +25,48 @@ struct dulcet_app {
 	struct dulcet_term *n;
 };
 
+// Closed term shared by every node that refers to it, see `dulcet_alloc_ref`, or a term borrowed
+// from the caller, see `dulcet_beta_nor_shared`
+struct dulcet_shared;
+
+struct dulcet_ref {
+	struct dulcet_shared *shared;
+};
+
+struct dulcet_int {
+	long long value;
+};
+
+struct dulcet_bool {
+	int value;
+};
+
+// Primitive operations on constants. Arithmetic wraps around on overflow and division truncates
+// towards zero, while a division by zero is left as it is. `=` compares two integers or two
+// booleans, `<` two integers, and `if` takes a boolean and the two terms to choose from.
+enum dulcet_prim_op {
+	DULCET_PRIM_OP_ADD,
+	DULCET_PRIM_OP_SUB,
+	DULCET_PRIM_OP_MUL,
+	DULCET_PRIM_OP_DIV,
+	DULCET_PRIM_OP_EQ,
+	DULCET_PRIM_OP_LT,
+	DULCET_PRIM_OP_IF,
+	DULCET_PRIM_OP_COUNT,
+};
+
+struct dulcet_prim {
+	enum dulcet_prim_op op;
+};
+
 enum dulcet_term_kind {
 	DULCET_TERM_KIND_VAR,
 	DULCET_TERM_KIND_ABS,
 	DULCET_TERM_KIND_APP,
+	DULCET_TERM_KIND_REF,
+	DULCET_TERM_KIND_INT,
+	DULCET_TERM_KIND_BOOL,
+	DULCET_TERM_KIND_PRIM,
 };
 
 struct dulcet_term {
@@ -37,18 +76,124 @@ struct dulcet_term {
 		struct dulcet_var var;
 		struct dulcet_abs abs;
 		struct dulcet_app app;
+		struct dulcet_ref ref;
+		struct dulcet_int integer;
+		struct dulcet_bool boolean;
+		struct dulcet_prim prim;
 	};
 };
 
+// Variables take no memory of their own: `dulcet_alloc_var` returns an immediate, which encodes
+// the index in the pointer itself and must not be dereferenced, and which freeing and copying
+// leave as it is. Terms are thus read through `dulcet_term_kind` and `dulcet_var_index`, which
+// also see the nodes reduced in place to a variable. Allocators must align nodes to at least two
+// bytes.
+enum dulcet_term_kind dulcet_term_kind(const struct dulcet_term *t);
+unsigned int dulcet_var_index(const struct dulcet_term *t);
+
 struct dulcet_term *dulcet_alloc_var(unsigned int index);
 struct dulcet_term *dulcet_alloc_abs(struct dulcet_term *m);
 struct dulcet_term *dulcet_alloc_app(struct dulcet_term *m, struct dulcet_term *n);
 
+// Constants, which the reducers compute with natively: an application of a primitive to as many
+// arguments as it takes is reduced, once its strict arguments reduce to constants of the right
+// kinds, in a single step, which counts against the step limit like a beta reduction step.
+// Every argument is strict, but the last two of `if`.
+struct dulcet_term *dulcet_alloc_int(long long value);
+struct dulcet_term *dulcet_alloc_bool(int value);
+struct dulcet_term *dulcet_alloc_prim(enum dulcet_prim_op op);
+
+// Name of a primitive as the parsers and printers write it, such as `+` or `if`, and the number
+// of arguments it takes.
+const char *dulcet_prim_name(enum dulcet_prim_op op);
+unsigned int dulcet_prim_arity(enum dulcet_prim_op op);
+
+// Church encodings, for terms that compute with both them and constants: `λf.λx.f (f ... (f x))`
+// with `value` applications of `f`, which must not be negative, and `λa.λb.a` or `λa.λb.b`. The
+// decoders read a term in normal form back into `*value`, returning whether it was such an
+// encoding. As they are the same term, the numeral for zero also decodes as false.
+struct dulcet_term *dulcet_church_from_int(long long value);
+struct dulcet_term *dulcet_church_from_bool(int value);
+int dulcet_church_to_int(const struct dulcet_term *t, long long *value);
+int dulcet_church_to_bool(const struct dulcet_term *t, int *value);
+
+// Decoders of pairs `λf.f a b` and of lists, either of pairs ending with `λx.λa.λb.a`, or folds
+// `λc.λn.c a (c b ... n)`, which set the elements they find to closed subterms of `t`. Those of a
+// list go in an array allocated with malloc, which the caller frees.
+int dulcet_church_to_pair(const struct dulcet_term *t, const struct dulcet_term **first,
+			  const struct dulcet_term **second);
+int dulcet_church_to_list(const struct dulcet_term *t, const struct dulcet_term ***items,
+			  size_t *size);
+
+// Share the closed term `m`, which is then owned by the returned node and every copy of it, so
+// that copying the node costs one node, however large `m` is. The reducers put a copy of `m` in
+// place of a node only where they need to look into it, such as at the head of an application,
+// and normal order leaves it shared if it is already in normal form. Everything else sees `m`
+// wherever the node is, except `dulcet_term_size`, which counts the node itself.
+struct dulcet_term *dulcet_alloc_ref(struct dulcet_term *m);
+
+// A program compiled ahead of time, see `dulcetc`, as the terms of its definitions, one after
+// another, each in preorder: an abstraction is followed by its body, and an application by its
+// left and then its right subterm. Definitions may refer to those before them, through a node of
+// kind `DULCET_TERM_KIND_REF`, which each is then written once for. The term of a program is its
+// last definition.
+struct dulcet_image_node {
+	enum dulcet_term_kind kind;
+	// Index of a variable, value of a constant, operation of a primitive, or index of the
+	// definition referred to
+	long long value;
+};
+
+struct dulcet_image_definition {
+	const char *name; // NULL for the term of a program, and those only referred to
+	size_t size; // Nodes of its term
+};
+
+struct dulcet_image {
+	const struct dulcet_image_node *nodes;
+	size_t nodes_size;
+	const struct dulcet_image_definition *definitions;
+	size_t definitions_size;
+};
+
+// The terms of the definitions of an image, each shared, as with `dulcet_alloc_ref`, so that a
+// copy of one costs a node. Copies are freed as usual, but every one of them, and whatever the
+// reducers made of them, must be freed before the image is unloaded.
+struct dulcet_loaded_image {
+	const struct dulcet_image *image;
+	const struct dulcet_term **terms;
+	void *block;
+	size_t block_size; // Bytes of `block`
+};
+
+// Flatten the closed terms `terms` into `image`, as the definitions named by `names`, which are
+// not copied, and which may be NULL. Shared terms they refer to become definitions of their own,
+// unnamed unless they are among `terms`. Free the image with `dulcet_image_free`.
+void dulcet_image_build(struct dulcet_image *image, const struct dulcet_term *const *terms,
+			const char *const *names, size_t size);
+void dulcet_image_free(struct dulcet_image *image);
+
+// Build the terms of `image` in a single allocation, without parsing any text, which has to
+// outlive them. Within a context, the block comes from its allocator, and the image must be
+// unloaded in the same context.
+void dulcet_image_load(struct dulcet_loaded_image *loaded, const struct dulcet_image *image);
+void dulcet_image_unload(struct dulcet_loaded_image *loaded);
+
+// Return the term of the last definition named `name`, or NULL if there is none.
+const struct dulcet_term *dulcet_image_lookup(const struct dulcet_loaded_image *loaded,
+					      const char *name, unsigned int name_len);
+
 struct dulcet_term *dulcet_term_copy(const struct dulcet_term *t);
 void dulcet_term_free(struct dulcet_term *t);
 
 int dulcet_term_eq(struct dulcet_term *a, struct dulcet_term *b);
 
+// Return the number of nodes of the term.
+size_t dulcet_term_size(const struct dulcet_term *t);
+
+// Return whether none of the variables of the term is free.
+int dulcet_term_closed(const struct dulcet_term *t);
+
 int dulcet_term_print_classic(const struct dulcet_term *t);
 int dulcet_term_print_de_bruijn(const struct dulcet_term *t);
 
@@ -58,11 +203,330 @@ int dulcet_term_fprint_de_bruijn(const struct dulcet_term *t, FILE *fp);
 int dulcet_term_sprint_classic(const struct dulcet_term *t, char *buf);
 int dulcet_term_sprint_de_bruijn(const struct dulcet_term *t, char *buf);
 
+// Like `snprintf`, write at most `size - 1` bytes of output and a null terminator to `buf`, and
+// return the length of the whole output, so that a return value of `size` or more means that it
+// was truncated.
+int dulcet_term_snprint_classic(const struct dulcet_term *t, char *buf, size_t size);
+int dulcet_term_snprint_de_bruijn(const struct dulcet_term *t, char *buf, size_t size);
+
+// Like the above, but write each closed subterm that occurs more than once only once, as a
+// `let` that it is then referred to by, as in `let $1 = λa.a a in λa.a $1 $1`. The output grows
+// with the number of distinct subterms, rather than with the size of the term written out.
+int dulcet_term_fprint_classic_shared(const struct dulcet_term *t, FILE *fp);
+int dulcet_term_fprint_de_bruijn_shared(const struct dulcet_term *t, FILE *fp);
+
+int dulcet_term_snprint_classic_shared(const struct dulcet_term *t, char *buf, size_t size);
+int dulcet_term_snprint_de_bruijn_shared(const struct dulcet_term *t, char *buf, size_t size);
+
+// Return the length of the output of the printers, without the null terminator, without
+// rendering it.
+int dulcet_term_len_classic(const struct dulcet_term *t);
+int dulcet_term_len_de_bruijn(const struct dulcet_term *t);
+
 void dulcet_apply(struct dulcet_term *t, struct dulcet_term *rhs);
 void dulcet_eval(struct dulcet_term *t);
 
-void dulcet_beta_cbn(struct dulcet_term *t);
-void dulcet_beta_nor(struct dulcet_term *t);
-void dulcet_beta_app(struct dulcet_term *t);
+// A beta reduction step, reported once it was taken. Sizes are in nodes.
+struct dulcet_step_event {
+	unsigned long long step; // Steps taken on the calling thread since the hook was set
+	unsigned int depth; // Depth of the redex in the term being reduced, the root being at 0
+	size_t body_size; // Body of the abstraction of the redex
+	size_t argument_size; // Argument of the redex
+	size_t result_size; // Term that replaced the redex
+	size_t term_size; // Whole term being reduced, after the step
+	const struct dulcet_term *result;
+};
+
+typedef void (*dulcet_step_hook)(const struct dulcet_step_event *event, void *data);
+
+// Call `hook` with `data` after every beta reduction step taken on the calling thread by
+// `dulcet_eval`, and so by the reducers, until another hook, or `NULL`, is set. Measuring the
+// sizes in the events makes each step take time linear in the size of the redex.
+void dulcet_set_step_hook(dulcet_step_hook hook, void *data);
+
+struct dulcet_profile_entry {
+	const char *source;
+	char *parameter; // NULL in de Bruijn notation
+	unsigned int line;
+	unsigned int column;
+
+	unsigned long long reductions; // Beta reduction steps that applied an abstraction from here
+	unsigned long long substitutions; // Occurrences of its parameter substituted by them
+	unsigned long long nodes_copied; // Nodes of the arguments copied into all but one of them
+};
+
+// Attributes the work of reduction to the lambdas of the source. While a profile is set on a
+// thread, the parsers register each lambda they read in it, and mark the abstraction with the
+// registered origin, which copies of it carry along; each beta reduction step is then counted
+// against the origin of the abstraction that it applies.
+struct dulcet_profile {
+	struct dulcet_profile_entry *entries; // Entry of origin `i` is at `i - 1`
+	size_t size;
+	size_t capacity;
+
+	// Name of the source being parsed, and offset of its locations within it, for input that
+	// is part of a larger file. The column offset only applies to the first line.
+	const char *source;
+	unsigned int line_offset;
+	unsigned int column_offset;
+};
+
+void dulcet_profile_init(struct dulcet_profile *profile);
+void dulcet_profile_deinit(struct dulcet_profile *profile);
+
+// Register a lambda at `line` and `column` of the source, whose parameter may be NULL, returning
+// its origin.
+unsigned int dulcet_profile_add(struct dulcet_profile *profile, const char *parameter,
+				unsigned int parameter_len, unsigned int line, unsigned int column);
+
+// Profile the calling thread from now on, until another profile, or `NULL`, is set.
+void dulcet_set_profile(struct dulcet_profile *profile);
+struct dulcet_profile *dulcet_get_profile(void);
+
+#define DULCET_UNLIMITED_STEPS ((unsigned long) -1)
+
+// How a reducer returned: with the term in normal form, or in weak head normal form for call by
+// name, or early, leaving it partially reduced, because of a limit, an interruption, or as the
+// reduction was found to never end.
+enum dulcet_status {
+	DULCET_STATUS_OK,
+	DULCET_STATUS_STEP_LIMIT,
+	DULCET_STATUS_MEMORY_LIMIT,
+	DULCET_STATUS_DEADLINE,
+	DULCET_STATUS_INTERRUPTED,
+	DULCET_STATUS_DIVERGED,
+	DULCET_STATUS_DEPTH_LIMIT,
+};
+
+const char *dulcet_status_name(enum dulcet_status status);
+
+// Limits on the reducers of the calling thread. Zero, or `DULCET_UNLIMITED_STEPS` for the steps,
+// means no limit. Memory is that of the term nodes alive on the thread, in count or in bytes, and
+// the time is a wall-clock duration from when the limits are set, checked every few steps.
+//
+// With `divergence` set, the reducers that change a term in place also stop once it comes back to
+// a term it was before, from which they would only go round in circles. The term is compared with
+// a copy of it, which takes as much memory again, replaced after ever longer runs of steps, so
+// that cycles of any length are found, in a number of steps that grows with their length and with
+// the size of the term. Reductions that diverge without repeating a term, such as those that keep
+// growing it, still need the other limits.
+//
+// The depth is how far the reducers may recurse into a term, each level of which takes a frame of
+// the stack of the thread, so that a term too deep for it, or a reduction that keeps nesting
+// deeper, stops them rather than overflowing the stack.
+struct dulcet_limits {
+	unsigned long steps;
+	unsigned long long nodes;
+	unsigned long long bytes;
+	unsigned long long time_ns;
+	int divergence;
+	unsigned int depth;
+};
+
+// Set the limits of the reducers of the calling thread from now on. Once one is reached, they
+// return early, leaving the term partially reduced, and so does any reducer called after that until
+// the limits are set again. Reducing a term with no normal form thus terminates. Setting them also
+// resets the count of steps taken, and clears any interruption.
+void dulcet_set_limits(const struct dulcet_limits *limits);
+
+// Stop the reducers of every thread at their next step, until each sets its limits again. This may
+// be called from a signal handler.
+void dulcet_interrupt(void);
+
+// Why the reducers of the calling thread stopped, if they did, and the steps they took so far.
+enum dulcet_status dulcet_status(void);
+unsigned long dulcet_steps_taken(void);
+
+// Only limit the steps, as with `dulcet_set_limits`.
+void dulcet_set_step_limit(unsigned long limit);
+unsigned long dulcet_steps_left(void);
+int dulcet_step_limit_reached(void);
+
+enum dulcet_status dulcet_beta_cbn(struct dulcet_term *t);
+enum dulcet_status dulcet_beta_nor(struct dulcet_term *t);
+enum dulcet_status dulcet_beta_app(struct dulcet_term *t);
+
+// Reduce `t` like the reducers above, but without changing it, returning the result as a new
+// term, with the status left in `dulcet_status`. Every subterm of `t` that the reduction leaves
+// where it is, such as those already in normal form, is referred to rather than copied, as are
+// the closed arguments of its redexes, so `t` must outlive the result and stay unchanged while it
+// does. The result is freed with `dulcet_term_free` as any other term, which leaves `t` alone.
+struct dulcet_term *dulcet_beta_cbn_shared(const struct dulcet_term *t);
+struct dulcet_term *dulcet_beta_nor_shared(const struct dulcet_term *t);
+struct dulcet_term *dulcet_beta_app_shared(const struct dulcet_term *t);
+
+// Reduce `t` to normal form by racing strategies on threads of their own: normal order on `t` and
+// applicative order on a copy of it. The first normal form found is kept in `t` and the other
+// reductions are cancelled; as normal forms are unique, which one finds it only changes how long
+// it takes. Where applicative order diverges, normal order still finds it, and if none does, `t`
+// is left as normal order left it. The limits of the calling thread apply to each reduction, and
+// the steps taken are those of the one that is kept. Neither the step hook nor the profile of the
+// calling thread see the steps, while the stats count those of every strategy. The allocator of
+// the context in use, if any, is called from those threads too, though by only one at a time. A
+// fatal error on either stops both, and is then raised on the calling thread, so that the error
+// handler is only ever called there.
+enum dulcet_status dulcet_beta_portfolio(struct dulcet_term *t);
+
+// Reduce `t` in normal order, like `dulcet_beta_nor`, while writing its normal form to `fp` head
+// first: its binders and head variable as soon as its head normal form is known, and then each of
+// its arguments, normalized in turn from left to right. The output is flushed before every
+// reduction, so that what is final can be read while the rest is computed. If writing fails, e.g.
+// as the reader closed the pipe, the reduction stops too and -1 is returned, or otherwise the
+// length of the output. Once a limit stops the reduction, the rest of the term is written as is.
+int dulcet_term_stream_classic(struct dulcet_term *t, FILE *fp);
+int dulcet_term_stream_de_bruijn(struct dulcet_term *t, FILE *fp);
+
+enum dulcet_strategy {
+	DULCET_STRATEGY_NONE, // `dulcet_eval` called directly
+	DULCET_STRATEGY_CBN,
+	DULCET_STRATEGY_NOR,
+	DULCET_STRATEGY_APP,
+	DULCET_STRATEGY_COUNT,
+};
+
+enum dulcet_phase {
+	DULCET_PHASE_READ,
+	DULCET_PHASE_PARSE,
+	DULCET_PHASE_REDUCE,
+	DULCET_PHASE_PRINT,
+	DULCET_PHASE_COUNT,
+};
+
+// Counters of the work done by the library on the calling thread since the last reset. They are
+// only kept when it is built with `DULCET_STATS` defined, and are otherwise always zero.
+struct dulcet_stats {
+	unsigned long long beta_steps[DULCET_STRATEGY_COUNT];
+	unsigned long long delta_steps; // Applications of primitives reduced
+	unsigned long long substitutions;
+	unsigned long long arguments_moved; // Into the one occurrence that needs no copy of them
+	unsigned long long arguments_erased; // Freed, as the parameter did not occur
+	unsigned long long nodes_copied;
+	unsigned long long refs_instantiated; // Shared terms copied where a reducer looked into them
+	unsigned long long nodes_shifted;
+	unsigned long long nodes_allocated;
+	unsigned long long nodes_freed;
+	unsigned long long peak_live_nodes; // Counting those already alive at the last reset
+	unsigned long long max_depth;
+	unsigned long long phase_ns[DULCET_PHASE_COUNT];
+};
+
+int dulcet_stats_enabled(void);
+void dulcet_stats_get(struct dulcet_stats *stats);
+void dulcet_stats_reset(void);
+
+// Record time spent by the caller in a phase, such as reading the input, measured with
+// `dulcet_stats_time`, a monotonic clock in nanoseconds.
+void dulcet_stats_add_time(enum dulcet_phase phase, unsigned long long ns);
+unsigned long long dulcet_stats_time(void);
+
+// Allocator of the memory of a context: its term nodes, which are all `sizeof(struct dulcet_term)`
+// bytes, and the blocks of the images loaded in it, which are larger and aligned like nodes.
+// `alloc` returns NULL when out of memory, and `free` is given back what it returned, along with
+// its size.
+struct dulcet_allocator {
+	void *(*alloc)(void *data, size_t size);
+	void (*free)(void *data, void *ptr, size_t size);
+	void *data;
+};
+
+// Called on the errors after which the library cannot go on, such as running out of memory or
+// meeting a term of an unknown kind, with the terms it was working on left inconsistent. Without a
+// handler, or if it returns, the error is written to stderr and the process exits. A handler may
+// instead `longjmp` out of the library, and throw away the terms of the context along with its
+// heap. By then, the context is no longer in use.
+typedef void (*dulcet_error_handler)(void *data, const char *error);
+
+// State of the library that belongs to a context, kept here while it is not in use
+struct __dulcet_ctx_state {
+	struct dulcet_allocator allocator;
+	int cache_nodes;
+	struct dulcet_term *node_cache;
+	unsigned long long cached_nodes;
+	long long live_nodes;
+	unsigned long long image_bytes;
+	dulcet_error_handler error_handler;
+	void *error_handler_data;
+	const char *error;
+	struct dulcet_limits limits;
+	unsigned long steps_taken;
+	unsigned long long deadline;
+	int governed;
+	enum dulcet_status status;
+	unsigned long interrupts_seen;
+	struct dulcet_stats stats;
+};
+
+// A heap of term nodes, with its own limits, stats and error state, for the threads of a program
+// to work apart from each other: every call the library makes on the calling thread between
+// `dulcet_ctx_enter` and `dulcet_ctx_leave` uses them instead of those of the thread, and so does
+// each of the `dulcet_ctx_` variants of the entry points. Nodes freed within a context are kept to
+// be allocated again, without going back to its allocator until it is deinitialized, so terms of a
+// context must be allocated and freed in it. A context may move between threads, while only one
+// at a time uses it, and contexts may be entered within each other.
+struct dulcet_ctx {
+	struct __dulcet_ctx_state state;
+	struct __dulcet_ctx_state outer; // Of the thread or context in use before it was entered
+	struct dulcet_ctx *outer_ctx;
+	unsigned int depth;
+};
+
+// Initialize a context, with nodes from `allocator`, or from `malloc` if NULL, and no limits.
+void dulcet_ctx_init(struct dulcet_ctx *ctx, const struct dulcet_allocator *allocator);
+// Give the nodes kept by the context back to its allocator. Those of its terms that are still
+// alive are not freed, which an allocator that throws away its whole heap does not need.
+void dulcet_ctx_deinit(struct dulcet_ctx *ctx);
+
+void dulcet_ctx_enter(struct dulcet_ctx *ctx);
+void dulcet_ctx_leave(struct dulcet_ctx *ctx);
+
+void dulcet_ctx_set_error_handler(struct dulcet_ctx *ctx, dulcet_error_handler handler, void *data);
+// The last error met by the library within the context, or NULL.
+const char *dulcet_ctx_error(struct dulcet_ctx *ctx);
+
+// Nodes of the terms alive in the context, and bytes taken from its allocator, counting the nodes
+// kept to be allocated again and the blocks of the images loaded.
+unsigned long long dulcet_ctx_live_nodes(struct dulcet_ctx *ctx);
+unsigned long long dulcet_ctx_bytes(struct dulcet_ctx *ctx);
+
+struct dulcet_term *dulcet_ctx_alloc_var(struct dulcet_ctx *ctx, unsigned int index);
+struct dulcet_term *dulcet_ctx_alloc_abs(struct dulcet_ctx *ctx, struct dulcet_term *m);
+struct dulcet_term *dulcet_ctx_alloc_app(struct dulcet_ctx *ctx, struct dulcet_term *m,
+					 struct dulcet_term *n);
+struct dulcet_term *dulcet_ctx_alloc_int(struct dulcet_ctx *ctx, long long value);
+struct dulcet_term *dulcet_ctx_alloc_bool(struct dulcet_ctx *ctx, int value);
+struct dulcet_term *dulcet_ctx_alloc_prim(struct dulcet_ctx *ctx, enum dulcet_prim_op op);
+struct dulcet_term *dulcet_ctx_alloc_ref(struct dulcet_ctx *ctx, struct dulcet_term *m);
+
+struct dulcet_term *dulcet_ctx_church_from_int(struct dulcet_ctx *ctx, long long value);
+struct dulcet_term *dulcet_ctx_church_from_bool(struct dulcet_ctx *ctx, int value);
+
+void dulcet_ctx_image_load(struct dulcet_ctx *ctx, struct dulcet_loaded_image *loaded,
+			   const struct dulcet_image *image);
+void dulcet_ctx_image_unload(struct dulcet_ctx *ctx, struct dulcet_loaded_image *loaded);
+
+struct dulcet_term *dulcet_ctx_term_copy(struct dulcet_ctx *ctx, const struct dulcet_term *t);
+void dulcet_ctx_term_free(struct dulcet_ctx *ctx, struct dulcet_term *t);
+
+void dulcet_ctx_apply(struct dulcet_ctx *ctx, struct dulcet_term *t, struct dulcet_term *rhs);
+void dulcet_ctx_eval(struct dulcet_ctx *ctx, struct dulcet_term *t);
+
+void dulcet_ctx_set_limits(struct dulcet_ctx *ctx, const struct dulcet_limits *limits);
+enum dulcet_status dulcet_ctx_status(struct dulcet_ctx *ctx);
+unsigned long dulcet_ctx_steps_taken(struct dulcet_ctx *ctx);
+
+enum dulcet_status dulcet_ctx_beta_cbn(struct dulcet_ctx *ctx, struct dulcet_term *t);
+enum dulcet_status dulcet_ctx_beta_nor(struct dulcet_ctx *ctx, struct dulcet_term *t);
+enum dulcet_status dulcet_ctx_beta_app(struct dulcet_ctx *ctx, struct dulcet_term *t);
+enum dulcet_status dulcet_ctx_beta_portfolio(struct dulcet_ctx *ctx, struct dulcet_term *t);
+
+struct dulcet_term *dulcet_ctx_beta_cbn_shared(struct dulcet_ctx *ctx, const struct dulcet_term *t);
+struct dulcet_term *dulcet_ctx_beta_nor_shared(struct dulcet_ctx *ctx, const struct dulcet_term *t);
+struct dulcet_term *dulcet_ctx_beta_app_shared(struct dulcet_ctx *ctx, const struct dulcet_term *t);
+
+int dulcet_ctx_term_stream_classic(struct dulcet_ctx *ctx, struct dulcet_term *t, FILE *fp);
+int dulcet_ctx_term_stream_de_bruijn(struct dulcet_ctx *ctx, struct dulcet_term *t, FILE *fp);
+
+void dulcet_ctx_stats_get(struct dulcet_ctx *ctx, struct dulcet_stats *stats);
+void dulcet_ctx_stats_reset(struct dulcet_ctx *ctx);
 
 #endif // _DULCET_H
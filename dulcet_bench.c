@@ -0,0 +1,653 @@
+/*
+ * Copyright (c) 2022 Leonardo Duarte
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <dirent.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#include "dulcet.h"
+
+#include "dulcet_parser.h"
+#include "dulcet_perf.h"
+#include "dulcet_session.h"
+
+/*
+ * Benchmark driver for the reducers. Every engine is run over a corpus of workloads, made of the
+ * examples and of families of generated terms that scale with a size parameter, and each
+ * measurement is written to stdout as a line of JSON, so that runs before and after a change can
+ * be compared with any tool. Measurements run in a child process of their own, which keeps the
+ * peak RSS of each one apart, and turns a workload that crashes or runs out of time into a
+ * result instead of the end of the suite.
+ */
+
+static const struct engine {
+	const char *name;
+	enum dulcet_status (*reduce)(struct dulcet_term *t);
+} engines[] = {
+	{ "cbn", dulcet_beta_cbn },
+	{ "nor", dulcet_beta_nor },
+	{ "app", dulcet_beta_app },
+	{ "portfolio", dulcet_beta_portfolio },
+};
+
+#define ENGINES_SIZE (sizeof(engines) / sizeof(engines[0]))
+
+// Definitions that the generated families are written with, without being reduced beforehand
+static const char *const prelude[] = {
+	"true := \\x.\\y.x",
+	"false := \\x.\\y.y",
+	"iszero := \\n.n (\\x.false) true",
+	"succ := \\n.\\f.\\x.f (n f x)",
+	"pred := \\n.\\f.\\x.n (\\g.\\h.h (g f)) (\\u.x) (\\u.u)",
+	"plus := \\m.\\n.\\f.\\x.m f (n f x)",
+	"mult := \\m.\\n.\\f.m (n f)",
+	"exp := \\m.\\n.n m",
+	"sub := \\m.\\n.n pred m",
+	"leq := \\m.\\n.iszero (sub m n)",
+	"Y := \\g.(\\x.g (x x)) (\\x.g (x x))",
+	"fact := Y (\\r.\\n.iszero n (\\f.\\x.f x) (mult n (r (pred n))))",
+	"fib := Y (\\r.\\n.leq n (\\f.\\x.f x) n (plus (r (pred n)) (r (pred (pred n)))))",
+	"ack := \\m.m (\\g.\\n.n g (g (\\f.\\x.f x))) succ",
+};
+
+enum workload_kind {
+	WORKLOAD_KIND_SOURCE,
+	WORKLOAD_KIND_RANDOM_DEEP,
+	WORKLOAD_KIND_RANDOM_WIDE,
+	WORKLOAD_KIND_FILE,
+};
+
+#define FAMILY_MAX_SIZES 8
+
+// A family of workloads, whose terms are given by a format in which every `%N` is replaced by
+// the Church numeral of the size, and every `%n` by the size itself
+static const struct family {
+	const char *name;
+	enum workload_kind kind;
+	const char *format;
+	unsigned int sizes[FAMILY_MAX_SIZES];
+} families[] = {
+	{ "church-plus", WORKLOAD_KIND_SOURCE, "plus %N %N", { 64, 256, 1024 } },
+	{ "church-mult", WORKLOAD_KIND_SOURCE, "mult %N %N", { 8, 16, 32, 64 } },
+	{ "church-exp", WORKLOAD_KIND_SOURCE, "exp (\\f.\\x.f (f x)) %N", { 4, 8, 12 } },
+	{ "factorial", WORKLOAD_KIND_SOURCE, "fact %N", { 2, 3, 4, 5 } },
+	{ "fibonacci", WORKLOAD_KIND_SOURCE, "fib %N", { 4, 6, 8, 10 } },
+	{ "ackermann-2", WORKLOAD_KIND_SOURCE, "ack (\\f.\\x.f (f x)) %N", { 1, 2, 4, 8 } },
+	{ "ackermann-3", WORKLOAD_KIND_SOURCE, "ack (\\f.\\x.f (f (f x))) %N", { 1, 2, 3 } },
+	{ "random-deep", WORKLOAD_KIND_RANDOM_DEEP, NULL, { 64, 256, 1024, 4096 } },
+	{ "random-wide", WORKLOAD_KIND_RANDOM_WIDE, NULL, { 32, 64, 128, 256 } },
+};
+
+#define FAMILIES_SIZE (sizeof(families) / sizeof(families[0]))
+
+struct workload {
+	const char *family;
+	enum workload_kind kind;
+	const char *format;
+	char *path;
+	unsigned int size;
+};
+
+struct options {
+	unsigned int runs;
+	unsigned long max_steps;
+	unsigned int timeout;
+	unsigned long max_memory;
+	int perf;
+	const char *filter;
+};
+
+// Returns `p`, unless it is the NULL of a failed allocation, which the bench cannot go on from
+static void *checked(void *p)
+{
+	if (!p) {
+		fprintf(stderr, "dulcet_bench: fatal error: out of memory\n");
+		exit(1);
+	}
+
+	return p;
+}
+
+struct string {
+	char *buf;
+	size_t size;
+	size_t capacity;
+};
+
+static void string_append(struct string *s, const char *text, size_t text_len)
+{
+	if (s->size + text_len + 1 > s->capacity) {
+		while (s->size + text_len + 1 > s->capacity) {
+			s->capacity = s->capacity ? 2 * s->capacity : 256;
+		}
+		s->buf = checked(realloc(s->buf, s->capacity));
+	}
+
+	memcpy(s->buf + s->size, text, text_len);
+	s->size += text_len;
+	s->buf[s->size] = '\0';
+}
+
+static void string_append_numeral(struct string *s, unsigned int n)
+{
+	string_append(s, "(\\f.\\x.", 7);
+	for (unsigned int i = 0; i < n; ++i) {
+		string_append(s, "f (", 3);
+	}
+	string_append(s, "x", 1);
+	for (unsigned int i = 0; i < n; ++i) {
+		string_append(s, ")", 1);
+	}
+	string_append(s, ")", 1);
+}
+
+static char *format_workload(const char *format, unsigned int size)
+{
+	struct string s = { NULL, 0, 0 };
+
+	for (const char *c = format; *c != '\0'; ++c) {
+		if (c[0] == '%' && c[1] == 'N') {
+			string_append_numeral(&s, size);
+			c += 1;
+		} else if (c[0] == '%' && c[1] == 'n') {
+			char digits[16];
+			int len = snprintf(digits, sizeof(digits), "%u", size);
+			string_append(&s, digits, len);
+			c += 1;
+		} else {
+			string_append(&s, c, 1);
+		}
+	}
+
+	return s.buf;
+}
+
+static uint64_t random_next(uint64_t *state)
+{
+	// xorshift64
+	*state ^= *state << 13;
+	*state ^= *state >> 7;
+	*state ^= *state << 17;
+	return *state;
+}
+
+// Generates a term of `size` nodes whose variables are all bound by one of the `binders`
+// abstractions around it, choosing an abstraction over an application with the given odds out
+// of 100
+static struct dulcet_term *random_term(uint64_t *state, unsigned int size, unsigned int binders,
+				       unsigned int abs_odds)
+{
+	if (size == 1) {
+		return dulcet_alloc_var(1 + random_next(state) % binders);
+	}
+
+	if (size == 2 || random_next(state) % 100 < abs_odds) {
+		return dulcet_alloc_abs(random_term(state, size - 1, binders + 1, abs_odds));
+	}
+
+	unsigned int m_size = 1 + random_next(state) % (size - 2);
+
+	return dulcet_alloc_app(random_term(state, m_size, binders, abs_odds),
+				random_term(state, size - 1 - m_size, binders, abs_odds));
+}
+
+static char *read_file(const char *path, unsigned int *len)
+{
+	FILE *fp = fopen(path, "r");
+	if (!fp) {
+		return NULL;
+	}
+
+	struct string s = { NULL, 0, 0 };
+	char buf[BUFSIZ];
+	size_t bytes_read;
+
+	while ((bytes_read = fread(buf, 1, sizeof(buf), fp)) > 0) {
+		string_append(&s, buf, bytes_read);
+	}
+
+	fclose(fp);
+
+	*len = s.size;
+	return s.buf ? s.buf : checked(calloc(1, 1));
+}
+
+static struct dulcet_term *build_workload(const struct workload *w)
+{
+	// Seeded by the size alone, so that every run of the suite sees the same terms
+	uint64_t state = 0x9e3779b97f4a7c15u ^ w->size;
+
+	// An abstraction applied to another, so that every strategy has a redex to start from
+	unsigned int m_size = w->size / 2;
+	unsigned int n_size = w->size - m_size - 1;
+
+	switch (w->kind) {
+	case WORKLOAD_KIND_RANDOM_DEEP:
+		return dulcet_alloc_app(dulcet_alloc_abs(random_term(&state, m_size - 1, 1, 50)),
+					dulcet_alloc_abs(random_term(&state, n_size - 1, 1, 50)));
+	case WORKLOAD_KIND_RANDOM_WIDE:
+		return dulcet_alloc_app(dulcet_alloc_abs(random_term(&state, m_size - 1, 1, 10)),
+					dulcet_alloc_abs(random_term(&state, n_size - 1, 1, 10)));
+	case WORKLOAD_KIND_SOURCE:
+	case WORKLOAD_KIND_FILE:
+		break;
+	}
+
+	struct dulcet_session session;
+	dulcet_session_init(&session);
+
+	for (size_t i = 0; i < sizeof(prelude) / sizeof(prelude[0]); ++i) {
+		struct dulcet_parse_result result =
+			dulcet_session_exec(&session, prelude[i], strlen(prelude[i]));
+		if (result.kind != DULCET_PARSE_OK) {
+			fprintf(stderr, "dulcet_bench: fatal error: bad prelude `%s`\n", prelude[i]);
+			exit(1);
+		}
+	}
+
+	unsigned int text_len;
+	char *text;
+
+	if (w->kind == WORKLOAD_KIND_FILE) {
+		text = read_file(w->path, &text_len);
+		if (!text) {
+			fprintf(stderr, "dulcet_bench: fatal error: could not open file `%s`: %s\n",
+				w->path, strerror(errno));
+			exit(1);
+		}
+	} else {
+		text = format_workload(w->format, w->size);
+		text_len = strlen(text);
+	}
+
+	struct dulcet_parse_result result = dulcet_session_parse(&session, text, text_len);
+	if (result.kind != DULCET_PARSE_OK || !result.value) {
+		fprintf(stderr, "dulcet_bench: fatal error: could not parse workload `%s`\n",
+			w->path ? w->path : w->family);
+		exit(1);
+	}
+
+	free(text);
+	dulcet_session_deinit(&session);
+
+	return result.value;
+}
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t) ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+static int compare_u64(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *) a;
+	uint64_t y = *(const uint64_t *) b;
+
+	return (x > y) - (x < y);
+}
+
+// Nearest rank percentile of sorted samples
+static uint64_t percentile(const uint64_t *samples, unsigned int n, unsigned int p)
+{
+	unsigned int rank = (p * n + 99) / 100;
+
+	return samples[rank > 0 ? rank - 1 : 0];
+}
+
+static void print_workload_fields(const struct workload *w, const struct engine *e)
+{
+	printf("{\"workload\":\"%s\",\"size\":%u,", w->path ? w->path : w->family, w->size);
+	printf("\"strategy\":\"%s\",", e->name);
+}
+
+// Runs in the child process of a measurement, and exits with it
+static void measure(const struct workload *w, const struct engine *e, const struct options *o)
+{
+	struct dulcet_term *t = build_workload(w);
+	uint64_t *samples = checked(malloc(o->runs * sizeof(*samples)));
+	unsigned long steps = 0;
+	enum dulcet_status status = DULCET_STATUS_OK;
+
+	struct dulcet_perf perf;
+	struct dulcet_perf_sample perf_total = { { 0 } };
+	int perf_open = o->perf && dulcet_perf_open(&perf) >= 0;
+
+	// The first run only warms up caches and the allocator
+	for (unsigned int i = 0; i <= o->runs; ++i) {
+		struct dulcet_term *s = dulcet_term_copy(t);
+		struct dulcet_perf_sample perf_start, perf_end;
+
+		dulcet_set_step_limit(o->max_steps);
+
+		if (perf_open) {
+			dulcet_perf_read(&perf, &perf_start);
+		}
+
+		uint64_t start = now_ns();
+		status = e->reduce(s);
+		uint64_t end = now_ns();
+
+		if (perf_open) {
+			dulcet_perf_read(&perf, &perf_end);
+		}
+
+		if (i > 0) {
+			samples[i - 1] = end - start;
+
+			for (int j = 0; perf_open && j < DULCET_PERF_COUNTER_COUNT; ++j) {
+				perf_total.values[j] += perf_end.values[j] - perf_start.values[j];
+			}
+		}
+
+		steps = dulcet_steps_taken();
+
+		dulcet_term_free(s);
+	}
+
+	qsort(samples, o->runs, sizeof(*samples), compare_u64);
+
+	uint64_t median = samples[o->runs / 2];
+	if (o->runs % 2 == 0) {
+		median = (samples[o->runs / 2 - 1] + samples[o->runs / 2]) / 2;
+	}
+
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+
+	print_workload_fields(w, e);
+	printf("\"nodes\":%zu,\"status\":\"%s\",\"runs\":%u,\"steps\":%lu,", dulcet_term_size(t),
+	       dulcet_status_name(status), o->runs, steps);
+	printf("\"min_ns\":%llu,\"median_ns\":%llu,\"p90_ns\":%llu,\"p99_ns\":%llu,"
+	       "\"max_ns\":%llu,",
+	       (unsigned long long) samples[0], (unsigned long long) median,
+	       (unsigned long long) percentile(samples, o->runs, 90),
+	       (unsigned long long) percentile(samples, o->runs, 99),
+	       (unsigned long long) samples[o->runs - 1]);
+	printf("\"steps_per_sec\":%.0f,\"peak_rss_kb\":%ld",
+	       median > 0 ? steps * 1e9 / median : 0.0, usage.ru_maxrss);
+
+	// Counts are the mean of a run, also given per beta reduction step
+	for (int j = 0; perf_open && j < DULCET_PERF_COUNTER_COUNT; ++j) {
+		if (dulcet_perf_available(&perf, j)) {
+			double mean = (double) perf_total.values[j] / o->runs;
+
+			printf(",\"%s\":%.0f,\"%s_per_step\":%.3f", dulcet_perf_counter_names[j],
+			       mean, dulcet_perf_counter_names[j], steps > 0 ? mean / steps : 0.0);
+		}
+	}
+	printf("}\n");
+
+	if (perf_open) {
+		dulcet_perf_close(&perf);
+	}
+
+	free(samples);
+	dulcet_term_free(t);
+
+	fflush(stdout);
+	exit(0);
+}
+
+static int run(const struct workload *w, const struct engine *e, const struct options *o)
+{
+	fflush(stdout);
+
+	pid_t pid = fork();
+	if (pid < 0) {
+		perror("fork");
+		return -1;
+	}
+
+	if (pid == 0) {
+		// Terms that blow up make the allocator fail, and so the child crash, long before
+		// they could take the memory of the whole machine
+		struct rlimit limit = {
+			.rlim_cur = o->max_memory * 1024 * 1024,
+			.rlim_max = o->max_memory * 1024 * 1024,
+		};
+		setrlimit(RLIMIT_AS, &limit);
+
+		alarm(o->timeout);
+		measure(w, e, o);
+	}
+
+	int status;
+	while (waitpid(pid, &status, 0) < 0) {
+		if (errno != EINTR) {
+			perror("waitpid");
+			return -1;
+		}
+	}
+
+	if (WIFSIGNALED(status)) {
+		print_workload_fields(w, e);
+		printf("\"status\":\"%s\",\"signal\":%d}\n",
+		       WTERMSIG(status) == SIGALRM ? "timeout" : "crashed", WTERMSIG(status));
+	} else if (WEXITSTATUS(status) != 0) {
+		return -1;
+	}
+
+	return 0;
+}
+
+static int compare_strings(const void *a, const void *b)
+{
+	return strcmp(*(char *const *) a, *(char *const *) b);
+}
+
+// Appends a workload for every `.lc` file in `examples_dir`, in order of name
+static int add_examples(struct workload **workloads, size_t *workloads_size,
+			const char *examples_dir)
+{
+	DIR *dir = opendir(examples_dir);
+	if (!dir) {
+		fprintf(stderr, "dulcet_bench: fatal error: could not open directory `%s`: %s\n",
+			examples_dir, strerror(errno));
+		return -1;
+	}
+
+	char **names = NULL;
+	size_t names_size = 0;
+	struct dirent *entry;
+
+	while ((entry = readdir(dir)) != NULL) {
+		size_t len = strlen(entry->d_name);
+		if (len > 3 && strcmp(entry->d_name + len - 3, ".lc") == 0) {
+			names = checked(realloc(names, (names_size + 1) * sizeof(*names)));
+			names[names_size++] = checked(strdup(entry->d_name));
+		}
+	}
+	closedir(dir);
+
+	qsort(names, names_size, sizeof(*names), compare_strings);
+
+	*workloads =
+		checked(realloc(*workloads, (*workloads_size + names_size) * sizeof(**workloads)));
+
+	for (size_t i = 0; i < names_size; ++i) {
+		char *path = checked(malloc(strlen(examples_dir) + strlen(names[i]) + 2));
+		sprintf(path, "%s/%s", examples_dir, names[i]);
+		free(names[i]);
+
+		(*workloads)[(*workloads_size)++] = (struct workload) {
+			.family = "examples",
+			.kind = WORKLOAD_KIND_FILE,
+			.format = NULL,
+			.path = path,
+			.size = 0,
+		};
+	}
+	free(names);
+
+	return 0;
+}
+
+static void print_usage(const char *program_name)
+{
+	printf("dulcet_bench: a benchmark suite for the dulcet reducers\n");
+	printf("\n");
+	printf("Usage: %s [options]\n", program_name);
+	printf("Options:\n");
+	printf("  -h, --help         \tDisplay this information.\n");
+	printf("  -n <runs>          \tTime each workload `runs` times, after a warmup run (default 5).\n");
+	printf("  --max-steps <n>    \tStop each run after `n` beta reduction steps (default 1000000).\n");
+	printf("  --timeout <seconds>\tGive up on a workload after `seconds` seconds (default 60).\n");
+	printf("  --max-memory <MiB> \tLimit the address space of each workload (default 1024).\n");
+	printf("  --only <name>      \tOnly run the workloads whose name contains `name`.\n");
+	printf("  --examples <dir>   \tInclude the `.lc` files in `dir` (default `examples`).\n");
+	printf("  --perf             \tAlso count cycles, instructions, cache and branch misses of each\n");
+	printf("                     \treduction with `perf_event_open`, where available.\n");
+	printf("  --list             \tList the workloads instead of running them.\n");
+	printf("\n");
+	printf("Each result is written to stdout as a line of JSON.\n");
+}
+
+static char *shift_arg(int *argc, char ***argv)
+{
+	char *arg = **argv;
+	*argc -= 1;
+	*argv += 1;
+	return arg;
+}
+
+int main(int argc, char **argv)
+{
+	char *program_name = shift_arg(&argc, &argv);
+	const char *examples_dir = "examples";
+	int list = 0;
+	struct options options = {
+		.runs = 5,
+		.max_steps = 1000000,
+		.timeout = 60,
+		.max_memory = 1024,
+		.perf = 0,
+		.filter = NULL,
+	};
+
+	while (argc > 0) {
+		char *opt = shift_arg(&argc, &argv);
+
+		if (strcmp(opt, "-h") == 0 || strcmp(opt, "--help") == 0) {
+			print_usage(program_name);
+			return 0;
+		} else if (strcmp(opt, "--list") == 0) {
+			list = 1;
+		} else if (strcmp(opt, "--perf") == 0) {
+			struct dulcet_perf perf;
+			if (dulcet_perf_open(&perf) < 0) {
+				fprintf(stderr,
+					"%s: warning: performance counters are not available: %s\n",
+					program_name, strerror(errno));
+			} else {
+				dulcet_perf_close(&perf);
+				options.perf = 1;
+			}
+		} else if (strcmp(opt, "--only") == 0 || strcmp(opt, "--examples") == 0) {
+			if (argc <= 0) {
+				fprintf(stderr, "%s: fatal error: `%s` flag requires an argument\n",
+					program_name, opt);
+				return 1;
+			}
+
+			if (strcmp(opt, "--only") == 0) {
+				options.filter = shift_arg(&argc, &argv);
+			} else {
+				examples_dir = shift_arg(&argc, &argv);
+			}
+		} else if (strcmp(opt, "-n") == 0 || strcmp(opt, "--max-steps") == 0 ||
+			   strcmp(opt, "--timeout") == 0 || strcmp(opt, "--max-memory") == 0) {
+			char *end = NULL;
+			char *value = argc > 0 ? shift_arg(&argc, &argv) : "";
+			unsigned long n = strtoul(value, &end, 10);
+
+			if (*value == '\0' || *end != '\0' || n == 0 ||
+			    (strcmp(opt, "--max-steps") != 0 && n > 1000000)) {
+				fprintf(stderr,
+					"%s: fatal error: `%s` flag requires a positive number\n",
+					program_name, opt);
+				return 1;
+			}
+
+			if (strcmp(opt, "-n") == 0) {
+				options.runs = n;
+			} else if (strcmp(opt, "--max-steps") == 0) {
+				options.max_steps = n < DULCET_UNLIMITED_STEPS ? n
+									: DULCET_UNLIMITED_STEPS - 1;
+			} else if (strcmp(opt, "--timeout") == 0) {
+				options.timeout = n;
+			} else {
+				options.max_memory = n;
+			}
+		} else {
+			fprintf(stderr, "%s: fatal error: unknown parameter `%s`\n", program_name,
+				opt);
+			return 1;
+		}
+	}
+
+	struct workload *workloads = NULL;
+	size_t workloads_size = 0;
+
+	if (add_examples(&workloads, &workloads_size, examples_dir) < 0) {
+		return 1;
+	}
+
+	for (size_t i = 0; i < FAMILIES_SIZE; ++i) {
+		for (size_t j = 0; j < FAMILY_MAX_SIZES && families[i].sizes[j] > 0; ++j) {
+			workloads = checked(
+				realloc(workloads, (workloads_size + 1) * sizeof(*workloads)));
+			workloads[workloads_size++] = (struct workload) {
+				.family = families[i].name,
+				.kind = families[i].kind,
+				.format = families[i].format,
+				.path = NULL,
+				.size = families[i].sizes[j],
+			};
+		}
+	}
+
+	int rc = 0;
+
+	for (size_t i = 0; i < workloads_size && rc == 0; ++i) {
+		const struct workload *w = &workloads[i];
+		const char *name = w->path ? w->path : w->family;
+
+		if (options.filter && !strstr(name, options.filter)) {
+			continue;
+		}
+
+		if (list) {
+			printf("%s %u\n", name, w->size);
+			continue;
+		}
+
+		for (size_t j = 0; j < ENGINES_SIZE && rc == 0; ++j) {
+			rc = run(w, &engines[j], &options);
+		}
+	}
+
+	for (size_t i = 0; i < workloads_size; ++i) {
+		free(workloads[i].path);
+	}
+	free(workloads);
+
+	return rc < 0;
+}
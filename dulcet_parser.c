@@ -5,6 +5,8 @@
  */
 
 #include <assert.h>
+#include <limits.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -20,6 +22,10 @@ enum token_kind {
 	TOKEN_KIND_RPAREN,
 	TOKEN_KIND_LAMBDA,
 	TOKEN_KIND_DOT,
+	TOKEN_KIND_LET,
+	TOKEN_KIND_IN,
+	TOKEN_KIND_EQUALS,
+	TOKEN_KIND_EOF,
 };
 
 struct location {
@@ -46,15 +52,45 @@ static struct token __dulcet_token_begin(enum token_kind kind, const char *text_
 
 struct tokenization {
 	size_t size;
-	struct token buf[];
+	size_t capacity;
+	struct token *buf;
+	bool out_of_memory; // Set once a token could not be pushed
 };
 
-static const size_t TOKENIZATION_BUFFER_MAX_SIZE = 1024;
+static const size_t TOKENIZATION_BUFFER_INITIAL_CAPACITY = 1024;
+
+// Identifiers that are keywords of definitions, which may then not be used as names
+static enum token_kind __dulcet_keyword_kind(struct sorvete_sv text)
+{
+	if (sorvete_sv_eq(text, sorvete_sv_from_cstr("let"))) {
+		return TOKEN_KIND_LET;
+	} else if (sorvete_sv_eq(text, sorvete_sv_from_cstr("in"))) {
+		return TOKEN_KIND_IN;
+	} else if (sorvete_sv_eq(text, sorvete_sv_from_cstr("="))) {
+		return TOKEN_KIND_EQUALS;
+	}
+
+	return TOKEN_KIND_IDENT;
+}
 
 static void __dulcet_tokenization_push_token(struct tokenization *tokenization, struct token tk)
 {
-	// FIXME: implement the tokenization buffer as a dynamic list
-	assert(tokenization->size < TOKENIZATION_BUFFER_MAX_SIZE);
+	if (tk.kind == TOKEN_KIND_IDENT) {
+		tk.kind = __dulcet_keyword_kind(tk.text);
+	}
+
+	if (tokenization->size == tokenization->capacity) {
+		size_t capacity = tokenization->capacity ? 2 * tokenization->capacity
+							 : TOKENIZATION_BUFFER_INITIAL_CAPACITY;
+		struct token *buf = realloc(tokenization->buf, capacity * sizeof(struct token));
+		if (!buf) {
+			tokenization->out_of_memory = true;
+			return;
+		}
+
+		tokenization->buf = buf;
+		tokenization->capacity = capacity;
+	}
 
 	tokenization->buf[tokenization->size] = tk;
 	tokenization->size += 1;
@@ -100,7 +136,7 @@ static int __dulcet_tokenize(struct tokenization *tokenization, struct sorvete_s
 
 	struct token tk = { 0 };
 
-	while (loc.pos < input.size) {
+	while (loc.pos < input.size && input.data[loc.pos] != '\0') {
 		char c = input.data[loc.pos];
 
 		switch (state) {
@@ -212,7 +248,15 @@ static int __dulcet_tokenize(struct tokenization *tokenization, struct sorvete_s
 		loc.pos += 1;
 	}
 
-	return 0;
+	if (state == LEXER_STATE_READ_IDENT || state == LEXER_STATE_READ_INT) {
+		__dulcet_tokenization_push_token(tokenization, tk);
+	}
+
+	tk = __dulcet_token_begin(TOKEN_KIND_EOF, input.data + loc.pos, loc);
+	tk.text.size = 0;
+	__dulcet_tokenization_push_token(tokenization, tk);
+
+	return tokenization->out_of_memory ? -1 : 0;
 }
 
 struct token_stream {
@@ -220,14 +264,55 @@ struct token_stream {
 	const struct tokenization *tokenization;
 };
 
-#define PARAMETER_STACK_MAX_SIZE 256
+enum parsing_frame_kind {
+	PARSING_FRAME_KIND_ROOT,
+	PARSING_FRAME_KIND_PAREN,
+	PARSING_FRAME_KIND_LAMBDA,
+	PARSING_FRAME_KIND_DEFINITION,
+	PARSING_FRAME_KIND_LET,
+};
+
+// A term whose parsing is still underway: the whole input, a parenthesized subterm, the body of a
+// lambda or of a let, which extend as far to the right as possible, or the definition of a let, up
+// to its `in`. `m` holds the application of every argument read so far, and is NULL while none
+// have been read.
+//
+// Definitions written as `name = term` at the top of the input, before the term that uses them,
+// are lets too, whose definition ends at the first token at the start of a line.
+struct parsing_frame {
+	enum parsing_frame_kind kind;
+	struct token opening; // The name of a definition or let
+	struct dulcet_term *m;
+	unsigned int parameter_stack_size;
+	bool top_level;
+
+	// Of a let whose definition is not closed, and is thus applied to its body instead of shared
+	struct dulcet_term *definition;
+};
+
+// A name in scope: the parameter of a lambda, or a let, whose occurrences are then references to
+// its definition, shared between them
+struct binding {
+	struct sorvete_sv name;
+	struct dulcet_term *shared;
+};
+
+static const size_t PARSING_STACK_INITIAL_CAPACITY = 64;
 
 struct parsing_context {
 	struct token_stream tks;
-	unsigned int paren_depth;
 
-	struct sorvete_sv parameter_stack[PARAMETER_STACK_MAX_SIZE];
+	struct parsing_frame *frame_stack;
+	size_t frame_stack_size;
+	size_t frame_stack_capacity;
+
+	struct binding *parameter_stack;
 	unsigned int parameter_stack_size;
+	unsigned int parameter_stack_capacity;
+
+	const struct dulcet_parse_env *env;
+
+	bool top_level_definition;
 };
 
 static struct token __dulcet_current_token(const struct parsing_context *ctx)
@@ -237,31 +322,124 @@ static struct token __dulcet_current_token(const struct parsing_context *ctx)
 
 static struct token __dulcet_next_token(struct parsing_context *ctx)
 {
-	ctx->tks.pos += 1;
+	// The last token is always TOKEN_KIND_EOF, so the stream never moves past it
+	if (ctx->tks.pos + 1 < ctx->tks.tokenization->size) {
+		ctx->tks.pos += 1;
+	}
 	return __dulcet_current_token(ctx);
 }
 
-static void __dulcet_push_parameter(struct parsing_context *ctx, struct sorvete_sv parameter)
+// The stacks are grown as they fill up, and pushing returns false if there is no memory for it,
+// in which case the stack is left as it was
+static bool __dulcet_push_binding(struct parsing_context *ctx, struct sorvete_sv name,
+				  struct dulcet_term *shared)
 {
-	ctx->parameter_stack[ctx->parameter_stack_size] = parameter;
+	if (ctx->parameter_stack_size == ctx->parameter_stack_capacity) {
+		unsigned int capacity = ctx->parameter_stack_capacity
+						? 2 * ctx->parameter_stack_capacity
+						: PARSING_STACK_INITIAL_CAPACITY;
+		struct binding *stack =
+			realloc(ctx->parameter_stack, capacity * sizeof(struct binding));
+		if (!stack) {
+			return false;
+		}
+
+		ctx->parameter_stack = stack;
+		ctx->parameter_stack_capacity = capacity;
+	}
+
+	ctx->parameter_stack[ctx->parameter_stack_size] = (struct binding) {
+		.name = name,
+		.shared = shared,
+	};
 	ctx->parameter_stack_size += 1;
+
+	return true;
+}
+
+static bool __dulcet_push_parameter(struct parsing_context *ctx, struct sorvete_sv parameter)
+{
+	return __dulcet_push_binding(ctx, parameter, NULL);
 }
 
-static void __dulcet_pop_parameter(struct parsing_context *ctx)
+static void __dulcet_pop_bindings(struct parsing_context *ctx, unsigned int size)
 {
-	ctx->parameter_stack_size -= 1;
+	while (ctx->parameter_stack_size > size) {
+		ctx->parameter_stack_size -= 1;
+
+		struct binding *binding = &ctx->parameter_stack[ctx->parameter_stack_size];
+		if (binding->shared) {
+			dulcet_term_free(binding->shared);
+		}
+	}
 }
 
-static long long __dulcet_parameter_to_de_bruijn_index(const struct parsing_context *ctx,
-						       struct sorvete_sv parameter)
+// Finds the innermost binding of `name`, along with its de Bruijn index if it is a parameter, as
+// shared lets take none
+static const struct binding *__dulcet_find_binding(const struct parsing_context *ctx,
+						   struct sorvete_sv name, unsigned int *index)
 {
-	for (int i = ctx->parameter_stack_size - 1; i >= 0; --i) {
-		if (sorvete_sv_eq(ctx->parameter_stack[i], parameter)) {
-			return ctx->parameter_stack_size - i;
+	unsigned int parameters = 0;
+
+	for (long long i = (long long) ctx->parameter_stack_size - 1; i >= 0; --i) {
+		const struct binding *binding = &ctx->parameter_stack[i];
+
+		if (!binding->shared) {
+			parameters += 1;
+		}
+
+		if (sorvete_sv_eq(binding->name, name)) {
+			*index = parameters;
+			return binding;
 		}
 	}
 
-	return -1;
+	return NULL;
+}
+
+static struct parsing_frame *__dulcet_top_frame(struct parsing_context *ctx)
+{
+	assert(ctx->frame_stack_size > 0);
+
+	return &ctx->frame_stack[ctx->frame_stack_size - 1];
+}
+
+static bool __dulcet_push_frame(struct parsing_context *ctx, enum parsing_frame_kind kind,
+				struct token opening)
+{
+	if (ctx->frame_stack_size == ctx->frame_stack_capacity) {
+		size_t capacity = ctx->frame_stack_capacity ? 2 * ctx->frame_stack_capacity
+							    : PARSING_STACK_INITIAL_CAPACITY;
+		struct parsing_frame *stack =
+			realloc(ctx->frame_stack, capacity * sizeof(struct parsing_frame));
+		if (!stack) {
+			return false;
+		}
+
+		ctx->frame_stack = stack;
+		ctx->frame_stack_capacity = capacity;
+	}
+
+	ctx->frame_stack[ctx->frame_stack_size] = (struct parsing_frame) {
+		.kind = kind,
+		.opening = opening,
+		.m = NULL,
+		.parameter_stack_size = ctx->parameter_stack_size,
+		.top_level = false,
+		.definition = NULL,
+	};
+	ctx->frame_stack_size += 1;
+
+	return true;
+}
+
+static void __dulcet_frame_append(struct parsing_frame *frame, struct dulcet_term *n)
+{
+	if (n == NULL) {
+		return;
+	}
+
+	frame->m = frame->m == NULL ? n : dulcet_alloc_app(frame->m, n);
 }
 
 static struct dulcet_parse_result __dulcet_error(enum dulcet_parse_error_cause cause,
@@ -279,263 +457,453 @@ static struct dulcet_parse_result __dulcet_error(enum dulcet_parse_error_cause c
         };
 }
 
-static struct dulcet_parse_result __dulcet_parse_classic(struct parsing_context *ctx)
+// Discards every partially parsed term before reporting an error
+static struct dulcet_parse_result __dulcet_fail(struct parsing_context *ctx,
+						enum dulcet_parse_error_cause cause,
+						struct token tk)
 {
-	struct dulcet_term *m = NULL;
+	for (size_t i = 0; i < ctx->frame_stack_size; ++i) {
+		if (ctx->frame_stack[i].m != NULL) {
+			dulcet_term_free(ctx->frame_stack[i].m);
+		}
+		if (ctx->frame_stack[i].definition != NULL) {
+			dulcet_term_free(ctx->frame_stack[i].definition);
+		}
+	}
+	ctx->frame_stack_size = 0;
 
-	while (ctx->tks.pos < ctx->tks.tokenization->size) {
-		struct token tk = __dulcet_current_token(ctx);
+	__dulcet_pop_bindings(ctx, 0);
 
-		if (tk.kind == TOKEN_KIND_RPAREN) {
-			if (ctx->paren_depth == 0) {
-				if (m != NULL) {
-					dulcet_term_free(m);
-				}
+	return __dulcet_error(cause, tk);
+}
 
-				return __dulcet_error(DULCET_PARSE_ERROR_CAUSE_UNMATCHED_PAREN, tk);
-			} else {
-				break;
-			}
+// Abstracts `m` over the parameter bound by the frame `top`, if any
+static struct dulcet_term *__dulcet_abstract(const struct parsing_context *ctx,
+					     const struct parsing_frame *top, struct dulcet_term *m)
+{
+	struct dulcet_term *n = dulcet_alloc_abs(m);
+
+	struct dulcet_profile *profile = dulcet_get_profile();
+	if (profile) {
+		struct sorvete_sv parameter = { .data = NULL, .size = 0 };
+		if (ctx->parameter_stack_size > top->parameter_stack_size) {
+			parameter = ctx->parameter_stack[top->parameter_stack_size].name;
 		}
 
-		struct dulcet_term *n = NULL;
+		n->abs.origin = dulcet_profile_add(profile, parameter.data, parameter.size,
+						   top->opening.loc.line, top->opening.loc.column);
+	}
 
-		if (tk.kind == TOKEN_KIND_LPAREN) {
-			__dulcet_next_token(ctx);
+	return n;
+}
 
-			ctx->paren_depth += 1;
+// Closes every lambda and let whose body extends up to `tk`. Returns false if one of them has no
+// body, once parsing failed.
+static bool __dulcet_close_bodies(struct parsing_context *ctx, struct token tk,
+				  struct dulcet_parse_result *result)
+{
+	struct parsing_frame *top = __dulcet_top_frame(ctx);
 
-			struct dulcet_parse_result result = __dulcet_parse_classic(ctx);
-			if (result.kind == DULCET_PARSE_ERROR) {
-				if (m != NULL) {
-					dulcet_term_free(m);
-				}
+	while (top->kind == PARSING_FRAME_KIND_LAMBDA || top->kind == PARSING_FRAME_KIND_LET) {
+		if (top->m == NULL) {
+			*result = __dulcet_fail(ctx, DULCET_PARSE_ERROR_CAUSE_UNEXPECTED_TOKEN, tk);
+			return false;
+		}
 
-				return result;
-			}
+		struct dulcet_term *n = top->m;
 
-			ctx->paren_depth -= 1;
+		if (top->kind == PARSING_FRAME_KIND_LAMBDA) {
+			n = __dulcet_abstract(ctx, top, n);
+		} else if (top->definition) {
+			n = dulcet_alloc_app(__dulcet_abstract(ctx, top, n), top->definition);
+		}
 
-			n = result.value;
+		__dulcet_pop_bindings(ctx, top->parameter_stack_size);
+		ctx->frame_stack_size -= 1;
 
-			if (ctx->tks.pos >= ctx->tks.tokenization->size ||
-			    __dulcet_current_token(ctx).kind != TOKEN_KIND_RPAREN) {
-				if (m != NULL) {
-					dulcet_term_free(m);
-				}
+		top = __dulcet_top_frame(ctx);
+		__dulcet_frame_append(top, n);
+	}
 
-				if (n != NULL) {
-					dulcet_term_free(n);
-				}
+	return true;
+}
 
-				return __dulcet_error(DULCET_PARSE_ERROR_CAUSE_UNMATCHED_PAREN, tk);
-			}
+// Handles an `in`, or the end of a top-level definition, which first close every lambda and let
+// whose body extends up to them, and then the innermost definition, whose let starts. Its name
+// refers to the definition, shared if it is closed, in the body of the let. Returns false if
+// parsing failed, with the error stored in `result`.
+static bool __dulcet_close_definition(struct parsing_context *ctx, struct token tk, bool top_level,
+				      struct dulcet_parse_result *result)
+{
+	if (!__dulcet_close_bodies(ctx, tk, result)) {
+		return false;
+	}
 
-			__dulcet_next_token(ctx);
-		} else if (tk.kind == TOKEN_KIND_IDENT) {
-			__dulcet_next_token(ctx);
+	struct parsing_frame *top = __dulcet_top_frame(ctx);
 
-			long long index = __dulcet_parameter_to_de_bruijn_index(ctx, tk.text);
+	if (top->kind != PARSING_FRAME_KIND_DEFINITION || top->top_level != top_level ||
+	    top->m == NULL) {
+		*result = __dulcet_fail(ctx, DULCET_PARSE_ERROR_CAUSE_UNEXPECTED_TOKEN, tk);
+		return false;
+	}
 
-			if (index < 0) {
-				return __dulcet_error(DULCET_PARSE_ERROR_CAUSE_UNBOUND_VARIABLE,
-						      tk);
-			}
+	struct dulcet_term *definition = top->m;
+	struct token name = top->opening;
 
-			n = dulcet_alloc_var(index);
-		} else if (tk.kind == TOKEN_KIND_LAMBDA) {
-			tk = __dulcet_next_token(ctx);
-			if (tk.kind != TOKEN_KIND_IDENT) {
-				if (m != NULL) {
-					dulcet_term_free(m);
-				}
+	ctx->frame_stack_size -= 1;
+	ctx->top_level_definition = false;
 
-				return __dulcet_error(DULCET_PARSE_ERROR_CAUSE_UNEXPECTED_TOKEN,
-						      tk);
-			}
-			__dulcet_push_parameter(ctx, tk.text);
+	if (!__dulcet_push_frame(ctx, PARSING_FRAME_KIND_LET, name)) {
+		dulcet_term_free(definition);
+		*result = __dulcet_fail(ctx, DULCET_PARSE_ERROR_CAUSE_UNKNOWN, tk);
+		return false;
+	}
+	top = __dulcet_top_frame(ctx);
+	top->top_level = top_level;
+
+	if (dulcet_term_closed(definition)) {
+		struct dulcet_term *shared = dulcet_alloc_ref(definition);
+		if (!__dulcet_push_binding(ctx, name.text, shared)) {
+			dulcet_term_free(shared);
+			*result = __dulcet_fail(ctx, DULCET_PARSE_ERROR_CAUSE_UNKNOWN, tk);
+			return false;
+		}
+	} else {
+		top->definition = definition;
+		if (!__dulcet_push_parameter(ctx, name.text)) {
+			*result = __dulcet_fail(ctx, DULCET_PARSE_ERROR_CAUSE_UNKNOWN, tk);
+			return false;
+		}
+	}
 
-			tk = __dulcet_next_token(ctx);
-			if (tk.kind != TOKEN_KIND_DOT) {
-				if (m != NULL) {
-					dulcet_term_free(m);
-				}
+	return true;
+}
 
-				return __dulcet_error(DULCET_PARSE_ERROR_CAUSE_UNEXPECTED_TOKEN,
-						      tk);
-			}
-			__dulcet_next_token(ctx);
+// Handles a `)` or the end of input, which first close every lambda and let whose body extends up
+// to them, and then the innermost parenthesized subterm or the whole term, respectively. Returns
+// true once parsing is over, either successfully or not, with its outcome stored in `result`.
+static bool __dulcet_close_frames(struct parsing_context *ctx, struct token tk,
+				  struct dulcet_parse_result *result)
+{
+	if (!__dulcet_close_bodies(ctx, tk, result)) {
+		return true;
+	}
 
-			struct dulcet_parse_result result = __dulcet_parse_classic(ctx);
-			if (result.kind == DULCET_PARSE_ERROR) {
-				if (m != NULL) {
-					dulcet_term_free(m);
-				}
+	struct parsing_frame *top = __dulcet_top_frame(ctx);
 
-				return result;
-			}
-			__dulcet_pop_parameter(ctx);
+	if (top->kind == PARSING_FRAME_KIND_DEFINITION && tk.kind == TOKEN_KIND_EOF) {
+		*result = __dulcet_fail(ctx, DULCET_PARSE_ERROR_CAUSE_UNEXPECTED_TOKEN, tk);
+		return true;
+	}
 
-			n = dulcet_alloc_abs(result.value);
+	if (tk.kind == TOKEN_KIND_RPAREN) {
+		if (top->kind != PARSING_FRAME_KIND_PAREN) {
+			*result = __dulcet_fail(ctx, DULCET_PARSE_ERROR_CAUSE_UNMATCHED_PAREN, tk);
+			return true;
 		}
 
-		if (m == NULL) {
-			m = n;
-		} else if (n != NULL) {
-			m = dulcet_alloc_app(m, n);
-		}
+		struct dulcet_term *n = top->m;
+
+		ctx->frame_stack_size -= 1;
+
+		__dulcet_frame_append(__dulcet_top_frame(ctx), n);
+		__dulcet_next_token(ctx);
+
+		return false;
 	}
 
-	return (struct dulcet_parse_result) {
+	if (top->kind == PARSING_FRAME_KIND_PAREN) {
+		*result = __dulcet_fail(ctx, DULCET_PARSE_ERROR_CAUSE_UNMATCHED_PAREN, top->opening);
+		return true;
+	}
+
+	*result = (struct dulcet_parse_result) {
 		.kind = DULCET_PARSE_OK,
-		.value = m,
+		.value = top->m,
 	};
+	ctx->frame_stack_size = 0;
+
+	return true;
 }
 
-static struct dulcet_parse_result __dulcet_parse_de_bruijn(struct parsing_context *ctx)
+// Reads a decimal integer, with an optional minus sign, failing if it does not fit
+static bool __dulcet_parse_integer(struct sorvete_sv text, long long *value)
 {
-	struct dulcet_term *m = NULL;
+	size_t i = 0;
+	bool negative = text.size > 1 && text.data[0] == '-';
+	if (negative) {
+		i += 1;
+	}
 
-	while (ctx->tks.pos < ctx->tks.tokenization->size) {
-		struct token tk = __dulcet_current_token(ctx);
+	if (i == text.size) {
+		return false;
+	}
 
-		if (tk.kind == TOKEN_KIND_RPAREN) {
-			if (ctx->paren_depth == 0) {
-				if (m != NULL) {
-					dulcet_term_free(m);
-				}
+	// Accumulated negatively, as the smallest integer has no positive counterpart
+	long long n = 0;
+	for (; i < text.size; ++i) {
+		if (text.data[i] < '0' || text.data[i] > '9') {
+			return false;
+		}
 
-				return __dulcet_error(DULCET_PARSE_ERROR_CAUSE_UNMATCHED_PAREN, tk);
-			} else {
-				break;
-			}
+		int digit = text.data[i] - '0';
+		if (n < (LLONG_MIN + digit) / 10) {
+			return false;
 		}
+		n = n * 10 - digit;
+	}
 
-		struct dulcet_term *n = NULL;
+	if (!negative && n == LLONG_MIN) {
+		return false;
+	}
 
-		if (tk.kind == TOKEN_KIND_LPAREN) {
-			__dulcet_next_token(ctx);
+	*value = negative ? n : -n;
 
-			ctx->paren_depth += 1;
+	return true;
+}
 
-			struct dulcet_parse_result result = __dulcet_parse_de_bruijn(ctx);
-			if (result.kind == DULCET_PARSE_ERROR) {
-				if (m != NULL) {
-					dulcet_term_free(m);
-				}
+// Constants stand for the names that nothing else binds: the primitives, `true`, `false`, and
+// integers, which are marked with `#` in de Bruijn notation, where numbers are variables.
+// Returns NULL for any other name.
+static struct dulcet_term *__dulcet_constant(struct sorvete_sv text, bool de_bruijn)
+{
+	for (int op = 0; op < DULCET_PRIM_OP_COUNT; ++op) {
+		if (sorvete_sv_eq(text, sorvete_sv_from_cstr(dulcet_prim_name(op)))) {
+			return dulcet_alloc_prim(op);
+		}
+	}
+
+	if (sorvete_sv_eq(text, SORVETE_SV("true"))) {
+		return dulcet_alloc_bool(1);
+	} else if (sorvete_sv_eq(text, SORVETE_SV("false"))) {
+		return dulcet_alloc_bool(0);
+	}
+
+	if (de_bruijn) {
+		if (text.size == 0 || text.data[0] != '#') {
+			return NULL;
+		}
+		text = sorvete_sv_from_parts(text.data + 1, text.size - 1);
+	}
+
+	long long value;
+	if (!__dulcet_parse_integer(text, &value)) {
+		return NULL;
+	}
+
+	return dulcet_alloc_int(value);
+}
 
+static struct dulcet_parse_result __dulcet_parse_classic(struct parsing_context *ctx)
+{
+	struct dulcet_parse_result result;
+
+	if (!__dulcet_push_frame(ctx, PARSING_FRAME_KIND_ROOT, __dulcet_current_token(ctx))) {
+		return __dulcet_fail(ctx, DULCET_PARSE_ERROR_CAUSE_UNKNOWN,
+				     __dulcet_current_token(ctx));
+	}
+
+	for (;;) {
+		struct token tk = __dulcet_current_token(ctx);
+		struct parsing_frame *top = __dulcet_top_frame(ctx);
+
+		if (ctx->top_level_definition && tk.loc.column == 1 && tk.kind != TOKEN_KIND_EOF) {
+			if (!__dulcet_close_definition(ctx, tk, true, &result)) {
 				return result;
 			}
+			top = __dulcet_top_frame(ctx);
+		}
 
-			ctx->paren_depth -= 1;
+		bool at_top_level = top->m == NULL && (top->kind == PARSING_FRAME_KIND_ROOT ||
+						       (top->kind == PARSING_FRAME_KIND_LET &&
+							top->top_level));
 
-			n = result.value;
+		if (tk.kind == TOKEN_KIND_IDENT && at_top_level &&
+		    ctx->tks.pos + 1 < ctx->tks.tokenization->size &&
+		    ctx->tks.tokenization->buf[ctx->tks.pos + 1].kind == TOKEN_KIND_EQUALS) {
+			if (!__dulcet_push_frame(ctx, PARSING_FRAME_KIND_DEFINITION, tk)) {
+				return __dulcet_fail(ctx, DULCET_PARSE_ERROR_CAUSE_UNKNOWN, tk);
+			}
+			__dulcet_top_frame(ctx)->top_level = true;
+			ctx->top_level_definition = true;
 
-			if (ctx->tks.pos >= ctx->tks.tokenization->size ||
-			    __dulcet_current_token(ctx).kind != TOKEN_KIND_RPAREN) {
-				if (m != NULL) {
-					dulcet_term_free(m);
+			__dulcet_next_token(ctx);
+			__dulcet_next_token(ctx);
+		} else if (tk.kind == TOKEN_KIND_IDENT) {
+			unsigned int index = 0;
+			const struct binding *binding = __dulcet_find_binding(ctx, tk.text, &index);
+			struct dulcet_term *n;
+
+			if (binding && binding->shared) {
+				n = dulcet_term_copy(binding->shared);
+			} else if (binding) {
+				n = dulcet_alloc_var(index);
+			} else {
+				const struct dulcet_term *definition = NULL;
+				if (ctx->env) {
+					definition = ctx->env->lookup(ctx->env->data, tk.text.data,
+								      tk.text.size);
 				}
 
-				if (n != NULL) {
-					dulcet_term_free(n);
+				if (definition) {
+					n = dulcet_term_copy(definition);
+				} else if (!(n = __dulcet_constant(tk.text, false))) {
+					return __dulcet_fail(
+						ctx, DULCET_PARSE_ERROR_CAUSE_UNBOUND_VARIABLE, tk);
 				}
-
-				return __dulcet_error(DULCET_PARSE_ERROR_CAUSE_UNMATCHED_PAREN, tk);
 			}
 
+			__dulcet_frame_append(__dulcet_top_frame(ctx), n);
 			__dulcet_next_token(ctx);
 		} else if (tk.kind == TOKEN_KIND_INT) {
+			struct dulcet_term *n = __dulcet_constant(tk.text, false);
+			if (!n) {
+				return __dulcet_fail(ctx, DULCET_PARSE_ERROR_CAUSE_UNEXPECTED_TOKEN,
+						     tk);
+			}
+
+			__dulcet_frame_append(__dulcet_top_frame(ctx), n);
 			__dulcet_next_token(ctx);
+		} else if (tk.kind == TOKEN_KIND_EQUALS) {
+			// Where a term is expected, rather than after the name of a definition, `=`
+			// is the primitive
+			__dulcet_frame_append(__dulcet_top_frame(ctx),
+					      dulcet_alloc_prim(DULCET_PRIM_OP_EQ));
+			__dulcet_next_token(ctx);
+		} else if (tk.kind == TOKEN_KIND_LPAREN) {
+			if (!__dulcet_push_frame(ctx, PARSING_FRAME_KIND_PAREN, tk)) {
+				return __dulcet_fail(ctx, DULCET_PARSE_ERROR_CAUSE_UNKNOWN, tk);
+			}
+			__dulcet_next_token(ctx);
+		} else if (tk.kind == TOKEN_KIND_LAMBDA) {
+			struct token lambda = tk;
 
-			unsigned int value = 0;
-			for (size_t i = 0; i < tk.text.size; ++i) {
-				value *= 10;
-				value += tk.text.data[i] - '0';
+			tk = __dulcet_next_token(ctx);
+			if (tk.kind != TOKEN_KIND_IDENT) {
+				return __dulcet_fail(ctx, DULCET_PARSE_ERROR_CAUSE_UNEXPECTED_TOKEN,
+						     tk);
 			}
+			struct sorvete_sv parameter = tk.text;
 
-			n = dulcet_alloc_var(value);
-		} else if (tk.kind == TOKEN_KIND_LAMBDA) {
+			tk = __dulcet_next_token(ctx);
+			if (tk.kind != TOKEN_KIND_DOT) {
+				return __dulcet_fail(ctx, DULCET_PARSE_ERROR_CAUSE_UNEXPECTED_TOKEN,
+						     tk);
+			}
 			__dulcet_next_token(ctx);
 
-			struct dulcet_parse_result result = __dulcet_parse_de_bruijn(ctx);
-			if (result.kind == DULCET_PARSE_ERROR) {
-				if (m != NULL) {
-					dulcet_term_free(m);
-				}
-
-				return result;
+			if (!__dulcet_push_frame(ctx, PARSING_FRAME_KIND_LAMBDA, lambda) ||
+			    !__dulcet_push_parameter(ctx, parameter)) {
+				return __dulcet_fail(ctx, DULCET_PARSE_ERROR_CAUSE_UNKNOWN, lambda);
+			}
+		} else if (tk.kind == TOKEN_KIND_LET) {
+			struct token name = __dulcet_next_token(ctx);
+			if (name.kind != TOKEN_KIND_IDENT) {
+				return __dulcet_fail(ctx, DULCET_PARSE_ERROR_CAUSE_UNEXPECTED_TOKEN,
+						     name);
 			}
 
-			n = dulcet_alloc_abs(result.value);
-		}
+			tk = __dulcet_next_token(ctx);
+			if (tk.kind != TOKEN_KIND_EQUALS) {
+				return __dulcet_fail(ctx, DULCET_PARSE_ERROR_CAUSE_UNEXPECTED_TOKEN,
+						     tk);
+			}
+			__dulcet_next_token(ctx);
 
-		if (m == NULL) {
-			m = n;
-		} else if (n != NULL) {
-			m = dulcet_alloc_app(m, n);
+			if (!__dulcet_push_frame(ctx, PARSING_FRAME_KIND_DEFINITION, name)) {
+				return __dulcet_fail(ctx, DULCET_PARSE_ERROR_CAUSE_UNKNOWN, name);
+			}
+		} else if (tk.kind == TOKEN_KIND_IN) {
+			if (!__dulcet_close_definition(ctx, tk, false, &result)) {
+				return result;
+			}
+			__dulcet_next_token(ctx);
+		} else if (tk.kind == TOKEN_KIND_RPAREN || tk.kind == TOKEN_KIND_EOF) {
+			if (__dulcet_close_frames(ctx, tk, &result)) {
+				return result;
+			}
+		} else {
+			return __dulcet_fail(ctx, DULCET_PARSE_ERROR_CAUSE_UNEXPECTED_TOKEN, tk);
 		}
 	}
-
-	return (struct dulcet_parse_result) {
-		.kind = DULCET_PARSE_OK,
-		.value = m,
-	};
 }
 
-struct dulcet_parse_result dulcet_parse_classic(const char *input, unsigned int input_len)
+static struct dulcet_parse_result __dulcet_parse_de_bruijn(struct parsing_context *ctx)
 {
-	struct tokenization *tokenization = malloc(
-		sizeof(struct tokenization) + TOKENIZATION_BUFFER_MAX_SIZE * sizeof(struct token));
-	tokenization->size = 0;
+	struct dulcet_parse_result result;
 
-	struct sorvete_sv input_sv = sorvete_sv_from_parts(input, input_len);
-
-	int rc = __dulcet_tokenize(tokenization, input_sv);
-	if (rc != 0) {
-		return (struct dulcet_parse_result) {
-			.kind = DULCET_PARSE_ERROR,
-			.error = {
-                                .cause = DULCET_PARSE_ERROR_CAUSE_UNKNOWN,
-                                .line = 1,
-                                .column = 1,
-                        },
-		};
+	if (!__dulcet_push_frame(ctx, PARSING_FRAME_KIND_ROOT, __dulcet_current_token(ctx))) {
+		return __dulcet_fail(ctx, DULCET_PARSE_ERROR_CAUSE_UNKNOWN,
+				     __dulcet_current_token(ctx));
 	}
 
-	struct parsing_context ctx = {
-                .tks = {
-		        .tokenization = tokenization,
-		        .pos = 0,
-	        },
-                .paren_depth = 0,
-                .parameter_stack_size = 0,
-        };
+	for (;;) {
+		struct token tk = __dulcet_current_token(ctx);
 
-	struct dulcet_parse_result result = __dulcet_parse_classic(&ctx);
+		if (tk.kind == TOKEN_KIND_INT) {
+			unsigned int value = 0;
+			for (size_t i = 0; i < tk.text.size; ++i) {
+				value *= 10;
+				value += tk.text.data[i] - '0';
+			}
 
-	free(tokenization);
+			__dulcet_frame_append(__dulcet_top_frame(ctx), dulcet_alloc_var(value));
+			__dulcet_next_token(ctx);
+		} else if (tk.kind == TOKEN_KIND_IDENT || tk.kind == TOKEN_KIND_EQUALS) {
+			struct dulcet_term *n = __dulcet_constant(tk.text, true);
+			if (!n) {
+				return __dulcet_fail(ctx, DULCET_PARSE_ERROR_CAUSE_UNEXPECTED_TOKEN,
+						     tk);
+			}
 
-	return result;
+			__dulcet_frame_append(__dulcet_top_frame(ctx), n);
+			__dulcet_next_token(ctx);
+		} else if (tk.kind == TOKEN_KIND_LPAREN) {
+			if (!__dulcet_push_frame(ctx, PARSING_FRAME_KIND_PAREN, tk)) {
+				return __dulcet_fail(ctx, DULCET_PARSE_ERROR_CAUSE_UNKNOWN, tk);
+			}
+			__dulcet_next_token(ctx);
+		} else if (tk.kind == TOKEN_KIND_LAMBDA) {
+			if (!__dulcet_push_frame(ctx, PARSING_FRAME_KIND_LAMBDA, tk)) {
+				return __dulcet_fail(ctx, DULCET_PARSE_ERROR_CAUSE_UNKNOWN, tk);
+			}
+			__dulcet_next_token(ctx);
+		} else if (tk.kind == TOKEN_KIND_RPAREN || tk.kind == TOKEN_KIND_EOF) {
+			if (__dulcet_close_frames(ctx, tk, &result)) {
+				return result;
+			}
+		} else {
+			return __dulcet_fail(ctx, DULCET_PARSE_ERROR_CAUSE_UNEXPECTED_TOKEN, tk);
+		}
+	}
 }
 
-struct dulcet_parse_result dulcet_parse_de_bruijn(const char *input, unsigned int input_len)
+static struct dulcet_parse_result
+__dulcet_parse(const char *input, unsigned int input_len, const struct dulcet_parse_env *env,
+	       struct dulcet_parse_result (*parse)(struct parsing_context *))
 {
-	struct tokenization *tokenization = malloc(
-		sizeof(struct tokenization) + TOKENIZATION_BUFFER_MAX_SIZE * sizeof(struct token));
-	tokenization->size = 0;
+	unsigned long long start = dulcet_stats_time();
+
+	struct tokenization tokenization = {
+		.size = 0,
+		.capacity = 0,
+		.buf = NULL,
+		.out_of_memory = false,
+	};
 
 	struct sorvete_sv input_sv = sorvete_sv_from_parts(input, input_len);
 
-	int rc = __dulcet_tokenize(tokenization, input_sv);
+	int rc = __dulcet_tokenize(&tokenization, input_sv);
 	if (rc != 0) {
-		if (tokenization->size > 0) {
-			struct token last_tk = tokenization->buf[tokenization->size - 1];
+		struct dulcet_parse_result result;
+
+		if (tokenization.size > 0) {
+			struct token last_tk = tokenization.buf[tokenization.size - 1];
 
-			return __dulcet_error(DULCET_PARSE_ERROR_CAUSE_UNKNOWN, last_tk);
+			result = __dulcet_error(DULCET_PARSE_ERROR_CAUSE_UNKNOWN, last_tk);
 		} else {
 			// FIXME: indicate in some way that there is not valid position
-			return (struct dulcet_parse_result) {
+			result = (struct dulcet_parse_result) {
                                 .kind = DULCET_PARSE_ERROR,
                                 .error = {
                                         .cause = DULCET_PARSE_ERROR_CAUSE_UNKNOWN,
@@ -546,20 +914,83 @@ struct dulcet_parse_result dulcet_parse_de_bruijn(const char *input, unsigned in
                                 },
                         };
 		}
+
+		free(tokenization.buf);
+
+		dulcet_stats_add_time(DULCET_PHASE_PARSE, dulcet_stats_time() - start);
+
+		return result;
 	}
 
 	struct parsing_context ctx = {
                 .tks = {
-		        .tokenization = tokenization,
+		        .tokenization = &tokenization,
 		        .pos = 0,
 	        },
-                .paren_depth = 0,
+                .frame_stack = NULL,
+                .frame_stack_size = 0,
+                .frame_stack_capacity = 0,
+                .parameter_stack = NULL,
                 .parameter_stack_size = 0,
+                .parameter_stack_capacity = 0,
+                .env = env,
+                .top_level_definition = false,
         };
 
-	struct dulcet_parse_result result = __dulcet_parse_de_bruijn(&ctx);
+	struct dulcet_parse_result result = parse(&ctx);
+
+	free(ctx.parameter_stack);
+	free(ctx.frame_stack);
+	free(tokenization.buf);
+
+	dulcet_stats_add_time(DULCET_PHASE_PARSE, dulcet_stats_time() - start);
+
+	return result;
+}
+
+struct dulcet_parse_result dulcet_parse_classic(const char *input, unsigned int input_len)
+{
+	return __dulcet_parse(input, input_len, NULL, __dulcet_parse_classic);
+}
+
+struct dulcet_parse_result dulcet_parse_classic_env(const char *input, unsigned int input_len,
+						    const struct dulcet_parse_env *env)
+{
+	return __dulcet_parse(input, input_len, env, __dulcet_parse_classic);
+}
+
+struct dulcet_parse_result dulcet_parse_de_bruijn(const char *input, unsigned int input_len)
+{
+	return __dulcet_parse(input, input_len, NULL, __dulcet_parse_de_bruijn);
+}
+
+struct dulcet_parse_result dulcet_ctx_parse_classic(struct dulcet_ctx *ctx, const char *input,
+						    unsigned int input_len)
+{
+	dulcet_ctx_enter(ctx);
+	struct dulcet_parse_result result = dulcet_parse_classic(input, input_len);
+	dulcet_ctx_leave(ctx);
+
+	return result;
+}
+
+struct dulcet_parse_result dulcet_ctx_parse_classic_env(struct dulcet_ctx *ctx, const char *input,
+							unsigned int input_len,
+							const struct dulcet_parse_env *env)
+{
+	dulcet_ctx_enter(ctx);
+	struct dulcet_parse_result result = dulcet_parse_classic_env(input, input_len, env);
+	dulcet_ctx_leave(ctx);
 
-	free(tokenization);
+	return result;
+}
+
+struct dulcet_parse_result dulcet_ctx_parse_de_bruijn(struct dulcet_ctx *ctx, const char *input,
+						      unsigned int input_len)
+{
+	dulcet_ctx_enter(ctx);
+	struct dulcet_parse_result result = dulcet_parse_de_bruijn(input, input_len);
+	dulcet_ctx_leave(ctx);
 
 	return result;
 }
@@ -36,8 +36,28 @@ struct dulcet_parse_result {
 	};
 };
 
+// Resolves identifiers that no enclosing lambda binds, such as the names of definitions, to closed
+// terms, of which the parser places a copy wherever they occur. Lookups return NULL for unknown
+// names, which are then reported as unbound variables.
+struct dulcet_parse_env {
+	const struct dulcet_term *(*lookup)(void *data, const char *name, unsigned int name_len);
+	void *data;
+};
+
 struct dulcet_parse_result dulcet_parse_classic(const char *input, unsigned int input_len);
 
+struct dulcet_parse_result dulcet_parse_classic_env(const char *input, unsigned int input_len,
+						    const struct dulcet_parse_env *env);
+
 struct dulcet_parse_result dulcet_parse_de_bruijn(const char *input, unsigned int input_len);
 
+// The same, with the terms allocated in `ctx`.
+struct dulcet_parse_result dulcet_ctx_parse_classic(struct dulcet_ctx *ctx, const char *input,
+						    unsigned int input_len);
+struct dulcet_parse_result dulcet_ctx_parse_classic_env(struct dulcet_ctx *ctx, const char *input,
+							unsigned int input_len,
+							const struct dulcet_parse_env *env);
+struct dulcet_parse_result dulcet_ctx_parse_de_bruijn(struct dulcet_ctx *ctx, const char *input,
+						      unsigned int input_len);
+
 #endif // _DULCET_PARSER_H
@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2022 Leonardo Duarte
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#define _DEFAULT_SOURCE
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#endif
+
+#include "dulcet_perf.h"
+
+const char *const dulcet_perf_counter_names[DULCET_PERF_COUNTER_COUNT] = {
+	[DULCET_PERF_CYCLES] = "cycles",
+	[DULCET_PERF_INSTRUCTIONS] = "instructions",
+	[DULCET_PERF_L1D_MISSES] = "l1d_misses",
+	[DULCET_PERF_LLC_MISSES] = "llc_misses",
+	[DULCET_PERF_BRANCH_MISSES] = "branch_misses",
+	[DULCET_PERF_PAGE_FAULTS] = "page_faults",
+};
+
+#ifdef __linux__
+static const struct {
+	uint32_t type;
+	uint64_t config;
+} events[DULCET_PERF_COUNTER_COUNT] = {
+	[DULCET_PERF_CYCLES] = { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+	[DULCET_PERF_INSTRUCTIONS] = { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+	[DULCET_PERF_L1D_MISSES] = { PERF_TYPE_HW_CACHE,
+				     PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+					     (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+	[DULCET_PERF_LLC_MISSES] = { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+	[DULCET_PERF_BRANCH_MISSES] = { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+	[DULCET_PERF_PAGE_FAULTS] = { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS },
+};
+
+int dulcet_perf_open(struct dulcet_perf *perf)
+{
+	int available = 0;
+	int error = 0;
+
+	for (int i = 0; i < DULCET_PERF_COUNTER_COUNT; ++i) {
+		struct perf_event_attr attr;
+		memset(&attr, 0, sizeof(attr));
+
+		attr.size = sizeof(attr);
+		attr.type = events[i].type;
+		attr.config = events[i].config;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+		// Each counter is on its own rather than in a group, so that one that is missing
+		// does not take the others with it
+		perf->fds[i] = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+		if (perf->fds[i] < 0) {
+			error = errno;
+		} else {
+			available += 1;
+		}
+	}
+
+	if (available == 0) {
+		errno = error;
+		return -1;
+	}
+
+	return available;
+}
+
+void dulcet_perf_read(const struct dulcet_perf *perf, struct dulcet_perf_sample *sample)
+{
+	for (int i = 0; i < DULCET_PERF_COUNTER_COUNT; ++i) {
+		uint64_t values[3] = { 0, 0, 0 };
+
+		if (perf->fds[i] < 0 || read(perf->fds[i], values, sizeof(values)) != sizeof(values)) {
+			sample->values[i] = 0;
+			continue;
+		}
+
+		// values[1] and values[2] are the times the counter was enabled and running
+		if (values[2] > 0 && values[2] < values[1]) {
+			values[0] = (double) values[0] * values[1] / values[2];
+		}
+
+		sample->values[i] = values[0];
+	}
+}
+#else
+int dulcet_perf_open(struct dulcet_perf *perf)
+{
+	for (int i = 0; i < DULCET_PERF_COUNTER_COUNT; ++i) {
+		perf->fds[i] = -1;
+	}
+
+	errno = ENOSYS;
+	return -1;
+}
+
+void dulcet_perf_read(const struct dulcet_perf *perf, struct dulcet_perf_sample *sample)
+{
+	(void) perf;
+
+	memset(sample, 0, sizeof(*sample));
+}
+#endif
+
+void dulcet_perf_close(struct dulcet_perf *perf)
+{
+	for (int i = 0; i < DULCET_PERF_COUNTER_COUNT; ++i) {
+		if (perf->fds[i] >= 0) {
+			close(perf->fds[i]);
+			perf->fds[i] = -1;
+		}
+	}
+}
+
+int dulcet_perf_available(const struct dulcet_perf *perf, enum dulcet_perf_counter counter)
+{
+	return perf->fds[counter] >= 0;
+}
+
+void dulcet_perf_diff(const struct dulcet_perf_sample *start, const struct dulcet_perf_sample *end,
+		      struct dulcet_perf_sample *delta)
+{
+	for (int i = 0; i < DULCET_PERF_COUNTER_COUNT; ++i) {
+		delta->values[i] = end->values[i] - start->values[i];
+	}
+}
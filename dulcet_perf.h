@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2022 Leonardo Duarte
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef _DULCET_PERF_H
+#define _DULCET_PERF_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+ * Hardware performance counters of the calling thread, read through Linux `perf_event_open`, for
+ * the benchmark tooling to attribute cache and branch behaviour to the phases and reducers that
+ * it runs. Counters that the machine or its `perf_event_paranoid` setting does not allow, such as
+ * the hardware ones inside most virtual machines, are simply left out, and on other systems none
+ * are available.
+ */
+
+enum dulcet_perf_counter {
+	DULCET_PERF_CYCLES,
+	DULCET_PERF_INSTRUCTIONS,
+	DULCET_PERF_L1D_MISSES,
+	DULCET_PERF_LLC_MISSES,
+	DULCET_PERF_BRANCH_MISSES,
+	DULCET_PERF_PAGE_FAULTS,
+	DULCET_PERF_COUNTER_COUNT,
+};
+
+extern const char *const dulcet_perf_counter_names[DULCET_PERF_COUNTER_COUNT];
+
+struct dulcet_perf {
+	int fds[DULCET_PERF_COUNTER_COUNT];
+};
+
+// Counts since the counters were opened, scaled up for the time they were multiplexed out
+struct dulcet_perf_sample {
+	uint64_t values[DULCET_PERF_COUNTER_COUNT];
+};
+
+// Open and start every available counter, returning how many there are, or -1 with `errno` set
+// if there are none.
+int dulcet_perf_open(struct dulcet_perf *perf);
+void dulcet_perf_close(struct dulcet_perf *perf);
+
+int dulcet_perf_available(const struct dulcet_perf *perf, enum dulcet_perf_counter counter);
+
+void dulcet_perf_read(const struct dulcet_perf *perf, struct dulcet_perf_sample *sample);
+
+// Store in `delta` the counts between samples `start` and `end`.
+void dulcet_perf_diff(const struct dulcet_perf_sample *start, const struct dulcet_perf_sample *end,
+		      struct dulcet_perf_sample *delta);
+
+#endif // _DULCET_PERF_H
@@ -0,0 +1,270 @@
+/*
+ * Copyright (c) 2022 Leonardo Duarte
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "dulcet_session.h"
+
+#include "dulcet.h"
+#include "dulcet_parser.h"
+#include "sorvete.h"
+
+void dulcet_session_init(struct dulcet_session *session)
+{
+	*session = (struct dulcet_session) {
+		.definitions = NULL,
+		.definitions_size = 0,
+		.definitions_capacity = 0,
+	};
+}
+
+void dulcet_session_deinit(struct dulcet_session *session)
+{
+	for (size_t i = 0; i < session->definitions_size; ++i) {
+		free(session->definitions[i].name);
+		dulcet_term_free(session->definitions[i].value);
+	}
+
+	free(session->definitions);
+
+	dulcet_session_init(session);
+}
+
+static struct dulcet_definition *__dulcet_session_find(const struct dulcet_session *session,
+						       struct sorvete_sv name)
+{
+	for (size_t i = 0; i < session->definitions_size; ++i) {
+		struct dulcet_definition *definition = &session->definitions[i];
+
+		if (sorvete_sv_eq(sorvete_sv_from_parts(definition->name, definition->name_len),
+				  name)) {
+			return definition;
+		}
+	}
+
+	return NULL;
+}
+
+const struct dulcet_term *dulcet_session_lookup(const struct dulcet_session *session,
+						const char *name, unsigned int name_len)
+{
+	struct dulcet_definition *definition =
+		__dulcet_session_find(session, sorvete_sv_from_parts(name, name_len));
+
+	return definition ? definition->value : NULL;
+}
+
+static const struct dulcet_term *__dulcet_session_env_lookup(void *data, const char *name,
+							     unsigned int name_len)
+{
+	return dulcet_session_lookup(data, name, name_len);
+}
+
+struct dulcet_parse_result dulcet_session_parse(const struct dulcet_session *session,
+						const char *input, unsigned int input_len)
+{
+	struct dulcet_parse_env env = {
+		.lookup = __dulcet_session_env_lookup,
+		.data = (void *) session,
+	};
+
+	return dulcet_parse_classic_env(input, input_len, &env);
+}
+
+// Defines `name` as `value`, which the session then owns, in place of any earlier definition.
+// Returns NULL if there is no memory for a new definition, which `value` is then freed instead of.
+static struct dulcet_term *__dulcet_session_put(struct dulcet_session *session, const char *name,
+						unsigned int name_len, struct dulcet_term *value)
+{
+	struct dulcet_definition *definition =
+		__dulcet_session_find(session, sorvete_sv_from_parts(name, name_len));
+
+	if (definition) {
+		dulcet_term_free(definition->value);
+	} else {
+		if (session->definitions_size == session->definitions_capacity) {
+			size_t capacity = session->definitions_capacity
+						  ? 2 * session->definitions_capacity
+						  : 16;
+			struct dulcet_definition *definitions = realloc(
+				session->definitions, capacity * sizeof(struct dulcet_definition));
+			if (!definitions) {
+				dulcet_term_free(value);
+				return NULL;
+			}
+
+			session->definitions = definitions;
+			session->definitions_capacity = capacity;
+		}
+
+		// Allocated with at least a byte, so that an empty name is not taken for a failure
+		char *copy = malloc(name_len + 1);
+		if (!copy) {
+			dulcet_term_free(value);
+			return NULL;
+		}
+		memcpy(copy, name, name_len);
+
+		definition = &session->definitions[session->definitions_size];
+		session->definitions_size += 1;
+
+		definition->name = copy;
+		definition->name_len = name_len;
+	}
+
+	definition->value = value;
+
+	return value;
+}
+
+struct dulcet_parse_result dulcet_session_define(struct dulcet_session *session, const char *name,
+						 unsigned int name_len, const char *input,
+						 unsigned int input_len, int normalize)
+{
+	struct dulcet_parse_result result = dulcet_session_parse(session, input, input_len);
+	if (result.kind == DULCET_PARSE_ERROR || result.value == NULL) {
+		return result;
+	}
+
+	if (normalize) {
+		dulcet_beta_nor(result.value);
+	}
+
+	// Definitions are closed, so that every later occurrence can share them
+	result.value =
+		__dulcet_session_put(session, name, name_len, dulcet_alloc_ref(result.value));
+
+	if (!result.value) {
+		// Out of memory, which has no cause of its own
+		result = (struct dulcet_parse_result) {
+			.kind = DULCET_PARSE_ERROR,
+			.error = {
+				.cause = DULCET_PARSE_ERROR_CAUSE_UNKNOWN,
+				.text_start = input,
+				.text_len = 0,
+				.line = 1,
+				.column = 1,
+			},
+		};
+	}
+
+	return result;
+}
+
+int dulcet_session_define_image(struct dulcet_session *session,
+				const struct dulcet_loaded_image *loaded)
+{
+	for (size_t i = 0; i < loaded->image->definitions_size; ++i) {
+		const char *name = loaded->image->definitions[i].name;
+		if (name && !__dulcet_session_put(session, name, strlen(name),
+						  dulcet_term_copy(loaded->terms[i]))) {
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+static int __dulcet_is_space(char c)
+{
+	return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+// Identifiers are delimited the same way the tokenizer does
+static int __dulcet_is_ident(char c)
+{
+	return !__dulcet_is_space(c) && c != '\0' && c != '(' && c != ')' && c != '\\' &&
+	       c != '.' && c != ';';
+}
+
+struct dulcet_parse_result dulcet_session_exec(struct dulcet_session *session, const char *input,
+					       unsigned int input_len)
+{
+	unsigned int pos = 0;
+
+	while (pos < input_len && __dulcet_is_space(input[pos])) {
+		pos += 1;
+	}
+
+	unsigned int name_start = pos;
+	while (pos < input_len && __dulcet_is_ident(input[pos])) {
+		pos += 1;
+	}
+	unsigned int name_len = pos - name_start;
+
+	while (pos < input_len && __dulcet_is_space(input[pos])) {
+		pos += 1;
+	}
+
+	int is_definition = 0;
+	int normalize = 1;
+
+	if (pos + 1 < input_len && input[pos] == ':' && input[pos + 1] == '=') {
+		is_definition = 1;
+		normalize = 0;
+		pos += 2;
+	} else if (pos < input_len && input[pos] == '=') {
+		is_definition = 1;
+		pos += 1;
+	}
+
+	// Just like any other identifier, the `=` must be followed by a delimiter
+	if (name_len > 0 && is_definition && (pos == input_len || !__dulcet_is_ident(input[pos]))) {
+		// Locations within the term are relative to the whole statement
+		unsigned int line_offset = 0;
+		unsigned int column_offset = 0;
+
+		for (unsigned int i = 0; i < pos; ++i) {
+			if (input[i] == '\n') {
+				line_offset += 1;
+				column_offset = 0;
+			} else {
+				column_offset += 1;
+			}
+		}
+
+		struct dulcet_profile *profile = dulcet_get_profile();
+		struct dulcet_profile saved_profile;
+		if (profile) {
+			saved_profile = *profile;
+
+			if (line_offset == 0) {
+				profile->column_offset += column_offset;
+			} else {
+				profile->column_offset = column_offset;
+			}
+			profile->line_offset += line_offset;
+		}
+
+		struct dulcet_parse_result result =
+			dulcet_session_define(session, input + name_start, name_len, input + pos,
+					      input_len - pos, normalize);
+
+		if (profile) {
+			profile->line_offset = saved_profile.line_offset;
+			profile->column_offset = saved_profile.column_offset;
+		}
+
+		if (result.kind == DULCET_PARSE_OK) {
+			result.value = NULL;
+		} else {
+			if (result.error.line == 1) {
+				result.error.column += column_offset;
+			}
+			result.error.line += line_offset;
+		}
+
+		return result;
+	}
+
+	struct dulcet_parse_result result = dulcet_session_parse(session, input, input_len);
+	if (result.kind == DULCET_PARSE_OK && result.value != NULL) {
+		dulcet_beta_nor(result.value);
+	}
+
+	return result;
+}
@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2022 Leonardo Duarte
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef _DULCET_SESSION_H
+#define _DULCET_SESSION_H
+
+#include <stddef.h>
+
+#include "dulcet.h"
+#include "dulcet_parser.h"
+
+struct dulcet_definition {
+	char *name;
+	unsigned int name_len;
+
+	// Closed term, already reduced when the definition was made
+	struct dulcet_term *value;
+};
+
+// Named definitions, which are parsed and reduced once, and then copied in memory into every
+// later term that refers to them by name.
+struct dulcet_session {
+	struct dulcet_definition *definitions;
+	size_t definitions_size;
+	size_t definitions_capacity;
+};
+
+void dulcet_session_init(struct dulcet_session *session);
+void dulcet_session_deinit(struct dulcet_session *session);
+
+const struct dulcet_term *dulcet_session_lookup(const struct dulcet_session *session,
+						const char *name, unsigned int name_len);
+
+// Parses `input` in classic notation against the definitions made so far and, if `normalize` is
+// set, reduces it with the normal order strategy, before defining `name` as the result. Fails with
+// DULCET_PARSE_ERROR_CAUSE_UNKNOWN if there is no memory for the definition.
+struct dulcet_parse_result dulcet_session_define(struct dulcet_session *session, const char *name,
+						 unsigned int name_len, const char *input,
+						 unsigned int input_len, int normalize);
+
+// Defines every named definition of `loaded`, which has to outlive the session, as its term.
+// Returns -1 if there is no memory for them all, leaving those defined before.
+int dulcet_session_define_image(struct dulcet_session *session,
+				const struct dulcet_loaded_image *loaded);
+
+// Parses `input` in classic notation against the definitions made so far.
+struct dulcet_parse_result dulcet_session_parse(const struct dulcet_session *session,
+						const char *input, unsigned int input_len);
+
+// Runs a single statement, which is either a definition, `name = term` or `name := term` for
+// definitions which are not to be reduced beforehand (such as those without a normal form), or a
+// term to be reduced with the normal order strategy. Definitions result in a NULL value, while
+// terms result in their normal form, which is then owned by the caller.
+struct dulcet_parse_result dulcet_session_exec(struct dulcet_session *session, const char *input,
+					       unsigned int input_len);
+
+#endif // _DULCET_SESSION_H
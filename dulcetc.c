@@ -0,0 +1,483 @@
+/*
+ * Copyright (c) 2022 Leonardo Duarte
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <ctype.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dulcet.h"
+
+#include "dulcet_parser.h"
+#include "dulcet_session.h"
+
+static void print_usage(const char *program_name)
+{
+	printf("dulcetc: a compiler of untyped lambda calculus programs into C data\n");
+	printf("\n");
+	printf("Usage: %s [options]\n", program_name);
+	printf("Options:\n");
+	printf("  -h, --help           \tDisplay this information.\n");
+	printf("  -f <input_file_path> \tCompile the program in the given file, which may be `-` for stdin.\n");
+	printf("                       \tBy default, the program is read from stdin, unless `-p` is given.\n");
+	printf("  -o <output_file_path>\tWrite the C source to the given file, creating it if doesn't exist and\n");
+	printf("                       \toverriding its contents. By default, it is written to stdout.\n");
+	printf("  -p <prelude_file_path>\tCompile the definitions, one per line as in `dulceti --repl`, from the\n");
+	printf("                       \tgiven file, which the program may then refer to by name.\n");
+	printf("  -n <name>            \tName the `struct dulcet_image` in the C source. By default, it is named\n");
+	printf("                       \tafter the input file.\n");
+	printf("  --notation <notation>\tRead the program in `classic` (default) or `de-bruijn` notation.\n");
+	printf("\n");
+	printf("The C source defines a `const struct dulcet_image`, see `dulcet.h`, of the definitions of the\n");
+	printf("prelude followed by the term of the program, if any, to be built with `dulcet_image_load`.\n");
+}
+
+static void print_parse_error(const char *input_file_path, struct dulcet_parse_error error,
+			      unsigned int line_offset)
+{
+	if (input_file_path) {
+		fprintf(stderr, "%s:", input_file_path);
+	}
+	fprintf(stderr, "%u:%u: fatal error: ", error.line + line_offset, error.column);
+
+	switch (error.cause) {
+	case DULCET_PARSE_ERROR_CAUSE_UNKNOWN:
+		fprintf(stderr, "unexpected error\n");
+		break;
+	case DULCET_PARSE_ERROR_CAUSE_UNMATCHED_PAREN:
+		fprintf(stderr, "unmatched `%.*s`\n", error.text_len, error.text_start);
+		break;
+	case DULCET_PARSE_ERROR_CAUSE_UNEXPECTED_TOKEN:
+		if (error.text_len == 0) {
+			fprintf(stderr, "unexpected end of input\n");
+		} else {
+			fprintf(stderr, "unexpected `%.*s`\n", error.text_len, error.text_start);
+		}
+		break;
+	case DULCET_PARSE_ERROR_CAUSE_UNBOUND_VARIABLE:
+		fprintf(stderr, "unbound variable `%.*s`\n", error.text_len, error.text_start);
+		break;
+	}
+}
+
+// Run the prelude one line at a time, as `dulceti -p` does, dropping the normal forms of its terms
+static int run_prelude(struct dulcet_session *session, const char *prelude_file_path, FILE *fp)
+{
+	char *line = NULL;
+	size_t line_capacity = 0;
+	unsigned int line_number = 0;
+	int failed = 0;
+
+	for (;;) {
+		ssize_t line_len = getline(&line, &line_capacity, fp);
+		if (line_len < 0) {
+			break;
+		}
+		line_number += 1;
+
+		struct dulcet_parse_result result = dulcet_session_exec(session, line, line_len);
+
+		if (result.kind == DULCET_PARSE_ERROR) {
+			print_parse_error(prelude_file_path, result.error, line_number - 1);
+			failed = 1;
+		} else if (result.value) {
+			dulcet_term_free(result.value);
+		}
+	}
+
+	free(line);
+
+	return failed;
+}
+
+// Names the image after the base name of `path`, without its extension, as a C identifier.
+// Returns NULL if there is no memory for the name.
+static char *image_name_from_path(const char *path)
+{
+	const char *base = strrchr(path, '/');
+	base = base ? base + 1 : path;
+
+	size_t len = strcspn(base, ".");
+	char *name = malloc(len + 2);
+	if (!name) {
+		return NULL;
+	}
+
+	size_t name_len = 0;
+
+	if (len == 0 || isdigit((unsigned char) base[0])) {
+		name[name_len++] = '_';
+	}
+	for (size_t i = 0; i < len; ++i) {
+		name[name_len++] = isalnum((unsigned char) base[i]) ? base[i] : '_';
+	}
+	name[name_len] = '\0';
+
+	return name;
+}
+
+static int is_identifier(const char *s)
+{
+	if (!isalpha((unsigned char) s[0]) && s[0] != '_') {
+		return 0;
+	}
+	for (; *s; ++s) {
+		if (!isalnum((unsigned char) *s) && *s != '_') {
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+static void write_string(FILE *fp, const char *s)
+{
+	fputc('"', fp);
+	for (; *s; ++s) {
+		if (*s == '"' || *s == '\\') {
+			fprintf(fp, "\\%c", *s);
+		} else if (isprint((unsigned char) *s)) {
+			fputc(*s, fp);
+		} else {
+			fprintf(fp, "\\%03o", (unsigned char) *s);
+		}
+	}
+	fputc('"', fp);
+}
+
+static const char *const kind_names[] = {
+	[DULCET_TERM_KIND_VAR] = "DULCET_TERM_KIND_VAR",
+	[DULCET_TERM_KIND_ABS] = "DULCET_TERM_KIND_ABS",
+	[DULCET_TERM_KIND_APP] = "DULCET_TERM_KIND_APP",
+	[DULCET_TERM_KIND_REF] = "DULCET_TERM_KIND_REF",
+	[DULCET_TERM_KIND_INT] = "DULCET_TERM_KIND_INT",
+	[DULCET_TERM_KIND_BOOL] = "DULCET_TERM_KIND_BOOL",
+	[DULCET_TERM_KIND_PRIM] = "DULCET_TERM_KIND_PRIM",
+};
+
+static const char *const prim_op_names[] = {
+	[DULCET_PRIM_OP_ADD] = "DULCET_PRIM_OP_ADD",
+	[DULCET_PRIM_OP_SUB] = "DULCET_PRIM_OP_SUB",
+	[DULCET_PRIM_OP_MUL] = "DULCET_PRIM_OP_MUL",
+	[DULCET_PRIM_OP_DIV] = "DULCET_PRIM_OP_DIV",
+	[DULCET_PRIM_OP_EQ] = "DULCET_PRIM_OP_EQ",
+	[DULCET_PRIM_OP_LT] = "DULCET_PRIM_OP_LT",
+	[DULCET_PRIM_OP_IF] = "DULCET_PRIM_OP_IF",
+};
+
+static void write_image(FILE *fp, const struct dulcet_image *image, const char *name,
+			const char *source)
+{
+	fprintf(fp, "// Generated by dulcetc from %s, do not edit. Declare it with\n", source);
+	fprintf(fp, "// `extern const struct dulcet_image %s;` and build it with ", name);
+	fprintf(fp, "`dulcet_image_load`.\n");
+	fprintf(fp, "\n");
+	fprintf(fp, "#include \"dulcet.h\"\n");
+	fprintf(fp, "\n");
+
+	// Arrays cannot be empty, so an empty image gets none
+	if (image->nodes_size > 0) {
+		fprintf(fp, "static const struct dulcet_image_node %s_nodes[] = {\n", name);
+		for (size_t i = 0; i < image->nodes_size; ++i) {
+			const struct dulcet_image_node *node = &image->nodes[i];
+
+			fprintf(fp, "\t{ %s, ", kind_names[node->kind]);
+			if (node->kind == DULCET_TERM_KIND_PRIM) {
+				fprintf(fp, "%s", prim_op_names[node->value]);
+			} else if (node->value == LLONG_MIN) {
+				fprintf(fp, "-%lld - 1", LLONG_MAX);
+			} else {
+				fprintf(fp, "%lld", node->value);
+			}
+			fprintf(fp, " },\n");
+		}
+		fprintf(fp, "};\n");
+		fprintf(fp, "\n");
+
+		fprintf(fp, "static const struct dulcet_image_definition %s_definitions[] = {\n",
+			name);
+		for (size_t i = 0; i < image->definitions_size; ++i) {
+			const struct dulcet_image_definition *definition = &image->definitions[i];
+
+			fprintf(fp, "\t{ ");
+			if (definition->name) {
+				write_string(fp, definition->name);
+			} else {
+				fprintf(fp, "NULL");
+			}
+			fprintf(fp, ", %zu },\n", definition->size);
+		}
+		fprintf(fp, "};\n");
+		fprintf(fp, "\n");
+	}
+
+	fprintf(fp, "const struct dulcet_image %s = {\n", name);
+	if (image->nodes_size > 0) {
+		fprintf(fp, "\t.nodes = %s_nodes,\n", name);
+		fprintf(fp, "\t.nodes_size = %zu,\n", image->nodes_size);
+		fprintf(fp, "\t.definitions = %s_definitions,\n", name);
+		fprintf(fp, "\t.definitions_size = %zu,\n", image->definitions_size);
+	}
+	fprintf(fp, "};\n");
+}
+
+// Returns NULL if reading fails, with errno set to ENOMEM if there is no memory for the input
+static char *read_input(FILE *fp, size_t *input_len)
+{
+	char *input = NULL;
+	size_t input_capacity = 0;
+
+	*input_len = 0;
+
+	for (;;) {
+		if (input_capacity - *input_len < BUFSIZ) {
+			input_capacity = input_capacity ? 2 * input_capacity : BUFSIZ;
+
+			char *grown = realloc(input, input_capacity);
+			if (!grown) {
+				free(input);
+				errno = ENOMEM;
+				return NULL;
+			}
+			input = grown;
+		}
+
+		size_t bytes_read = fread(input + *input_len, sizeof(char), BUFSIZ, fp);
+		*input_len += bytes_read;
+
+		if (bytes_read < BUFSIZ) {
+			break;
+		}
+	}
+
+	if (ferror(fp)) {
+		free(input);
+		return NULL;
+	}
+
+	return input;
+}
+
+static char *shift_arg(int *argc, char ***argv)
+{
+	char *arg = **argv;
+	*argc -= 1;
+	*argv += 1;
+	return arg;
+}
+
+int main(int argc, char **argv)
+{
+	char *program_name = shift_arg(&argc, &argv);
+	char *input_file_path = NULL;
+	char *output_file_path = NULL;
+	char *prelude_file_path = NULL;
+	char *image_name = NULL;
+	int de_bruijn = 0;
+
+	while (argc > 0) {
+		char *opt = shift_arg(&argc, &argv);
+
+		if (strcmp(opt, "-h") == 0 || strcmp(opt, "--help") == 0) {
+			print_usage(program_name);
+
+			return 0;
+		} else if (strcmp(opt, "-f") == 0 || strcmp(opt, "-o") == 0 ||
+			   strcmp(opt, "-p") == 0 || strcmp(opt, "-n") == 0) {
+			if (argc <= 0) {
+				fprintf(stderr, "%s: fatal error: `%s` flag requires %s argument\n",
+					program_name, opt,
+					opt[1] == 'n' ? "a name" : "a file");
+				return 1;
+			}
+
+			char *arg = shift_arg(&argc, &argv);
+
+			switch (opt[1]) {
+			case 'f':
+				input_file_path = arg;
+				break;
+			case 'o':
+				output_file_path = arg;
+				break;
+			case 'p':
+				prelude_file_path = arg;
+				break;
+			default:
+				image_name = arg;
+				break;
+			}
+		} else if (strcmp(opt, "--notation") == 0) {
+			char *name = argc > 0 ? shift_arg(&argc, &argv) : "";
+
+			if (strcmp(name, "classic") == 0) {
+				de_bruijn = 0;
+			} else if (strcmp(name, "de-bruijn") == 0) {
+				de_bruijn = 1;
+			} else {
+				fprintf(stderr,
+					"%s: fatal error: `--notation` flag requires `classic` or `de-bruijn`\n",
+					program_name);
+				return 1;
+			}
+		} else {
+			fprintf(stderr, "%s: fatal error: unknown parameter `%s`\n", program_name,
+				opt);
+			return 1;
+		}
+	}
+
+	if (image_name && !is_identifier(image_name)) {
+		fprintf(stderr, "%s: fatal error: `%s` is not a C identifier\n", program_name,
+			image_name);
+		return 1;
+	}
+
+	// The program is read from stdin unless only a prelude is compiled
+	int program = input_file_path || !prelude_file_path;
+	if (input_file_path && strcmp(input_file_path, "-") == 0) {
+		input_file_path = NULL;
+	}
+
+	struct dulcet_session session;
+	dulcet_session_init(&session);
+
+	if (prelude_file_path) {
+		FILE *prelude_fp = fopen(prelude_file_path, "r");
+		if (!prelude_fp) {
+			fprintf(stderr, "%s: fatal error: could not open file `%s`: %s\n",
+				program_name, prelude_file_path, strerror(errno));
+			return 1;
+		}
+
+		int failed = run_prelude(&session, prelude_file_path, prelude_fp);
+		fclose(prelude_fp);
+		if (failed) {
+			return 1;
+		}
+	}
+
+	struct dulcet_term *program_term = NULL;
+
+	if (program) {
+		FILE *input_fp = stdin;
+		if (input_file_path) {
+			input_fp = fopen(input_file_path, "r");
+			if (!input_fp) {
+				fprintf(stderr, "%s: fatal error: could not open file `%s`: %s\n",
+					program_name, input_file_path, strerror(errno));
+				return 1;
+			}
+		}
+
+		size_t input_len;
+		errno = 0;
+		char *input = read_input(input_fp, &input_len);
+		if (!input) {
+			if (errno == ENOMEM) {
+				fprintf(stderr, "%s: fatal error: out of memory\n", program_name);
+			} else {
+				perror("fread");
+			}
+			return 1;
+		}
+		if (input_fp != stdin) {
+			fclose(input_fp);
+		}
+
+		struct dulcet_parse_result result =
+			de_bruijn ? dulcet_parse_de_bruijn(input, input_len)
+				  : dulcet_session_parse(&session, input, input_len);
+
+		if (result.kind == DULCET_PARSE_ERROR) {
+			print_parse_error(input_file_path, result.error, 0);
+			return 1;
+		}
+
+		program_term = result.value;
+		free(input);
+	}
+
+	// The definitions of the prelude come first, so that the program may refer to them, and
+	// their names are copied, as the session does not terminate them
+	size_t size = session.definitions_size + (program_term != NULL);
+	const struct dulcet_term **terms = malloc(size * sizeof(*terms) + 1);
+	char **names = malloc(size * sizeof(*names) + 1);
+	if (!terms || !names) {
+		fprintf(stderr, "%s: fatal error: out of memory\n", program_name);
+		return 1;
+	}
+
+	for (size_t i = 0; i < session.definitions_size; ++i) {
+		const struct dulcet_definition *definition = &session.definitions[i];
+
+		terms[i] = definition->value;
+		names[i] = malloc(definition->name_len + 1);
+		if (!names[i]) {
+			fprintf(stderr, "%s: fatal error: out of memory\n", program_name);
+			return 1;
+		}
+		memcpy(names[i], definition->name, definition->name_len);
+		names[i][definition->name_len] = '\0';
+	}
+	if (program_term) {
+		terms[size - 1] = program_term;
+		names[size - 1] = NULL;
+	}
+
+	struct dulcet_image image;
+	dulcet_image_build(&image, terms, (const char *const *) names, size);
+
+	FILE *output_fp = stdout;
+	if (output_file_path) {
+		output_fp = fopen(output_file_path, "w");
+		if (!output_fp) {
+			fprintf(stderr, "%s: fatal error: could not open file `%s`: %s\n",
+				program_name, output_file_path, strerror(errno));
+			return 1;
+		}
+	}
+
+	const char *source = !program ? prelude_file_path
+			     : input_file_path ? input_file_path
+					       : "<stdin>";
+	char *name = image_name;
+	if (!name) {
+		name = image_name_from_path(program && !input_file_path ? "program" : source);
+		if (!name) {
+			fprintf(stderr, "%s: fatal error: out of memory\n", program_name);
+			return 1;
+		}
+	}
+
+	write_image(output_fp, &image, name, source);
+
+	int rc = fclose(output_fp);
+	if (rc != 0) {
+		perror("fclose");
+		return 1;
+	}
+
+	if (name != image_name) {
+		free(name);
+	}
+	dulcet_image_free(&image);
+	for (size_t i = 0; i < size; ++i) {
+		free(names[i]);
+	}
+	free(names);
+	free(terms);
+	if (program_term) {
+		dulcet_term_free(program_term);
+	}
+	dulcet_session_deinit(&session);
+
+	return 0;
+}
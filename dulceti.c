@@ -4,13 +4,23 @@
  * SPDX-License-Identifier: BSD-2-Clause
  */
 
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <signal.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <unistd.h>
 
 #include "dulcet.h"
 
 #include "dulcet_parser.h"
+#include "dulcet_perf.h"
+#include "dulcet_session.h"
+#include "dulceti_server.h"
+#include "dulceti_trace.h"
 
 static void print_usage(const char *program_name)
 {
@@ -23,6 +33,532 @@ static void print_usage(const char *program_name)
 	printf("                       \tBy default, the interpreter will accept input from stdin.\n");
 	printf("  -o <output_file_path>\tRun the interpreter and write its output to the given file, creating it if doesn't exist and overriding its contents.\n");
 	printf("                       \tBy default, the interpreter will write its output to stdout.\n");
+	printf("  -r, --repl           \tRun the input one line at a time, where each line is either a term,\n");
+	printf("                       \twhose normal form is written to the output, or a definition `name = term`\n");
+	printf("                       \tthat later lines may refer to by name. The term of a definition is reduced\n");
+	printf("                       \tonce when defined, unless it is written as `name := term`.\n");
+	printf("  -p <prelude_file_path>\tLoad definitions, one per line as in `--repl`, from the given file.\n");
+	printf("  --notation <notation>\tRead and write terms in `classic` (default) or `de-bruijn` notation.\n");
+	printf("  --strategy <strategy>\tReduce with the `nor` (normal order, default), `cbn` (call by name)\n");
+	printf("                       \tor `app` (applicative order) strategy, or with `portfolio`, which races\n");
+	printf("                       \t`nor` and `app` on threads of their own and keeps the first normal form.\n");
+	printf("  --max-steps <n>      \tStop after `n` beta reduction steps, writing the partially reduced term.\n");
+	printf("  --max-nodes <n>      \tStop once the terms take more than `n` nodes, likewise.\n");
+	printf("  --max-memory <MiB>   \tStop once the terms take more than the given memory, likewise.\n");
+	printf("  --timeout <seconds>  \tStop once the run, or each line with `--repl`, takes longer than the given\n");
+	printf("                       \ttime, likewise.\n");
+	printf("  --detect-divergence  \tStop once the term comes back to a term it was before, as it would then\n");
+	printf("                       \tnever get anywhere else, likewise.\n");
+	printf("  --partial            \tOn SIGINT, stop reducing and write the partially reduced term, as when a\n");
+	printf("                       \tlimit is reached, followed by the stats if requested.\n");
+	printf("  --decode <encoding>  \tWrite the normal form as the `nat`, `bool`, `list` or `pair` it encodes,\n");
+	printf("                       \tsuch as `3`, `true`, `[1,2,3]` or `(1,2)`, or as usual if it is none.\n");
+	printf("                       \tElements are written as numerals or booleans where they are ones.\n");
+	printf("  --share              \tWrite each closed subterm of the normal form that occurs more than once\n");
+	printf("                       \tonly once, as a binding `let $1 = term in ...` that is then referred to.\n");
+	printf("  --stream             \tWrite the normal form head first, as its parts become final, while the rest\n");
+	printf("                       \tis still being reduced. Only for the `nor` strategy.\n");
+	printf("  --stats              \tWrite counters of the work done and the time spent in each phase to stderr.\n");
+	printf("  --perf               \tWrite hardware performance counters of each phase to stderr, along with\n");
+	printf("                       \tcache and branch misses per beta reduction step.\n");
+	printf("  --trace <trace_path> \tWrite the phases and sampled beta reduction steps of the run to the given\n");
+	printf("                       \tfile in Chrome trace JSON format, to be opened in Perfetto or chrome://tracing.\n");
+	printf("  --trace-every <n>    \tSample one of every `n` steps, besides those that grow the term to a new\n");
+	printf("                       \tpeak size. By default, every step is sampled.\n");
+	printf("  --profile <profile_path>\tCount the beta reduction steps that apply each lambda of the input\n");
+	printf("                       \tand prelude, and the nodes they copy, and write them to the given file.\n");
+	printf("  --profile-format <format>\tWrite the profile as a `table` (default) sorted by steps, or as\n");
+	printf("                       \t`folded` stacks for flame graph tools.\n");
+	printf("  --serve <socket_path>\tListen for evaluation requests on the given Unix domain socket until\n");
+	printf("                       \tinterrupted, keeping the prelude loaded in between requests.\n");
+	printf("  --workers <n>        \tEvaluate requests with `n` threads when serving. By default, one per core.\n");
+	printf("  --connect <socket_path>\tSend the input to the server listening on the given socket instead of\n");
+	printf("                       \tevaluating it, writing its response to the output.\n");
+	printf("\n");
+	printf("Exit status is 0 on success, 1 on error, and when a single term is evaluated and stopped early,\n");
+	printf("2 for the step limit, 3 for the memory limits, 4 for the timeout, 5 for divergence, 6 for a\n");
+	printf("term too deep to reduce and 130 for SIGINT.\n");
+}
+
+static void handle_interrupt(int signal)
+{
+	(void) signal;
+
+	dulcet_interrupt();
+}
+
+// Church encodings that normal forms are read back from, see `--decode`
+enum decode {
+	DECODE_NONE,
+	DECODE_NAT,
+	DECODE_BOOL,
+	DECODE_LIST,
+	DECODE_PAIR,
+};
+
+// Write `t` in `notation`, with each repeated closed subterm written once if `share` is set
+static void print_notation(const struct dulcet_term *t, enum dulceti_notation notation, int share,
+			   FILE *fp)
+{
+	if (notation == DULCETI_NOTATION_CLASSIC) {
+		share ? dulcet_term_fprint_classic_shared(t, fp)
+		      : dulcet_term_fprint_classic(t, fp);
+	} else {
+		share ? dulcet_term_fprint_de_bruijn_shared(t, fp)
+		      : dulcet_term_fprint_de_bruijn(t, fp);
+	}
+}
+
+// Write an element of a list or pair as a numeral or a boolean if it is one, and as usual otherwise
+static void print_element(const struct dulcet_term *t, enum dulceti_notation notation, int share,
+			  FILE *fp)
+{
+	long long value;
+	int boolean;
+
+	if (dulcet_church_to_int(t, &value)) {
+		fprintf(fp, "%lld", value);
+	} else if (dulcet_church_to_bool(t, &boolean)) {
+		fprintf(fp, "%s", boolean ? "true" : "false");
+	} else {
+		print_notation(t, notation, share, fp);
+	}
+}
+
+// Write `t` as what it encodes, if it is the encoding given by `decode`, and as usual otherwise
+static void print_term(const struct dulcet_term *t, enum dulceti_notation notation,
+		       enum decode decode, int share, FILE *fp)
+{
+	long long value;
+	int boolean;
+	const struct dulcet_term *first, *second;
+	const struct dulcet_term **items;
+	size_t size;
+
+	if (decode == DECODE_NAT && dulcet_church_to_int(t, &value)) {
+		fprintf(fp, "%lld", value);
+	} else if (decode == DECODE_BOOL && dulcet_church_to_bool(t, &boolean)) {
+		fprintf(fp, "%s", boolean ? "true" : "false");
+	} else if (decode == DECODE_LIST && dulcet_church_to_list(t, &items, &size)) {
+		fprintf(fp, "[");
+		for (size_t i = 0; i < size; ++i) {
+			if (i > 0) {
+				fprintf(fp, ",");
+			}
+			print_element(items[i], notation, share, fp);
+		}
+		fprintf(fp, "]");
+
+		free(items);
+	} else if (decode == DECODE_PAIR && dulcet_church_to_pair(t, &first, &second)) {
+		fprintf(fp, "(");
+		print_element(first, notation, share, fp);
+		fprintf(fp, ",");
+		print_element(second, notation, share, fp);
+		fprintf(fp, ")");
+	} else {
+		print_notation(t, notation, share, fp);
+	}
+}
+
+// Report how far the reduction of `t`, if known, got before it stopped early, if it did
+static void print_stopped(const char *program_name, enum dulcet_status status,
+			  unsigned long long steps, const struct dulcet_term *t)
+{
+	static const char *reasons[] = {
+		[DULCET_STATUS_OK] = "",
+		[DULCET_STATUS_STEP_LIMIT] = "the step limit was reached",
+		[DULCET_STATUS_MEMORY_LIMIT] = "the memory limit was reached",
+		[DULCET_STATUS_DEADLINE] = "the timeout expired",
+		[DULCET_STATUS_INTERRUPTED] = "interrupted",
+		[DULCET_STATUS_DIVERGED] = "the reduction goes round in circles",
+		[DULCET_STATUS_DEPTH_LIMIT] = "the term got too deep to reduce",
+	};
+
+	if (status == DULCET_STATUS_OK) {
+		return;
+	}
+
+	fprintf(stderr, "%s: warning: stopped after %llu beta reduction steps (%s)", program_name,
+		steps, reasons[status]);
+	if (t) {
+		fprintf(stderr, ", leaving a term of %zu nodes", dulcet_term_size(t));
+	}
+	fprintf(stderr, "\n");
+}
+
+static int status_exit_code(enum dulcet_status status)
+{
+	switch (status) {
+	case DULCET_STATUS_OK:
+		return 0;
+	case DULCET_STATUS_STEP_LIMIT:
+		return 2;
+	case DULCET_STATUS_MEMORY_LIMIT:
+		return 3;
+	case DULCET_STATUS_DEADLINE:
+		return 4;
+	case DULCET_STATUS_INTERRUPTED:
+		return 128 + SIGINT;
+	case DULCET_STATUS_DIVERGED:
+		return 5;
+	case DULCET_STATUS_DEPTH_LIMIT:
+		return 6;
+	}
+
+	return 1;
+}
+
+// The reason a response of the server tells that the reduction stopped, as `dulcet_status`, or -1
+// if it is an error
+static int response_stopped(enum dulceti_status status)
+{
+	switch (status) {
+	case DULCETI_STATUS_OK:
+		return DULCET_STATUS_OK;
+	case DULCETI_STATUS_STEP_LIMIT:
+		return DULCET_STATUS_STEP_LIMIT;
+	case DULCETI_STATUS_DEPTH_LIMIT:
+		return DULCET_STATUS_DEPTH_LIMIT;
+	case DULCETI_STATUS_MEMORY_LIMIT:
+		return DULCET_STATUS_MEMORY_LIMIT;
+	case DULCETI_STATUS_DEADLINE:
+		return DULCET_STATUS_DEADLINE;
+	case DULCETI_STATUS_INTERRUPTED:
+		return DULCET_STATUS_INTERRUPTED;
+	case DULCETI_STATUS_DIVERGED:
+		return DULCET_STATUS_DIVERGED;
+	case DULCETI_STATUS_PARSE_ERROR:
+	case DULCETI_STATUS_BAD_REQUEST:
+		break;
+	}
+
+	return -1;
+}
+
+static void print_parse_error(const char *input_file_path, struct dulcet_parse_error error,
+			      unsigned int line_offset)
+{
+	if (input_file_path) {
+		fprintf(stderr, "%s:", input_file_path);
+	}
+	fprintf(stderr, "%u:%u: fatal error: ", error.line + line_offset, error.column);
+
+	switch (error.cause) {
+	case DULCET_PARSE_ERROR_CAUSE_UNKNOWN:
+		fprintf(stderr, "unexpected error\n");
+		break;
+	case DULCET_PARSE_ERROR_CAUSE_UNMATCHED_PAREN:
+		fprintf(stderr, "unmatched `%.*s`\n", error.text_len, error.text_start);
+		break;
+	case DULCET_PARSE_ERROR_CAUSE_UNEXPECTED_TOKEN:
+		if (error.text_len == 0) {
+			fprintf(stderr, "unexpected end of input\n");
+		} else {
+			fprintf(stderr, "unexpected `%.*s`\n", error.text_len, error.text_start);
+		}
+		break;
+	case DULCET_PARSE_ERROR_CAUSE_UNBOUND_VARIABLE:
+		fprintf(stderr, "unbound variable `%.*s`\n", error.text_len, error.text_start);
+		break;
+	}
+}
+
+// Run the input one line at a time, under the given limits, if any, set anew for each line
+static int run_repl(struct dulcet_session *session, const char *input_file_path, FILE *input_fp,
+		    FILE *output_fp, const struct dulcet_limits *limits, enum decode decode,
+		    int share, const char *program_name)
+{
+	int interactive = input_fp == stdin && output_fp && isatty(STDIN_FILENO);
+	int failed = 0;
+
+	struct dulcet_profile *profile = dulcet_get_profile();
+	if (profile) {
+		profile->source = input_file_path ? input_file_path : "<stdin>";
+	}
+
+	char *line = NULL;
+	size_t line_capacity = 0;
+	unsigned int line_number = 0;
+
+	for (;;) {
+		if (interactive) {
+			printf("> ");
+			fflush(stdout);
+		}
+
+		ssize_t line_len = getline(&line, &line_capacity, input_fp);
+		if (line_len < 0) {
+			break;
+		}
+		line_number += 1;
+
+		if (profile) {
+			profile->line_offset = line_number - 1;
+		}
+
+		if (limits) {
+			dulcet_set_limits(limits);
+		}
+
+		struct dulcet_parse_result result = dulcet_session_exec(session, line, line_len);
+
+		if (limits && result.kind == DULCET_PARSE_OK) {
+			print_stopped(program_name, dulcet_status(), dulcet_steps_taken(),
+				      result.value);
+		}
+
+		if (result.kind == DULCET_PARSE_ERROR) {
+			print_parse_error(input_file_path, result.error, line_number - 1);
+			failed = 1;
+			continue;
+		}
+
+		if (result.value) {
+			if (output_fp) {
+				print_term(result.value, DULCETI_NOTATION_CLASSIC, decode, share,
+					   output_fp);
+				fprintf(output_fp, "\n");
+				fflush(output_fp);
+			}
+
+			dulcet_term_free(result.value);
+		}
+	}
+
+	if (interactive) {
+		printf("\n");
+	}
+
+	free(line);
+
+	return failed && !interactive;
+}
+
+static void print_stats(const char *program_name)
+{
+	static const char *strategy_names[DULCET_STRATEGY_COUNT] = {
+		[DULCET_STRATEGY_NONE] = "eval",
+		[DULCET_STRATEGY_CBN] = "cbn",
+		[DULCET_STRATEGY_NOR] = "nor",
+		[DULCET_STRATEGY_APP] = "app",
+	};
+	static const char *phase_names[DULCET_PHASE_COUNT] = {
+		[DULCET_PHASE_READ] = "read",
+		[DULCET_PHASE_PARSE] = "parse",
+		[DULCET_PHASE_REDUCE] = "reduce",
+		[DULCET_PHASE_PRINT] = "print",
+	};
+
+	if (!dulcet_stats_enabled()) {
+		fprintf(stderr, "%s: warning: built without `DULCET_STATS`, no stats were kept\n",
+			program_name);
+		return;
+	}
+
+	struct dulcet_stats stats;
+	dulcet_stats_get(&stats);
+
+	for (int i = 0; i < DULCET_STRATEGY_COUNT; i++) {
+		if (stats.beta_steps[i] > 0) {
+			fprintf(stderr, "beta steps (%s):%*s%llu\n", strategy_names[i],
+				(int) (6 - strlen(strategy_names[i])), "", stats.beta_steps[i]);
+		}
+	}
+	fprintf(stderr, "delta steps:        %llu\n", stats.delta_steps);
+	fprintf(stderr, "substitutions:      %llu\n", stats.substitutions);
+	fprintf(stderr, "arguments moved:    %llu\n", stats.arguments_moved);
+	fprintf(stderr, "arguments erased:   %llu\n", stats.arguments_erased);
+	fprintf(stderr, "nodes copied:       %llu\n", stats.nodes_copied);
+	fprintf(stderr, "refs instantiated:  %llu\n", stats.refs_instantiated);
+	fprintf(stderr, "nodes shifted:      %llu\n", stats.nodes_shifted);
+	fprintf(stderr, "nodes allocated:    %llu\n", stats.nodes_allocated);
+	fprintf(stderr, "nodes freed:        %llu\n", stats.nodes_freed);
+	fprintf(stderr, "peak live nodes:    %llu\n", stats.peak_live_nodes);
+	fprintf(stderr, "max depth:          %llu\n", stats.max_depth);
+
+	for (int i = 0; i < DULCET_PHASE_COUNT; i++) {
+		fprintf(stderr, "%s time:%*s%.3f ms\n", phase_names[i],
+			(int) (14 - strlen(phase_names[i])), "", stats.phase_ns[i] / 1e6);
+	}
+}
+
+enum perf_phase {
+	PERF_PHASE_READ,
+	PERF_PHASE_PARSE,
+	PERF_PHASE_REDUCE,
+	PERF_PHASE_PRINT,
+	PERF_PHASE_COUNT,
+};
+
+// Write the counts of each phase, between consecutive samples, and those of the reduction per
+// beta reduction step
+static void print_perf(const struct dulcet_perf *perf,
+		       const struct dulcet_perf_sample samples[PERF_PHASE_COUNT + 1],
+		       enum dulceti_strategy strategy, unsigned long steps)
+{
+	static const char *strategy_names[] = {
+		[DULCETI_STRATEGY_NOR] = "nor",
+		[DULCETI_STRATEGY_CBN] = "cbn",
+		[DULCETI_STRATEGY_APP] = "app",
+		[DULCETI_STRATEGY_PORTFOLIO] = "portfolio",
+	};
+	static const char *phase_names[PERF_PHASE_COUNT] = {
+		[PERF_PHASE_READ] = "read",
+		[PERF_PHASE_PARSE] = "parse",
+		[PERF_PHASE_REDUCE] = "reduce",
+		[PERF_PHASE_PRINT] = "print",
+	};
+
+	fprintf(stderr, "%-14s", "phase");
+	for (int i = 0; i < DULCET_PERF_COUNTER_COUNT; ++i) {
+		if (dulcet_perf_available(perf, i)) {
+			fprintf(stderr, " %14s", dulcet_perf_counter_names[i]);
+		}
+	}
+	fprintf(stderr, "\n");
+
+	struct dulcet_perf_sample reduce;
+
+	for (int phase = 0; phase <= PERF_PHASE_COUNT; ++phase) {
+		struct dulcet_perf_sample delta;
+		char name[32];
+
+		if (phase == PERF_PHASE_COUNT) {
+			dulcet_perf_diff(&samples[0], &samples[PERF_PHASE_COUNT], &delta);
+			snprintf(name, sizeof(name), "total");
+		} else {
+			dulcet_perf_diff(&samples[phase], &samples[phase + 1], &delta);
+			snprintf(name, sizeof(name), "%s", phase_names[phase]);
+		}
+
+		if (phase == PERF_PHASE_REDUCE) {
+			reduce = delta;
+			snprintf(name, sizeof(name), "reduce (%s)", strategy_names[strategy]);
+		}
+
+		fprintf(stderr, "%-14s", name);
+		for (int i = 0; i < DULCET_PERF_COUNTER_COUNT; ++i) {
+			if (dulcet_perf_available(perf, i)) {
+				fprintf(stderr, " %14llu", (unsigned long long) delta.values[i]);
+			}
+		}
+		fprintf(stderr, "\n");
+	}
+
+	if (dulcet_perf_available(perf, DULCET_PERF_CYCLES) &&
+	    dulcet_perf_available(perf, DULCET_PERF_INSTRUCTIONS) &&
+	    reduce.values[DULCET_PERF_CYCLES] > 0) {
+		fprintf(stderr, "reduce instructions per cycle: %.2f\n",
+			(double) reduce.values[DULCET_PERF_INSTRUCTIONS] /
+				reduce.values[DULCET_PERF_CYCLES]);
+	}
+
+	if (steps == 0) {
+		return;
+	}
+
+	fprintf(stderr, "per beta reduction step (%lu steps):\n", steps);
+	for (int i = 0; i < DULCET_PERF_COUNTER_COUNT; ++i) {
+		if (dulcet_perf_available(perf, i)) {
+			fprintf(stderr, "  %-14s %14.2f\n", dulcet_perf_counter_names[i],
+				(double) reduce.values[i] / steps);
+		}
+	}
+}
+
+static int compare_profile_entries(const void *a, const void *b)
+{
+	const struct dulcet_profile_entry *x = a;
+	const struct dulcet_profile_entry *y = b;
+
+	if (x->reductions != y->reductions) {
+		return x->reductions < y->reductions ? 1 : -1;
+	}
+	if (x->nodes_copied != y->nodes_copied) {
+		return x->nodes_copied < y->nodes_copied ? 1 : -1;
+	}
+
+	return 0;
+}
+
+static void print_profile_lambda(FILE *fp, const struct dulcet_profile_entry *entry)
+{
+	fprintf(fp, "%s:%u:%u ", entry->source ? entry->source : "<input>", entry->line,
+		entry->column);
+
+	if (entry->parameter) {
+		fprintf(fp, "\\%s.", entry->parameter);
+	} else {
+		fprintf(fp, "\\");
+	}
+}
+
+// Write the lambdas that were applied at least once, the busiest first. Folded stacks, as read by
+// `flamegraph.pl` and speedscope, put the steps under a `beta` frame and the copied nodes under
+// a `copy` frame, so that both can be told apart in the same graph.
+static int write_profile(const char *profile_file_path, struct dulcet_profile *profile,
+			 int folded)
+{
+	FILE *fp = fopen(profile_file_path, "w");
+	if (!fp) {
+		return -1;
+	}
+
+	qsort(profile->entries, profile->size, sizeof(*profile->entries), compare_profile_entries);
+
+	if (!folded) {
+		fprintf(fp, "%12s %14s %14s  %s\n", "steps", "substitutions", "nodes copied",
+			"lambda");
+	}
+
+	for (size_t i = 0; i < profile->size; ++i) {
+		const struct dulcet_profile_entry *entry = &profile->entries[i];
+
+		if (entry->reductions == 0) {
+			break;
+		}
+
+		if (folded) {
+			fprintf(fp, "beta;");
+			print_profile_lambda(fp, entry);
+			fprintf(fp, " %llu\n", entry->reductions);
+
+			if (entry->nodes_copied > 0) {
+				fprintf(fp, "copy;");
+				print_profile_lambda(fp, entry);
+				fprintf(fp, " %llu\n", entry->nodes_copied);
+			}
+		} else {
+			fprintf(fp, "%12llu %14llu %14llu  ", entry->reductions,
+				entry->substitutions, entry->nodes_copied);
+			print_profile_lambda(fp, entry);
+			fprintf(fp, "\n");
+		}
+	}
+
+	int failed = ferror(fp);
+	if (fclose(fp) != 0 || failed) {
+		return -1;
+	}
+
+	return 0;
+}
+
+static enum dulcet_status reduce(struct dulcet_term *t, enum dulceti_strategy strategy)
+{
+	switch (strategy) {
+	case DULCETI_STRATEGY_NOR:
+		return dulcet_beta_nor(t);
+	case DULCETI_STRATEGY_CBN:
+		return dulcet_beta_cbn(t);
+	case DULCETI_STRATEGY_APP:
+		return dulcet_beta_app(t);
+	case DULCETI_STRATEGY_PORTFOLIO:
+		return dulcet_beta_portfolio(t);
+	}
+
+	return DULCET_STATUS_OK;
 }
 
 static char *shift_arg(int *argc, char ***argv)
@@ -33,12 +569,31 @@ static char *shift_arg(int *argc, char ***argv)
 	return arg;
 }
 
-int main(int argc, char **argv)
+static int run(int argc, char **argv)
 {
 	char *program_name = shift_arg(&argc, &argv);
 	char *input_file_path = NULL;
 	FILE *input_fp = stdin;
 	FILE *output_fp = stdout;
+	int repl = 0;
+	int stats = 0;
+	int perf = 0;
+	int partial = 0;
+	int stream = 0;
+	char *prelude_file_path = NULL;
+	char *serve_socket_path = NULL;
+	char *connect_socket_path = NULL;
+	char *trace_file_path = NULL;
+	char *profile_file_path = NULL;
+	int profile_folded = 0;
+	unsigned long trace_every = 1;
+	unsigned long workers = 0;
+	unsigned long long max_steps = 0;
+	struct dulcet_limits limits = { .steps = DULCET_UNLIMITED_STEPS, .depth = DULCETI_DEPTH_LIMIT };
+	enum dulceti_notation notation = DULCETI_NOTATION_CLASSIC;
+	enum dulceti_strategy strategy = DULCETI_STRATEGY_NOR;
+	enum decode decode = DECODE_NONE;
+	int share = 0;
 
 	while (argc > 0) {
 		char *opt = shift_arg(&argc, &argv);
@@ -47,6 +602,20 @@ int main(int argc, char **argv)
 			print_usage(program_name);
 
 			return 0;
+		} else if (strcmp(opt, "-r") == 0 || strcmp(opt, "--repl") == 0) {
+			repl = 1;
+		} else if (strcmp(opt, "--stats") == 0) {
+			stats = 1;
+		} else if (strcmp(opt, "--perf") == 0) {
+			perf = 1;
+		} else if (strcmp(opt, "--partial") == 0) {
+			partial = 1;
+		} else if (strcmp(opt, "--stream") == 0) {
+			stream = 1;
+		} else if (strcmp(opt, "--share") == 0) {
+			share = 1;
+		} else if (strcmp(opt, "--detect-divergence") == 0) {
+			limits.divergence = 1;
 		} else if (strcmp(opt, "-f") == 0) {
 			if (argc <= 0) {
 				fprintf(stderr,
@@ -84,6 +653,147 @@ int main(int argc, char **argv)
 					program_name, output_file_path, strerror(errno));
 				return 1;
 			}
+		} else if (strcmp(opt, "-p") == 0) {
+			if (argc <= 0) {
+				fprintf(stderr,
+					"%s: fatal error: `-p` flag requires a file argument\n",
+					program_name);
+				return 1;
+			}
+
+			prelude_file_path = shift_arg(&argc, &argv);
+		} else if (strcmp(opt, "--notation") == 0) {
+			char *name = argc > 0 ? shift_arg(&argc, &argv) : "";
+
+			if (strcmp(name, "classic") == 0) {
+				notation = DULCETI_NOTATION_CLASSIC;
+			} else if (strcmp(name, "de-bruijn") == 0) {
+				notation = DULCETI_NOTATION_DE_BRUIJN;
+			} else {
+				fprintf(stderr,
+					"%s: fatal error: `--notation` flag requires `classic` or `de-bruijn`\n",
+					program_name);
+				return 1;
+			}
+		} else if (strcmp(opt, "--strategy") == 0) {
+			char *name = argc > 0 ? shift_arg(&argc, &argv) : "";
+
+			if (strcmp(name, "nor") == 0) {
+				strategy = DULCETI_STRATEGY_NOR;
+			} else if (strcmp(name, "cbn") == 0) {
+				strategy = DULCETI_STRATEGY_CBN;
+			} else if (strcmp(name, "app") == 0) {
+				strategy = DULCETI_STRATEGY_APP;
+			} else if (strcmp(name, "portfolio") == 0) {
+				strategy = DULCETI_STRATEGY_PORTFOLIO;
+			} else {
+				fprintf(stderr,
+					"%s: fatal error: `--strategy` flag requires `nor`, `cbn`, `app` or "
+					"`portfolio`\n",
+					program_name);
+				return 1;
+			}
+		} else if (strcmp(opt, "--decode") == 0) {
+			char *name = argc > 0 ? shift_arg(&argc, &argv) : "";
+
+			if (strcmp(name, "nat") == 0) {
+				decode = DECODE_NAT;
+			} else if (strcmp(name, "bool") == 0) {
+				decode = DECODE_BOOL;
+			} else if (strcmp(name, "list") == 0) {
+				decode = DECODE_LIST;
+			} else if (strcmp(name, "pair") == 0) {
+				decode = DECODE_PAIR;
+			} else {
+				fprintf(stderr,
+					"%s: fatal error: `--decode` flag requires `nat`, `bool`, `list` or "
+					"`pair`\n",
+					program_name);
+				return 1;
+			}
+		} else if (strcmp(opt, "--profile") == 0) {
+			if (argc <= 0) {
+				fprintf(stderr,
+					"%s: fatal error: `--profile` flag requires a file argument\n",
+					program_name);
+				return 1;
+			}
+
+			profile_file_path = shift_arg(&argc, &argv);
+		} else if (strcmp(opt, "--profile-format") == 0) {
+			char *name = argc > 0 ? shift_arg(&argc, &argv) : "";
+
+			if (strcmp(name, "table") == 0) {
+				profile_folded = 0;
+			} else if (strcmp(name, "folded") == 0) {
+				profile_folded = 1;
+			} else {
+				fprintf(stderr,
+					"%s: fatal error: `--profile-format` flag requires `table` or `folded`\n",
+					program_name);
+				return 1;
+			}
+		} else if (strcmp(opt, "--trace") == 0) {
+			if (argc <= 0) {
+				fprintf(stderr,
+					"%s: fatal error: `--trace` flag requires a file argument\n",
+					program_name);
+				return 1;
+			}
+
+			trace_file_path = shift_arg(&argc, &argv);
+		} else if (strcmp(opt, "--timeout") == 0) {
+			char *end = NULL;
+			char *value = argc > 0 ? shift_arg(&argc, &argv) : "";
+			double seconds = strtod(value, &end);
+
+			if (*value == '\0' || *end != '\0' || !(seconds > 0 && seconds < 1e9)) {
+				fprintf(stderr,
+					"%s: fatal error: `%s` flag requires a positive number of seconds\n",
+					program_name, opt);
+				return 1;
+			}
+
+			limits.time_ns = seconds * 1e9;
+		} else if (strcmp(opt, "--max-steps") == 0 || strcmp(opt, "--workers") == 0 ||
+			   strcmp(opt, "--trace-every") == 0 || strcmp(opt, "--max-nodes") == 0 ||
+			   strcmp(opt, "--max-memory") == 0) {
+			char *end = NULL;
+			char *value = argc > 0 ? shift_arg(&argc, &argv) : "";
+			unsigned long long n = strtoull(value, &end, 10);
+
+			if (*value == '\0' || *end != '\0' || n == 0) {
+				fprintf(stderr,
+					"%s: fatal error: `%s` flag requires a positive number\n",
+					program_name, opt);
+				return 1;
+			}
+
+			if (strcmp(opt, "--max-steps") == 0) {
+				max_steps = n;
+				limits.steps = n < DULCET_UNLIMITED_STEPS ? n : DULCET_UNLIMITED_STEPS;
+			} else if (strcmp(opt, "--max-nodes") == 0) {
+				limits.nodes = n;
+			} else if (strcmp(opt, "--max-memory") == 0) {
+				limits.bytes = n < (1ull << 44) ? n << 20 : 1ull << 63;
+			} else if (strcmp(opt, "--workers") == 0) {
+				workers = n;
+			} else {
+				trace_every = n;
+			}
+		} else if (strcmp(opt, "--serve") == 0 || strcmp(opt, "--connect") == 0) {
+			if (argc <= 0) {
+				fprintf(stderr,
+					"%s: fatal error: `%s` flag requires a socket argument\n",
+					program_name, opt);
+				return 1;
+			}
+
+			if (strcmp(opt, "--serve") == 0) {
+				serve_socket_path = shift_arg(&argc, &argv);
+			} else {
+				connect_socket_path = shift_arg(&argc, &argv);
+			}
 		} else {
 			fprintf(stderr, "%s: fatal error: unknown parameter `%s`\n", program_name,
 				opt);
@@ -91,10 +801,184 @@ int main(int argc, char **argv)
 		}
 	}
 
-	char input[BUFSIZ] = { 0 };
+	if ((trace_file_path || perf || stream) && (repl || serve_socket_path || connect_socket_path)) {
+		fprintf(stderr, "%s: fatal error: `%s` flag requires a single term to evaluate\n",
+			program_name, stream ? "--stream" : perf ? "--perf" : "--trace");
+		return 1;
+	}
+
+	// Streaming interleaves reducing and printing, which these measure apart, and writes the
+	// normal form before it is whole, as decoding would need it
+	if (stream &&
+	    (strategy != DULCETI_STRATEGY_NOR || trace_file_path || perf || decode || share)) {
+		fprintf(stderr, "%s: fatal error: `--stream` flag cannot be used with `%s`\n",
+			program_name,
+			strategy != DULCETI_STRATEGY_NOR ? "--strategy"
+			: perf				 ? "--perf"
+			: trace_file_path		 ? "--trace"
+			: decode			 ? "--decode"
+							 : "--share");
+		return 1;
+	}
+
+	// The portfolio reduces on threads of its own, which these do not follow
+	if (strategy == DULCETI_STRATEGY_PORTFOLIO && (trace_file_path || perf || profile_file_path)) {
+		fprintf(stderr, "%s: fatal error: `portfolio` strategy cannot be used with `%s`\n",
+			program_name, perf ? "--perf" : trace_file_path ? "--trace" : "--profile");
+		return 1;
+	}
+
+	if ((limits.nodes || limits.bytes || limits.time_ns || limits.divergence || partial) &&
+	    (serve_socket_path || connect_socket_path)) {
+		fprintf(stderr,
+			"%s: fatal error: limits other than `--max-steps` cannot be used with `%s`\n",
+			program_name, serve_socket_path ? "--serve" : "--connect");
+		return 1;
+	}
+
+	if ((profile_file_path || decode || share) && (serve_socket_path || connect_socket_path)) {
+		fprintf(stderr, "%s: fatal error: `%s` flag cannot be used with `%s`\n", program_name,
+			profile_file_path ? "--profile"
+			: decode	  ? "--decode"
+					  : "--share",
+			serve_socket_path ? "--serve" : "--connect");
+		return 1;
+	}
+
+	struct dulcet_profile profile;
+	if (profile_file_path) {
+		dulcet_profile_init(&profile);
+		dulcet_set_profile(&profile);
+	}
+
+	struct dulcet_session session;
+	dulcet_session_init(&session);
+
+	// The definitions of the prelude are reduced without limits, other than how deep they go
+	struct dulcet_limits prelude_limits = { .depth = DULCETI_DEPTH_LIMIT };
+	dulcet_set_limits(&prelude_limits);
+
+	if (prelude_file_path) {
+		FILE *prelude_fp = fopen(prelude_file_path, "r");
+		if (!prelude_fp) {
+			fprintf(stderr, "%s: fatal error: could not open file `%s`: %s\n",
+				program_name, prelude_file_path, strerror(errno));
+			return 1;
+		}
+
+		int rc = run_repl(&session, prelude_file_path, prelude_fp, NULL, NULL, DECODE_NONE,
+				  0, program_name);
+		fclose(prelude_fp);
+
+		if (rc != 0) {
+			return 1;
+		}
+	}
+
+	if (serve_socket_path) {
+		if (workers == 0) {
+			long cores = sysconf(_SC_NPROCESSORS_ONLN);
+			workers = cores > 0 ? cores : 1;
+		}
+
+		int rc = dulceti_serve(serve_socket_path, workers, &session);
+
+		dulcet_session_deinit(&session);
+
+		return rc;
+	}
+
+	// The stats cover the input, not the prelude
+	dulcet_stats_reset();
+
+	// Interrupted system calls restart, so that reading and writing carry on, and only the
+	// reduction stops
+	if (partial) {
+		struct sigaction action = { .sa_handler = handle_interrupt, .sa_flags = SA_RESTART };
+		sigemptyset(&action.sa_mask);
+		sigaction(SIGINT, &action, NULL);
+	}
+
+	if (repl) {
+		int rc = run_repl(&session, input_file_path, input_fp, output_fp, &limits, decode,
+				  share, program_name);
+
+		if (stats) {
+			print_stats(program_name);
+		}
+
+		if (profile_file_path) {
+			if (write_profile(profile_file_path, &profile, profile_folded) < 0) {
+				fprintf(stderr, "%s: fatal error: could not write file `%s`\n",
+					program_name, profile_file_path);
+				rc = 1;
+			}
+
+			dulcet_set_profile(NULL);
+			dulcet_profile_deinit(&profile);
+		}
+
+		if (input_fp != stdin) {
+			fclose(input_fp);
+		}
+		fclose(output_fp);
+		dulcet_session_deinit(&session);
+
+		return rc;
+	}
+
+	char *input = NULL;
+	size_t input_len = 0;
+	size_t input_capacity = 0;
+
+	struct dulceti_trace trace;
+	if (trace_file_path && dulceti_trace_open(&trace, trace_file_path, trace_every) < 0) {
+		fprintf(stderr, "%s: fatal error: could not open file `%s`: %s\n", program_name,
+			trace_file_path, strerror(errno));
+		return 1;
+	}
+
+	struct dulcet_perf perf_counters;
+	struct dulcet_perf_sample perf_samples[PERF_PHASE_COUNT + 1];
+	if (perf) {
+		if (dulcet_perf_open(&perf_counters) < 0) {
+			fprintf(stderr,
+				"%s: warning: performance counters are not available: %s\n",
+				program_name, strerror(errno));
+			perf = 0;
+		} else {
+			dulcet_perf_read(&perf_counters, &perf_samples[PERF_PHASE_READ]);
+		}
+	}
+
+	// The timeout covers the whole run, and an interruption before the reduction stops it as soon as
+	// it starts
+	dulcet_set_limits(&limits);
+
+	unsigned long long read_start = dulcet_stats_time();
+	unsigned long long phase_start = dulceti_trace_now();
+
+	for (;;) {
+		if (input_capacity - input_len < BUFSIZ) {
+			input_capacity = input_capacity ? 2 * input_capacity : BUFSIZ;
+
+			char *grown = realloc(input, input_capacity);
+			if (!grown) {
+				fprintf(stderr, "%s: fatal error: out of memory\n", program_name);
+				free(input);
+				return 1;
+			}
+			input = grown;
+		}
+
+		size_t bytes_read = fread(input + input_len, sizeof(char), BUFSIZ, input_fp);
+		input_len += bytes_read;
+
+		if (bytes_read < BUFSIZ) {
+			break;
+		}
+	}
 
-	int bytes_read = fread(input, sizeof(char), BUFSIZ, input_fp);
-	(void) bytes_read;
 	int rc = ferror(input_fp);
 	if (rc != 0) {
 		perror("fread");
@@ -107,48 +991,222 @@ int main(int argc, char **argv)
                 return 1;
         }
 
-	struct dulcet_parse_result result = dulcet_parse_classic(input, strlen(input));
+	dulcet_stats_add_time(DULCET_PHASE_READ, dulcet_stats_time() - read_start);
 
-	if (result.kind == DULCET_PARSE_ERROR) {
-		if (input_file_path) {
-			fprintf(stderr, "%s:", input_file_path);
+	if (perf) {
+		dulcet_perf_read(&perf_counters, &perf_samples[PERF_PHASE_PARSE]);
+	}
+
+	if (trace_file_path) {
+		unsigned long long phase_end = dulceti_trace_now();
+		dulceti_trace_phase(&trace, "read", phase_start, phase_end);
+		phase_start = phase_end;
+	}
+
+	if (connect_socket_path) {
+		struct dulceti_request request = {
+			.notation = notation,
+			.strategy = strategy,
+			.step_limit = max_steps,
+			.text = input,
+			.text_len = input_len,
+		};
+		struct dulceti_response response;
+
+		if (dulceti_request(connect_socket_path, &request, &response) < 0) {
+			return 1;
 		}
-		fprintf(stderr, "%u:%u: fatal error: ", result.error.line, result.error.column);
 
-		switch (result.error.cause) {
-		case DULCET_PARSE_ERROR_CAUSE_UNKNOWN:
-			fprintf(stderr, "unexpected error\n");
-			break;
-		case DULCET_PARSE_ERROR_CAUSE_UNMATCHED_PAREN:
-			fprintf(stderr, "unmatched `%.*s`\n", result.error.text_len,
-				result.error.text_start);
-			break;
-		case DULCET_PARSE_ERROR_CAUSE_UNEXPECTED_TOKEN:
-			fprintf(stderr, "unexpected `%.*s`\n", result.error.text_len,
-				result.error.text_start);
-			break;
-		case DULCET_PARSE_ERROR_CAUSE_UNBOUND_VARIABLE:
-			fprintf(stderr, "unbound variable `%.*s`\n", result.error.text_len,
-				result.error.text_start);
-			break;
+		int stopped = response_stopped(response.status);
+
+		if (stopped >= 0) {
+			fprintf(output_fp, "%s\n", response.text);
+			print_stopped(program_name, stopped, response.steps, NULL);
+		} else {
+			fprintf(stderr, "%s: fatal error: %s\n", program_name, response.text);
 		}
+
+		fclose(output_fp);
+		free(response.text);
+		free(input);
+		dulcet_session_deinit(&session);
+
+		return stopped >= 0 ? status_exit_code(stopped) : 1;
+	}
+
+	if (profile_file_path) {
+		profile.source = input_file_path ? input_file_path : "<stdin>";
+		profile.line_offset = 0;
+	}
+
+	struct dulcet_parse_result result = notation == DULCETI_NOTATION_CLASSIC
+						    ? dulcet_session_parse(&session, input, input_len)
+						    : dulcet_parse_de_bruijn(input, input_len);
+
+	if (result.kind == DULCET_PARSE_ERROR) {
+		print_parse_error(input_file_path, result.error, 0);
 		return 1;
 	}
 
 	struct dulcet_term *input_term = result.value;
+	enum dulcet_status status = DULCET_STATUS_OK;
+
+	if (perf) {
+		dulcet_perf_read(&perf_counters, &perf_samples[PERF_PHASE_REDUCE]);
+	}
+
+	if (trace_file_path) {
+		unsigned long long phase_end = dulceti_trace_now();
+		dulceti_trace_phase(&trace, "parse", phase_start, phase_end);
+		phase_start = phase_end;
+
+		dulcet_set_step_hook(dulceti_trace_step, &trace);
+	}
+
+	if (input_term && stream) {
+		// A reader that closes the pipe makes the writes fail instead of killing the process,
+		// which then stops reducing what nobody is going to read
+		struct sigaction action = { .sa_handler = SIG_IGN };
+		sigemptyset(&action.sa_mask);
+		sigaction(SIGPIPE, &action, NULL);
+
+		int written = notation == DULCETI_NOTATION_CLASSIC
+				      ? dulcet_term_stream_classic(input_term, output_fp)
+				      : dulcet_term_stream_de_bruijn(input_term, output_fp);
+		status = dulcet_status();
+
+		if (written < 0) {
+			if (errno != EPIPE) {
+				fprintf(stderr, "%s: fatal error: could not write the output: %s\n",
+					program_name, strerror(errno));
+			}
+
+			dulcet_term_free(input_term);
+			free(input);
+			dulcet_session_deinit(&session);
+
+			return 1;
+		}
+	} else if (input_term) {
+		status = reduce(input_term, strategy);
 
-	dulcet_beta_nor(input_term);
+		if (perf) {
+			dulcet_perf_read(&perf_counters, &perf_samples[PERF_PHASE_PRINT]);
+		}
+
+		if (trace_file_path) {
+			dulcet_set_step_hook(NULL, NULL);
+
+			unsigned long long phase_end = dulceti_trace_now();
+			dulceti_trace_phase(&trace, "reduce", phase_start, phase_end);
+			phase_start = phase_end;
+		}
 
-	dulcet_term_fprint_classic(input_term, output_fp);
+		print_term(input_term, notation, decode, share, output_fp);
+	}
 	fprintf(output_fp, "\n");
 
-        fclose(output_fp);
+	if (perf) {
+		if (!input_term) {
+			perf_samples[PERF_PHASE_PRINT] = perf_samples[PERF_PHASE_REDUCE];
+		}
+		dulcet_perf_read(&perf_counters, &perf_samples[PERF_PHASE_COUNT]);
+
+		print_perf(&perf_counters, perf_samples, strategy, dulcet_steps_taken());
+		dulcet_perf_close(&perf_counters);
+	}
+
+	if (trace_file_path) {
+		dulcet_set_step_hook(NULL, NULL);
+		dulceti_trace_phase(&trace, "print", phase_start, dulceti_trace_now());
+
+		if (dulceti_trace_close(&trace) < 0) {
+			fprintf(stderr, "%s: fatal error: could not write file `%s`\n",
+				program_name, trace_file_path);
+			return 1;
+		}
+	}
+
+	print_stopped(program_name, status, dulcet_steps_taken(), input_term);
+
+        rc = fclose(output_fp);
         if (rc != 0) {
                 perror("fclose");
                 return 1;
         }
 
-	dulcet_term_free(input_term);
+	if (input_term) {
+		dulcet_term_free(input_term);
+	}
+	free(input);
 
-	return 0;
+	if (stats) {
+		print_stats(program_name);
+	}
+
+	dulcet_session_deinit(&session);
+
+	if (profile_file_path) {
+		if (write_profile(profile_file_path, &profile, profile_folded) < 0) {
+			fprintf(stderr, "%s: fatal error: could not write file `%s`\n", program_name,
+				profile_file_path);
+			return 1;
+		}
+
+		dulcet_set_profile(NULL);
+		dulcet_profile_deinit(&profile);
+	}
+
+	return status_exit_code(status);
+}
+
+struct run_args {
+	int argc;
+	char **argv;
+	sigset_t signals;
+	int rc;
+};
+
+static void *run_thread(void *arg)
+{
+	struct run_args *args = arg;
+
+	pthread_sigmask(SIG_SETMASK, &args->signals, NULL);
+	args->rc = run(args->argc, args->argv);
+
+	return NULL;
+}
+
+// Everything runs on a thread with a stack as large as those of the workers of the server, so that
+// the reducers get as deep into a term as they do there. The main thread only waits for it, with
+// every signal blocked, so that they are all delivered to the thread that handles them.
+int main(int argc, char **argv)
+{
+	struct run_args args = { .argc = argc, .argv = argv };
+
+	sigset_t signals;
+	sigfillset(&signals);
+	pthread_sigmask(SIG_SETMASK, &signals, &args.signals);
+
+	pthread_attr_t attr;
+	int attr_ok = pthread_attr_init(&attr) == 0;
+	if (attr_ok) {
+		pthread_attr_setstacksize(&attr, DULCETI_STACK_SIZE);
+	}
+
+	pthread_t thread;
+	int started = pthread_create(&thread, attr_ok ? &attr : NULL, run_thread, &args) == 0;
+
+	if (attr_ok) {
+		pthread_attr_destroy(&attr);
+	}
+
+	if (!started) {
+		pthread_sigmask(SIG_SETMASK, &args.signals, NULL);
+		return run(argc, argv);
+	}
+
+	pthread_join(thread, NULL);
+
+	return args.rc;
 }
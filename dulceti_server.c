@@ -0,0 +1,690 @@
+/*
+ * Copyright (c) 2022 Leonardo Duarte
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include "dulceti_server.h"
+
+#include "dulcet.h"
+#include "dulcet_parser.h"
+#include "dulcet_session.h"
+
+static void put_u32(unsigned char *buf, uint32_t value)
+{
+	for (int i = 3; i >= 0; --i) {
+		buf[i] = value & 0xff;
+		value >>= 8;
+	}
+}
+
+static void put_u64(unsigned char *buf, uint64_t value)
+{
+	for (int i = 7; i >= 0; --i) {
+		buf[i] = value & 0xff;
+		value >>= 8;
+	}
+}
+
+static uint32_t get_u32(const unsigned char *buf)
+{
+	uint32_t value = 0;
+	for (int i = 0; i < 4; ++i) {
+		value = (value << 8) | buf[i];
+	}
+	return value;
+}
+
+static uint64_t get_u64(const unsigned char *buf)
+{
+	uint64_t value = 0;
+	for (int i = 0; i < 8; ++i) {
+		value = (value << 8) | buf[i];
+	}
+	return value;
+}
+
+static int read_full(int fd, void *buf, size_t size)
+{
+	size_t done = 0;
+
+	while (done < size) {
+		ssize_t rc = read(fd, (char *) buf + done, size - done);
+		if (rc < 0 && errno == EINTR) {
+			continue;
+		}
+		if (rc <= 0) {
+			return -1;
+		}
+		done += rc;
+	}
+
+	return 0;
+}
+
+static int write_full(int fd, const void *buf, size_t size)
+{
+	size_t done = 0;
+
+	while (done < size) {
+		ssize_t rc = write(fd, (const char *) buf + done, size - done);
+		if (rc < 0 && errno == EINTR) {
+			continue;
+		}
+		if (rc <= 0) {
+			return -1;
+		}
+		done += rc;
+	}
+
+	return 0;
+}
+
+// Reads a whole frame, without its length, into a buffer owned by the caller. A frame that is too
+// large, or that there is no memory for, is left unread, with why stored in `*error`.
+static unsigned char *read_frame(int fd, uint32_t *size, const char **error)
+{
+	*error = NULL;
+
+	unsigned char length[4];
+	if (read_full(fd, length, sizeof(length)) < 0) {
+		return NULL;
+	}
+
+	*size = get_u32(length);
+	if (*size > DULCETI_MAX_FRAME_SIZE) {
+		*error = "frame is too large";
+		return NULL;
+	}
+
+	unsigned char *frame = malloc(*size + 1);
+	if (!frame) {
+		*error = "out of memory";
+		return NULL;
+	}
+
+	if (read_full(fd, frame, *size) < 0) {
+		free(frame);
+		return NULL;
+	}
+
+	return frame;
+}
+
+static uint64_t elapsed_ns(const struct timespec *start, const struct timespec *end)
+{
+	return (uint64_t) (end->tv_sec - start->tv_sec) * 1000000000u +
+	       (end->tv_nsec - start->tv_nsec);
+}
+
+static void response_header(const struct dulceti_response *response, unsigned char *frame,
+			    size_t frame_size)
+{
+	put_u32(frame, frame_size - 4);
+	frame[4] = response->status;
+	frame[5] = frame[6] = frame[7] = 0;
+	put_u64(frame + 8, response->steps);
+	put_u64(frame + 16, response->parse_ns);
+	put_u64(frame + 24, response->reduce_ns);
+	put_u64(frame + 32, response->print_ns);
+}
+
+// Builds a response frame around a result text of `text_len` bytes, which is left for the caller
+// to fill in after the header. Returns NULL if there is no memory for it.
+static unsigned char *response_begin(const struct dulceti_response *response, size_t text_len,
+				     size_t *frame_size)
+{
+	*frame_size = 4 + DULCETI_RESPONSE_HEADER_SIZE + text_len;
+
+	unsigned char *frame = malloc(*frame_size + 1);
+	if (frame) {
+		response_header(response, frame, *frame_size);
+	}
+
+	return frame;
+}
+
+static unsigned char *response_message(enum dulceti_status status, const char *message,
+				       size_t *frame_size)
+{
+	struct dulceti_response response = { .status = status };
+	size_t message_len = strlen(message);
+
+	unsigned char *frame = response_begin(&response, message_len, frame_size);
+	if (frame) {
+		memcpy(frame + 4 + DULCETI_RESPONSE_HEADER_SIZE, message, message_len);
+	}
+
+	return frame;
+}
+
+// Answers a request there was no memory to handle, or to answer otherwise
+static int write_out_of_memory(int fd)
+{
+	static const char message[] = "out of memory";
+	struct dulceti_response response = { .status = DULCETI_STATUS_BAD_REQUEST };
+	unsigned char frame[4 + DULCETI_RESPONSE_HEADER_SIZE + sizeof(message) - 1];
+
+	response_header(&response, frame, sizeof(frame));
+	memcpy(frame + 4 + DULCETI_RESPONSE_HEADER_SIZE, message, sizeof(message) - 1);
+
+	return write_full(fd, frame, sizeof(frame));
+}
+
+static unsigned char *response_parse_error(struct dulcet_parse_error error, size_t *frame_size)
+{
+	char message[256];
+
+	switch (error.cause) {
+	case DULCET_PARSE_ERROR_CAUSE_UNMATCHED_PAREN:
+		snprintf(message, sizeof(message), "%u:%u: unmatched `%.*s`", error.line,
+			 error.column, error.text_len, error.text_start);
+		break;
+	case DULCET_PARSE_ERROR_CAUSE_UNEXPECTED_TOKEN:
+		if (error.text_len == 0) {
+			snprintf(message, sizeof(message), "%u:%u: unexpected end of input",
+				 error.line, error.column);
+		} else {
+			snprintf(message, sizeof(message), "%u:%u: unexpected `%.*s`", error.line,
+				 error.column, error.text_len, error.text_start);
+		}
+		break;
+	case DULCET_PARSE_ERROR_CAUSE_UNBOUND_VARIABLE:
+		snprintf(message, sizeof(message), "%u:%u: unbound variable `%.*s`", error.line,
+			 error.column, error.text_len, error.text_start);
+		break;
+	case DULCET_PARSE_ERROR_CAUSE_UNKNOWN:
+	default:
+		snprintf(message, sizeof(message), "%u:%u: unexpected error", error.line,
+			 error.column);
+		break;
+	}
+
+	return response_message(DULCETI_STATUS_PARSE_ERROR, message, frame_size);
+}
+
+static enum dulceti_status response_status(enum dulcet_status status)
+{
+	switch (status) {
+	case DULCET_STATUS_OK:
+		return DULCETI_STATUS_OK;
+	case DULCET_STATUS_STEP_LIMIT:
+		return DULCETI_STATUS_STEP_LIMIT;
+	case DULCET_STATUS_MEMORY_LIMIT:
+		return DULCETI_STATUS_MEMORY_LIMIT;
+	case DULCET_STATUS_DEADLINE:
+		return DULCETI_STATUS_DEADLINE;
+	case DULCET_STATUS_INTERRUPTED:
+		return DULCETI_STATUS_INTERRUPTED;
+	case DULCET_STATUS_DIVERGED:
+		return DULCETI_STATUS_DIVERGED;
+	case DULCET_STATUS_DEPTH_LIMIT:
+		return DULCETI_STATUS_DEPTH_LIMIT;
+	}
+
+	return DULCETI_STATUS_OK;
+}
+
+// Returns NULL if there is no memory for the response
+static unsigned char *handle_request(const struct dulcet_session *session, unsigned char *frame,
+				     uint32_t size, size_t *response_size)
+{
+	if (size < DULCETI_REQUEST_HEADER_SIZE || frame[0] != DULCETI_PROTOCOL_VERSION ||
+	    frame[1] > DULCETI_NOTATION_DE_BRUIJN || frame[2] > DULCETI_STRATEGY_PORTFOLIO ||
+	    frame[3] != 0) {
+		return response_message(DULCETI_STATUS_BAD_REQUEST, "malformed request header",
+					response_size);
+	}
+
+	enum dulceti_notation notation = frame[1];
+	enum dulceti_strategy strategy = frame[2];
+	uint64_t step_limit = get_u64(frame + 4);
+
+	const char *text = (const char *) frame + DULCETI_REQUEST_HEADER_SIZE;
+	unsigned int text_len = size - DULCETI_REQUEST_HEADER_SIZE;
+
+	struct dulceti_response response = { .status = DULCETI_STATUS_OK };
+	struct timespec start, end;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	struct dulcet_parse_result result = notation == DULCETI_NOTATION_CLASSIC
+						    ? dulcet_session_parse(session, text, text_len)
+						    : dulcet_parse_de_bruijn(text, text_len);
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	response.parse_ns = elapsed_ns(&start, &end);
+
+	if (result.kind == DULCET_PARSE_ERROR) {
+		return response_parse_error(result.error, response_size);
+	}
+
+	struct dulcet_term *t = result.value;
+	if (!t) {
+		return response_begin(&response, 0, response_size);
+	}
+
+	struct dulcet_limits limits = {
+		.steps = step_limit == 0 || step_limit >= DULCET_UNLIMITED_STEPS
+				 ? DULCET_UNLIMITED_STEPS
+				 : step_limit,
+		.depth = DULCETI_DEPTH_LIMIT,
+	};
+	dulcet_set_limits(&limits);
+
+	start = end;
+
+	enum dulcet_status status = DULCET_STATUS_OK;
+	switch (strategy) {
+	case DULCETI_STRATEGY_NOR:
+		status = dulcet_beta_nor(t);
+		break;
+	case DULCETI_STRATEGY_CBN:
+		status = dulcet_beta_cbn(t);
+		break;
+	case DULCETI_STRATEGY_APP:
+		status = dulcet_beta_app(t);
+		break;
+	case DULCETI_STRATEGY_PORTFOLIO:
+		status = dulcet_beta_portfolio(t);
+		break;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	response.reduce_ns = elapsed_ns(&start, &end);
+
+	response.steps = dulcet_steps_taken();
+	response.status = response_status(status);
+
+	dulcet_set_step_limit(DULCET_UNLIMITED_STEPS);
+
+	start = end;
+
+	// The output is measured first so that the response is allocated exactly once
+	int len = notation == DULCETI_NOTATION_CLASSIC ? dulcet_term_len_classic(t)
+						       : dulcet_term_len_de_bruijn(t);
+	if (len < 0 || (size_t) len > DULCETI_MAX_FRAME_SIZE - DULCETI_RESPONSE_HEADER_SIZE) {
+		dulcet_term_free(t);
+		return response_message(DULCETI_STATUS_BAD_REQUEST, "result is too large",
+					response_size);
+	}
+
+	unsigned char *response_frame = response_begin(&response, len, response_size);
+	if (!response_frame) {
+		dulcet_term_free(t);
+		return NULL;
+	}
+
+	char *out = (char *) response_frame + 4 + DULCETI_RESPONSE_HEADER_SIZE;
+
+	if (notation == DULCETI_NOTATION_CLASSIC) {
+		dulcet_term_snprint_classic(t, out, len + 1);
+	} else {
+		dulcet_term_snprint_de_bruijn(t, out, len + 1);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	response.print_ns = elapsed_ns(&start, &end);
+	put_u64(response_frame + 32, response.print_ns);
+
+	dulcet_term_free(t);
+
+	return response_frame;
+}
+
+struct connection_queue {
+	int *fds;
+	size_t capacity;
+	size_t head;
+	size_t size;
+	int closed;
+
+	mtx_t lock;
+	cnd_t not_empty;
+	cnd_t not_full;
+};
+
+struct server {
+	const struct dulcet_session *session;
+	struct connection_queue queue;
+};
+
+static void connection_queue_push(struct connection_queue *queue, int fd)
+{
+	mtx_lock(&queue->lock);
+
+	while (queue->size == queue->capacity) {
+		cnd_wait(&queue->not_full, &queue->lock);
+	}
+
+	queue->fds[(queue->head + queue->size) % queue->capacity] = fd;
+	queue->size += 1;
+
+	cnd_signal(&queue->not_empty);
+	mtx_unlock(&queue->lock);
+}
+
+// Returns -1 once the queue is closed and drained
+static int connection_queue_pop(struct connection_queue *queue)
+{
+	mtx_lock(&queue->lock);
+
+	while (queue->size == 0 && !queue->closed) {
+		cnd_wait(&queue->not_empty, &queue->lock);
+	}
+
+	int fd = -1;
+	if (queue->size > 0) {
+		fd = queue->fds[queue->head];
+		queue->head = (queue->head + 1) % queue->capacity;
+		queue->size -= 1;
+
+		cnd_signal(&queue->not_full);
+	}
+
+	mtx_unlock(&queue->lock);
+
+	return fd;
+}
+
+static void connection_queue_close(struct connection_queue *queue)
+{
+	mtx_lock(&queue->lock);
+	queue->closed = 1;
+	cnd_broadcast(&queue->not_empty);
+	mtx_unlock(&queue->lock);
+}
+
+static void *worker_run(void *arg)
+{
+	struct server *server = arg;
+	int fd;
+
+	while ((fd = connection_queue_pop(&server->queue)) >= 0) {
+		for (;;) {
+			uint32_t size = 0;
+			const char *error;
+			unsigned char *frame = read_frame(fd, &size, &error);
+			if (!frame) {
+				// The frame is left unread, so the connection cannot go on
+				if (size > DULCETI_MAX_FRAME_SIZE) {
+					size_t response_size;
+					unsigned char *response = response_message(
+						DULCETI_STATUS_BAD_REQUEST, "request is too large",
+						&response_size);
+					if (response) {
+						write_full(fd, response, response_size);
+						free(response);
+					} else {
+						write_out_of_memory(fd);
+					}
+				} else if (error) {
+					write_out_of_memory(fd);
+				}
+				break;
+			}
+
+			size_t response_size;
+			unsigned char *response =
+				handle_request(server->session, frame, size, &response_size);
+			free(frame);
+
+			int rc;
+			if (response) {
+				rc = write_full(fd, response, response_size);
+				free(response);
+			} else {
+				rc = write_out_of_memory(fd);
+			}
+
+			if (rc < 0) {
+				break;
+			}
+		}
+
+		close(fd);
+	}
+
+	return NULL;
+}
+
+static volatile sig_atomic_t stop_requested = 0;
+
+static void request_stop(int signal)
+{
+	(void) signal;
+	stop_requested = 1;
+}
+
+static int open_socket(const char *socket_path, struct sockaddr_un *addr)
+{
+	if (strlen(socket_path) >= sizeof(addr->sun_path)) {
+		fprintf(stderr, "dulceti: fatal error: socket path `%s` is too long\n", socket_path);
+		return -1;
+	}
+
+	memset(addr, 0, sizeof(*addr));
+	addr->sun_family = AF_UNIX;
+	strcpy(addr->sun_path, socket_path);
+
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0) {
+		perror("socket");
+	}
+
+	return fd;
+}
+
+int dulceti_serve(const char *socket_path, unsigned int workers,
+		  const struct dulcet_session *session)
+{
+	struct sockaddr_un addr;
+	int listen_fd = open_socket(socket_path, &addr);
+	if (listen_fd < 0) {
+		return 1;
+	}
+
+	// Replace the socket left behind by a previous server, but nothing else
+	struct stat st;
+	if (lstat(socket_path, &st) == 0 && S_ISSOCK(st.st_mode)) {
+		unlink(socket_path);
+	}
+
+	if (bind(listen_fd, (struct sockaddr *) &addr, sizeof(addr)) < 0 ||
+	    listen(listen_fd, SOMAXCONN) < 0) {
+		fprintf(stderr, "dulceti: fatal error: could not listen on `%s`: %s\n", socket_path,
+			strerror(errno));
+		close(listen_fd);
+		return 1;
+	}
+
+	int *fds = malloc(4 * workers * sizeof(int));
+	pthread_t *threads = malloc(workers * sizeof(pthread_t));
+	if (!fds || !threads) {
+		fprintf(stderr, "dulceti: fatal error: out of memory\n");
+		free(threads);
+		free(fds);
+		close(listen_fd);
+		unlink(socket_path);
+		return 1;
+	}
+
+	struct server server = {
+		.session = session,
+		.queue = {
+			.fds = fds,
+			.capacity = 4 * workers,
+			.head = 0,
+			.size = 0,
+			.closed = 0,
+		},
+	};
+	mtx_init(&server.queue.lock, mtx_plain);
+	cnd_init(&server.queue.not_empty);
+	cnd_init(&server.queue.not_full);
+
+	signal(SIGPIPE, SIG_IGN);
+
+	// Only the accepting thread handles termination signals, so that they interrupt `accept`
+	sigset_t signals, old_signals;
+	sigemptyset(&signals);
+	sigaddset(&signals, SIGINT);
+	sigaddset(&signals, SIGTERM);
+	pthread_sigmask(SIG_BLOCK, &signals, &old_signals);
+
+	pthread_attr_t attr;
+	int attr_ok = pthread_attr_init(&attr) == 0;
+	if (attr_ok) {
+		pthread_attr_setstacksize(&attr, DULCETI_STACK_SIZE);
+	}
+
+	unsigned int started = 0;
+	while (started < workers &&
+	       pthread_create(&threads[started], attr_ok ? &attr : NULL, worker_run, &server) == 0) {
+		started += 1;
+	}
+
+	if (attr_ok) {
+		pthread_attr_destroy(&attr);
+	}
+
+	stop_requested = 0;
+
+	struct sigaction action = { 0 };
+	action.sa_handler = request_stop;
+	sigemptyset(&action.sa_mask);
+	sigaction(SIGINT, &action, NULL);
+	sigaction(SIGTERM, &action, NULL);
+
+	pthread_sigmask(SIG_SETMASK, &old_signals, NULL);
+
+	int rc = 0;
+
+	if (started == 0) {
+		fprintf(stderr, "dulceti: fatal error: could not start the workers\n");
+		rc = 1;
+	}
+
+	while (rc == 0 && !stop_requested) {
+		int fd = accept(listen_fd, NULL, NULL);
+		if (fd < 0) {
+			if (errno == EINTR || errno == ECONNABORTED) {
+				continue;
+			}
+
+			perror("accept");
+			rc = 1;
+			break;
+		}
+
+		connection_queue_push(&server.queue, fd);
+	}
+
+	close(listen_fd);
+	unlink(socket_path);
+
+	connection_queue_close(&server.queue);
+	for (unsigned int i = 0; i < started; ++i) {
+		pthread_join(threads[i], NULL);
+	}
+
+	free(threads);
+	free(server.queue.fds);
+	cnd_destroy(&server.queue.not_full);
+	cnd_destroy(&server.queue.not_empty);
+	mtx_destroy(&server.queue.lock);
+
+	return rc;
+}
+
+int dulceti_request(const char *socket_path, const struct dulceti_request *request,
+		    struct dulceti_response *response)
+{
+	struct sockaddr_un addr;
+	int fd = open_socket(socket_path, &addr);
+	if (fd < 0) {
+		return -1;
+	}
+
+	if (connect(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+		fprintf(stderr, "dulceti: fatal error: could not connect to `%s`: %s\n", socket_path,
+			strerror(errno));
+		close(fd);
+		return -1;
+	}
+
+	if (request->text_len > DULCETI_MAX_FRAME_SIZE - DULCETI_REQUEST_HEADER_SIZE) {
+		fprintf(stderr, "dulceti: fatal error: term is too large\n");
+		close(fd);
+		return -1;
+	}
+
+	size_t frame_size = 4 + DULCETI_REQUEST_HEADER_SIZE + request->text_len;
+	unsigned char *frame = malloc(frame_size);
+	if (!frame) {
+		fprintf(stderr, "dulceti: fatal error: out of memory\n");
+		close(fd);
+		return -1;
+	}
+
+	put_u32(frame, frame_size - 4);
+	frame[4] = DULCETI_PROTOCOL_VERSION;
+	frame[5] = request->notation;
+	frame[6] = request->strategy;
+	frame[7] = 0;
+	put_u64(frame + 8, request->step_limit);
+	memcpy(frame + 4 + DULCETI_REQUEST_HEADER_SIZE, request->text, request->text_len);
+
+	int rc = write_full(fd, frame, frame_size);
+	free(frame);
+
+	uint32_t size;
+	const char *error = NULL;
+	unsigned char *answer = rc < 0 ? NULL : read_frame(fd, &size, &error);
+	close(fd);
+
+	if (error) {
+		fprintf(stderr, "dulceti: fatal error: could not read the response from `%s`: %s\n",
+			socket_path, error);
+		return -1;
+	}
+
+	if (!answer || size < DULCETI_RESPONSE_HEADER_SIZE) {
+		fprintf(stderr, "dulceti: fatal error: no response from `%s`\n", socket_path);
+		free(answer);
+		return -1;
+	}
+
+	*response = (struct dulceti_response) {
+		.status = answer[0],
+		.steps = get_u64(answer + 4),
+		.parse_ns = get_u64(answer + 12),
+		.reduce_ns = get_u64(answer + 20),
+		.print_ns = get_u64(answer + 28),
+		.text_len = size - DULCETI_RESPONSE_HEADER_SIZE,
+	};
+
+	// The text is moved to the start of the frame, which the caller then owns
+	memmove(answer, answer + DULCETI_RESPONSE_HEADER_SIZE, response->text_len);
+	answer[response->text_len] = '\0';
+	response->text = (char *) answer;
+
+	return 0;
+}
@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2022 Leonardo Duarte
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef _DULCETI_SERVER_H
+#define _DULCETI_SERVER_H
+
+#include <stdint.h>
+
+#include "dulcet_session.h"
+
+/*
+ * Protocol spoken over the Unix domain socket of `dulceti --serve`. A client may send any number of
+ * requests over a single connection, each of which is answered in order with a response. Both are
+ * framed by a 4 byte length of the rest of the frame, and every integer is unsigned and big endian.
+ *
+ * Request:
+ *   u32 length
+ *   u8  version, which must be DULCETI_PROTOCOL_VERSION
+ *   u8  notation of both the term and the result (enum dulceti_notation)
+ *   u8  strategy (enum dulceti_strategy)
+ *   u8  reserved, must be zero
+ *   u64 step limit, where zero means unlimited
+ *   ... term text, up to the end of the frame
+ *
+ * Response:
+ *   u32 length
+ *   u8  status (enum dulceti_status)
+ *   u8  reserved (3 bytes)
+ *   u64 beta reduction steps taken
+ *   u64 parse time in nanoseconds
+ *   u64 reduction time in nanoseconds
+ *   u64 print time in nanoseconds
+ *   ... result text, which is the (possibly partially reduced) term or an error message
+ *
+ * A frame longer than DULCETI_MAX_FRAME_SIZE is answered with DULCETI_STATUS_BAD_REQUEST, after
+ * which the server closes the connection, as it cannot tell where the next frame starts. So is a
+ * frame the server has no memory to read, with the message "out of memory", which also answers
+ * a request whose response it has no memory for, though the connection then goes on.
+ */
+
+#define DULCETI_PROTOCOL_VERSION 1
+
+#define DULCETI_REQUEST_HEADER_SIZE 12
+#define DULCETI_RESPONSE_HEADER_SIZE 36
+
+#define DULCETI_MAX_FRAME_SIZE (64u * 1024 * 1024)
+
+// Terms are reduced on threads with stacks large enough for the recursion of the reducers on deep
+// terms, of which only what is used is ever touched, and are stopped well before their end
+#define DULCETI_STACK_SIZE ((size_t) 512 << 20)
+#define DULCETI_DEPTH_LIMIT (1u << 20)
+
+enum dulceti_notation {
+	DULCETI_NOTATION_CLASSIC,
+	DULCETI_NOTATION_DE_BRUIJN,
+};
+
+enum dulceti_strategy {
+	DULCETI_STRATEGY_NOR,
+	DULCETI_STRATEGY_CBN,
+	DULCETI_STRATEGY_APP,
+	DULCETI_STRATEGY_PORTFOLIO,
+};
+
+// Besides errors, a response tells why the reduction stopped early, if it did, as the
+// `dulcet_status` of the same name, in which case its text is the partially reduced term
+enum dulceti_status {
+	DULCETI_STATUS_OK,
+	DULCETI_STATUS_STEP_LIMIT,
+	DULCETI_STATUS_PARSE_ERROR,
+	DULCETI_STATUS_BAD_REQUEST,
+	DULCETI_STATUS_DEPTH_LIMIT,
+	DULCETI_STATUS_MEMORY_LIMIT,
+	DULCETI_STATUS_DEADLINE,
+	DULCETI_STATUS_INTERRUPTED,
+	DULCETI_STATUS_DIVERGED,
+};
+
+struct dulceti_request {
+	enum dulceti_notation notation;
+	enum dulceti_strategy strategy;
+	uint64_t step_limit;
+	const char *text;
+	uint32_t text_len;
+};
+
+struct dulceti_response {
+	enum dulceti_status status;
+	uint64_t steps;
+	uint64_t parse_ns;
+	uint64_t reduce_ns;
+	uint64_t print_ns;
+	char *text;
+	uint32_t text_len;
+};
+
+// Listens on `socket_path` until interrupted by SIGINT or SIGTERM, evaluating requests with
+// `workers` threads. Definitions in `session` are available to every request in classic
+// notation, and must not change while serving.
+int dulceti_serve(const char *socket_path, unsigned int workers,
+		  const struct dulcet_session *session);
+
+// Sends a single request to the server at `socket_path`, storing its answer in `response`, whose
+// text is then owned by the caller.
+int dulceti_request(const char *socket_path, const struct dulceti_request *request,
+		    struct dulceti_response *response);
+
+#endif // _DULCETI_SERVER_H
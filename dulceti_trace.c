@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2022 Leonardo Duarte
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <time.h>
+
+#include "dulceti_trace.h"
+
+// Every event of the trace belongs to the same process and thread
+#define TRACE_IDS "\"pid\":1,\"tid\":1"
+
+unsigned long long dulceti_trace_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (unsigned long long) ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+// Timestamps of the format are in microseconds since the start of the trace
+static double trace_us(const struct dulceti_trace *trace, unsigned long long ns)
+{
+	return (ns - trace->origin_ns) / 1e3;
+}
+
+int dulceti_trace_open(struct dulceti_trace *trace, const char *path, unsigned long every)
+{
+	FILE *fp = fopen(path, "w");
+	if (!fp) {
+		return -1;
+	}
+
+	*trace = (struct dulceti_trace) {
+		.fp = fp,
+		.every = every > 0 ? every : 1,
+		.peak_term_size = 0,
+		.origin_ns = dulceti_trace_now(),
+	};
+
+	// The metadata event goes first so that every later event can be preceded by a comma
+	fprintf(fp, "{\"traceEvents\":[\n");
+	fprintf(fp, "{\"name\":\"process_name\",\"ph\":\"M\"," TRACE_IDS
+		    ",\"args\":{\"name\":\"dulceti\"}}");
+
+	return 0;
+}
+
+int dulceti_trace_close(struct dulceti_trace *trace)
+{
+	fprintf(trace->fp, "\n],\"displayTimeUnit\":\"ms\"}\n");
+
+	int failed = ferror(trace->fp);
+
+	if (fclose(trace->fp) != 0 || failed) {
+		return -1;
+	}
+
+	return 0;
+}
+
+void dulceti_trace_phase(struct dulceti_trace *trace, const char *name,
+			 unsigned long long start_ns, unsigned long long end_ns)
+{
+	fprintf(trace->fp,
+		",\n{\"name\":\"%s\",\"cat\":\"phase\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f," TRACE_IDS
+		"}",
+		name, trace_us(trace, start_ns), (end_ns - start_ns) / 1e3);
+}
+
+void dulceti_trace_step(const struct dulcet_step_event *event, void *data)
+{
+	struct dulceti_trace *trace = data;
+
+	int peak = event->term_size > trace->peak_term_size;
+	if (peak) {
+		trace->peak_term_size = event->term_size;
+	} else if (event->step % trace->every != 0) {
+		return;
+	}
+
+	double ts = trace_us(trace, dulceti_trace_now());
+
+	fprintf(trace->fp,
+		",\n{\"name\":\"beta\",\"cat\":\"step\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f," TRACE_IDS
+		",\"args\":{\"step\":%llu,\"depth\":%u,\"body\":%zu,\"argument\":%zu,\"result\":%zu}}",
+		ts, event->step, event->depth, event->body_size, event->argument_size,
+		event->result_size);
+	fprintf(trace->fp,
+		",\n{\"name\":\"term size\",\"cat\":\"step\",\"ph\":\"C\",\"ts\":%.3f," TRACE_IDS
+		",\"args\":{\"nodes\":%zu}}",
+		ts, event->term_size);
+}
@@ -0,0 +1,41 @@
+/*
+ * Copyright (c) 2022 Leonardo Duarte
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef _DULCETI_TRACE_H
+#define _DULCETI_TRACE_H
+
+#include <stdio.h>
+
+#include "dulcet.h"
+
+/*
+ * Trace of a run of `dulceti --trace`, written in the Chrome trace event JSON format, which both
+ * chrome://tracing and Perfetto open. The phases of the run are complete ("X") events, and each
+ * sampled beta reduction step is an instant ("i") event with the sizes of its redex, next to a
+ * counter ("C") event with the size of the whole term, so that blowups show up as steps in the
+ * counter track. A step is sampled if it is one of every `every` steps, or if it makes the term
+ * larger than it has ever been.
+ */
+struct dulceti_trace {
+	FILE *fp;
+	unsigned long every;
+	size_t peak_term_size;
+	unsigned long long origin_ns;
+};
+
+int dulceti_trace_open(struct dulceti_trace *trace, const char *path, unsigned long every);
+int dulceti_trace_close(struct dulceti_trace *trace);
+
+// Monotonic time in nanoseconds, to measure phases with.
+unsigned long long dulceti_trace_now(void);
+
+void dulceti_trace_phase(struct dulceti_trace *trace, const char *name,
+			 unsigned long long start_ns, unsigned long long end_ns);
+
+// Step hook to pass to `dulcet_set_step_hook` along with the trace.
+void dulceti_trace_step(const struct dulcet_step_event *event, void *data);
+
+#endif // _DULCETI_TRACE_H
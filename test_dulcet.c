@@ -4,16 +4,27 @@
  * SPDX-License-Identifier: BSD-2-Clause
  */
 
+#define _POSIX_C_SOURCE 200809L
+
+#include <fcntl.h>
+#include <setjmp.h>
+#include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 #define ZIDANE_IMPLEMENTATION
 #include "zidane.h"
 
 #include "dulcet.h"
 
+#define ARRAY_SIZE(xs) (sizeof(xs) / sizeof(*(xs)))
+
 #define VAR(x) dulcet_alloc_var(x)
 #define ABS(m) dulcet_alloc_abs(m)
 #define APP(m, n) dulcet_alloc_app(m, n)
+#define INT(value) dulcet_alloc_int(value)
+#define PRIM(op) dulcet_alloc_prim(DULCET_PRIM_OP_##op)
 
 ZIDANE_TEST(sanity)
 {
@@ -33,6 +44,97 @@ ZIDANE_TEST(term_eq)
 	dulcet_term_free(x);
 }
 
+// A variable held by a node rather than an immediate, as those of the largest indices are where
+// pointers are too narrow: `(\x.x) y` reduced in place leaves its root a node of kind variable
+static struct dulcet_term *var_node(unsigned int index)
+{
+	struct dulcet_term *t = APP(ABS(VAR(1)), VAR(index));
+
+	dulcet_beta_nor(t);
+
+	return t;
+}
+
+ZIDANE_TEST(var_node_kind_index)
+{
+	struct dulcet_term *node = var_node(5);
+	struct dulcet_term *immediate = VAR(5);
+
+	ZIDANE_VERIFY(!((uintptr_t) node & 1));
+	ZIDANE_VERIFY((uintptr_t) immediate & 1);
+
+	ZIDANE_VERIFY(dulcet_term_kind(node) == DULCET_TERM_KIND_VAR);
+	ZIDANE_VERIFY(dulcet_term_kind(immediate) == DULCET_TERM_KIND_VAR);
+	ZIDANE_VERIFY(dulcet_var_index(node) == 5);
+	ZIDANE_VERIFY(dulcet_var_index(immediate) == 5);
+
+	ZIDANE_VERIFY(dulcet_term_eq(node, immediate));
+	ZIDANE_VERIFY(dulcet_term_eq(immediate, node));
+
+	struct dulcet_term *other = VAR(6);
+	ZIDANE_VERIFY(!dulcet_term_eq(node, other));
+	ZIDANE_VERIFY(!dulcet_term_eq(other, node));
+
+	struct dulcet_term *copy = dulcet_term_copy(node);
+	ZIDANE_VERIFY(dulcet_term_kind(copy) == DULCET_TERM_KIND_VAR);
+	ZIDANE_VERIFY(dulcet_var_index(copy) == 5);
+	ZIDANE_VERIFY(dulcet_term_eq(copy, immediate));
+
+	struct dulcet_term *x = APP(ABS(var_node(1)), var_node(2));
+	struct dulcet_term *y = dulcet_term_copy(x);
+	struct dulcet_term *z = APP(ABS(VAR(1)), VAR(2));
+	ZIDANE_VERIFY(dulcet_term_eq(x, y));
+	ZIDANE_VERIFY(dulcet_term_eq(y, z));
+
+	dulcet_term_free(z);
+	dulcet_term_free(y);
+	dulcet_term_free(x);
+	dulcet_term_free(copy);
+	dulcet_term_free(other);
+	dulcet_term_free(immediate);
+	dulcet_term_free(node);
+}
+
+ZIDANE_TEST(var_node_beta)
+{
+	enum dulcet_status (*reducers[])(struct dulcet_term *) = {
+		dulcet_beta_nor,
+		dulcet_beta_app,
+	};
+
+	for (size_t i = 0; i < ARRAY_SIZE(reducers); ++i) {
+		// Substituted into: `(\x.x 3) 7`, with `x` and the free `3` as nodes, is `7 2`
+		struct dulcet_term *t = APP(ABS(APP(var_node(1), var_node(3))), INT(7));
+		struct dulcet_term *expected = APP(INT(7), VAR(2));
+
+		ZIDANE_VERIFY(reducers[i](t) == DULCET_STATUS_OK);
+		ZIDANE_VERIFY(dulcet_term_eq(t, expected));
+
+		dulcet_term_free(expected);
+		dulcet_term_free(t);
+
+		// Shifted: `(\x.\y.y x) 3`, with `3` as a node, is `\y.y 4`
+		t = APP(ABS(ABS(APP(VAR(1), VAR(2)))), var_node(3));
+		expected = ABS(APP(VAR(1), VAR(4)));
+
+		ZIDANE_VERIFY(reducers[i](t) == DULCET_STATUS_OK);
+		ZIDANE_VERIFY(dulcet_term_eq(t, expected));
+
+		dulcet_term_free(expected);
+		dulcet_term_free(t);
+
+		// Copied: `(\x.\y.x x y) 5`, with `5` as a node, is `\y.6 6 y`
+		t = APP(ABS(ABS(APP(APP(VAR(2), VAR(2)), VAR(1)))), var_node(5));
+		expected = ABS(APP(APP(VAR(6), VAR(6)), VAR(1)));
+
+		ZIDANE_VERIFY(reducers[i](t) == DULCET_STATUS_OK);
+		ZIDANE_VERIFY(dulcet_term_eq(t, expected));
+
+		dulcet_term_free(expected);
+		dulcet_term_free(t);
+	}
+}
+
 ZIDANE_TEST(beta_nor_pred_succ)
 {
 	struct dulcet_term *succ = ABS(ABS(ABS(APP(VAR(2), APP(APP(VAR(3), VAR(2)), VAR(1))))));
@@ -51,6 +153,292 @@ ZIDANE_TEST(beta_nor_pred_succ)
 	dulcet_term_free(actual);
 }
 
+ZIDANE_TEST(beta_nor_shared)
+{
+	// λx.x (λf.λa.f a) ((λy.y) x)
+	struct dulcet_term *two = ABS(ABS(APP(VAR(2), VAR(1))));
+	struct dulcet_term *t = ABS(APP(APP(VAR(1), two), APP(ABS(VAR(1)), VAR(1))));
+	struct dulcet_term *original = dulcet_term_copy(t);
+
+	struct dulcet_term *actual = dulcet_beta_nor_shared(t);
+	ZIDANE_VERIFY(dulcet_status() == DULCET_STATUS_OK);
+
+	struct dulcet_term *expected = dulcet_term_copy(t);
+	dulcet_beta_nor(expected);
+
+	ZIDANE_VERIFY(dulcet_term_eq(t, original));
+	ZIDANE_VERIFY(dulcet_term_eq(actual, expected));
+
+	// Only the nodes on the way to the redex are new, and `x (λf.λa.f a)` is borrowed
+	ZIDANE_VERIFY(actual->abs.m->app.m->kind == DULCET_TERM_KIND_REF);
+	ZIDANE_VERIFY(dulcet_term_size(actual) == 4);
+
+	// Which it no longer does once the result is reduced further
+	struct dulcet_term *id = ABS(VAR(1));
+	actual = APP(actual, dulcet_term_copy(id));
+	expected = APP(expected, dulcet_term_copy(id));
+	dulcet_beta_nor(actual);
+	dulcet_beta_nor(expected);
+
+	dulcet_term_free(t);
+	ZIDANE_VERIFY(dulcet_term_eq(actual, expected));
+	ZIDANE_VERIFY(dulcet_term_eq(actual, id));
+
+	dulcet_term_free(id);
+	dulcet_term_free(expected);
+	dulcet_term_free(actual);
+	dulcet_term_free(original);
+}
+
+ZIDANE_TEST(beta_nor_shared_open)
+{
+	// λx.λy.y (x x) ((λz.z) y), whose result refers to `x x` under the binder of `x`
+	struct dulcet_term *t =
+		ABS(ABS(APP(APP(VAR(1), APP(VAR(2), VAR(2))), APP(ABS(VAR(1)), VAR(1)))));
+
+	struct dulcet_term *actual = APP(dulcet_beta_nor_shared(t), ABS(VAR(1)));
+	dulcet_beta_nor(actual);
+
+	// λy.y (λz.z) y
+	struct dulcet_term *expected = ABS(APP(APP(VAR(1), ABS(VAR(1))), VAR(1)));
+	ZIDANE_VERIFY(dulcet_term_eq(actual, expected));
+
+	dulcet_term_free(expected);
+	dulcet_term_free(actual);
+	dulcet_term_free(t);
+}
+
+ZIDANE_TEST(beta_app_shared_pred_succ)
+{
+	struct dulcet_term *succ = ABS(ABS(ABS(APP(VAR(2), APP(APP(VAR(3), VAR(2)), VAR(1))))));
+	struct dulcet_term *pred = ABS(ABS(
+		ABS(APP(APP(APP(VAR(3), ABS(ABS(APP(VAR(1), APP(VAR(2), VAR(4)))))), ABS(VAR(2))),
+			ABS(VAR(1))))));
+	struct dulcet_term *t = APP(pred, succ);
+
+	struct dulcet_term *actual = dulcet_beta_app_shared(t);
+	struct dulcet_term *expected = ABS(ABS(VAR(1)));
+
+	ZIDANE_VERIFY(dulcet_term_eq(actual, expected));
+	ZIDANE_VERIFY(t->kind == DULCET_TERM_KIND_APP && t->app.m->kind == DULCET_TERM_KIND_ABS);
+
+	dulcet_term_free(expected);
+	dulcet_term_free(actual);
+	dulcet_term_free(t);
+}
+
+ZIDANE_TEST(beta_shared_var)
+{
+	struct dulcet_term *(*reducers[])(const struct dulcet_term *) = {
+		dulcet_beta_cbn_shared,
+		dulcet_beta_nor_shared,
+		dulcet_beta_app_shared,
+	};
+	struct dulcet_term *ts[] = { VAR(1), var_node(2) };
+
+	for (size_t i = 0; i < ARRAY_SIZE(reducers); ++i) {
+		for (size_t j = 0; j < ARRAY_SIZE(ts); ++j) {
+			struct dulcet_term *actual = reducers[i](ts[j]);
+			ZIDANE_VERIFY(dulcet_status() == DULCET_STATUS_OK);
+			ZIDANE_VERIFY(dulcet_term_kind(actual) == DULCET_TERM_KIND_VAR);
+			ZIDANE_VERIFY(dulcet_var_index(actual) == j + 1);
+			dulcet_term_free(actual);
+		}
+	}
+
+	for (size_t j = 0; j < ARRAY_SIZE(ts); ++j) {
+		dulcet_term_free(ts[j]);
+	}
+}
+
+ZIDANE_TEST(beta_delta)
+{
+	// if (< 1 2) (+ 40 2) (/ 1 0), in which the branch that is not taken is stuck
+	struct dulcet_term *t =
+		APP(APP(APP(PRIM(IF), APP(APP(PRIM(LT), INT(1)), INT(2))),
+			APP(APP(PRIM(ADD), INT(40)), INT(2))),
+		    APP(APP(PRIM(DIV), INT(1)), INT(0)));
+	enum dulcet_status (*reducers[])(struct dulcet_term *) = {
+		dulcet_beta_cbn,
+		dulcet_beta_nor,
+		dulcet_beta_app,
+	};
+	struct dulcet_term *expected = INT(42);
+
+	for (size_t i = 0; i < ARRAY_SIZE(reducers); ++i) {
+		struct dulcet_term *actual = dulcet_term_copy(t);
+		ZIDANE_VERIFY(reducers[i](actual) == DULCET_STATUS_OK);
+		ZIDANE_VERIFY(dulcet_term_eq(actual, expected));
+		dulcet_term_free(actual);
+	}
+
+	struct dulcet_term *actual = dulcet_beta_nor_shared(t);
+	ZIDANE_VERIFY(dulcet_term_eq(actual, expected));
+	dulcet_term_free(actual);
+
+	// (λx.- x 1) 5 takes a beta and a delta reduction step, while λx.- x 1 is stuck
+	dulcet_set_step_limit(1);
+	actual = APP(ABS(APP(APP(PRIM(SUB), VAR(1)), INT(1))), INT(5));
+	ZIDANE_VERIFY(dulcet_beta_nor(actual) == DULCET_STATUS_STEP_LIMIT);
+	dulcet_set_step_limit(DULCET_UNLIMITED_STEPS);
+	ZIDANE_VERIFY(dulcet_beta_nor(actual) == DULCET_STATUS_OK);
+	ZIDANE_VERIFY(dulcet_term_kind(actual) == DULCET_TERM_KIND_INT &&
+		      actual->integer.value == 4);
+	dulcet_term_free(actual);
+
+	actual = ABS(APP(APP(PRIM(SUB), VAR(1)), INT(1)));
+	struct dulcet_term *stuck = dulcet_term_copy(actual);
+	ZIDANE_VERIFY(dulcet_beta_nor(actual) == DULCET_STATUS_OK);
+	ZIDANE_VERIFY(dulcet_term_eq(actual, stuck));
+	dulcet_term_free(stuck);
+	dulcet_term_free(actual);
+
+	dulcet_term_free(expected);
+	dulcet_term_free(t);
+}
+
+ZIDANE_TEST(church_conversions)
+{
+	long long value;
+	int boolean;
+
+	struct dulcet_term *t = dulcet_church_from_int(3);
+	struct dulcet_term *expected = ABS(ABS(APP(VAR(2), APP(VAR(2), APP(VAR(2), VAR(1))))));
+	ZIDANE_VERIFY(dulcet_term_eq(t, expected));
+	ZIDANE_VERIFY(dulcet_church_to_int(t, &value) && value == 3);
+	ZIDANE_VERIFY(!dulcet_church_to_bool(t, &boolean));
+	dulcet_term_free(expected);
+	dulcet_term_free(t);
+
+	t = dulcet_church_from_bool(1);
+	ZIDANE_VERIFY(dulcet_church_to_bool(t, &boolean) && boolean);
+	ZIDANE_VERIFY(!dulcet_church_to_int(t, &value));
+	dulcet_term_free(t);
+
+	// Zero and false are the same term
+	t = dulcet_church_from_int(0);
+	ZIDANE_VERIFY(dulcet_church_to_int(t, &value) && value == 0);
+	ZIDANE_VERIFY(dulcet_church_to_bool(t, &boolean) && !boolean);
+	dulcet_term_free(t);
+
+	t = ABS(ABS(APP(VAR(1), VAR(2))));
+	ZIDANE_VERIFY(!dulcet_church_to_int(t, &value));
+	dulcet_term_free(t);
+}
+
+ZIDANE_TEST(church_lists_pairs)
+{
+	const struct dulcet_term *first, *second;
+	const struct dulcet_term **items;
+	size_t size;
+
+	// λf.f 1 true
+	struct dulcet_term *t = ABS(APP(APP(VAR(1), INT(1)), dulcet_church_from_bool(1)));
+	ZIDANE_VERIFY(dulcet_church_to_pair(t, &first, &second));
+	ZIDANE_VERIFY(first->kind == DULCET_TERM_KIND_INT);
+	ZIDANE_VERIFY(dulcet_term_eq((struct dulcet_term *) second, t->abs.m->app.n));
+	ZIDANE_VERIFY(!dulcet_church_to_list(t, &items, &size));
+	dulcet_term_free(t);
+
+	// λf.f f 1 refers to its binder
+	t = ABS(APP(APP(VAR(1), VAR(1)), INT(1)));
+	ZIDANE_VERIFY(!dulcet_church_to_pair(t, &first, &second));
+	dulcet_term_free(t);
+
+	// Pairs ending with λx.λa.λb.a, and the same list as a fold
+	struct dulcet_term *nil = ABS(ABS(ABS(VAR(2))));
+	t = ABS(APP(APP(VAR(1), INT(1)), ABS(APP(APP(VAR(1), INT(2)), nil))));
+	ZIDANE_VERIFY(dulcet_church_to_list(t, &items, &size));
+	ZIDANE_VERIFY(size == 2 && items[0]->integer.value == 1 && items[1]->integer.value == 2);
+	free((void *) items);
+	dulcet_term_free(t);
+
+	t = ABS(ABS(APP(APP(VAR(2), INT(1)), APP(APP(VAR(2), INT(2)), VAR(1)))));
+	ZIDANE_VERIFY(dulcet_church_to_list(t, &items, &size));
+	ZIDANE_VERIFY(size == 2 && items[0]->integer.value == 1 && items[1]->integer.value == 2);
+	free((void *) items);
+	dulcet_term_free(t);
+
+	// The empty fold is zero, and elements that refer to `c` or `n` are not elements
+	t = dulcet_church_from_int(0);
+	ZIDANE_VERIFY(dulcet_church_to_list(t, &items, &size) && size == 0);
+	free((void *) items);
+	dulcet_term_free(t);
+
+	t = ABS(ABS(APP(APP(VAR(2), VAR(1)), VAR(1))));
+	ZIDANE_VERIFY(!dulcet_church_to_list(t, &items, &size));
+	dulcet_term_free(t);
+}
+
+ZIDANE_TEST(image_load)
+{
+	// succ = λλλ2 (3 2 1), zero = λλ1, and then succ (succ zero) + 1, unnamed
+	static const struct dulcet_image_node nodes[] = {
+		{ DULCET_TERM_KIND_ABS, 0 },  { DULCET_TERM_KIND_ABS, 0 },
+		{ DULCET_TERM_KIND_ABS, 0 },  { DULCET_TERM_KIND_APP, 0 },
+		{ DULCET_TERM_KIND_VAR, 2 },  { DULCET_TERM_KIND_APP, 0 },
+		{ DULCET_TERM_KIND_APP, 0 },  { DULCET_TERM_KIND_VAR, 3 },
+		{ DULCET_TERM_KIND_VAR, 2 },  { DULCET_TERM_KIND_VAR, 1 },
+		{ DULCET_TERM_KIND_ABS, 0 },  { DULCET_TERM_KIND_ABS, 0 },
+		{ DULCET_TERM_KIND_VAR, 1 },  { DULCET_TERM_KIND_APP, 0 },
+		{ DULCET_TERM_KIND_REF, 0 },  { DULCET_TERM_KIND_APP, 0 },
+		{ DULCET_TERM_KIND_REF, 0 },  { DULCET_TERM_KIND_REF, 1 },
+		{ DULCET_TERM_KIND_APP, 0 },  { DULCET_TERM_KIND_APP, 0 },
+		{ DULCET_TERM_KIND_PRIM, DULCET_PRIM_OP_ADD },
+		{ DULCET_TERM_KIND_INT, 41 }, { DULCET_TERM_KIND_INT, 1 },
+	};
+	static const struct dulcet_image_definition definitions[] = {
+		{ "succ", 10 },
+		{ "zero", 3 },
+		{ NULL, 5 },
+		{ NULL, 5 },
+	};
+	static const struct dulcet_image image = {
+		.nodes = nodes,
+		.nodes_size = ARRAY_SIZE(nodes),
+		.definitions = definitions,
+		.definitions_size = ARRAY_SIZE(definitions),
+	};
+
+	struct dulcet_loaded_image loaded;
+	dulcet_image_load(&loaded, &image);
+
+	struct dulcet_term *succ = ABS(ABS(ABS(APP(VAR(2), APP(APP(VAR(3), VAR(2)), VAR(1))))));
+	struct dulcet_term *t = dulcet_term_copy(dulcet_image_lookup(&loaded, "succ", 4));
+	ZIDANE_VERIFY(dulcet_term_eq(t, succ));
+	ZIDANE_VERIFY(dulcet_image_lookup(&loaded, "pred", 4) == NULL);
+	dulcet_term_free(t);
+
+	t = dulcet_term_copy(loaded.terms[2]);
+	long long value;
+	dulcet_beta_nor(t);
+	ZIDANE_VERIFY(dulcet_church_to_int(t, &value) && value == 2);
+	dulcet_term_free(t);
+
+	t = dulcet_term_copy(loaded.terms[3]);
+	dulcet_beta_nor(t);
+	ZIDANE_VERIFY(t->kind == DULCET_TERM_KIND_INT && t->integer.value == 42);
+	dulcet_term_free(t);
+
+	// Building the loaded terms back gives the same image
+	struct dulcet_image built;
+	const char *names[] = { "succ", "zero", NULL, NULL };
+	dulcet_image_build(&built, loaded.terms, names, ARRAY_SIZE(names));
+	ZIDANE_VERIFY(built.nodes_size == image.nodes_size);
+	for (size_t i = 0; i < built.nodes_size; ++i) {
+		ZIDANE_VERIFY(built.nodes[i].kind == nodes[i].kind);
+		ZIDANE_VERIFY(built.nodes[i].value == nodes[i].value);
+	}
+	ZIDANE_VERIFY(built.definitions_size == image.definitions_size);
+	for (size_t i = 0; i < built.definitions_size; ++i) {
+		ZIDANE_VERIFY(built.definitions[i].size == definitions[i].size);
+	}
+	dulcet_image_free(&built);
+
+	dulcet_term_free(succ);
+	dulcet_image_unload(&loaded);
+}
+
 ZIDANE_TEST(term_sprint_classic)
 {
 	struct dulcet_term *succ = ABS(ABS(ABS(APP(VAR(2), APP(APP(VAR(3), VAR(2)), VAR(1))))));
@@ -79,6 +467,23 @@ ZIDANE_TEST(term_sprint_de_bruijn)
 	dulcet_term_free(succ);
 }
 
+ZIDANE_TEST(term_sprint_constants)
+{
+	struct dulcet_term *t = ABS(APP(APP(APP(PRIM(IF), dulcet_alloc_bool(0)), INT(-12)),
+					APP(PRIM(EQ), VAR(1))));
+	char buf[64];
+
+	ZIDANE_VERIFY(dulcet_term_sprint_classic(t, buf) == 22);
+	ZIDANE_VERIFY(strcmp(buf, "λa.if false -12 (= a)") == 0);
+	ZIDANE_VERIFY(dulcet_term_len_classic(t) == 22);
+
+	ZIDANE_VERIFY(dulcet_term_sprint_de_bruijn(t, buf) == 21);
+	ZIDANE_VERIFY(strcmp(buf, "λif false #-12 (= 1)") == 0);
+	ZIDANE_VERIFY(dulcet_term_len_de_bruijn(t) == 21);
+
+	dulcet_term_free(t);
+}
+
 ZIDANE_TEST(term_sprint_fail)
 {
 	char buf[BUFSIZ];
@@ -86,3 +491,1018 @@ ZIDANE_TEST(term_sprint_fail)
 
 	ZIDANE_VERIFY(rc < 0);
 }
+
+ZIDANE_TEST(term_sprint_deep)
+{
+	const unsigned int n = 100000;
+
+	struct dulcet_term *numeral = VAR(1);
+	for (unsigned int i = 0; i < n; ++i) {
+		numeral = APP(VAR(2), numeral);
+	}
+	numeral = ABS(ABS(numeral));
+
+	// "λa.λb." followed by n - 1 times "a (", then "a b" and n - 1 times ")"
+	size_t expected_len = 2 * (sizeof("λa.") - 1) + 3 * n + (n - 1);
+	char *buf = malloc(expected_len + 1);
+
+	int rc = dulcet_term_sprint_classic(numeral, buf);
+
+	ZIDANE_VERIFY(rc > 0);
+	ZIDANE_VERIFY((size_t) rc == expected_len);
+	ZIDANE_VERIFY(strncmp(buf, "λa.λb.a (a (a ", sizeof("λa.λb.a (a (a ") - 1) == 0);
+	ZIDANE_VERIFY(buf[rc - n] == 'b');
+	ZIDANE_VERIFY(strspn(buf + rc - n + 1, ")") == n - 1);
+
+	free(buf);
+	dulcet_term_free(numeral);
+}
+
+ZIDANE_TEST(term_snprint_classic)
+{
+	struct dulcet_term *succ = ABS(ABS(ABS(APP(VAR(2), APP(APP(VAR(3), VAR(2)), VAR(1))))));
+	const char expected[] = "λa.λb.λc.b (a b c)";
+
+	int len = dulcet_term_len_classic(succ);
+	ZIDANE_VERIFY(len == sizeof(expected) - 1);
+
+	char *buf = malloc(len + 1);
+	int rc = dulcet_term_snprint_classic(succ, buf, len + 1);
+
+	ZIDANE_VERIFY(rc == len);
+	ZIDANE_VERIFY(strcmp(buf, expected) == 0);
+
+	free(buf);
+	dulcet_term_free(succ);
+}
+
+ZIDANE_TEST(term_snprint_de_bruijn)
+{
+	struct dulcet_term *t = ABS(APP(VAR(12), APP(APP(VAR(345), ABS(VAR(1))), VAR(1))));
+	const char expected[] = "λ12 (345 (λ1) 1)";
+
+	int len = dulcet_term_len_de_bruijn(t);
+	ZIDANE_VERIFY(len == sizeof(expected) - 1);
+
+	char buf[sizeof(expected)];
+	int rc = dulcet_term_snprint_de_bruijn(t, buf, sizeof(buf));
+
+	ZIDANE_VERIFY(rc == len);
+	ZIDANE_VERIFY(strcmp(buf, expected) == 0);
+
+	dulcet_term_free(t);
+}
+
+ZIDANE_TEST(term_snprint_truncated)
+{
+	struct dulcet_term *succ = ABS(ABS(ABS(APP(VAR(2), APP(APP(VAR(3), VAR(2)), VAR(1))))));
+
+	char buf[8] = "xxxxxxx";
+	int rc = dulcet_term_snprint_classic(succ, buf, 7);
+
+	ZIDANE_VERIFY(rc == sizeof("λa.λb.λc.b (a b c)") - 1);
+	ZIDANE_VERIFY(strcmp(buf, "λa.λ") == 0);
+
+	rc = dulcet_term_snprint_classic(succ, NULL, 0);
+	ZIDANE_VERIFY(rc == sizeof("λa.λb.λc.b (a b c)") - 1);
+
+	dulcet_term_free(succ);
+}
+
+ZIDANE_TEST(term_snprint_shared)
+{
+	char buf[BUFSIZ];
+
+	// λf.f (λx.x x) (λx.x x), where only the closed copies are bound
+	struct dulcet_term *t = ABS(APP(APP(VAR(1), ABS(APP(VAR(1), VAR(1)))),
+					ABS(APP(VAR(1), VAR(1)))));
+	int rc = dulcet_term_snprint_classic_shared(t, buf, sizeof(buf));
+	ZIDANE_VERIFY((unsigned long) rc == strlen(buf));
+	ZIDANE_VERIFY(strcmp(buf, "let $1 = λa.a a in λa.a $1 $1") == 0);
+
+	dulcet_term_snprint_de_bruijn_shared(t, buf, sizeof(buf));
+	ZIDANE_VERIFY(strcmp(buf, "let $1 = λ1 1 in λ1 $1 $1") == 0);
+	dulcet_term_free(t);
+
+	// Open subterms are written out wherever they occur
+	t = ABS(APP(APP(VAR(1), ABS(APP(VAR(1), VAR(2)))), ABS(APP(VAR(1), VAR(2)))));
+	dulcet_term_snprint_classic_shared(t, buf, sizeof(buf));
+	ZIDANE_VERIFY(strcmp(buf, "λa.a (λb.b a) (λb.b a)") == 0);
+	dulcet_term_free(t);
+
+	// Copies of a shared term are bound like any other repeated subterm
+	struct dulcet_term *pair = dulcet_alloc_ref(ABS(APP(APP(VAR(1), INT(1)), INT(2))));
+	t = APP(APP(VAR(1), dulcet_term_copy(pair)), pair);
+	t = ABS(APP(APP(VAR(1), ABS(t)), ABS(dulcet_term_copy(t))));
+	dulcet_term_snprint_classic_shared(t, buf, sizeof(buf));
+	ZIDANE_VERIFY(strcmp(buf, "let $1 = λa.a 1 2 in let $2 = λa.a $1 $1 in λa.a $2 $2") ==
+		      0);
+	dulcet_term_free(t);
+}
+
+ZIDANE_TEST(beta_nor_step_limit)
+{
+	struct dulcet_term *omega = ABS(APP(VAR(1), VAR(1)));
+	struct dulcet_term *actual = APP(omega, dulcet_term_copy(omega));
+
+	dulcet_set_step_limit(100);
+	dulcet_beta_nor(actual);
+
+	ZIDANE_VERIFY(dulcet_step_limit_reached());
+	ZIDANE_VERIFY(dulcet_steps_left() == 0);
+
+	struct dulcet_term *expected = APP(ABS(APP(VAR(1), VAR(1))), ABS(APP(VAR(1), VAR(1))));
+
+	ZIDANE_VERIFY(dulcet_term_eq(actual, expected));
+
+	dulcet_set_step_limit(DULCET_UNLIMITED_STEPS);
+	ZIDANE_VERIFY(!dulcet_step_limit_reached());
+
+	dulcet_term_free(expected);
+	dulcet_term_free(actual);
+}
+
+ZIDANE_TEST(beta_nor_memory_limit)
+{
+	// Every step grows the term by a copy of `\x.x x x`
+	struct dulcet_term *omega3 = ABS(APP(APP(VAR(1), VAR(1)), VAR(1)));
+	struct dulcet_term *t = APP(omega3, dulcet_term_copy(omega3));
+
+	struct dulcet_limits limits = { .nodes = 1000 };
+	dulcet_set_limits(&limits);
+
+	ZIDANE_VERIFY(dulcet_beta_nor(t) == DULCET_STATUS_MEMORY_LIMIT);
+	ZIDANE_VERIFY(dulcet_status() == DULCET_STATUS_MEMORY_LIMIT);
+	ZIDANE_VERIFY(dulcet_steps_taken() > 0);
+
+	// Once stopped, the reducers take no further step until the limits are set again
+	unsigned long steps = dulcet_steps_taken();
+	ZIDANE_VERIFY(dulcet_beta_app(t) == DULCET_STATUS_MEMORY_LIMIT);
+	ZIDANE_VERIFY(dulcet_steps_taken() == steps);
+
+	dulcet_set_step_limit(DULCET_UNLIMITED_STEPS);
+	ZIDANE_VERIFY(dulcet_status() == DULCET_STATUS_OK);
+	ZIDANE_VERIFY(dulcet_steps_taken() == 0);
+
+	dulcet_term_free(t);
+}
+
+ZIDANE_TEST(beta_nor_deadline)
+{
+	struct dulcet_term *omega = ABS(APP(VAR(1), VAR(1)));
+	struct dulcet_term *t = APP(omega, dulcet_term_copy(omega));
+
+	struct dulcet_limits limits = { .time_ns = 1000000 };
+	dulcet_set_limits(&limits);
+
+	ZIDANE_VERIFY(dulcet_beta_nor(t) == DULCET_STATUS_DEADLINE);
+	ZIDANE_VERIFY(strcmp(dulcet_status_name(dulcet_status()), "deadline") == 0);
+
+	dulcet_set_step_limit(DULCET_UNLIMITED_STEPS);
+
+	dulcet_term_free(t);
+}
+
+ZIDANE_TEST(beta_nor_divergence)
+{
+	// λz.(λx.(λy.x x) z) (λx.(λy.x x) z), which comes back to itself every two steps
+	struct dulcet_term *w = ABS(APP(ABS(APP(VAR(2), VAR(2))), VAR(2)));
+	struct dulcet_term *t = ABS(APP(w, dulcet_term_copy(w)));
+	struct dulcet_term *expected = dulcet_term_copy(t);
+
+	struct dulcet_limits limits = { .divergence = 1 };
+	dulcet_set_limits(&limits);
+
+	ZIDANE_VERIFY(dulcet_beta_nor(t) == DULCET_STATUS_DIVERGED);
+	ZIDANE_VERIFY(strcmp(dulcet_status_name(dulcet_status()), "diverged") == 0);
+	ZIDANE_VERIFY(dulcet_steps_taken() < 16);
+	ZIDANE_VERIFY(dulcet_term_eq(t, expected));
+
+	// A term that keeps growing never comes back to itself, so only the other limits stop it
+	struct dulcet_term *omega3 = ABS(APP(APP(VAR(1), VAR(1)), VAR(1)));
+	struct dulcet_term *u = APP(omega3, dulcet_term_copy(omega3));
+
+	limits.steps = 1000;
+	dulcet_set_limits(&limits);
+
+	ZIDANE_VERIFY(dulcet_beta_nor(u) == DULCET_STATUS_STEP_LIMIT);
+
+	dulcet_set_step_limit(DULCET_UNLIMITED_STEPS);
+
+	dulcet_term_free(u);
+	dulcet_term_free(expected);
+	dulcet_term_free(t);
+}
+
+ZIDANE_TEST(beta_portfolio_diverging_argument)
+{
+	// (λx.λy.y) Ω, which applicative order never finishes, and normal order does in one step
+	struct dulcet_term *omega = ABS(APP(VAR(1), VAR(1)));
+	struct dulcet_term *actual = APP(ABS(ABS(VAR(1))), APP(omega, dulcet_term_copy(omega)));
+
+	dulcet_set_step_limit(DULCET_UNLIMITED_STEPS);
+
+	ZIDANE_VERIFY(dulcet_beta_portfolio(actual) == DULCET_STATUS_OK);
+	ZIDANE_VERIFY(dulcet_steps_taken() == 1);
+
+	struct dulcet_term *expected = ABS(VAR(1));
+
+	ZIDANE_VERIFY(dulcet_term_eq(actual, expected));
+
+	dulcet_term_free(expected);
+	dulcet_term_free(actual);
+}
+
+ZIDANE_TEST(beta_portfolio_pred_succ)
+{
+	struct dulcet_term *succ = ABS(ABS(ABS(APP(VAR(2), APP(APP(VAR(3), VAR(2)), VAR(1))))));
+	struct dulcet_term *pred = ABS(ABS(
+		ABS(APP(APP(APP(VAR(3), ABS(ABS(APP(VAR(1), APP(VAR(2), VAR(4)))))), ABS(VAR(2))),
+			ABS(VAR(1))))));
+
+	struct dulcet_term *actual = APP(pred, succ);
+
+	dulcet_set_step_limit(DULCET_UNLIMITED_STEPS);
+	ZIDANE_VERIFY(dulcet_beta_portfolio(actual) == DULCET_STATUS_OK);
+
+	struct dulcet_term *expected = ABS(ABS(VAR(1)));
+
+	ZIDANE_VERIFY(dulcet_term_eq(actual, expected));
+
+	dulcet_term_free(expected);
+	dulcet_term_free(actual);
+}
+
+ZIDANE_TEST(beta_portfolio_step_limit)
+{
+	struct dulcet_term *omega = ABS(APP(VAR(1), VAR(1)));
+	struct dulcet_term *actual = APP(omega, dulcet_term_copy(omega));
+
+	dulcet_set_step_limit(100);
+
+	ZIDANE_VERIFY(dulcet_beta_portfolio(actual) == DULCET_STATUS_STEP_LIMIT);
+	ZIDANE_VERIFY(dulcet_steps_taken() == 100);
+
+	struct dulcet_term *expected = APP(ABS(APP(VAR(1), VAR(1))), ABS(APP(VAR(1), VAR(1))));
+
+	ZIDANE_VERIFY(dulcet_term_eq(actual, expected));
+
+	dulcet_set_step_limit(DULCET_UNLIMITED_STEPS);
+
+	dulcet_term_free(expected);
+	dulcet_term_free(actual);
+}
+
+ZIDANE_TEST(beta_portfolio_divergence)
+{
+	// (λx.Ω) (λx.x x x), on which normal order goes round in circles, so that there is no
+	// normal form to wait for from applicative order, which keeps growing the argument
+	struct dulcet_term *omega = ABS(APP(VAR(1), VAR(1)));
+	struct dulcet_term *omega3 = ABS(APP(APP(VAR(1), VAR(1)), VAR(1)));
+	struct dulcet_term *t = APP(ABS(APP(omega, dulcet_term_copy(omega))), omega3);
+
+	struct dulcet_limits limits = { .divergence = 1 };
+	dulcet_set_limits(&limits);
+
+	ZIDANE_VERIFY(dulcet_beta_portfolio(t) == DULCET_STATUS_DIVERGED);
+
+	dulcet_set_step_limit(DULCET_UNLIMITED_STEPS);
+
+	dulcet_term_free(t);
+}
+
+// Reads back what was streamed to a temporary file
+static char *read_stream(FILE *fp)
+{
+	long len = ftell(fp);
+	char *buf = malloc(len + 1);
+
+	rewind(fp);
+	buf[fread(buf, 1, len, fp)] = '\0';
+	fclose(fp);
+
+	return buf;
+}
+
+ZIDANE_TEST(term_stream_classic)
+{
+	// plus 2 3, whose arguments are only normalized once the head is printed
+	struct dulcet_term *plus = ABS(ABS(ABS(ABS(APP(APP(VAR(4), VAR(2)),
+							  APP(APP(VAR(3), VAR(2)), VAR(1)))))));
+	struct dulcet_term *two = ABS(ABS(APP(VAR(2), APP(VAR(2), VAR(1)))));
+	struct dulcet_term *three = ABS(ABS(APP(VAR(2), APP(VAR(2), APP(VAR(2), VAR(1))))));
+	struct dulcet_term *t = APP(APP(plus, two), three);
+	struct dulcet_term *expected = dulcet_term_copy(t);
+
+	dulcet_set_step_limit(DULCET_UNLIMITED_STEPS);
+	dulcet_beta_nor(expected);
+
+	char expected_buf[64];
+	dulcet_term_sprint_classic(expected, expected_buf);
+
+	FILE *fp = tmpfile();
+	ZIDANE_VERIFY(fp != NULL);
+	if (!fp) {
+		return;
+	}
+
+	int rc = dulcet_term_stream_classic(t, fp);
+	char *buf = read_stream(fp);
+
+	ZIDANE_VERIFY(rc == (int) strlen(expected_buf));
+	ZIDANE_VERIFY(strcmp(buf, expected_buf) == 0);
+	ZIDANE_VERIFY(dulcet_term_eq(t, expected));
+
+	free(buf);
+	dulcet_term_free(expected);
+	dulcet_term_free(t);
+}
+
+ZIDANE_TEST(term_stream_de_bruijn_step_limit)
+{
+	// `\1 (\1) ((\1 1) (\1 1))`: the head is final, then its second argument diverges
+	struct dulcet_term *omega = ABS(APP(VAR(1), VAR(1)));
+	struct dulcet_term *t =
+		ABS(APP(APP(VAR(1), APP(ABS(VAR(1)), ABS(VAR(1)))),
+			APP(omega, dulcet_term_copy(omega))));
+
+	FILE *fp = tmpfile();
+	ZIDANE_VERIFY(fp != NULL);
+	if (!fp) {
+		return;
+	}
+
+	dulcet_set_step_limit(100);
+
+	int rc = dulcet_term_stream_de_bruijn(t, fp);
+	char *buf = read_stream(fp);
+
+	ZIDANE_VERIFY(dulcet_status() == DULCET_STATUS_STEP_LIMIT);
+	ZIDANE_VERIFY(rc == (int) strlen(buf));
+	ZIDANE_VERIFY(strcmp(buf, "λ1 (λ1) ((λ1 1) (λ1 1))") == 0);
+
+	dulcet_set_step_limit(DULCET_UNLIMITED_STEPS);
+
+	free(buf);
+	dulcet_term_free(t);
+}
+
+ZIDANE_TEST(stats_beta_nor)
+{
+	dulcet_stats_reset();
+
+	struct dulcet_term *t = APP(ABS(APP(VAR(1), VAR(1))), ABS(VAR(1)));
+	dulcet_beta_nor(t);
+	dulcet_term_free(t);
+
+	struct dulcet_stats stats;
+	dulcet_stats_get(&stats);
+
+	if (!dulcet_stats_enabled()) {
+		ZIDANE_VERIFY(stats.beta_steps[DULCET_STRATEGY_NOR] == 0);
+		return;
+	}
+
+	ZIDANE_VERIFY(stats.beta_steps[DULCET_STRATEGY_NOR] == 2);
+	ZIDANE_VERIFY(stats.beta_steps[DULCET_STRATEGY_CBN] == 0);
+	ZIDANE_VERIFY(stats.substitutions == 3);
+	ZIDANE_VERIFY(stats.nodes_allocated == stats.nodes_freed);
+	ZIDANE_VERIFY(stats.peak_live_nodes >= 4);
+	ZIDANE_VERIFY(stats.max_depth > 0);
+}
+
+ZIDANE_TEST(stats_reset_live_nodes)
+{
+	struct dulcet_term *t = APP(ABS(VAR(1)), ABS(VAR(1)));
+	dulcet_stats_reset();
+	dulcet_term_free(t);
+
+	struct dulcet_stats stats;
+	dulcet_stats_get(&stats);
+
+	if (!dulcet_stats_enabled()) {
+		ZIDANE_VERIFY(stats.peak_live_nodes == 0);
+		return;
+	}
+
+	// The nodes alive at the reset count toward the peak, but were not allocated since
+	ZIDANE_VERIFY(stats.nodes_allocated == 0);
+	ZIDANE_VERIFY(stats.nodes_freed == 3);
+	ZIDANE_VERIFY(stats.peak_live_nodes >= 3);
+}
+
+ZIDANE_TEST(stats_beta_nor_arguments_moved)
+{
+	dulcet_stats_reset();
+
+	// `(\x.\y.\u.x y y) (\z.z) (\w.w w) (\v.v)` applies linear, duplicating and unused binders
+	struct dulcet_term *t =
+		APP(APP(APP(ABS(ABS(ABS(APP(APP(VAR(3), VAR(2)), VAR(2))))), ABS(VAR(1))),
+			ABS(APP(VAR(1), VAR(1)))),
+		    ABS(VAR(1)));
+	struct dulcet_term *expected = APP(ABS(APP(VAR(1), VAR(1))), ABS(APP(VAR(1), VAR(1))));
+
+	struct dulcet_limits limits = { .steps = 4 };
+	dulcet_set_limits(&limits);
+
+	dulcet_beta_nor(t);
+	ZIDANE_VERIFY(dulcet_term_eq(t, expected));
+
+	dulcet_set_step_limit(DULCET_UNLIMITED_STEPS);
+	dulcet_term_free(expected);
+	dulcet_term_free(t);
+
+	struct dulcet_stats stats;
+	dulcet_stats_get(&stats);
+
+	if (!dulcet_stats_enabled()) {
+		return;
+	}
+
+	// Only `\w.w w` is copied, once, and moved into the other occurrence of `y`, its variables
+	// being immediates
+	ZIDANE_VERIFY(stats.substitutions == 4);
+	ZIDANE_VERIFY(stats.arguments_moved == 3);
+	ZIDANE_VERIFY(stats.arguments_erased == 1);
+	ZIDANE_VERIFY(stats.nodes_copied == 2);
+}
+
+struct step_hook_record {
+	unsigned long long calls;
+	struct dulcet_step_event last;
+};
+
+static void step_hook_record(const struct dulcet_step_event *event, void *data)
+{
+	struct step_hook_record *record = data;
+
+	record->calls += 1;
+	record->last = *event;
+}
+
+ZIDANE_TEST(step_hook_beta_nor)
+{
+	struct dulcet_term *plus = ABS(ABS(ABS(ABS(APP(APP(VAR(4), VAR(2)),
+						       APP(APP(VAR(3), VAR(2)), VAR(1)))))));
+	struct dulcet_term *two = ABS(ABS(APP(VAR(2), APP(VAR(2), VAR(1)))));
+	struct dulcet_term *three = ABS(ABS(APP(VAR(2), APP(VAR(2), APP(VAR(2), VAR(1))))));
+	struct dulcet_term *t = APP(APP(plus, two), three);
+
+	ZIDANE_VERIFY(dulcet_term_size(t) == 31);
+
+	struct step_hook_record record = { 0 };
+
+	dulcet_set_step_hook(step_hook_record, &record);
+	dulcet_beta_nor(t);
+	dulcet_set_step_hook(NULL, NULL);
+
+	ZIDANE_VERIFY(record.calls > 0);
+	ZIDANE_VERIFY(record.last.step == record.calls);
+	ZIDANE_VERIFY(record.last.term_size == dulcet_term_size(t));
+
+	dulcet_beta_nor(t);
+	ZIDANE_VERIFY(record.last.step == record.calls);
+
+	dulcet_term_free(t);
+}
+
+// Counts the steps after which the size reported for the term being reduced is not its own
+struct step_hook_size {
+	const struct dulcet_term *t;
+	unsigned long long calls;
+	unsigned long long wrong;
+};
+
+static void step_hook_size(const struct dulcet_step_event *event, void *data)
+{
+	struct step_hook_size *record = data;
+
+	record->calls += 1;
+	record->wrong += event->term_size != dulcet_term_size(record->t);
+}
+
+ZIDANE_TEST(step_hook_let)
+{
+	enum dulcet_status (*reducers[])(struct dulcet_term *) = {
+		dulcet_beta_nor,
+		dulcet_beta_app,
+	};
+
+	for (size_t i = 0; i < ARRAY_SIZE(reducers); ++i) {
+		// let twice = λf.λx.f (f x) in let id = λy.y in λz.twice id (twice id z), each use of
+		// the definitions being a reference to them
+		struct dulcet_term *twice = dulcet_alloc_ref(ABS(ABS(APP(VAR(2), APP(VAR(2), VAR(1))))));
+		struct dulcet_term *id = dulcet_alloc_ref(ABS(VAR(1)));
+		struct dulcet_term *t =
+			ABS(APP(APP(dulcet_term_copy(twice), dulcet_term_copy(id)),
+				APP(APP(dulcet_term_copy(twice), dulcet_term_copy(id)), VAR(1))));
+		struct step_hook_size record = { .t = t };
+
+		dulcet_set_step_hook(step_hook_size, &record);
+		ZIDANE_VERIFY(reducers[i](t) == DULCET_STATUS_OK);
+		dulcet_set_step_hook(NULL, NULL);
+
+		struct dulcet_term *expected = ABS(VAR(1));
+		ZIDANE_VERIFY(dulcet_term_eq(t, expected));
+		ZIDANE_VERIFY(record.calls > 0);
+		ZIDANE_VERIFY(record.wrong == 0);
+
+		dulcet_term_free(expected);
+		dulcet_term_free(t);
+		dulcet_term_free(id);
+		dulcet_term_free(twice);
+	}
+}
+
+ZIDANE_TEST(step_hook_delta)
+{
+	enum dulcet_status (*reducers[])(struct dulcet_term *) = {
+		dulcet_beta_nor,
+		dulcet_beta_app,
+	};
+	struct dulcet_term *ts[] = {
+		// (λx.x x) (+ (* 3 4) 5)
+		APP(ABS(APP(VAR(1), VAR(1))),
+		    APP(APP(PRIM(ADD), APP(APP(PRIM(MUL), INT(3)), INT(4))), INT(5))),
+		// (λf.λx.+ (f x) (f x)) (λy.* y y) 3
+		APP(APP(ABS(ABS(APP(APP(PRIM(ADD), APP(VAR(2), VAR(1))), APP(VAR(2), VAR(1))))),
+			ABS(APP(APP(PRIM(MUL), VAR(1)), VAR(1)))),
+		    INT(3)),
+		// (λx.if (< x 2) (+ 40 2) (/ 1 0)) 1
+		APP(ABS(APP(APP(APP(PRIM(IF), APP(APP(PRIM(LT), VAR(1)), INT(2))),
+				APP(APP(PRIM(ADD), INT(40)), INT(2))),
+			    APP(APP(PRIM(DIV), INT(1)), INT(0)))),
+		    INT(1)),
+	};
+	struct dulcet_term *expected[] = {
+		APP(INT(17), INT(17)),
+		INT(18),
+		INT(42),
+	};
+
+	for (size_t i = 0; i < ARRAY_SIZE(reducers); ++i) {
+		for (size_t j = 0; j < ARRAY_SIZE(ts); ++j) {
+			// Under a stuck head, and followed by a beta step, whose size is then checked
+			// after the last delta step as well
+			struct dulcet_term *t =
+				APP(APP(VAR(1), dulcet_term_copy(ts[j])), APP(ABS(VAR(1)), INT(0)));
+			struct step_hook_size record = { .t = t };
+
+			dulcet_set_step_hook(step_hook_size, &record);
+			ZIDANE_VERIFY(reducers[i](t) == DULCET_STATUS_OK);
+			dulcet_set_step_hook(NULL, NULL);
+
+			ZIDANE_VERIFY(dulcet_term_eq(t->app.m->app.n, expected[j]));
+			ZIDANE_VERIFY(record.calls > 0);
+			ZIDANE_VERIFY(record.wrong == 0);
+
+			dulcet_term_free(t);
+		}
+	}
+
+	for (size_t j = 0; j < ARRAY_SIZE(ts); ++j) {
+		dulcet_term_free(expected[j]);
+		dulcet_term_free(ts[j]);
+	}
+}
+
+// Hands out nodes of a fixed array, and fails once it is used up
+struct arena {
+	struct dulcet_term nodes[64];
+	size_t used;
+	size_t freed;
+	jmp_buf on_error;
+};
+
+static void *arena_alloc(void *data, size_t size)
+{
+	struct arena *arena = data;
+
+	if (size != sizeof(struct dulcet_term) || arena->used == ARRAY_SIZE(arena->nodes)) {
+		return NULL;
+	}
+
+	return &arena->nodes[arena->used++];
+}
+
+static void arena_free(void *data, void *ptr, size_t size)
+{
+	struct arena *arena = data;
+
+	(void) ptr;
+	(void) size;
+
+	arena->freed += 1;
+}
+
+static void arena_error(void *data, const char *error)
+{
+	struct arena *arena = data;
+
+	(void) error;
+
+	longjmp(arena->on_error, 1);
+}
+
+ZIDANE_TEST(ctx_allocator)
+{
+	struct arena arena = { 0 };
+	struct dulcet_allocator allocator = { arena_alloc, arena_free, &arena };
+	struct dulcet_ctx ctx;
+
+	dulcet_ctx_init(&ctx, &allocator);
+
+	struct dulcet_stats before;
+	dulcet_stats_get(&before);
+
+	// (λx.x x) (λy.y), built within the context, whose variables take no nodes
+	dulcet_ctx_enter(&ctx);
+	struct dulcet_term *t = APP(ABS(APP(VAR(1), VAR(1))), ABS(VAR(1)));
+	dulcet_ctx_leave(&ctx);
+
+	ZIDANE_VERIFY(arena.used == 4);
+	ZIDANE_VERIFY(dulcet_ctx_live_nodes(&ctx) == 4);
+
+	struct dulcet_limits limits = { .nodes = 16 };
+	dulcet_ctx_set_limits(&ctx, &limits);
+
+	ZIDANE_VERIFY(dulcet_ctx_beta_nor(&ctx, t) == DULCET_STATUS_OK);
+	ZIDANE_VERIFY(dulcet_ctx_steps_taken(&ctx) == 2);
+	ZIDANE_VERIFY(dulcet_term_kind(t) == DULCET_TERM_KIND_ABS &&
+		      dulcet_term_kind(t->abs.m) == DULCET_TERM_KIND_VAR);
+
+	// Freed nodes are allocated again rather than given back
+	ZIDANE_VERIFY(arena.freed == 0);
+	ZIDANE_VERIFY(dulcet_ctx_live_nodes(&ctx) == 1);
+	ZIDANE_VERIFY(dulcet_ctx_bytes(&ctx) == arena.used * sizeof(struct dulcet_term));
+
+	// The stats of the context are apart from those of the thread
+	struct dulcet_stats stats;
+	struct dulcet_stats after;
+	dulcet_ctx_stats_get(&ctx, &stats);
+	dulcet_stats_get(&after);
+
+	ZIDANE_VERIFY(!dulcet_stats_enabled() || stats.beta_steps[DULCET_STRATEGY_NOR] == 2);
+	ZIDANE_VERIFY(after.beta_steps[DULCET_STRATEGY_NOR] == before.beta_steps[DULCET_STRATEGY_NOR]);
+
+	dulcet_ctx_term_free(&ctx, t);
+	dulcet_ctx_deinit(&ctx);
+
+	ZIDANE_VERIFY(arena.freed == arena.used);
+}
+
+ZIDANE_TEST(ctx_out_of_memory)
+{
+	struct arena arena = { 0 };
+	struct dulcet_allocator allocator = { arena_alloc, arena_free, &arena };
+	struct dulcet_ctx ctx;
+
+	dulcet_ctx_init(&ctx, &allocator);
+	dulcet_ctx_set_error_handler(&ctx, arena_error, &arena);
+
+	dulcet_ctx_enter(&ctx);
+	struct dulcet_term *triple = ABS(APP(APP(VAR(1), VAR(1)), VAR(1)));
+	struct dulcet_term *t = APP(triple, dulcet_term_copy(triple));
+	dulcet_ctx_leave(&ctx);
+
+	// (λx.x x x) (λx.x x x) grows without end, until the arena runs out
+	volatile int jumped = 0;
+	if (setjmp(arena.on_error) == 0) {
+		dulcet_ctx_beta_nor(&ctx, t);
+	} else {
+		jumped = 1;
+	}
+
+	ZIDANE_VERIFY(jumped);
+	ZIDANE_VERIFY(arena.used == ARRAY_SIZE(arena.nodes));
+	ZIDANE_VERIFY(strcmp(dulcet_ctx_error(&ctx), "out of memory") == 0);
+
+	// The thread is back to its own heap, and the arena is thrown away as a whole
+	struct dulcet_term *s = VAR(1);
+	dulcet_term_free(s);
+
+	dulcet_ctx_deinit(&ctx);
+}
+
+ZIDANE_TEST(ctx_portfolio)
+{
+	struct arena arena = { 0 };
+	struct dulcet_allocator allocator = { arena_alloc, arena_free, &arena };
+	struct dulcet_ctx ctx;
+
+	dulcet_ctx_init(&ctx, &allocator);
+
+	// (λx.λy.y) ((λx.x x) (λx.x x)), on which applicative order never ends
+	dulcet_ctx_enter(&ctx);
+	struct dulcet_term *omega = ABS(APP(VAR(1), VAR(1)));
+	struct dulcet_term *t = APP(ABS(ABS(VAR(1))), APP(omega, dulcet_term_copy(omega)));
+	dulcet_ctx_leave(&ctx);
+
+	struct dulcet_limits limits = { .steps = 1000 };
+	dulcet_ctx_set_limits(&ctx, &limits);
+
+	ZIDANE_VERIFY(dulcet_ctx_beta_portfolio(&ctx, t) == DULCET_STATUS_OK);
+	ZIDANE_VERIFY(dulcet_term_kind(t) == DULCET_TERM_KIND_ABS &&
+		      dulcet_term_kind(t->abs.m) == DULCET_TERM_KIND_VAR);
+
+	// Every node of either thread came from the arena, and went back to the context
+	ZIDANE_VERIFY(arena.used <= ARRAY_SIZE(arena.nodes));
+	ZIDANE_VERIFY(dulcet_ctx_live_nodes(&ctx) == 1);
+
+	dulcet_ctx_term_free(&ctx, t);
+	dulcet_ctx_deinit(&ctx);
+
+	ZIDANE_VERIFY(arena.freed == arena.used);
+}
+
+ZIDANE_TEST(ctx_portfolio_out_of_memory)
+{
+	struct arena arena = { 0 };
+	struct dulcet_allocator allocator = { arena_alloc, arena_free, &arena };
+	struct dulcet_ctx ctx;
+
+	dulcet_ctx_init(&ctx, &allocator);
+	dulcet_ctx_set_error_handler(&ctx, arena_error, &arena);
+
+	dulcet_ctx_enter(&ctx);
+	struct dulcet_term *triple = ABS(APP(APP(VAR(1), VAR(1)), VAR(1)));
+	struct dulcet_term *t = APP(triple, dulcet_term_copy(triple));
+	dulcet_ctx_leave(&ctx);
+
+	// Both strategies run out of the arena, and the handler is called on this thread, which it
+	// may thus jump back to
+	volatile int jumped = 0;
+	if (setjmp(arena.on_error) == 0) {
+		dulcet_ctx_beta_portfolio(&ctx, t);
+	} else {
+		jumped = 1;
+	}
+
+	ZIDANE_VERIFY(jumped);
+	ZIDANE_VERIFY(arena.used == ARRAY_SIZE(arena.nodes));
+	ZIDANE_VERIFY(strcmp(dulcet_ctx_error(&ctx), "out of memory") == 0);
+
+	struct dulcet_term *s = VAR(1);
+	dulcet_term_free(s);
+
+	dulcet_ctx_deinit(&ctx);
+}
+
+// Hands out memory of the C library, counting the bytes in use and the blocks larger than a node
+struct counter {
+	size_t bytes;
+	size_t blocks;
+};
+
+static void *counter_alloc(void *data, size_t size)
+{
+	struct counter *counter = data;
+
+	counter->bytes += size;
+	counter->blocks += size != sizeof(struct dulcet_term);
+
+	return malloc(size);
+}
+
+static void counter_free(void *data, void *ptr, size_t size)
+{
+	struct counter *counter = data;
+
+	counter->bytes -= size;
+	counter->blocks -= size != sizeof(struct dulcet_term);
+
+	free(ptr);
+}
+
+ZIDANE_TEST(ctx_image)
+{
+	// id := λx.x, and the program id 7
+	static const struct dulcet_image_node nodes[] = {
+		{ DULCET_TERM_KIND_ABS, 0 }, { DULCET_TERM_KIND_VAR, 1 },
+		{ DULCET_TERM_KIND_APP, 0 }, { DULCET_TERM_KIND_REF, 0 },
+		{ DULCET_TERM_KIND_INT, 7 },
+	};
+	static const struct dulcet_image_definition definitions[] = {
+		{ "id", 2 },
+		{ NULL, 3 },
+	};
+	static const struct dulcet_image image = {
+		.nodes = nodes,
+		.nodes_size = ARRAY_SIZE(nodes),
+		.definitions = definitions,
+		.definitions_size = ARRAY_SIZE(definitions),
+	};
+
+	struct counter counter = { 0 };
+	struct dulcet_allocator allocator = { counter_alloc, counter_free, &counter };
+	struct dulcet_ctx ctx;
+
+	dulcet_ctx_init(&ctx, &allocator);
+
+	// The image takes a single block of the context
+	struct dulcet_loaded_image loaded;
+	dulcet_ctx_image_load(&ctx, &loaded, &image);
+	ZIDANE_VERIFY(counter.blocks == 1);
+	ZIDANE_VERIFY(dulcet_ctx_bytes(&ctx) == counter.bytes);
+
+	struct dulcet_term *t = dulcet_ctx_term_copy(&ctx, loaded.terms[1]);
+	ZIDANE_VERIFY(dulcet_ctx_beta_nor(&ctx, t) == DULCET_STATUS_OK);
+	ZIDANE_VERIFY(t->kind == DULCET_TERM_KIND_INT && t->integer.value == 7);
+	dulcet_ctx_term_free(&ctx, t);
+
+	// id applied to a shared numeral, contracted and then streamed
+	struct dulcet_term *two = dulcet_ctx_alloc_ref(&ctx, dulcet_ctx_church_from_int(&ctx, 2));
+	t = dulcet_ctx_alloc_app(&ctx, dulcet_ctx_term_copy(&ctx, loaded.terms[0]), two);
+	dulcet_ctx_eval(&ctx, t);
+
+	FILE *fp = tmpfile();
+	ZIDANE_VERIFY(fp != NULL);
+	if (fp) {
+		ZIDANE_VERIFY(dulcet_ctx_term_stream_classic(&ctx, t, fp) > 0);
+		char *buf = read_stream(fp);
+		ZIDANE_VERIFY(strcmp(buf, "λa.λb.a (a b)") == 0);
+		free(buf);
+	}
+	dulcet_ctx_term_free(&ctx, t);
+
+	dulcet_ctx_image_unload(&ctx, &loaded);
+	ZIDANE_VERIFY(counter.blocks == 0);
+	ZIDANE_VERIFY(dulcet_ctx_bytes(&ctx) == counter.bytes);
+
+	dulcet_ctx_deinit(&ctx);
+	ZIDANE_VERIFY(counter.bytes == 0);
+}
+
+ZIDANE_BENCH(beta_nor_church_mult)
+{
+	// mult 16 16
+	struct dulcet_term *sixteen = VAR(1);
+	for (int i = 0; i < 16; ++i) {
+		sixteen = APP(VAR(2), sixteen);
+	}
+	sixteen = ABS(ABS(sixteen));
+
+	struct dulcet_term *mult = ABS(ABS(ABS(APP(VAR(3), APP(VAR(2), VAR(1))))));
+	struct dulcet_term *t = APP(APP(mult, dulcet_term_copy(sixteen)), sixteen);
+
+	ZIDANE_BENCH_LOOP {
+		struct dulcet_term *s = dulcet_term_copy(t);
+		dulcet_beta_nor(s);
+		dulcet_term_free(s);
+	}
+
+	dulcet_term_free(t);
+}
+
+// Large normal forms for the printer benchmarks: a Church numeral, as deep as it gets, and a
+// variable applied to itself over and over, as wide
+enum bench_term_shape {
+	BENCH_TERM_SHAPE_DEEP,
+	BENCH_TERM_SHAPE_WIDE,
+};
+
+static const char *const bench_term_shape_names[] = {
+	[BENCH_TERM_SHAPE_DEEP] = "deep",
+	[BENCH_TERM_SHAPE_WIDE] = "wide",
+};
+
+static const unsigned int bench_term_sizes[] = { 1u << 12, 1u << 15, 1u << 18 };
+
+static struct dulcet_term *bench_term_generate(enum bench_term_shape shape, unsigned int n)
+{
+	struct dulcet_term *t = VAR(1);
+
+	switch (shape) {
+	case BENCH_TERM_SHAPE_DEEP:
+		for (unsigned int i = 0; i < n / 2; ++i) {
+			t = APP(VAR(2), t);
+		}
+		return ABS(ABS(t));
+
+	case BENCH_TERM_SHAPE_WIDE:
+		for (unsigned int i = 0; i < n / 2; ++i) {
+			t = APP(t, VAR(1));
+		}
+		return ABS(t);
+	}
+
+	return t;
+}
+
+enum bench_printer {
+	BENCH_PRINTER_PRINT,
+	BENCH_PRINTER_FPRINT,
+	BENCH_PRINTER_SPRINT,
+	BENCH_PRINTER_SNPRINT,
+};
+
+static int bench_printer_run(enum bench_printer printer, bool de_bruijn,
+			     const struct dulcet_term *t, FILE *fp, char *buf, size_t size)
+{
+	int rc = -1;
+
+	switch (printer) {
+	case BENCH_PRINTER_PRINT:
+		// The benchmark report goes to the standard output too, so it only points elsewhere
+		// while printing there
+		fflush(stdout);
+		int saved_stdout = dup(STDOUT_FILENO);
+		dup2(fileno(fp), STDOUT_FILENO);
+
+		rc = de_bruijn ? dulcet_term_print_de_bruijn(t) : dulcet_term_print_classic(t);
+
+		fflush(stdout);
+		dup2(saved_stdout, STDOUT_FILENO);
+		close(saved_stdout);
+
+		return rc;
+	case BENCH_PRINTER_FPRINT:
+		return de_bruijn ? dulcet_term_fprint_de_bruijn(t, fp)
+				 : dulcet_term_fprint_classic(t, fp);
+	case BENCH_PRINTER_SPRINT:
+		return de_bruijn ? dulcet_term_sprint_de_bruijn(t, buf)
+				 : dulcet_term_sprint_classic(t, buf);
+	case BENCH_PRINTER_SNPRINT:
+		return de_bruijn ? dulcet_term_snprint_de_bruijn(t, buf, size)
+				 : dulcet_term_snprint_classic(t, buf, size);
+	}
+
+	return rc;
+}
+
+static void bench_print(struct zidane_bench *__zidane_bench, enum bench_printer printer,
+			bool de_bruijn)
+{
+	FILE *fp = fopen("/dev/null", "w");
+	ZIDANE_VERIFY(fp != NULL);
+	if (fp == NULL) {
+		return;
+	}
+
+	for (size_t shape = 0; shape < ARRAY_SIZE(bench_term_shape_names); ++shape) {
+		for (size_t i = 0; i < ARRAY_SIZE(bench_term_sizes); ++i) {
+			struct dulcet_term *t = bench_term_generate(shape, bench_term_sizes[i]);
+
+			int len = de_bruijn ? dulcet_term_len_de_bruijn(t)
+					    : dulcet_term_len_classic(t);
+			char *buf = malloc(len + 1);
+
+			ZIDANE_BENCH_CASE("%s/%u", bench_term_shape_names[shape],
+					  bench_term_sizes[i]);
+			ZIDANE_BENCH_BYTES(len);
+			ZIDANE_BENCH_ITEMS(dulcet_term_size(t), "nodes");
+
+			int rc = 0;
+			ZIDANE_BENCH_LOOP {
+				rc = bench_printer_run(printer, de_bruijn, t, fp, buf, len + 1);
+			}
+
+			ZIDANE_VERIFY(rc == len);
+
+			free(buf);
+			dulcet_term_free(t);
+		}
+	}
+
+	fclose(fp);
+}
+
+ZIDANE_BENCH(term_print_classic)
+{
+	bench_print(__zidane_bench, BENCH_PRINTER_PRINT, false);
+}
+
+ZIDANE_BENCH(term_fprint_classic)
+{
+	bench_print(__zidane_bench, BENCH_PRINTER_FPRINT, false);
+}
+
+ZIDANE_BENCH(term_sprint_classic)
+{
+	bench_print(__zidane_bench, BENCH_PRINTER_SPRINT, false);
+}
+
+ZIDANE_BENCH(term_snprint_classic)
+{
+	bench_print(__zidane_bench, BENCH_PRINTER_SNPRINT, false);
+}
+
+ZIDANE_BENCH(term_print_de_bruijn)
+{
+	bench_print(__zidane_bench, BENCH_PRINTER_PRINT, true);
+}
+
+ZIDANE_BENCH(term_fprint_de_bruijn)
+{
+	bench_print(__zidane_bench, BENCH_PRINTER_FPRINT, true);
+}
+
+ZIDANE_BENCH(term_sprint_de_bruijn)
+{
+	bench_print(__zidane_bench, BENCH_PRINTER_SPRINT, true);
+}
+
+ZIDANE_BENCH(term_snprint_de_bruijn)
+{
+	bench_print(__zidane_bench, BENCH_PRINTER_SNPRINT, true);
+}
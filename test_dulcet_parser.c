@@ -4,6 +4,11 @@
  * SPDX-License-Identifier: BSD-2-Clause
  */
 
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <string.h>
+
 #include "dulcet.h"
 #include "dulcet_parser.h"
 
@@ -123,3 +128,400 @@ ZIDANE_TEST(parse_de_bruijn_unexpected_rparen_nested)
 	ZIDANE_VERIFY(result.error.line == 1);
 	ZIDANE_VERIFY(result.error.column == 7);
 }
+
+ZIDANE_TEST(parse_classic_unexpected_end_of_input)
+{
+	const char input[] = "(\\x.)";
+
+	struct dulcet_parse_result result = dulcet_parse_classic(input, ARRAY_SIZE(input));
+	ZIDANE_VERIFY(result.kind == DULCET_PARSE_ERROR);
+	ZIDANE_VERIFY(result.error.cause == DULCET_PARSE_ERROR_CAUSE_UNEXPECTED_TOKEN);
+	ZIDANE_VERIFY(result.error.line == 1);
+	ZIDANE_VERIFY(result.error.column == 5);
+}
+
+ZIDANE_TEST(parse_classic_last_token)
+{
+	const char input[] = "\\x.\\y.x y";
+	struct dulcet_term *expected = ABS(ABS(APP(VAR(2), VAR(1))));
+
+	struct dulcet_parse_result result = dulcet_parse_classic(input, sizeof(input) - 1);
+	ZIDANE_VERIFY(result.kind == DULCET_PARSE_OK);
+
+	struct dulcet_term *actual = result.value;
+	ZIDANE_VERIFY(dulcet_term_eq(actual, expected));
+
+	dulcet_term_free(actual);
+	dulcet_term_free(expected);
+}
+
+#define DEEP_NESTING 100000
+
+ZIDANE_TEST(parse_classic_deep_nesting)
+{
+	const char prefix[] = "\\x.(";
+	char *input = malloc(DEEP_NESTING * (sizeof(prefix) - 1) + DEEP_NESTING + 1);
+	unsigned int input_len = 0;
+
+	for (unsigned int i = 0; i < DEEP_NESTING; ++i) {
+		memcpy(input + input_len, prefix, sizeof(prefix) - 1);
+		input_len += sizeof(prefix) - 1;
+	}
+	input[input_len++] = 'x';
+	memset(input + input_len, ')', DEEP_NESTING - 1);
+	input_len += DEEP_NESTING - 1;
+
+	struct dulcet_parse_result result = dulcet_parse_classic(input, input_len);
+	ZIDANE_VERIFY(result.kind == DULCET_PARSE_ERROR);
+	ZIDANE_VERIFY(result.error.cause == DULCET_PARSE_ERROR_CAUSE_UNMATCHED_PAREN);
+	ZIDANE_VERIFY(result.error.column == 4);
+
+	input[input_len++] = ')';
+
+	result = dulcet_parse_classic(input, input_len);
+	ZIDANE_VERIFY(result.kind == DULCET_PARSE_OK);
+
+	struct dulcet_term *t = result.value;
+	for (unsigned int i = 0; i < DEEP_NESTING; ++i) {
+		ZIDANE_VERIFY(t->kind == DULCET_TERM_KIND_ABS);
+		t = t->abs.m;
+	}
+	ZIDANE_VERIFY(dulcet_term_kind(t) == DULCET_TERM_KIND_VAR && dulcet_var_index(t) == 1);
+
+	dulcet_term_free(result.value);
+	free(input);
+}
+
+ZIDANE_TEST(parse_de_bruijn_deep_nesting)
+{
+	char *input = malloc(2 * DEEP_NESTING + 2);
+	unsigned int input_len = 0;
+
+	memset(input, '(', DEEP_NESTING);
+	input_len += DEEP_NESTING;
+	input[input_len++] = '\\';
+	input[input_len++] = '1';
+	memset(input + input_len, ')', DEEP_NESTING);
+	input_len += DEEP_NESTING;
+
+	struct dulcet_term *expected = ABS(VAR(1));
+
+	struct dulcet_parse_result result = dulcet_parse_de_bruijn(input, input_len);
+	ZIDANE_VERIFY(result.kind == DULCET_PARSE_OK);
+
+	struct dulcet_term *actual = result.value;
+	ZIDANE_VERIFY(dulcet_term_eq(actual, expected));
+
+	dulcet_term_free(actual);
+	dulcet_term_free(expected);
+	free(input);
+}
+
+ZIDANE_TEST(parse_classic_profile)
+{
+	struct dulcet_profile profile;
+	dulcet_profile_init(&profile);
+	profile.source = "test.lc";
+
+	dulcet_set_profile(&profile);
+
+	const char *input = "(\\x.x x)\n  (\\y.y)";
+	struct dulcet_parse_result result = dulcet_parse_classic(input, strlen(input));
+	ZIDANE_VERIFY(result.kind == DULCET_PARSE_OK);
+
+	struct dulcet_term *t = result.value;
+	ZIDANE_VERIFY(profile.size == 2);
+
+	unsigned int x = t->app.m->abs.origin;
+	unsigned int y = t->app.n->abs.origin;
+	ZIDANE_VERIFY(x > 0 && y > 0 && x != y);
+	ZIDANE_VERIFY(profile.entries[x - 1].line == 1 && profile.entries[x - 1].column == 2);
+	ZIDANE_VERIFY(profile.entries[y - 1].line == 2 && profile.entries[y - 1].column == 4);
+	ZIDANE_VERIFY(strcmp(profile.entries[x - 1].parameter, "x") == 0);
+
+	dulcet_beta_nor(t);
+
+	// The first step copies `\y.y` into one occurrence of `x` and moves it into the other, and
+	// the second applies one of them
+	ZIDANE_VERIFY(profile.entries[x - 1].reductions == 1);
+	ZIDANE_VERIFY(profile.entries[x - 1].substitutions == 2);
+	ZIDANE_VERIFY(profile.entries[x - 1].nodes_copied == 2);
+	ZIDANE_VERIFY(profile.entries[y - 1].reductions == 1);
+	ZIDANE_VERIFY(t->kind == DULCET_TERM_KIND_ABS && t->abs.origin == y);
+
+	dulcet_set_profile(NULL);
+
+	dulcet_term_free(t);
+	dulcet_profile_deinit(&profile);
+}
+
+ZIDANE_TEST(parse_classic_let_shared)
+{
+	const char *input = "let two = \\f.\\x.f (f x) in two two";
+	struct dulcet_term *two = ABS(ABS(APP(VAR(2), APP(VAR(2), VAR(1)))));
+	struct dulcet_term *expected = APP(dulcet_term_copy(two), dulcet_term_copy(two));
+
+	struct dulcet_parse_result result = dulcet_parse_classic(input, strlen(input));
+	ZIDANE_VERIFY(result.kind == DULCET_PARSE_OK);
+
+	// Each occurrence is a single node, referring to the same definition
+	struct dulcet_term *actual = result.value;
+	ZIDANE_VERIFY(actual->app.m->kind == DULCET_TERM_KIND_REF);
+	ZIDANE_VERIFY(actual->app.m->ref.shared == actual->app.n->ref.shared);
+	ZIDANE_VERIFY(dulcet_term_size(actual) == 3);
+	ZIDANE_VERIFY(dulcet_term_eq(actual, expected));
+
+	dulcet_beta_nor(actual);
+	dulcet_beta_nor(expected);
+	ZIDANE_VERIFY(dulcet_term_eq(actual, expected));
+
+	dulcet_term_free(actual);
+	dulcet_term_free(expected);
+	dulcet_term_free(two);
+}
+
+ZIDANE_TEST(parse_classic_let_open)
+{
+	// A definition that refers to an enclosing parameter is applied to the body instead
+	const char *input = "\\y.let k = \\x.y in k k";
+	struct dulcet_term *expected = ABS(APP(ABS(APP(VAR(1), VAR(1))), ABS(VAR(2))));
+
+	struct dulcet_parse_result result = dulcet_parse_classic(input, strlen(input));
+	ZIDANE_VERIFY(result.kind == DULCET_PARSE_OK);
+
+	struct dulcet_term *actual = result.value;
+	ZIDANE_VERIFY(dulcet_term_eq(actual, expected));
+
+	dulcet_term_free(actual);
+	dulcet_term_free(expected);
+}
+
+ZIDANE_TEST(parse_classic_constants)
+{
+	// Names that something binds are not constants, and `=` only names a definition after let
+	const char *input = "\\if.let x = = -7 (+ 1 2) in if x";
+	struct dulcet_term *expected = ABS(
+		APP(VAR(1), APP(APP(dulcet_alloc_prim(DULCET_PRIM_OP_EQ), dulcet_alloc_int(-7)),
+				APP(APP(dulcet_alloc_prim(DULCET_PRIM_OP_ADD), dulcet_alloc_int(1)),
+				    dulcet_alloc_int(2)))));
+
+	struct dulcet_parse_result result = dulcet_parse_classic(input, strlen(input));
+	ZIDANE_VERIFY(result.kind == DULCET_PARSE_OK);
+	ZIDANE_VERIFY(dulcet_term_eq(result.value, expected));
+	dulcet_term_free(result.value);
+
+	input = "\\(= -7 (+ 1 2))";
+	result = dulcet_parse_de_bruijn(input, strlen(input));
+	ZIDANE_VERIFY(result.kind == DULCET_PARSE_ERROR);
+
+	input = "\\1 (= #-7 (+ #1 #2))";
+	result = dulcet_parse_de_bruijn(input, strlen(input));
+	ZIDANE_VERIFY(result.kind == DULCET_PARSE_OK);
+	ZIDANE_VERIFY(dulcet_term_eq(result.value, expected));
+	dulcet_term_free(result.value);
+
+	// Too large for a machine integer
+	input = "9223372036854775808";
+	result = dulcet_parse_classic(input, strlen(input));
+	ZIDANE_VERIFY(result.kind == DULCET_PARSE_ERROR &&
+		      result.error.cause == DULCET_PARSE_ERROR_CAUSE_UNEXPECTED_TOKEN);
+
+	input = "-9223372036854775808";
+	result = dulcet_parse_classic(input, strlen(input));
+	ZIDANE_VERIFY(result.kind == DULCET_PARSE_OK &&
+		      result.value->integer.value == -9223372036854775807 - 1);
+	dulcet_term_free(result.value);
+
+	dulcet_term_free(expected);
+}
+
+ZIDANE_TEST(parse_classic_top_level_definitions)
+{
+	const char *input = "id = \\x.x\n"
+			    "twice = \\f.\\x.f (f x)\n"
+			    "  ; a comment\n"
+			    "twice id\n";
+	struct dulcet_term *expected = ABS(VAR(1));
+
+	struct dulcet_parse_result result = dulcet_parse_classic(input, strlen(input));
+	ZIDANE_VERIFY(result.kind == DULCET_PARSE_OK);
+
+	struct dulcet_term *actual = result.value;
+	dulcet_beta_nor(actual);
+	ZIDANE_VERIFY(dulcet_term_eq(actual, expected));
+
+	dulcet_term_free(actual);
+	dulcet_term_free(expected);
+
+	// The term that uses the definitions is missing
+	input = "id = \\x.x\n";
+	result = dulcet_parse_classic(input, strlen(input));
+	ZIDANE_VERIFY(result.kind == DULCET_PARSE_ERROR);
+	ZIDANE_VERIFY(result.error.cause == DULCET_PARSE_ERROR_CAUSE_UNEXPECTED_TOKEN);
+}
+
+// Inputs of growing size for the parser benchmarks, in either notation
+enum bench_input_shape {
+	BENCH_INPUT_SHAPE_DEEP,
+	BENCH_INPUT_SHAPE_WIDE,
+	BENCH_INPUT_SHAPE_IDENTIFIERS,
+	BENCH_INPUT_SHAPE_COMMENTS,
+};
+
+static const unsigned int bench_input_sizes[] = { 1u << 10, 1u << 13, 1u << 16 };
+
+// Number of binders the long identifiers, or the large indices in de Bruijn notation, refer to
+#define BENCH_INPUT_BINDERS 256
+
+struct bench_input {
+	char *data;
+	unsigned int size;
+	unsigned int capacity;
+};
+
+static void bench_input_append(struct bench_input *input, const char *s)
+{
+	size_t len = strlen(s);
+
+	if (input->size + len + 1 > input->capacity) {
+		input->capacity = 2 * (input->size + len + 1);
+		input->data = realloc(input->data, input->capacity);
+	}
+
+	memcpy(input->data + input->size, s, len + 1);
+	input->size += len;
+}
+
+static void bench_input_generate(struct bench_input *input, enum bench_input_shape shape,
+				 bool de_bruijn, unsigned int n)
+{
+	char buf[64];
+
+	input->size = 0;
+
+	switch (shape) {
+	case BENCH_INPUT_SHAPE_DEEP:
+		for (unsigned int i = 0; i < n; ++i) {
+			bench_input_append(input, de_bruijn ? "(\\" : "\\x.(");
+		}
+		bench_input_append(input, de_bruijn ? "1" : "x");
+		for (unsigned int i = 0; i < n; ++i) {
+			bench_input_append(input, ")");
+		}
+		break;
+
+	case BENCH_INPUT_SHAPE_WIDE:
+		bench_input_append(input, de_bruijn ? "\\" : "\\x.");
+		for (unsigned int i = 0; i < n; ++i) {
+			bench_input_append(input, de_bruijn ? " 1" : " x");
+		}
+		break;
+
+	case BENCH_INPUT_SHAPE_IDENTIFIERS:
+		for (unsigned int i = 0; i < BENCH_INPUT_BINDERS; ++i) {
+			if (de_bruijn) {
+				bench_input_append(input, "\\");
+			} else {
+				snprintf(buf, sizeof(buf), "\\a_rather_long_identifier_%03u.", i);
+				bench_input_append(input, buf);
+			}
+		}
+		for (unsigned int i = 0; i < n; ++i) {
+			unsigned int j = (i * 7) % BENCH_INPUT_BINDERS;
+			if (de_bruijn) {
+				snprintf(buf, sizeof(buf), " %u", BENCH_INPUT_BINDERS - j);
+			} else {
+				snprintf(buf, sizeof(buf), " a_rather_long_identifier_%03u", j);
+			}
+			bench_input_append(input, buf);
+		}
+		break;
+
+	case BENCH_INPUT_SHAPE_COMMENTS:
+		bench_input_append(input, de_bruijn ? "\\" : "\\x.");
+		for (unsigned int i = 0; i < n; ++i) {
+			bench_input_append(input, "; a comment that goes on for a while, as they do\n");
+			bench_input_append(input, de_bruijn ? "(1 1)\n" : "(x x)\n");
+		}
+		break;
+	}
+}
+
+static void bench_parse(struct zidane_bench *__zidane_bench, enum bench_input_shape shape,
+			bool de_bruijn)
+{
+	struct dulcet_parse_result (*parse)(const char *, unsigned int) =
+		de_bruijn ? dulcet_parse_de_bruijn : dulcet_parse_classic;
+
+	struct bench_input input = { 0 };
+
+	// The terms are freed after the loop, so that only parsing is timed
+	struct dulcet_term *terms[ZIDANE_BENCH_WARMUP + ZIDANE_BENCH_ITERATIONS];
+
+	for (size_t i = 0; i < ARRAY_SIZE(bench_input_sizes); ++i) {
+		bench_input_generate(&input, shape, de_bruijn, bench_input_sizes[i]);
+
+		struct dulcet_parse_result result = parse(input.data, input.size);
+		ZIDANE_VERIFY(result.kind == DULCET_PARSE_OK);
+		if (result.kind != DULCET_PARSE_OK) {
+			break;
+		}
+
+		ZIDANE_BENCH_CASE("%u", bench_input_sizes[i]);
+		ZIDANE_BENCH_BYTES(input.size);
+		ZIDANE_BENCH_ITEMS(dulcet_term_size(result.value), "nodes");
+		dulcet_term_free(result.value);
+
+		size_t terms_size = 0;
+		ZIDANE_BENCH_LOOP {
+			terms[terms_size++] = parse(input.data, input.size).value;
+		}
+
+		for (size_t j = 0; j < terms_size; ++j) {
+			dulcet_term_free(terms[j]);
+		}
+	}
+
+	free(input.data);
+}
+
+ZIDANE_BENCH(parse_classic_deep)
+{
+	bench_parse(__zidane_bench, BENCH_INPUT_SHAPE_DEEP, false);
+}
+
+ZIDANE_BENCH(parse_classic_wide)
+{
+	bench_parse(__zidane_bench, BENCH_INPUT_SHAPE_WIDE, false);
+}
+
+ZIDANE_BENCH(parse_classic_identifiers)
+{
+	bench_parse(__zidane_bench, BENCH_INPUT_SHAPE_IDENTIFIERS, false);
+}
+
+ZIDANE_BENCH(parse_classic_comments)
+{
+	bench_parse(__zidane_bench, BENCH_INPUT_SHAPE_COMMENTS, false);
+}
+
+ZIDANE_BENCH(parse_de_bruijn_deep)
+{
+	bench_parse(__zidane_bench, BENCH_INPUT_SHAPE_DEEP, true);
+}
+
+ZIDANE_BENCH(parse_de_bruijn_wide)
+{
+	bench_parse(__zidane_bench, BENCH_INPUT_SHAPE_WIDE, true);
+}
+
+// With de Bruijn indices, the long identifiers become indices of several digits
+ZIDANE_BENCH(parse_de_bruijn_identifiers)
+{
+	bench_parse(__zidane_bench, BENCH_INPUT_SHAPE_IDENTIFIERS, true);
+}
+
+ZIDANE_BENCH(parse_de_bruijn_comments)
+{
+	bench_parse(__zidane_bench, BENCH_INPUT_SHAPE_COMMENTS, true);
+}
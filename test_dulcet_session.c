@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2022 Leonardo Duarte
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "dulcet.h"
+#include "dulcet_parser.h"
+#include "dulcet_session.h"
+
+#define ZIDANE_IMPLEMENTATION
+#include "zidane.h"
+
+#define ARRAY_SIZE(xs) (sizeof(xs) / sizeof(*(xs)))
+
+#define VAR(x) dulcet_alloc_var(x)
+#define ABS(m) dulcet_alloc_abs(m)
+#define APP(m, n) dulcet_alloc_app(m, n)
+
+#define EXEC(session, statement) \
+	dulcet_session_exec((session), (statement), ARRAY_SIZE(statement) - 1)
+
+ZIDANE_TEST(session_define_normalizes)
+{
+	struct dulcet_session session;
+	dulcet_session_init(&session);
+
+	struct dulcet_parse_result result = EXEC(&session, "id = (\\x.x) (\\y.y)");
+	ZIDANE_VERIFY(result.kind == DULCET_PARSE_OK);
+	ZIDANE_VERIFY(result.value == NULL);
+
+	struct dulcet_term *expected = ABS(VAR(1));
+
+	const struct dulcet_term *actual = dulcet_session_lookup(&session, "id", 2);
+	ZIDANE_VERIFY(actual != NULL);
+	ZIDANE_VERIFY(dulcet_term_eq((struct dulcet_term *) actual, expected));
+
+	dulcet_term_free(expected);
+	dulcet_session_deinit(&session);
+}
+
+ZIDANE_TEST(session_query)
+{
+	struct dulcet_session session;
+	dulcet_session_init(&session);
+
+	EXEC(&session, "plus = \\m.\\n.\\f.\\x.m f (n f x)");
+	EXEC(&session, "two = \\f.\\x.f (f x)");
+	EXEC(&session, "Y := \\g.(\\x.g (x x)) (\\x.g (x x))");
+
+	struct dulcet_parse_result result = EXEC(&session, "plus two two");
+	ZIDANE_VERIFY(result.kind == DULCET_PARSE_OK);
+
+	struct dulcet_term *expected =
+		ABS(ABS(APP(VAR(2), APP(VAR(2), APP(VAR(2), APP(VAR(2), VAR(1)))))));
+
+	ZIDANE_VERIFY(dulcet_term_eq(result.value, expected));
+	ZIDANE_VERIFY(dulcet_session_lookup(&session, "Y", 1) != NULL);
+
+	dulcet_term_free(expected);
+	dulcet_term_free(result.value);
+	dulcet_session_deinit(&session);
+}
+
+ZIDANE_TEST(session_define_image)
+{
+	struct dulcet_session session;
+	dulcet_session_init(&session);
+
+	EXEC(&session, "plus = \\m.\\n.\\f.\\x.m f (n f x)");
+	EXEC(&session, "two = \\f.\\x.f (f x)");
+
+	struct dulcet_image image;
+	const struct dulcet_term *terms[] = { session.definitions[0].value,
+					      session.definitions[1].value };
+	const char *names[] = { "plus", "two" };
+	dulcet_image_build(&image, terms, names, ARRAY_SIZE(terms));
+	dulcet_session_deinit(&session);
+
+	struct dulcet_loaded_image loaded;
+	dulcet_image_load(&loaded, &image);
+	dulcet_session_init(&session);
+	ZIDANE_VERIFY(dulcet_session_define_image(&session, &loaded) == 0);
+
+	struct dulcet_parse_result result = EXEC(&session, "plus two two");
+	ZIDANE_VERIFY(result.kind == DULCET_PARSE_OK);
+
+	struct dulcet_term *expected =
+		ABS(ABS(APP(VAR(2), APP(VAR(2), APP(VAR(2), APP(VAR(2), VAR(1)))))));
+
+	ZIDANE_VERIFY(dulcet_term_eq(result.value, expected));
+
+	dulcet_term_free(expected);
+	dulcet_term_free(result.value);
+	dulcet_session_deinit(&session);
+	dulcet_image_unload(&loaded);
+	dulcet_image_free(&image);
+}
+
+ZIDANE_TEST(session_redefine)
+{
+	struct dulcet_session session;
+	dulcet_session_init(&session);
+
+	EXEC(&session, "x = \\a.\\b.a");
+	EXEC(&session, "x = \\a.\\b.b");
+
+	struct dulcet_parse_result result = EXEC(&session, "x");
+	ZIDANE_VERIFY(result.kind == DULCET_PARSE_OK);
+
+	struct dulcet_term *expected = ABS(ABS(VAR(1)));
+
+	ZIDANE_VERIFY(dulcet_term_eq(result.value, expected));
+	ZIDANE_VERIFY(session.definitions_size == 1);
+
+	dulcet_term_free(expected);
+	dulcet_term_free(result.value);
+	dulcet_session_deinit(&session);
+}
+
+ZIDANE_TEST(session_definition_error_location)
+{
+	struct dulcet_session session;
+	dulcet_session_init(&session);
+
+	struct dulcet_parse_result result = EXEC(&session, "f = \\x.y");
+	ZIDANE_VERIFY(result.kind == DULCET_PARSE_ERROR);
+	ZIDANE_VERIFY(result.error.cause == DULCET_PARSE_ERROR_CAUSE_UNBOUND_VARIABLE);
+	ZIDANE_VERIFY(result.error.line == 1);
+	ZIDANE_VERIFY(result.error.column == 8);
+	ZIDANE_VERIFY(dulcet_session_lookup(&session, "f", 1) == NULL);
+
+	dulcet_session_deinit(&session);
+}
@@ -0,0 +1,344 @@
+/*
+ * Copyright (c) 2022 Leonardo Duarte
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "dulceti_server.h"
+
+#define ZIDANE_IMPLEMENTATION
+#include "zidane.h"
+
+#define ARRAY_SIZE(xs) (sizeof(xs) / sizeof(*(xs)))
+
+// A single server is shared by every test, as it stops on signals to the whole process, and is left
+// running until the tests exit
+static char socket_path[64];
+static struct dulcet_session session;
+static once_flag server_once = ONCE_FLAG_INIT;
+
+static int server_run(void *arg)
+{
+	(void) arg;
+
+	return dulceti_serve(socket_path, 2, &session);
+}
+
+static void server_remove_socket(void)
+{
+	unlink(socket_path);
+}
+
+static void server_start(void)
+{
+	snprintf(socket_path, sizeof(socket_path), "/tmp/test_dulceti_server.%ld.sock",
+		 (long) getpid());
+	dulcet_session_init(&session);
+
+	thrd_t thread;
+	thrd_create(&thread, server_run, NULL);
+	thrd_detach(thread);
+
+	atexit(server_remove_socket);
+}
+
+// Connects to the server, waiting for it to listen for a while
+static int server_connect(void)
+{
+	call_once(&server_once, server_start);
+
+	struct sockaddr_un addr = { .sun_family = AF_UNIX };
+	strcpy(addr.sun_path, socket_path);
+
+	for (int attempt = 0; attempt < 500; ++attempt) {
+		int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (fd < 0) {
+			return -1;
+		}
+
+		if (connect(fd, (struct sockaddr *) &addr, sizeof(addr)) == 0) {
+			return fd;
+		}
+		close(fd);
+
+		nanosleep(&(struct timespec) { .tv_nsec = 10000000 }, NULL);
+	}
+
+	return -1;
+}
+
+static void put_u32(unsigned char *buf, uint32_t value)
+{
+	for (int i = 3; i >= 0; --i) {
+		buf[i] = value & 0xff;
+		value >>= 8;
+	}
+}
+
+static void put_u64(unsigned char *buf, uint64_t value)
+{
+	for (int i = 7; i >= 0; --i) {
+		buf[i] = value & 0xff;
+		value >>= 8;
+	}
+}
+
+static uint64_t get_u64(const unsigned char *buf)
+{
+	uint64_t value = 0;
+	for (int i = 0; i < 8; ++i) {
+		value = (value << 8) | buf[i];
+	}
+	return value;
+}
+
+// Writes a request frame for `text` into `buf`, returning its size
+static size_t request_frame(unsigned char *buf, unsigned char version,
+			    enum dulceti_notation notation, enum dulceti_strategy strategy,
+			    uint64_t step_limit, const char *text)
+{
+	size_t text_len = strlen(text);
+
+	put_u32(buf, DULCETI_REQUEST_HEADER_SIZE + text_len);
+	buf[4] = version;
+	buf[5] = notation;
+	buf[6] = strategy;
+	buf[7] = 0;
+	put_u64(buf + 8, step_limit);
+	memcpy(buf + 4 + DULCETI_REQUEST_HEADER_SIZE, text, text_len);
+
+	return 4 + DULCETI_REQUEST_HEADER_SIZE + text_len;
+}
+
+static int send_all(int fd, const void *buf, size_t size)
+{
+	return write(fd, buf, size) == (ssize_t) size ? 0 : -1;
+}
+
+static int recv_all(int fd, void *buf, size_t size)
+{
+	size_t done = 0;
+
+	while (done < size) {
+		ssize_t rc = read(fd, (char *) buf + done, size - done);
+		if (rc <= 0) {
+			return -1;
+		}
+		done += rc;
+	}
+
+	return 0;
+}
+
+// Reads a response, with its text NUL-terminated in `text`, returning -1 if there is none
+static int recv_response(int fd, struct dulceti_response *response, char *text, size_t text_size)
+{
+	unsigned char header[4 + DULCETI_RESPONSE_HEADER_SIZE];
+	if (recv_all(fd, header, sizeof(header)) < 0) {
+		return -1;
+	}
+
+	uint32_t size = (uint32_t) header[0] << 24 | header[1] << 16 | header[2] << 8 | header[3];
+	if (size < DULCETI_RESPONSE_HEADER_SIZE ||
+	    size - DULCETI_RESPONSE_HEADER_SIZE >= text_size) {
+		return -1;
+	}
+
+	*response = (struct dulceti_response) {
+		.status = header[4],
+		.steps = get_u64(header + 8),
+		.text_len = size - DULCETI_RESPONSE_HEADER_SIZE,
+	};
+
+	if (recv_all(fd, text, response->text_len) < 0) {
+		return -1;
+	}
+	text[response->text_len] = '\0';
+
+	return 0;
+}
+
+ZIDANE_TEST(serve_split_frame)
+{
+	int fd = server_connect();
+	ZIDANE_VERIFY(fd >= 0);
+
+	unsigned char frame[256];
+	size_t size = request_frame(frame, DULCETI_PROTOCOL_VERSION, DULCETI_NOTATION_CLASSIC,
+				    DULCETI_STRATEGY_NOR, 0, "(\\x.x) (\\y.y)");
+
+	// A frame may arrive in any number of pieces, even within its length
+	size_t cuts[] = { 2, 9, 17, size };
+	size_t done = 0;
+	for (size_t i = 0; i < ARRAY_SIZE(cuts); ++i) {
+		ZIDANE_VERIFY(send_all(fd, frame + done, cuts[i] - done) == 0);
+		done = cuts[i];
+		nanosleep(&(struct timespec) { .tv_nsec = 1000000 }, NULL);
+	}
+
+	struct dulceti_response response;
+	char text[256];
+	ZIDANE_VERIFY(recv_response(fd, &response, text, sizeof(text)) == 0);
+	ZIDANE_VERIFY(response.status == DULCETI_STATUS_OK);
+	ZIDANE_VERIFY(response.steps == 1);
+	ZIDANE_VERIFY(strcmp(text, "λa.a") == 0);
+
+	close(fd);
+}
+
+ZIDANE_TEST(serve_requests_on_one_connection)
+{
+	int fd = server_connect();
+	ZIDANE_VERIFY(fd >= 0);
+
+	// Every request is sent before any response is read, and they are answered in order
+	unsigned char frames[512];
+	size_t size = 0;
+	size += request_frame(frames + size, DULCETI_PROTOCOL_VERSION, DULCETI_NOTATION_CLASSIC,
+			      DULCETI_STRATEGY_NOR, 0, "(\\x.x) (\\y.y)");
+	size += request_frame(frames + size, DULCETI_PROTOCOL_VERSION, DULCETI_NOTATION_DE_BRUIJN,
+			      DULCETI_STRATEGY_APP, 0, "(\\\\1) (\\\\1)");
+	size += request_frame(frames + size, DULCETI_PROTOCOL_VERSION, DULCETI_NOTATION_CLASSIC,
+			      DULCETI_STRATEGY_NOR, 5, "(\\x.x x) (\\x.x x)");
+	size += request_frame(frames + size, DULCETI_PROTOCOL_VERSION, DULCETI_NOTATION_CLASSIC,
+			      DULCETI_STRATEGY_NOR, 0, "\\x.y");
+	ZIDANE_VERIFY(send_all(fd, frames, size) == 0);
+
+	struct dulceti_response response;
+	char text[256];
+
+	ZIDANE_VERIFY(recv_response(fd, &response, text, sizeof(text)) == 0);
+	ZIDANE_VERIFY(response.status == DULCETI_STATUS_OK);
+	ZIDANE_VERIFY(strcmp(text, "λa.a") == 0);
+
+	ZIDANE_VERIFY(recv_response(fd, &response, text, sizeof(text)) == 0);
+	ZIDANE_VERIFY(response.status == DULCETI_STATUS_OK);
+	ZIDANE_VERIFY(strcmp(text, "λ1") == 0);
+
+	ZIDANE_VERIFY(recv_response(fd, &response, text, sizeof(text)) == 0);
+	ZIDANE_VERIFY(response.status == DULCETI_STATUS_STEP_LIMIT);
+	ZIDANE_VERIFY(response.steps == 5);
+	ZIDANE_VERIFY(strcmp(text, "(λa.a a) (λa.a a)") == 0);
+
+	ZIDANE_VERIFY(recv_response(fd, &response, text, sizeof(text)) == 0);
+	ZIDANE_VERIFY(response.status == DULCETI_STATUS_PARSE_ERROR);
+
+	close(fd);
+}
+
+ZIDANE_TEST(serve_bad_header)
+{
+	int fd = server_connect();
+	ZIDANE_VERIFY(fd >= 0);
+
+	unsigned char frame[256];
+	struct dulceti_response response;
+	char text[256];
+
+	size_t size = request_frame(frame, DULCETI_PROTOCOL_VERSION + 1, DULCETI_NOTATION_CLASSIC,
+				    DULCETI_STRATEGY_NOR, 0, "\\x.x");
+	ZIDANE_VERIFY(send_all(fd, frame, size) == 0);
+	ZIDANE_VERIFY(recv_response(fd, &response, text, sizeof(text)) == 0);
+	ZIDANE_VERIFY(response.status == DULCETI_STATUS_BAD_REQUEST);
+
+	size = request_frame(frame, DULCETI_PROTOCOL_VERSION, DULCETI_NOTATION_CLASSIC,
+			     DULCETI_STRATEGY_PORTFOLIO + 1, 0, "\\x.x");
+	ZIDANE_VERIFY(send_all(fd, frame, size) == 0);
+	ZIDANE_VERIFY(recv_response(fd, &response, text, sizeof(text)) == 0);
+	ZIDANE_VERIFY(response.status == DULCETI_STATUS_BAD_REQUEST);
+
+	// Shorter than a header
+	unsigned char short_frame[] = { 0, 0, 0, 2, DULCETI_PROTOCOL_VERSION, 0 };
+	ZIDANE_VERIFY(send_all(fd, short_frame, sizeof(short_frame)) == 0);
+	ZIDANE_VERIFY(recv_response(fd, &response, text, sizeof(text)) == 0);
+	ZIDANE_VERIFY(response.status == DULCETI_STATUS_BAD_REQUEST);
+
+	// The frames were whole, so the connection goes on
+	size = request_frame(frame, DULCETI_PROTOCOL_VERSION, DULCETI_NOTATION_CLASSIC,
+			     DULCETI_STRATEGY_NOR, 0, "\\x.x");
+	ZIDANE_VERIFY(send_all(fd, frame, size) == 0);
+	ZIDANE_VERIFY(recv_response(fd, &response, text, sizeof(text)) == 0);
+	ZIDANE_VERIFY(response.status == DULCETI_STATUS_OK);
+	ZIDANE_VERIFY(strcmp(text, "λa.a") == 0);
+
+	close(fd);
+}
+
+ZIDANE_TEST(serve_oversized_frame)
+{
+	int fd = server_connect();
+	ZIDANE_VERIFY(fd >= 0);
+
+	unsigned char frame[4 + DULCETI_REQUEST_HEADER_SIZE] = { 0 };
+	put_u32(frame, DULCETI_MAX_FRAME_SIZE + 1);
+	frame[4] = DULCETI_PROTOCOL_VERSION;
+	ZIDANE_VERIFY(send_all(fd, frame, sizeof(frame)) == 0);
+
+	struct dulceti_response response;
+	char text[256];
+	ZIDANE_VERIFY(recv_response(fd, &response, text, sizeof(text)) == 0);
+	ZIDANE_VERIFY(response.status == DULCETI_STATUS_BAD_REQUEST);
+
+	// Then the connection is closed, as the rest of the frame cannot be told from the next one
+	ZIDANE_VERIFY(recv_response(fd, &response, text, sizeof(text)) < 0);
+
+	close(fd);
+}
+
+ZIDANE_TEST(serve_depth_limit)
+{
+	int fd = server_connect();
+	ZIDANE_VERIFY(fd >= 0);
+
+	// Applicative order keeps unfolding the fixed point combinator ever deeper, which stops it
+	// rather than the server
+	unsigned char frame[256];
+	size_t size = request_frame(frame, DULCETI_PROTOCOL_VERSION, DULCETI_NOTATION_CLASSIC,
+				    DULCETI_STRATEGY_APP, 0,
+				    "(\\g.(\\x.g (x x)) (\\x.g (x x))) (\\r.\\n.n)");
+	ZIDANE_VERIFY(send_all(fd, frame, size) == 0);
+
+	struct dulceti_response response;
+	static char text[1 << 24];
+	ZIDANE_VERIFY(recv_response(fd, &response, text, sizeof(text)) == 0);
+	ZIDANE_VERIFY(response.status == DULCETI_STATUS_DEPTH_LIMIT);
+
+	// Nor does it stop the portfolio, whose normal order reaches the depth limit on 2^21, as a
+	// numeral is a term as deep as it is large, while applicative order is cancelled
+	char exp[256] = "(\\m.\\n.n m) (\\f.\\x.f (f x)) (\\f.\\x.";
+	for (int i = 0; i < 21; ++i) {
+		strcat(exp, "f (");
+	}
+	strcat(exp, "x");
+	for (int i = 0; i < 21; ++i) {
+		strcat(exp, ")");
+	}
+	strcat(exp, ")");
+
+	size = request_frame(frame, DULCETI_PROTOCOL_VERSION, DULCETI_NOTATION_CLASSIC,
+			     DULCETI_STRATEGY_PORTFOLIO, 0, exp);
+	ZIDANE_VERIFY(send_all(fd, frame, size) == 0);
+	ZIDANE_VERIFY(recv_response(fd, &response, text, sizeof(text)) == 0);
+	ZIDANE_VERIFY(response.status == DULCETI_STATUS_DEPTH_LIMIT);
+
+	// And the server goes on
+	size = request_frame(frame, DULCETI_PROTOCOL_VERSION, DULCETI_NOTATION_CLASSIC,
+			     DULCETI_STRATEGY_NOR, 0, "(\\g.(\\x.g (x x)) (\\x.g (x x))) (\\r.\\n.n)");
+	ZIDANE_VERIFY(send_all(fd, frame, size) == 0);
+	ZIDANE_VERIFY(recv_response(fd, &response, text, sizeof(text)) == 0);
+	ZIDANE_VERIFY(response.status == DULCETI_STATUS_OK);
+	ZIDANE_VERIFY(strcmp(text, "λa.a") == 0);
+
+	close(fd);
+}
@@ -8,6 +8,7 @@
 #define _ZIDANE_H
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 
 #ifndef ZIDANE_SINGLE_THREADED
@@ -37,21 +38,102 @@
 			&(struct __zidane_test_fn_container) {             \
 				.s = #name,                                \
 				.f = __ZIDANE_TEST_FUNC_NAME(name),        \
+				.b = NULL,                                 \
 			};                                                 \
 	static void __ZIDANE_TEST_FUNC_NAME(name)()
 
+// Benchmarks are registered alongside the tests, but only run when the environment variable
+// `ZIDANE_BENCH` is set, one at a time on the main thread once every test is done. Their body
+// prepares whatever is needed, and then times the statement that follows `ZIDANE_BENCH_LOOP`
+// over a number of iterations, after a few more to warm up:
+//
+//	ZIDANE_BENCH(name)
+//	{
+//		setup();
+//
+//		ZIDANE_BENCH_LOOP {
+//			work();
+//		}
+//
+//		teardown();
+//	}
+//
+// A benchmark may time several loops, e.g. one per size of its input, each of them reported on a
+// line of its own under the label given by `ZIDANE_BENCH_CASE`, which takes a format and its
+// arguments like `printf`. Before a loop, `ZIDANE_BENCH_BYTES` and `ZIDANE_BENCH_ITEMS` declare how
+// much work a single iteration does, so that its throughput is reported along with its times:
+//
+//	ZIDANE_BENCH_CASE("%zu", size);
+//	ZIDANE_BENCH_BYTES(size);
+//	ZIDANE_BENCH_ITEMS(count, "nodes");
+//	ZIDANE_BENCH_LOOP {
+//		work(input, size);
+//	}
+#define __ZIDANE_BENCH_FUNC_NAME(name) __zidane_bench_##name
+
+#define ZIDANE_BENCH(name)                                                      \
+	static void __ZIDANE_BENCH_FUNC_NAME(name)(struct zidane_bench *);      \
+	static struct __zidane_test_fn_container *__zidane_bench_ptr_##name     \
+		__attribute((used, section("test_suite_array"))) =              \
+			&(struct __zidane_test_fn_container) {                  \
+				.s = #name,                                     \
+				.f = NULL,                                      \
+				.b = __ZIDANE_BENCH_FUNC_NAME(name),            \
+			};                                                      \
+	static void __ZIDANE_BENCH_FUNC_NAME(name)(struct zidane_bench * __zidane_bench)
+
+#ifndef ZIDANE_BENCH_WARMUP
+#define ZIDANE_BENCH_WARMUP 3
+#endif
+
+#ifndef ZIDANE_BENCH_ITERATIONS
+#define ZIDANE_BENCH_ITERATIONS 15
+#endif
+
+#define ZIDANE_BENCH_LOOP_N(warmup, iterations)                                    \
+	for (__zidane_bench_begin(__zidane_bench, (warmup), (iterations));          \
+	     __zidane_bench_next(__zidane_bench);)
+
+#define ZIDANE_BENCH_LOOP ZIDANE_BENCH_LOOP_N(ZIDANE_BENCH_WARMUP, ZIDANE_BENCH_ITERATIONS)
+
+#define ZIDANE_BENCH_CASE(...) \
+	snprintf(__zidane_bench->label, sizeof(__zidane_bench->label), __VA_ARGS__)
+
+#define ZIDANE_BENCH_BYTES(n) (__zidane_bench->bytes = (n))
+
+#define ZIDANE_BENCH_ITEMS(n, unit) \
+	(__zidane_bench->items = (n), __zidane_bench->items_unit = (unit))
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+struct zidane_bench {
+	const char *name;
+	char label[64];
+	uint64_t bytes;
+	uint64_t items;
+	const char *items_unit;
+
+	unsigned int warmup;
+	unsigned int iterations;
+	unsigned int current;
+	uint64_t start_ns;
+	uint64_t *samples;
+
+	unsigned int loops;
+};
+
 typedef void (*__zidane_test_fn_type)(void);
+typedef void (*__zidane_bench_fn_type)(struct zidane_bench *);
 
 struct __zidane_test_fn_container {
-#ifndef ZIDANE_SINGLE_THREADED
-	thrd_t tid;
-#endif
 	const char *s;
 	__zidane_test_fn_type f;
+	__zidane_bench_fn_type b;
+
+	bool failed;
+	uint64_t elapsed_ns;
 };
 
 struct failure_info {
@@ -67,6 +149,10 @@ extern _Thread_local unsigned int __zidane_failure_info_array_size;
 extern void zidane_init(void);
 extern void zidane_deinit(void);
 
+extern void __zidane_bench_begin(struct zidane_bench *bench, unsigned int warmup,
+				 unsigned int iterations);
+extern bool __zidane_bench_next(struct zidane_bench *bench);
+
 int main(void);
 
 #ifdef __cplusplus
@@ -78,7 +164,13 @@ int main(void);
 #ifdef ZIDANE_IMPLEMENTATION
 #undef ZIDANE_IMPLEMENTATION
 
-#include <sys/time.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifndef ZIDANE_SINGLE_THREADED
+#include <stdatomic.h>
+#endif
 
 _Thread_local bool __zidane_current_test_failed = false;
 _Thread_local struct failure_info __zidane_failure_info_array[256];
@@ -87,81 +179,269 @@ _Thread_local unsigned int __zidane_failure_info_array_size = 0;
 extern struct __zidane_test_fn_container *__start_test_suite_array;
 extern struct __zidane_test_fn_container *__stop_test_suite_array;
 
-#ifndef ZIDANE_SINGLE_THREADED
-static int __zidane_run_test(void *arg)
+static uint64_t __zidane_now_ns(void)
 {
-	struct __zidane_test_fn_container **ptr = arg;
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
 
-	(*ptr)->f();
+	return (uint64_t) ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
 
+static void __zidane_print_time(uint64_t ns)
+{
+	if (ns >= 1000000000u) {
+		printf("%0.3fs", ns / 1e9);
+	} else if (ns >= 1000000u) {
+		printf("%0.3fms", ns / 1e6);
+	} else {
+		printf("%0.3fus", ns / 1e3);
+	}
+}
+
+// Runs a single test on the calling thread, leaving its outcome in the container
+static void __zidane_run_test(struct __zidane_test_fn_container *test)
+{
+	__zidane_current_test_failed = false;
+	__zidane_failure_info_array_size = 0;
+
+	uint64_t start = __zidane_now_ns();
+	test->f();
+	test->elapsed_ns = __zidane_now_ns() - start;
+	test->failed = __zidane_current_test_failed;
+
+#ifndef ZIDANE_SINGLE_THREADED
 	flockfile(stderr);
 	flockfile(stdout);
+#endif
 	for (unsigned int i = 0; i < __zidane_failure_info_array_size; ++i) {
 		fprintf(stderr, "%s:%d: verify failed: %s.\n", __zidane_failure_info_array[i].file,
 			__zidane_failure_info_array[i].line,
 			__zidane_failure_info_array[i].expression);
 	}
 
-	if (__zidane_current_test_failed) {
-		printf("Test case \033[31m`%s`\033[0m failed.\n", (*ptr)->s);
+	if (test->failed) {
+		printf("Test case \033[31m`%s`\033[0m failed.\n", test->s);
 	}
+#ifndef ZIDANE_SINGLE_THREADED
 	funlockfile(stdout);
 	funlockfile(stderr);
+#endif
+}
+
+#ifndef ZIDANE_SINGLE_THREADED
+// Index of the next test for a worker of the pool to take
+static atomic_size_t __zidane_next_test = 0;
+
+static int __zidane_worker(void *arg)
+{
+	size_t tests_size = *(size_t *) arg;
 
-	return __zidane_current_test_failed;
+	for (;;) {
+		size_t i = atomic_fetch_add(&__zidane_next_test, 1);
+		if (i >= tests_size) {
+			return 0;
+		}
+
+		struct __zidane_test_fn_container *test = (&__start_test_suite_array)[i];
+		if (test->f) {
+			__zidane_run_test(test);
+		}
+	}
 }
 
-static void __zidane_run_all_tests(unsigned int *tests_failed_count,
-				   unsigned int *tests_passed_count)
+// The pool has a worker per core, unless the environment variable `ZIDANE_JOBS` says otherwise
+static unsigned int __zidane_workers_count(size_t tests_size)
 {
-	for (struct __zidane_test_fn_container **ptr = &__start_test_suite_array;
-	     ptr < &__stop_test_suite_array; ++ptr) {
-		thrd_t tid;
-		thrd_create(&tid, __zidane_run_test, ptr);
+	long workers = 0;
 
-		(*ptr)->tid = tid;
+	const char *jobs = getenv("ZIDANE_JOBS");
+	if (jobs) {
+		workers = strtol(jobs, NULL, 10);
+	}
+	if (workers <= 0) {
+		workers = sysconf(_SC_NPROCESSORS_ONLN);
+	}
+	if (workers <= 0) {
+		workers = 1;
 	}
 
-	for (struct __zidane_test_fn_container **ptr = &__start_test_suite_array;
-	     ptr < &__stop_test_suite_array; ++ptr) {
-		int ret;
+	return (size_t) workers < tests_size ? (unsigned int) workers : (unsigned int) tests_size;
+}
 
-		thrd_join((*ptr)->tid, &ret);
+static void __zidane_run_all_tests(void)
+{
+	size_t tests_size = &__stop_test_suite_array - &__start_test_suite_array;
+	unsigned int workers_count = __zidane_workers_count(tests_size);
 
-		if (ret != 0) {
-			*tests_failed_count += 1;
-		} else {
-			*tests_passed_count += 1;
+	thrd_t *workers = malloc(workers_count * sizeof(*workers));
+	unsigned int workers_started = 0;
+
+	for (unsigned int i = 0; i < workers_count; ++i) {
+		if (thrd_create(&workers[i], __zidane_worker, &tests_size) != thrd_success) {
+			break;
 		}
+		workers_started += 1;
 	}
+
+	// Without any worker, the main thread takes every test itself
+	if (workers_started == 0) {
+		__zidane_worker(&tests_size);
+	}
+
+	for (unsigned int i = 0; i < workers_started; ++i) {
+		thrd_join(workers[i], NULL);
+	}
+
+	free(workers);
 }
 #else
-static void __zidane_run_all_tests(unsigned int *tests_failed_count,
-				   unsigned int *tests_passed_count)
+static void __zidane_run_all_tests(void)
 {
 	for (struct __zidane_test_fn_container **ptr = &__start_test_suite_array;
 	     ptr < &__stop_test_suite_array; ++ptr) {
-		(*ptr)->f();
-
-		if (__zidane_current_test_failed) {
-			for (unsigned int i = 0; i < __zidane_failure_info_array_size; ++i) {
-				fprintf(stderr, "%s:%d: verify failed: %s.\n",
-					__zidane_failure_info_array[i].file,
-					__zidane_failure_info_array[i].line,
-					__zidane_failure_info_array[i].expression);
-			}
-			printf("Test case \033[31m`%s`\033[0m failed.\n", (*ptr)->s);
-
-			__zidane_current_test_failed = false;
-			__zidane_failure_info_array_size = 0;
-			*tests_failed_count += 1;
-		} else {
-			*tests_passed_count += 1;
+		if ((*ptr)->f) {
+			__zidane_run_test(*ptr);
 		}
 	}
 }
 #endif
 
+static int __zidane_compare_samples(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *) a;
+	uint64_t y = *(const uint64_t *) b;
+
+	return (x > y) - (x < y);
+}
+
+// Prints an amount per second with a decimal prefix, e.g. `12.3 MB/s` or `4.5 Mnodes/s`
+static void __zidane_print_rate(double per_second, const char *unit)
+{
+	static const char prefixes[] = " kMGT";
+
+	unsigned int i = 0;
+	while (per_second >= 1000 && i < sizeof(prefixes) - 2) {
+		per_second /= 1000;
+		i += 1;
+	}
+
+	if (i == 0) {
+		printf(", %0.1f %s/s", per_second, unit);
+	} else {
+		printf(", %0.1f %c%s/s", per_second, prefixes[i], unit);
+	}
+}
+
+// Reports the loop that just finished, and forgets its label and throughput for the next one
+static void __zidane_bench_report(struct zidane_bench *bench)
+{
+	unsigned int samples_size = bench->current - bench->warmup;
+
+	char name[128];
+	if (bench->label[0] != '\0') {
+		snprintf(name, sizeof(name), "%s/%s", bench->name, bench->label);
+	} else {
+		snprintf(name, sizeof(name), "%s", bench->name);
+	}
+
+	qsort(bench->samples, samples_size, sizeof(*bench->samples), __zidane_compare_samples);
+
+	uint64_t median = bench->samples[samples_size / 2];
+
+	printf("  %-40s min ", name);
+	__zidane_print_time(bench->samples[0]);
+	printf(", median ");
+	__zidane_print_time(median);
+	printf(", max ");
+	__zidane_print_time(bench->samples[samples_size - 1]);
+	printf(" (%u iterations)", samples_size);
+
+	if (bench->bytes > 0 && median > 0) {
+		__zidane_print_rate(bench->bytes * 1e9 / median, "B");
+	}
+	if (bench->items > 0 && median > 0) {
+		__zidane_print_rate(bench->items * 1e9 / median, bench->items_unit);
+	}
+	printf("\n");
+
+	bench->label[0] = '\0';
+	bench->bytes = 0;
+	bench->items = 0;
+	bench->loops += 1;
+}
+
+void __zidane_bench_begin(struct zidane_bench *bench, unsigned int warmup,
+			  unsigned int iterations)
+{
+	free(bench->samples);
+
+	bench->warmup = warmup;
+	bench->iterations = iterations > 0 ? iterations : 1;
+	bench->current = 0;
+	bench->samples = malloc(bench->iterations * sizeof(*bench->samples));
+	bench->start_ns = __zidane_now_ns();
+}
+
+// Closes the iteration that is running, if any, and tells whether to run another one. Once the
+// last one is done, the loop is reported.
+bool __zidane_bench_next(struct zidane_bench *bench)
+{
+	uint64_t now = __zidane_now_ns();
+
+	if (bench->current > bench->warmup) {
+		bench->samples[bench->current - bench->warmup - 1] = now - bench->start_ns;
+	}
+
+	if (bench->current == bench->warmup + bench->iterations) {
+		__zidane_bench_report(bench);
+		return false;
+	}
+
+	bench->current += 1;
+	bench->start_ns = __zidane_now_ns();
+
+	return true;
+}
+
+static void __zidane_run_bench(struct __zidane_test_fn_container *test)
+{
+	struct zidane_bench bench = {
+		.name = test->s,
+		.label = "",
+		.bytes = 0,
+		.items = 0,
+		.items_unit = "items",
+		.warmup = 0,
+		.iterations = 0,
+		.current = 0,
+		.start_ns = 0,
+		.samples = NULL,
+		.loops = 0,
+	};
+
+	__zidane_current_test_failed = false;
+	__zidane_failure_info_array_size = 0;
+
+	uint64_t start = __zidane_now_ns();
+	test->b(&bench);
+	test->elapsed_ns = __zidane_now_ns() - start;
+	test->failed = __zidane_current_test_failed;
+
+	for (unsigned int i = 0; i < __zidane_failure_info_array_size; ++i) {
+		fprintf(stderr, "%s:%d: verify failed: %s.\n", __zidane_failure_info_array[i].file,
+			__zidane_failure_info_array[i].line,
+			__zidane_failure_info_array[i].expression);
+	}
+
+	// A benchmark that never got to time anything is a failure too
+	if (test->failed || bench.loops == 0) {
+		printf("Benchmark \033[31m`%s`\033[0m failed.\n", test->s);
+		test->failed = true;
+	}
+
+	free(bench.samples);
+}
+
 #ifndef ZIDANE_INIT
 void zidane_init(void) {}
 #endif
@@ -177,22 +457,27 @@ int main(void)
 	unsigned int tests_failed_count = 0;
 	unsigned int tests_passed_count = 0;
 
-	bool should_time = true;
+	uint64_t start = __zidane_now_ns();
 
-	struct timeval start_tv;
-	if (should_time) {
-		if (gettimeofday(&start_tv, NULL) < 0) {
-			should_time = false;
-		}
-	}
+	__zidane_run_all_tests();
 
-	__zidane_run_all_tests(&tests_failed_count, &tests_passed_count);
+	uint64_t elapsed = __zidane_now_ns() - start;
 
-	struct timeval end_tv;
-	if (should_time) {
-		if (gettimeofday(&end_tv, NULL) < 0) {
-			should_time = false;
+	for (struct __zidane_test_fn_container **ptr = &__start_test_suite_array;
+	     ptr < &__stop_test_suite_array; ++ptr) {
+		if (!(*ptr)->f) {
+			continue;
 		}
+
+		if ((*ptr)->failed) {
+			tests_failed_count += 1;
+		} else {
+			tests_passed_count += 1;
+		}
+
+		printf("  %-40s ", (*ptr)->s);
+		__zidane_print_time((*ptr)->elapsed_ns);
+		printf("%s\n", (*ptr)->failed ? " \033[31mfailed\033[0m" : "");
 	}
 
 	printf("Tests:\t");
@@ -201,23 +486,30 @@ int main(void)
 	printf("\033[32m%u passed, \033[0m", tests_passed_count);
 	printf("%u total\n", tests_failed_count + tests_passed_count);
 
-	if (should_time) {
-		double start_time = (long) start_tv.tv_sec * 1000.0 + start_tv.tv_usec / 1000.0;
-		double end_time = (long) end_tv.tv_sec * 1000.0 + end_tv.tv_usec / 1000.0;
+	printf("Time elapsed: ");
+	__zidane_print_time(elapsed);
+	printf("\n");
 
-		// In milliseconds
-		double elapsed_time = end_time - start_time;
+	unsigned int benches_failed_count = 0;
+	unsigned int benches_count = 0;
 
-		if (elapsed_time > 1000.0) {
-			printf("Time elapsed: %0.3fs\n", elapsed_time / 1000.0);
-		} else {
-			printf("Time elapsed: %0.3fms\n", elapsed_time);
+	if (getenv("ZIDANE_BENCH")) {
+		for (struct __zidane_test_fn_container **ptr = &__start_test_suite_array;
+		     ptr < &__stop_test_suite_array; ++ptr) {
+			if ((*ptr)->b) {
+				__zidane_run_bench(*ptr);
+
+				benches_count += 1;
+				benches_failed_count += (*ptr)->failed;
+			}
 		}
+
+		printf("Benchmarks:\t%u run, %u failed\n", benches_count, benches_failed_count);
 	}
 
 	zidane_deinit();
 
-	return 0;
+	return tests_failed_count > 0 || benches_failed_count > 0;
 }
 
 #endif // ZIDANE_IMPLEMENTATION